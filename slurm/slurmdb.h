@@ -264,6 +264,12 @@ typedef struct {
 					    * without truncating the
 					    * time to the usage_start
 					    * and usage_end */
+	char *cursor_cluster;   /* cluster of the last job of the
+				 * previous page, NULL for the first */
+	uint32_t cursor_jobid;  /* last job id of the previous page */
+	uint32_t page_size;     /* return about this many jobs, starting
+				 * after the cursor, 0 for all. Cleared
+				 * if the slurmdbd can not page jobs */
 } slurmdb_job_cond_t;
 
 /* slurmdb_stats_t needs to be defined before slurmdb_job_rec_t and
@@ -66,6 +66,7 @@
 #include "src/common/log.h"
 #include "src/common/macros.h"
 #include "src/common/read_config.h"
+#include "src/common/sha256.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_protocol_defs.h"
 #include "src/common/slurm_protocol_interface.h"
@@ -79,6 +80,14 @@
 
 #define MAX_THREADS      8	/* These can be huge messages, so
 				 * only run MAX_THREADS at one time */
+#define MAX_PIPELINE	16	/* Most blocks in flight at one time */
+#define MAX_RETRIES	2	/* Resends of a block to nodes whose relay
+				 * failed, only when pipelining */
+
+typedef struct bcast_block {
+	file_bcast_msg_t msg;	/* with its own copy of the block data */
+	struct bcast_parameters *params;
+} bcast_block_t;
 
 int block_len;				/* block size */
 int fd;					/* source file descriptor */
@@ -86,6 +95,11 @@ void *src;				/* source mmap'd address */
 struct stat f_stat;			/* source file stats */
 job_sbcast_cred_msg_t *sbcast_cred;	/* job alloc info and sbcast cred */
 
+static pthread_mutex_t block_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  block_cond  = PTHREAD_COND_INITIALIZER;
+static int block_active = 0;		/* blocks in flight */
+static int block_rc = SLURM_SUCCESS;	/* worst result of sent blocks */
+
 static int   _bcast_file(struct bcast_parameters *params);
 static int   _file_bcast(struct bcast_parameters *params,
 			 file_bcast_msg_t *bcast_msg,
@@ -166,7 +180,10 @@ static int _get_job_info(struct bcast_parameters *params)
 	return rc;
 }
 
-/* Issue the RPC to transfer the file's data */
+/* Issue the RPC to transfer the file's data. When pipelining, nodes which
+ * could not be reached because a relay failed get the block again through
+ * a new forwarding tree. slurmd writes each block at its own offset, so a
+ * block received twice does no harm. */
 static int _file_bcast(struct bcast_parameters *params,
 		       file_bcast_msg_t *bcast_msg,
 		       job_sbcast_cred_msg_t *sbcast_cred)
@@ -174,12 +191,84 @@ static int _file_bcast(struct bcast_parameters *params,
 	List ret_list = NULL;
 	ListIterator itr;
 	ret_data_info_t *ret_data_info = NULL;
-	int rc = 0, msg_rc;
+	hostlist_t retry_hl = NULL;
+	char *node_list = sbcast_cred->node_list;
+	int rc = 0, msg_rc, retry = 0;
+	slurm_msg_t msg;
+
+	while (1) {
+		slurm_msg_t_init(&msg);
+		msg.data = bcast_msg;
+		msg.msg_type = REQUEST_FILE_BCAST;
+
+		ret_list = slurm_send_recv_msgs(
+			node_list, &msg, params->timeout, true);
+		if (ret_list == NULL) {
+			error("slurm_send_recv_msgs: %m");
+			exit(1);
+		}
+
+		itr = list_iterator_create(ret_list);
+		while ((ret_data_info = list_next(itr))) {
+			msg_rc = slurm_get_return_code(ret_data_info->type,
+						       ret_data_info->data);
+			if (msg_rc == SLURM_SUCCESS)
+				continue;
+
+			if ((params->pipeline > 1) && (retry < MAX_RETRIES) &&
+			    (ret_data_info->type == RESPONSE_FORWARD_FAILED) &&
+			    ret_data_info->node_name) {
+				if (!retry_hl)
+					retry_hl = hostlist_create(NULL);
+				hostlist_push_host(retry_hl,
+						   ret_data_info->node_name);
+				continue;
+			}
+			error("REQUEST_FILE_BCAST(%s): %s",
+			      ret_data_info->node_name,
+			      slurm_strerror(msg_rc));
+			rc = MAX(rc, msg_rc);
+		}
+		list_iterator_destroy(itr);
+		FREE_NULL_LIST(ret_list);
+
+		if (node_list != sbcast_cred->node_list)
+			xfree(node_list);
+		if (!retry_hl)
+			break;
+		node_list = hostlist_ranged_string_xmalloc(retry_hl);
+		hostlist_destroy(retry_hl);
+		retry_hl = NULL;
+		retry++;
+		verbose("block %u: resending to %s",
+			bcast_msg->block_no, node_list);
+	}
+
+	return rc;
+}
+
+/*
+ * Send the first block, which registers the file, as
+ * REQUEST_FILE_BCAST_PIPELINE. A slurmd which does not understand it writes
+ * blocks in the order received, so the block is sent to it again as
+ * REQUEST_FILE_BCAST and the rest of the file one block at a time. Nodes
+ * cut off by a failed relay are treated the same way, as they could not be
+ * asked.
+ */
+static int _file_bcast_pipeline_start(struct bcast_parameters *params,
+				      file_bcast_msg_t *bcast_msg)
+{
+	List ret_list = NULL;
+	ListIterator itr;
+	ret_data_info_t *ret_data_info = NULL;
+	job_sbcast_cred_msg_t retry_cred;
+	hostlist_t retry_hl;
 	slurm_msg_t msg;
+	int rc = SLURM_SUCCESS, msg_rc;
 
 	slurm_msg_t_init(&msg);
 	msg.data = bcast_msg;
-	msg.msg_type = REQUEST_FILE_BCAST;
+	msg.msg_type = REQUEST_FILE_BCAST_PIPELINE;
 
 	ret_list = slurm_send_recv_msgs(
 		sbcast_cred->node_list, &msg, params->timeout, true);
@@ -188,29 +277,190 @@ static int _file_bcast(struct bcast_parameters *params,
 		exit(1);
 	}
 
+	retry_hl = hostlist_create(NULL);
 	itr = list_iterator_create(ret_list);
 	while ((ret_data_info = list_next(itr))) {
 		msg_rc = slurm_get_return_code(ret_data_info->type,
 					       ret_data_info->data);
 		if (msg_rc == SLURM_SUCCESS)
 			continue;
-
+		if (((msg_rc == ESLURM_PROTOCOL_INCOMPLETE_PACKET) ||
+		     (ret_data_info->type == RESPONSE_FORWARD_FAILED)) &&
+		    ret_data_info->node_name) {
+			hostlist_push_host(retry_hl, ret_data_info->node_name);
+			continue;
+		}
 		error("REQUEST_FILE_BCAST(%s): %s",
-		      ret_data_info->node_name,
-		      slurm_strerror(msg_rc));
+		      ret_data_info->node_name, slurm_strerror(msg_rc));
 		rc = MAX(rc, msg_rc);
 	}
 	list_iterator_destroy(itr);
 	FREE_NULL_LIST(ret_list);
 
+	if ((rc == SLURM_SUCCESS) && hostlist_count(retry_hl)) {
+		hostlist_uniq(retry_hl);
+		memcpy(&retry_cred, sbcast_cred, sizeof(retry_cred));
+		retry_cred.node_list = hostlist_ranged_string_xmalloc(retry_hl);
+		verbose("%s can't take blocks out of order, sending one "
+			"block at a time", retry_cred.node_list);
+		params->pipeline = 1;
+		rc = _file_bcast(params, bcast_msg, &retry_cred);
+		xfree(retry_cred.node_list);
+	}
+	hostlist_destroy(retry_hl);
+
+	return rc;
+}
+
+/*
+ * Ask the nodes to install the file from their sbcast cache, then only
+ * send the file's data to the nodes which did not. Nodes which miss the
+ * cache add the file to it once its data has been received.
+ * RET count of nodes which still need the data
+ */
+static int _bcast_cached(struct bcast_parameters *params,
+			 file_bcast_msg_t *bcast_msg)
+{
+	List ret_list = NULL;
+	ListIterator itr;
+	ret_data_info_t *ret_data_info = NULL;
+	hostlist_t miss_hl;
+	slurm_msg_t msg;
+	int miss_cnt;
+	bool unknown_miss = false;
+	char *hash_str;
+	DEF_TIMERS;
+
+	START_TIMER;
+	bcast_hash_data(src, f_stat.st_size, bcast_msg->file_hash);
+	END_TIMER;
+	hash_str = bcast_hash_str(bcast_msg->file_hash);
+	verbose("file hash %s computed in %s", hash_str, TIME_STR);
+	xfree(hash_str);
+
+	slurm_msg_t_init(&msg);
+	msg.data = bcast_msg;
+	msg.msg_type = REQUEST_FILE_BCAST_CACHED;
+
+	ret_list = slurm_send_recv_msgs(
+		sbcast_cred->node_list, &msg, params->timeout, true);
+	if (ret_list == NULL) {
+		error("slurm_send_recv_msgs: %m");
+		exit(1);
+	}
+
+	/* Any failure, including from a slurmd without a cache, is
+	 * treated as a miss and reported by the transfer which follows */
+	miss_hl = hostlist_create(NULL);
+	itr = list_iterator_create(ret_list);
+	while ((ret_data_info = list_next(itr))) {
+		if (slurm_get_return_code(ret_data_info->type,
+					  ret_data_info->data) ==
+		    SLURM_SUCCESS)
+			continue;
+		if (!ret_data_info->node_name) {
+			/* Can't tell which node missed, send to them all */
+			unknown_miss = true;
+			continue;
+		}
+		hostlist_push_host(miss_hl, ret_data_info->node_name);
+	}
+	list_iterator_destroy(itr);
+	FREE_NULL_LIST(ret_list);
+
+	if (unknown_miss) {
+		hostlist_destroy(miss_hl);
+		verbose("unidentified node missed the file cache");
+		return sbcast_cred->node_cnt;
+	}
+
+	miss_cnt = hostlist_count(miss_hl);
+	verbose("file found in the cache of %u of %u nodes",
+		sbcast_cred->node_cnt - miss_cnt, sbcast_cred->node_cnt);
+	if (miss_cnt) {
+		hostlist_uniq(miss_hl);
+		xfree(sbcast_cred->node_list);
+		sbcast_cred->node_list =
+			hostlist_ranged_string_xmalloc(miss_hl);
+		sbcast_cred->node_cnt = hostlist_count(miss_hl);
+	}
+	hostlist_destroy(miss_hl);
+
+	return miss_cnt;
+}
+
+static void *_bcast_block_thr(void *arg)
+{
+	bcast_block_t *block = (bcast_block_t *) arg;
+	int rc;
+
+	rc = _file_bcast(block->params, &block->msg, sbcast_cred);
+
+	slurm_mutex_lock(&block_mutex);
+	block_rc = MAX(block_rc, rc);
+	block_active--;
+	pthread_cond_broadcast(&block_cond);
+	slurm_mutex_unlock(&block_mutex);
+
+	xfree(block->msg.block);
+	xfree(block);
+	return NULL;
+}
+
+/* Wait until no more than max_active blocks are in flight,
+ * RET the worst result of the blocks sent so far */
+static int _wait_blocks(int max_active)
+{
+	int rc;
+
+	slurm_mutex_lock(&block_mutex);
+	while (block_active > max_active)
+		pthread_cond_wait(&block_cond, &block_mutex);
+	rc = block_rc;
+	slurm_mutex_unlock(&block_mutex);
+
 	return rc;
 }
 
+/* Send a block from its own thread, once fewer than params->pipeline
+ * blocks are in flight */
+static int _file_bcast_async(struct bcast_parameters *params,
+			     file_bcast_msg_t *bcast_msg)
+{
+	bcast_block_t *block;
+	pthread_attr_t attr;
+	pthread_t thread_id;
+	int rc;
+
+	if ((rc = _wait_blocks(params->pipeline - 1)) != SLURM_SUCCESS)
+		return rc;
+
+	block = xmalloc(sizeof(bcast_block_t));
+	memcpy(&block->msg, bcast_msg, sizeof(file_bcast_msg_t));
+	block->msg.block = xmalloc(bcast_msg->block_len);
+	memcpy(block->msg.block, bcast_msg->block, bcast_msg->block_len);
+	block->params = params;
+
+	slurm_mutex_lock(&block_mutex);
+	block_active++;
+	slurm_mutex_unlock(&block_mutex);
+
+	slurm_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if (pthread_create(&thread_id, &attr, _bcast_block_thr, block)) {
+		error("pthread_create: %m");
+		_bcast_block_thr(block);
+	}
+	slurm_attr_destroy(&attr);
+
+	return SLURM_SUCCESS;
+}
+
 /* load a buffer with data from the file to broadcast,
  * return number of bytes read, zero on end of file */
 static int _get_block_none(char **buffer, int *orig_len, bool *more)
 {
-	static int remaining = -1;
+	static int64_t remaining = -1;
 	static void *position;
 	int size;
 
@@ -240,7 +490,7 @@ static int _get_block_zlib(struct bcast_parameters *params,
 	int chunk = (256 * 1024);
 	int flush = Z_NO_FLUSH;
 
-	static int remaining = -1;
+	static int64_t remaining = -1;
 	static int max_out;
 	static void *position;
 	int chunk_remaining, out_remaining, chunk_bite, size = 0;
@@ -307,7 +557,7 @@ static int _get_block_lz4(struct bcast_parameters *params,
 {
 #if HAVE_LZ4
 	int size_out;
-	static int remaining = -1;
+	static int64_t remaining = -1;
 	static void *position;
 	int size;
 
@@ -401,6 +651,13 @@ static int _bcast_file(struct bcast_parameters *params)
 	if (!params->fanout)
 		params->fanout = MAX_THREADS;
 	slurm_set_tree_width(MIN(MAX_THREADS, params->fanout));
+	params->pipeline = MIN(params->pipeline, MAX_PIPELINE);
+
+	if (params->cache && f_stat.st_size &&
+	    (_bcast_cached(params, &bcast_msg) == 0)) {
+		xfree(bcast_msg.user_name);
+		return SLURM_SUCCESS;
+	}
 
 	while (more) {
 		START_TIMER;
@@ -418,7 +675,21 @@ static int _bcast_file(struct bcast_parameters *params)
 		if (!more)
 			bcast_msg.last_block = 1;
 
-		rc = _file_bcast(params, &bcast_msg, sbcast_cred);
+		/* The first block registers the file and the last one
+		 * closes it, so those are sent after all others complete */
+		if ((params->pipeline > 1) && (bcast_msg.block_no > 1) &&
+		    !bcast_msg.last_block) {
+			rc = _file_bcast_async(params, &bcast_msg);
+		} else if ((params->pipeline > 1) &&
+			   !bcast_msg.last_block) {
+			rc = _file_bcast_pipeline_start(params, &bcast_msg);
+		} else {
+			if (params->pipeline > 1)
+				rc = _wait_blocks(0);
+			if (rc == SLURM_SUCCESS)
+				rc = _file_bcast(params, &bcast_msg,
+						 sbcast_cred);
+		}
 		if (rc != SLURM_SUCCESS)
 			break;
 		if (bcast_msg.last_block)
@@ -426,6 +697,8 @@ static int _bcast_file(struct bcast_parameters *params)
 		bcast_msg.block_no++;
 		bcast_msg.block_offset += orig_len;
 	}
+	if (params->pipeline > 1)
+		(void) _wait_blocks(0);
 	xfree(bcast_msg.user_name);
 	xfree(buffer);
 
@@ -543,6 +816,21 @@ extern int bcast_file(struct bcast_parameters *params)
 	return rc;
 }
 
+extern void bcast_hash_data(void *data, uint64_t len, uint8_t *hash)
+{
+	sha256(data, len, hash);
+}
+
+extern char *bcast_hash_str(uint8_t *hash)
+{
+	char *str = NULL;
+	int i;
+
+	for (i = 0; i < SHA256_LEN; i++)
+		xstrfmtcat(str, "%02x", hash[i]);
+	return str;
+}
+
 extern int bcast_decompress_data(file_bcast_msg_t *req)
 {
 	switch(req->compress) {
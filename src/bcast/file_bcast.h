@@ -46,11 +46,13 @@
 
 struct bcast_parameters {
 	uint32_t block_size;
+	bool cache;		/* install from the sbcast cache of slurmd */
 	uint16_t compress;
 	char *dst_fname;
 	int fanout;
 	bool force;
 	uint32_t job_id;
+	int pipeline;		/* blocks in flight, 0 or 1 for one at a time */
 	bool preserve;
 	char *src_fname;
 	uint32_t step_id;
@@ -58,10 +60,15 @@ struct bcast_parameters {
 	int verbose;
 };
 
+struct bcast_cache_file;
+
 typedef struct file_bcast_info {
+	struct bcast_cache_file *cache;	/* copy added to the slurmd cache */
+	bool complete;		/* last block was written */
 	void *data;		/* mmap of file data */
 	int fd;			/* file descriptor */
 	uint64_t file_size;	/* file size */
+	uint64_t max_offset;	/* end of the furthest block written */
 	char *fname;		/* filename */
 	gid_t gid;		/* gid of owner */
 	uint32_t job_id;	/* job id */
@@ -75,4 +82,11 @@ extern int bcast_file(struct bcast_parameters *params);
 
 extern int bcast_decompress_data(file_bcast_msg_t *req);
 
+/* Compute the SHA-256 of a file's contents, which identifies it in the
+ * sbcast cache of slurmd, writing SHA256_LEN bytes to hash */
+extern void bcast_hash_data(void *data, uint64_t len, uint8_t *hash);
+
+/* Format a hash from bcast_hash_data() in hex, xfree() the result */
+extern char *bcast_hash_str(uint8_t *hash);
+
 #endif
@@ -51,6 +51,27 @@
 
 #define ASSOC_HASH_SIZE 1000
 #define ASSOC_HASH_ID_INX(_assoc_id)	(_assoc_id % ASSOC_HASH_SIZE)
+#define USER_HASH_SIZE 1000
+#define QOS_HASH_SIZE 100
+
+/* Entry of the hash tables indexing the user and qos lists */
+typedef struct assoc_mgr_hash_ent {
+	struct assoc_mgr_hash_ent *next;
+	void *rec;
+} assoc_mgr_hash_ent_t;
+
+/* Sections of the assoc_mgr_state file, in the order they are written */
+enum {
+	STATE_TRES,
+	STATE_USERS,
+	STATE_RES,
+	STATE_QOS,
+	STATE_WCKEYS,
+	/* this needs to be done last so qos is set up
+	 * before hand when loading it back */
+	STATE_ASSOCS,
+	STATE_SECTION_CNT
+};
 
 slurmdb_assoc_rec_t *assoc_mgr_root_assoc = NULL;
 uint32_t g_qos_max_priority = 0;
@@ -73,6 +94,17 @@ static assoc_mgr_lock_flags_t assoc_mgr_locks;
 static assoc_init_args_t init_setup;
 static slurmdb_assoc_rec_t **assoc_hash_id = NULL;
 static slurmdb_assoc_rec_t **assoc_hash = NULL;
+static assoc_mgr_hash_ent_t **user_hash_uid = NULL;
+static assoc_mgr_hash_ent_t **user_hash_name = NULL;
+static assoc_mgr_hash_ent_t **qos_hash_id = NULL;
+static assoc_mgr_hash_ent_t **qos_hash_name = NULL;
+/*
+ * Packed copy of each list in assoc_mgr_state, NULL once the list changed.
+ * Each one is protected by the lock of its list.
+ */
+static Buf state_section[STATE_SECTION_CNT];
+/* assoc_mgr_state matches state_section, protected by the file lock */
+static bool state_file_current = false;
 
 static pthread_mutex_t locks_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t locks_cond = PTHREAD_COND_INITIALIZER;
@@ -309,6 +341,232 @@ static void _delete_assoc_hash(slurmdb_assoc_rec_t *assoc)
 		*assoc_pptr = assoc_ptr->assoc_next;
 }
 
+/*
+ * Note a list changed so dump_assoc_mgr_state() packs it again, the write
+ * lock of the list must be held.
+ */
+static void _state_changed(int section)
+{
+	if (state_section[section]) {
+		free_buf(state_section[section]);
+		state_section[section] = NULL;
+	}
+}
+
+/* ListFindF matching the record given as key itself */
+static int _find_rec_ptr(void *x, void *key)
+{
+	return (x == key);
+}
+
+static int _name_hash_index(char *name, int hash_size)
+{
+	int index = _get_str_inx(name) % hash_size;
+
+	if (index < 0)
+		index += hash_size;
+
+	return index;
+}
+
+/*
+ * Add rec at the end of its chain so lookups return the same record a walk
+ * of the list would when two records share a key.
+ */
+static void _add_hash_ent(assoc_mgr_hash_ent_t ***hash, int hash_size,
+			  int inx, void *rec)
+{
+	assoc_mgr_hash_ent_t **ent_pptr;
+
+	if (!*hash)
+		*hash = xmalloc(hash_size * sizeof(assoc_mgr_hash_ent_t *));
+
+	ent_pptr = &(*hash)[inx];
+	while (*ent_pptr)
+		ent_pptr = &(*ent_pptr)->next;
+
+	*ent_pptr = xmalloc(sizeof(assoc_mgr_hash_ent_t));
+	(*ent_pptr)->rec = rec;
+}
+
+static void _delete_hash_ent(assoc_mgr_hash_ent_t **hash, int inx, void *rec)
+{
+	assoc_mgr_hash_ent_t **ent_pptr, *ent_ptr;
+
+	if (!hash)
+		return;
+
+	ent_pptr = &hash[inx];
+	while ((ent_ptr = *ent_pptr)) {
+		if (ent_ptr->rec == rec) {
+			*ent_pptr = ent_ptr->next;
+			xfree(ent_ptr);
+			return;
+		}
+		ent_pptr = &ent_ptr->next;
+	}
+}
+
+static void _free_hash(assoc_mgr_hash_ent_t ***hash, int hash_size)
+{
+	assoc_mgr_hash_ent_t *ent_ptr, *next_ptr;
+	int i;
+
+	if (!*hash)
+		return;
+
+	for (i = 0; i < hash_size; i++) {
+		for (ent_ptr = (*hash)[i]; ent_ptr; ent_ptr = next_ptr) {
+			next_ptr = ent_ptr->next;
+			xfree(ent_ptr);
+		}
+	}
+	xfree(*hash);
+}
+
+/* Users without a uid are only indexed by name */
+static void _add_user_hash(slurmdb_user_rec_t *user)
+{
+	if (user->uid != NO_VAL)
+		_add_hash_ent(&user_hash_uid, USER_HASH_SIZE,
+			      user->uid % USER_HASH_SIZE, user);
+	if (user->name)
+		_add_hash_ent(&user_hash_name, USER_HASH_SIZE,
+			      _name_hash_index(user->name, USER_HASH_SIZE),
+			      user);
+}
+
+static void _delete_user_hash(slurmdb_user_rec_t *user)
+{
+	if (user->uid != NO_VAL)
+		_delete_hash_ent(user_hash_uid,
+				 user->uid % USER_HASH_SIZE, user);
+	if (user->name)
+		_delete_hash_ent(user_hash_name,
+				 _name_hash_index(user->name, USER_HASH_SIZE),
+				 user);
+}
+
+/* locks should be put in place before calling this function USER_WRITE */
+static void _rebuild_user_hash(void)
+{
+	slurmdb_user_rec_t *user;
+	ListIterator itr;
+
+	_free_hash(&user_hash_uid, USER_HASH_SIZE);
+	_free_hash(&user_hash_name, USER_HASH_SIZE);
+
+	if (!assoc_mgr_user_list)
+		return;
+
+	itr = list_iterator_create(assoc_mgr_user_list);
+	while ((user = list_next(itr)))
+		_add_user_hash(user);
+	list_iterator_destroy(itr);
+}
+
+/*
+ * _find_user_rec - return a pointer to the user record with the uid of
+ *	user, or with its name when the uid is not set
+ * IN user - requested user info
+ * RET pointer to the user's record, NULL if not found
+ */
+static slurmdb_user_rec_t *_find_user_rec(slurmdb_user_rec_t *user)
+{
+	assoc_mgr_hash_ent_t *ent_ptr;
+	slurmdb_user_rec_t *user_ptr;
+
+	if (user->uid != NO_VAL) {
+		if (!user_hash_uid)
+			return NULL;
+		for (ent_ptr = user_hash_uid[user->uid % USER_HASH_SIZE];
+		     ent_ptr; ent_ptr = ent_ptr->next) {
+			user_ptr = ent_ptr->rec;
+			if (user_ptr->uid == user->uid)
+				return user_ptr;
+		}
+	} else if (user->name && user_hash_name) {
+		for (ent_ptr = user_hash_name[
+			     _name_hash_index(user->name, USER_HASH_SIZE)];
+		     ent_ptr; ent_ptr = ent_ptr->next) {
+			user_ptr = ent_ptr->rec;
+			if (!xstrcasecmp(user_ptr->name, user->name))
+				return user_ptr;
+		}
+	}
+
+	return NULL;
+}
+
+static void _add_qos_hash(slurmdb_qos_rec_t *qos)
+{
+	_add_hash_ent(&qos_hash_id, QOS_HASH_SIZE, qos->id % QOS_HASH_SIZE,
+		      qos);
+	if (qos->name)
+		_add_hash_ent(&qos_hash_name, QOS_HASH_SIZE,
+			      _name_hash_index(qos->name, QOS_HASH_SIZE), qos);
+}
+
+static void _delete_qos_hash(slurmdb_qos_rec_t *qos)
+{
+	_delete_hash_ent(qos_hash_id, qos->id % QOS_HASH_SIZE, qos);
+	if (qos->name)
+		_delete_hash_ent(qos_hash_name,
+				 _name_hash_index(qos->name, QOS_HASH_SIZE),
+				 qos);
+}
+
+/* locks should be put in place before calling this function QOS_WRITE */
+static void _rebuild_qos_hash(void)
+{
+	slurmdb_qos_rec_t *qos;
+	ListIterator itr;
+
+	_free_hash(&qos_hash_id, QOS_HASH_SIZE);
+	_free_hash(&qos_hash_name, QOS_HASH_SIZE);
+
+	if (!assoc_mgr_qos_list)
+		return;
+
+	itr = list_iterator_create(assoc_mgr_qos_list);
+	while ((qos = list_next(itr)))
+		_add_qos_hash(qos);
+	list_iterator_destroy(itr);
+}
+
+/*
+ * _find_qos_rec - return a pointer to the qos record with the id of qos, or
+ *	with its name
+ * IN qos - requested qos info
+ * RET pointer to the qos' record, NULL if not found
+ */
+static slurmdb_qos_rec_t *_find_qos_rec(slurmdb_qos_rec_t *qos)
+{
+	assoc_mgr_hash_ent_t *ent_ptr;
+	slurmdb_qos_rec_t *qos_ptr;
+
+	if (qos_hash_id) {
+		for (ent_ptr = qos_hash_id[qos->id % QOS_HASH_SIZE];
+		     ent_ptr; ent_ptr = ent_ptr->next) {
+			qos_ptr = ent_ptr->rec;
+			if (qos_ptr->id == qos->id)
+				return qos_ptr;
+		}
+	}
+
+	if (qos->name && qos_hash_name) {
+		for (ent_ptr = qos_hash_name[
+			     _name_hash_index(qos->name, QOS_HASH_SIZE)];
+		     ent_ptr; ent_ptr = ent_ptr->next) {
+			qos_ptr = ent_ptr->rec;
+			if (!xstrcasecmp(qos_ptr->name, qos->name))
+				return qos_ptr;
+		}
+	}
+
+	return NULL;
+}
+
 
 static void _normalize_assoc_shares_fair_tree(
 	slurmdb_assoc_rec_t *assoc)
@@ -499,6 +757,8 @@ static int _change_user_name(slurmdb_user_rec_t *user)
 	} else
 		user->uid = pw_uid;
 
+	_state_changed(STATE_ASSOCS);
+	_state_changed(STATE_WCKEYS);
 	if (assoc_mgr_assoc_list) {
 		itr = list_iterator_create(assoc_mgr_assoc_list);
 		while ((assoc = list_next(itr))) {
@@ -649,6 +909,7 @@ static void _set_user_default_acct(slurmdb_assoc_rec_t *assoc)
 				user->default_acct = xstrdup(assoc->acct);
 				debug2("user %s default acct is %s",
 				       user->name, user->default_acct);
+				_state_changed(STATE_USERS);
 			}
 			break;
 		}
@@ -677,6 +938,7 @@ static void _set_user_default_wckey(slurmdb_wckey_rec_t *wckey)
 				user->default_wckey = xstrdup(wckey->name);
 				debug2("user %s default wckey is %s",
 				       user->name, user->default_wckey);
+				_state_changed(STATE_USERS);
 			}
 			break;
 		}
@@ -917,6 +1179,7 @@ static int _post_assoc_list(void)
 	if (!assoc_mgr_assoc_list)
 		return SLURM_ERROR;
 
+	_state_changed(STATE_ASSOCS);
 	xfree(assoc_hash_id);
 	xfree(assoc_hash);
 
@@ -1171,6 +1434,7 @@ static int _post_tres_list(List new_list, int new_cnt)
 
 	FREE_NULL_LIST(assoc_mgr_tres_list);
 	assoc_mgr_tres_list = new_list;
+	_state_changed(STATE_TRES);
 	new_list = NULL;
 
 	g_tres_count = new_cnt;
@@ -1406,6 +1670,7 @@ static int _get_assoc_mgr_assoc_list(void *db_conn, int enforce)
 //	DEF_TIMERS;
 	assoc_mgr_lock(&locks);
 	FREE_NULL_LIST(assoc_mgr_assoc_list);
+	_state_changed(STATE_ASSOCS);
 
 	memset(&assoc_q, 0, sizeof(slurmdb_assoc_cond_t));
 	if (assoc_mgr_cluster_name) {
@@ -1457,6 +1722,7 @@ static int _get_assoc_mgr_res_list(void *db_conn, int enforce)
 
 	assoc_mgr_lock(&locks);
 	FREE_NULL_LIST(assoc_mgr_res_list);
+	_state_changed(STATE_RES);
 
 	slurmdb_init_res_cond(&res_q, 0);
 	if (assoc_mgr_cluster_name) {
@@ -1511,10 +1777,12 @@ static int _get_assoc_mgr_qos_list(void *db_conn, int enforce)
 	assoc_mgr_lock(&locks);
 
 	FREE_NULL_LIST(assoc_mgr_qos_list);
+	_state_changed(STATE_QOS);
 	assoc_mgr_qos_list = new_list;
 	new_list = NULL;
 
 	_post_qos_list(assoc_mgr_qos_list);
+	_rebuild_qos_hash();
 
 	assoc_mgr_unlock(&locks);
 
@@ -1533,9 +1801,11 @@ static int _get_assoc_mgr_user_list(void *db_conn, int enforce)
 
 	assoc_mgr_lock(&locks);
 	FREE_NULL_LIST(assoc_mgr_user_list);
+	_state_changed(STATE_USERS);
 	assoc_mgr_user_list = acct_storage_g_get_users(db_conn, uid, &user_q);
 
 	if (!assoc_mgr_user_list) {
+		_rebuild_user_hash();
 		assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_ASSOCS) {
 			error("_get_assoc_mgr_user_list: "
@@ -1547,6 +1817,7 @@ static int _get_assoc_mgr_user_list(void *db_conn, int enforce)
 	}
 
 	_post_user_list(assoc_mgr_user_list);
+	_rebuild_user_hash();
 
 	assoc_mgr_unlock(&locks);
 	return SLURM_SUCCESS;
@@ -1563,6 +1834,7 @@ static int _get_assoc_mgr_wckey_list(void *db_conn, int enforce)
 //	DEF_TIMERS;
 	assoc_mgr_lock(&locks);
 	FREE_NULL_LIST(assoc_mgr_wckey_list);
+	_state_changed(STATE_WCKEYS);
 
 	memset(&wckey_q, 0, sizeof(slurmdb_wckey_cond_t));
 	if (assoc_mgr_cluster_name) {
@@ -1733,6 +2005,7 @@ static int _refresh_assoc_mgr_res_list(void *db_conn, int enforce)
 	_post_res_list(current_res);
 
 	FREE_NULL_LIST(assoc_mgr_res_list);
+	_state_changed(STATE_RES);
 
 	assoc_mgr_res_list = current_res;
 
@@ -1763,8 +2036,10 @@ static int _refresh_assoc_mgr_qos_list(void *db_conn, int enforce)
 	assoc_mgr_lock(&locks);
 
 	FREE_NULL_LIST(assoc_mgr_qos_list);
+	_state_changed(STATE_QOS);
 
 	assoc_mgr_qos_list = current_qos;
+	_rebuild_qos_hash();
 
 	assoc_mgr_unlock(&locks);
 
@@ -1797,8 +2072,10 @@ static int _refresh_assoc_mgr_user_list(void *db_conn, int enforce)
 	assoc_mgr_lock(&locks);
 
 	FREE_NULL_LIST(assoc_mgr_user_list);
+	_state_changed(STATE_USERS);
 
 	assoc_mgr_user_list = current_users;
+	_rebuild_user_hash();
 
 	assoc_mgr_unlock(&locks);
 
@@ -1840,6 +2117,7 @@ static int _refresh_assoc_wckey_list(void *db_conn, int enforce)
 
 	assoc_mgr_lock(&locks);
 	FREE_NULL_LIST(assoc_mgr_wckey_list);
+	_state_changed(STATE_WCKEYS);
 
 	assoc_mgr_wckey_list = current_wckeys;
 	assoc_mgr_unlock(&locks);
@@ -2002,9 +2280,10 @@ extern int assoc_mgr_init(void *db_conn, assoc_init_args_t *args,
 
 extern int assoc_mgr_fini(char *state_save_location)
 {
-	assoc_mgr_lock_t locks = { WRITE_LOCK, NO_LOCK, WRITE_LOCK,
+	assoc_mgr_lock_t locks = { WRITE_LOCK, WRITE_LOCK, WRITE_LOCK,
 				   WRITE_LOCK, WRITE_LOCK, WRITE_LOCK,
 				   WRITE_LOCK };
+	int i;
 
 	if (state_save_location)
 		dump_assoc_mgr_state(state_save_location);
@@ -2018,13 +2297,15 @@ extern int assoc_mgr_fini(char *state_save_location)
 	FREE_NULL_LIST(assoc_mgr_user_list);
 	FREE_NULL_LIST(assoc_mgr_wckey_list);
 	if (assoc_mgr_tres_name_array) {
-		int i;
 		for (i=0; i<g_tres_count; i++)
 			xfree(assoc_mgr_tres_name_array[i]);
 		xfree(assoc_mgr_tres_name_array);
 	}
 	xfree(assoc_mgr_tres_array);
 	xfree(assoc_mgr_cluster_name);
+	for (i = 0; i < STATE_SECTION_CNT; i++)
+		_state_changed(i);
+	state_file_current = false;
 	assoc_mgr_assoc_list = NULL;
 	assoc_mgr_res_list = NULL;
 	assoc_mgr_qos_list = NULL;
@@ -2036,6 +2317,10 @@ extern int assoc_mgr_fini(char *state_save_location)
 
 	xfree(assoc_hash_id);
 	xfree(assoc_hash);
+	_free_hash(&user_hash_uid, USER_HASH_SIZE);
+	_free_hash(&user_hash_name, USER_HASH_SIZE);
+	_free_hash(&qos_hash_id, QOS_HASH_SIZE);
+	_free_hash(&qos_hash_name, QOS_HASH_SIZE);
 
 	assoc_mgr_unlock(&locks);
 
@@ -2484,7 +2769,6 @@ extern int assoc_mgr_fill_in_user(void *db_conn, slurmdb_user_rec_t *user,
 				  int enforce,
 				  slurmdb_user_rec_t **user_pptr)
 {
-	ListIterator itr = NULL;
 	slurmdb_user_rec_t * found_user = NULL;
 	assoc_mgr_lock_t locks = { NO_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
 				   NO_LOCK, READ_LOCK, NO_LOCK };
@@ -2502,18 +2786,7 @@ extern int assoc_mgr_fill_in_user(void *db_conn, slurmdb_user_rec_t *user,
 		return SLURM_SUCCESS;
 	}
 
-	itr = list_iterator_create(assoc_mgr_user_list);
-	while ((found_user = list_next(itr))) {
-		if (user->uid != NO_VAL) {
-			if (user->uid == found_user->uid)
-				break;
-		} else if (user->name
-			   && !xstrcasecmp(user->name, found_user->name))
-			break;
-	}
-	list_iterator_destroy(itr);
-
-	if (!found_user) {
+	if (!(found_user = _find_user_rec(user))) {
 		assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_ASSOCS)
 			return SLURM_ERROR;
@@ -2554,7 +2827,6 @@ extern int assoc_mgr_fill_in_qos(void *db_conn, slurmdb_qos_rec_t *qos,
 				 int enforce,
 				 slurmdb_qos_rec_t **qos_pptr, bool locked)
 {
-	ListIterator itr = NULL;
 	slurmdb_qos_rec_t * found_qos = NULL;
 	assoc_mgr_lock_t locks = { NO_LOCK, NO_LOCK, READ_LOCK, NO_LOCK,
 				   NO_LOCK, NO_LOCK, NO_LOCK };
@@ -2588,16 +2860,7 @@ extern int assoc_mgr_fill_in_qos(void *db_conn, slurmdb_qos_rec_t *qos,
 		return SLURM_SUCCESS;
 	}
 
-	itr = list_iterator_create(assoc_mgr_qos_list);
-	while ((found_qos = list_next(itr))) {
-		if (qos->id == found_qos->id)
-			break;
-		else if (qos->name && !xstrcasecmp(qos->name, found_qos->name))
-			break;
-	}
-	list_iterator_destroy(itr);
-
-	if (!found_qos) {
+	if (!(found_qos = _find_qos_rec(qos))) {
 		if (!locked)
 			assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_QOS)
@@ -2861,7 +3124,7 @@ extern int assoc_mgr_fill_in_wckey(void *db_conn, slurmdb_wckey_rec_t *wckey,
 extern slurmdb_admin_level_t assoc_mgr_get_admin_level(void *db_conn,
 						       uint32_t uid)
 {
-	ListIterator itr = NULL;
+	slurmdb_user_rec_t user;
 	slurmdb_user_rec_t * found_user = NULL;
 	assoc_mgr_lock_t locks = { NO_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
 				   NO_LOCK, READ_LOCK, NO_LOCK };
@@ -2876,12 +3139,9 @@ extern slurmdb_admin_level_t assoc_mgr_get_admin_level(void *db_conn,
 		return SLURMDB_ADMIN_NOTSET;
 	}
 
-	itr = list_iterator_create(assoc_mgr_user_list);
-	while ((found_user = list_next(itr))) {
-		if (uid == found_user->uid)
-			break;
-	}
-	list_iterator_destroy(itr);
+	memset(&user, 0, sizeof(slurmdb_user_rec_t));
+	user.uid = uid;
+	found_user = _find_user_rec(&user);
 	assoc_mgr_unlock(&locks);
 
 	if (found_user)
@@ -2896,6 +3156,7 @@ extern bool assoc_mgr_is_user_acct_coord(void *db_conn,
 {
 	ListIterator itr = NULL;
 	slurmdb_coord_rec_t *acct = NULL;
+	slurmdb_user_rec_t user;
 	slurmdb_user_rec_t * found_user = NULL;
 	assoc_mgr_lock_t locks = { NO_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
 				   NO_LOCK, READ_LOCK, NO_LOCK };
@@ -2913,12 +3174,9 @@ extern bool assoc_mgr_is_user_acct_coord(void *db_conn,
 		return false;
 	}
 
-	itr = list_iterator_create(assoc_mgr_user_list);
-	while ((found_user = list_next(itr))) {
-		if (uid == found_user->uid)
-			break;
-	}
-	list_iterator_destroy(itr);
+	memset(&user, 0, sizeof(slurmdb_user_rec_t));
+	user.uid = uid;
+	found_user = _find_user_rec(&user);
 
 	if (!found_user || !found_user->coord_accts) {
 		assoc_mgr_unlock(&locks);
@@ -3521,6 +3779,8 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update, bool locked)
 		return SLURM_SUCCESS;
 	}
 
+	_state_changed(STATE_ASSOCS);
+
 	while ((object = list_pop(update->objects))) {
 		bool update_jobs = false;
 		if (object->cluster && assoc_mgr_cluster_name) {
@@ -3970,6 +4230,8 @@ extern int assoc_mgr_update_wckeys(slurmdb_update_object_t *update, bool locked)
 		return SLURM_SUCCESS;
 	}
 
+	_state_changed(STATE_WCKEYS);
+
 	itr = list_iterator_create(assoc_mgr_wckey_list);
 	while ((object = list_pop(update->objects))) {
 		if (object->cluster && assoc_mgr_cluster_name) {
@@ -4079,6 +4341,7 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update, bool locked)
 {
 	slurmdb_user_rec_t * rec = NULL;
 	slurmdb_user_rec_t * object = NULL;
+	slurmdb_user_rec_t user;
 
 	ListIterator itr = NULL;
 	int rc = SLURM_SUCCESS;
@@ -4094,18 +4357,17 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update, bool locked)
 		return SLURM_SUCCESS;
 	}
 
+	_state_changed(STATE_USERS);
+
 	itr = list_iterator_create(assoc_mgr_user_list);
 	while ((object = list_pop(update->objects))) {
-		list_iterator_reset(itr);
-		while ((rec = list_next(itr))) {
-			char *name;
-			if (object->old_name)
-				name = object->old_name;
-			else
-				name = object->name;
-			if (!xstrcasecmp(name, rec->name))
-				break;
-		}
+		memset(&user, 0, sizeof(slurmdb_user_rec_t));
+		user.uid = NO_VAL;
+		if (object->old_name)
+			user.name = object->old_name;
+		else
+			user.name = object->name;
+		rec = _find_user_rec(&user);
 
 		//info("%d user %s", update->type, object->name);
 		switch(update->type) {
@@ -4122,11 +4384,16 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update, bool locked)
 					      rec->name);
 					break;
 				}
+				/* The name and uid are both hashed, so remove
+				 * the user from the hash before the change.
+				 */
+				_delete_user_hash(rec);
 				xfree(rec->old_name);
 				rec->old_name = rec->name;
 				rec->name = object->name;
 				object->name = NULL;
 				rc = _change_user_name(rec);
+				_add_user_hash(rec);
 			}
 
 			if (object->default_acct) {
@@ -4157,6 +4424,7 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update, bool locked)
 			} else
 				object->uid = pw_uid;
 			list_append(assoc_mgr_user_list, object);
+			_add_user_hash(object);
 			object = NULL;
 			break;
 		case SLURMDB_REMOVE_USER:
@@ -4164,7 +4432,10 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update, bool locked)
 				//rc = SLURM_ERROR;
 				break;
 			}
-			list_delete_item(itr);
+			_delete_user_hash(rec);
+			list_iterator_reset(itr);
+			if (list_find(itr, _find_rec_ptr, rec))
+				list_delete_item(itr);
 			break;
 		case SLURMDB_ADD_COORD:
 			/* same as SLURMDB_REMOVE_COORD */
@@ -4200,6 +4471,7 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update, bool locked)
 {
 	slurmdb_qos_rec_t *rec = NULL;
 	slurmdb_qos_rec_t *object = NULL;
+	slurmdb_qos_rec_t qos;
 
 	ListIterator itr = NULL, assoc_itr = NULL;
 
@@ -4220,15 +4492,14 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update, bool locked)
 		return SLURM_SUCCESS;
 	}
 
+	_state_changed(STATE_QOS);
+
 	itr = list_iterator_create(assoc_mgr_qos_list);
 	while ((object = list_pop(update->objects))) {
 		bool update_jobs = false;
-		list_iterator_reset(itr);
-		while ((rec = list_next(itr))) {
-			if (object->id == rec->id) {
-				break;
-			}
-		}
+		memset(&qos, 0, sizeof(slurmdb_qos_rec_t));
+		qos.id = object->id;
+		rec = _find_qos_rec(&qos);
 
 		//info("%d qos %s", update->type, object->name);
 		switch(update->type) {
@@ -4245,6 +4516,7 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update, bool locked)
 			assoc_mgr_set_qos_tres_cnt(object);
 
 			list_append(assoc_mgr_qos_list, object);
+			_add_qos_hash(object);
 /* 			char *tmp = get_qos_complete_str_bitstr( */
 /* 				assoc_mgr_qos_list, */
 /* 				object->preempt_bitstr); */
@@ -4513,6 +4785,9 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update, bool locked)
 			if (rec->priority == g_qos_max_priority)
 				redo_priority = 2;
 
+			_delete_qos_hash(rec);
+			list_iterator_reset(itr);
+			list_find(itr, _find_rec_ptr, rec);
 			if (init_setup.remove_qos_notify) {
 				/* since there are some deadlock
 				   issues while inside our lock here
@@ -4528,6 +4803,7 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update, bool locked)
 
 			if (!assoc_mgr_assoc_list)
 				break;
+			_state_changed(STATE_ASSOCS);
 			/* Remove this qos from all the associations
 			   on this cluster.
 			*/
@@ -4639,6 +4915,8 @@ extern int assoc_mgr_update_res(slurmdb_update_object_t *update, bool locked)
 		return SLURM_SUCCESS;
 	}
 
+	_state_changed(STATE_RES);
+
 	itr = list_iterator_create(assoc_mgr_res_list);
 	while ((object = list_pop(update->objects))) {
 		/* If this doesn't already have a clus_res_rec and no
@@ -4786,6 +5064,7 @@ extern int assoc_mgr_update_tres(slurmdb_update_object_t *update, bool locked)
 	if (!locked)
 		assoc_mgr_lock(&locks);
 
+	_state_changed(STATE_TRES);
 	if (!assoc_mgr_tres_list) {
 		tmp_list = list_create(slurmdb_destroy_tres_rec);
 		freeit = true;
@@ -5070,81 +5349,64 @@ extern void assoc_mgr_remove_qos_usage(slurmdb_qos_rec_t *qos)
 	}
 }
 
-extern int dump_assoc_mgr_state(char *state_save_location)
+/* Pack the list of one section of assoc_mgr_state */
+static Buf _pack_state_section(int section)
 {
-	static int high_buffer_size = (1024 * 1024);
-	int error_code = 0, log_fd;
-	char *old_file = NULL, *new_file = NULL, *reg_file = NULL,
-		*tmp_char = NULL;
 	dbd_list_msg_t msg;
-	Buf buffer = init_buf(high_buffer_size);
-	assoc_mgr_lock_t locks = { READ_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK,
-				   READ_LOCK, READ_LOCK, READ_LOCK};
-	DEF_TIMERS;
-
-	START_TIMER;
-	/* write header: version, time */
-	pack16(SLURM_PROTOCOL_VERSION, buffer);
-	pack_time(time(NULL), buffer);
+	uint16_t type;
+	Buf buffer;
 
-	assoc_mgr_lock(&locks);
-	if (assoc_mgr_tres_list) {
-		memset(&msg, 0, sizeof(dbd_list_msg_t));
+	memset(&msg, 0, sizeof(dbd_list_msg_t));
+	switch (section) {
+	case STATE_TRES:
 		msg.my_list = assoc_mgr_tres_list;
-		/* let us know what to unpack */
-		pack16(DBD_ADD_TRES, buffer);
-		slurmdbd_pack_list_msg(&msg, SLURM_PROTOCOL_VERSION,
-				       DBD_ADD_TRES, buffer);
-	}
-
-	if (assoc_mgr_user_list) {
-		memset(&msg, 0, sizeof(dbd_list_msg_t));
+		type = DBD_ADD_TRES;
+		break;
+	case STATE_USERS:
 		msg.my_list = assoc_mgr_user_list;
-		/* let us know what to unpack */
-		pack16(DBD_ADD_USERS, buffer);
-		slurmdbd_pack_list_msg(&msg, SLURM_PROTOCOL_VERSION,
-				       DBD_ADD_USERS, buffer);
-	}
-
-	if (assoc_mgr_res_list) {
-		memset(&msg, 0, sizeof(dbd_list_msg_t));
+		type = DBD_ADD_USERS;
+		break;
+	case STATE_RES:
 		msg.my_list = assoc_mgr_res_list;
-		/* let us know what to unpack */
-		pack16(DBD_ADD_RES, buffer);
-		slurmdbd_pack_list_msg(&msg, SLURM_PROTOCOL_VERSION,
-				       DBD_ADD_RES, buffer);
-	}
-
-	if (assoc_mgr_qos_list) {
-		memset(&msg, 0, sizeof(dbd_list_msg_t));
+		type = DBD_ADD_RES;
+		break;
+	case STATE_QOS:
 		msg.my_list = assoc_mgr_qos_list;
-		/* let us know what to unpack */
-		pack16(DBD_ADD_QOS, buffer);
-		slurmdbd_pack_list_msg(&msg, SLURM_PROTOCOL_VERSION,
-				       DBD_ADD_QOS, buffer);
-	}
-
-	if (assoc_mgr_wckey_list) {
-		memset(&msg, 0, sizeof(dbd_list_msg_t));
+		type = DBD_ADD_QOS;
+		break;
+	case STATE_WCKEYS:
 		msg.my_list = assoc_mgr_wckey_list;
-		/* let us know what to unpack */
-		pack16(DBD_ADD_WCKEYS, buffer);
-		slurmdbd_pack_list_msg(&msg, SLURM_PROTOCOL_VERSION,
-				       DBD_ADD_WCKEYS, buffer);
-	}
-	/* this needs to be done last so qos is set up
-	 * before hand when loading it back */
-	if (assoc_mgr_assoc_list) {
-		memset(&msg, 0, sizeof(dbd_list_msg_t));
+		type = DBD_ADD_WCKEYS;
+		break;
+	case STATE_ASSOCS:
 		msg.my_list = assoc_mgr_assoc_list;
+		type = DBD_ADD_ASSOCS;
+		break;
+	default:
+		fatal("%s: unknown section %d", __func__, section);
+		return NULL;	/* Fix CLANG false positive error */
+	}
+
+	/* An empty buffer stands for a list we don't have */
+	buffer = init_buf(0);
+	if (msg.my_list) {
 		/* let us know what to unpack */
-		pack16(DBD_ADD_ASSOCS, buffer);
+		pack16(type, buffer);
 		slurmdbd_pack_list_msg(&msg, SLURM_PROTOCOL_VERSION,
-				       DBD_ADD_ASSOCS, buffer);
+				       type, buffer);
 	}
 
-	/* write the buffer to file */
-	reg_file = xstrdup_printf("%s/assoc_mgr_state", state_save_location);
+	return buffer;
+}
+
+/* Write buffer to state_save_location/name, keeping the last copy as .old */
+static int _write_state_file(Buf buffer, char *state_save_location,
+			     char *name)
+{
+	int error_code = 0, log_fd;
+	char *old_file = NULL, *new_file = NULL, *reg_file = NULL;
+
+	reg_file = xstrdup_printf("%s/%s", state_save_location, name);
 	old_file = xstrdup_printf("%s.old", reg_file);
 	new_file = xstrdup_printf("%s.new", reg_file);
 
@@ -5156,7 +5418,6 @@ extern int dump_assoc_mgr_state(char *state_save_location)
 	} else {
 		int pos = 0, nwrite = get_buf_offset(buffer), amount;
 		char *data = (char *)get_buf_data(buffer);
-		high_buffer_size = MAX(nwrite, high_buffer_size);
 		while (nwrite > 0) {
 			amount = write(log_fd, &data[pos], nwrite);
 			if ((amount < 0) && (errno != EINTR)) {
@@ -5187,13 +5448,63 @@ extern int dump_assoc_mgr_state(char *state_save_location)
 	xfree(reg_file);
 	xfree(new_file);
 
-	free_buf(buffer);
-	/* now make a file for assoc_usage */
+	return error_code;
+}
+
+/*
+ * Only the lists that changed since the last call are packed again, and
+ * assoc_mgr_state is only rewritten when one of them did. The files are
+ * written after the lists are unlocked.
+ */
+extern int dump_assoc_mgr_state(char *state_save_location)
+{
+	static int high_buffer_size = (1024 * 1024);
+	int error_code = 0, rc, i;
+	uint32_t size;
+	char *tmp_char = NULL;
+	bool repacked = false;
+	Buf state_buffer = NULL, assoc_buffer, qos_buffer;
+	assoc_mgr_lock_t locks = { READ_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK,
+				   READ_LOCK, READ_LOCK, READ_LOCK};
+	assoc_mgr_lock_t list_locks = { READ_LOCK, NO_LOCK, READ_LOCK,
+					READ_LOCK, READ_LOCK, READ_LOCK,
+					READ_LOCK};
+	assoc_mgr_lock_t file_lock = { NO_LOCK, WRITE_LOCK, NO_LOCK, NO_LOCK,
+				       NO_LOCK, NO_LOCK, NO_LOCK};
+	DEF_TIMERS;
+
+	START_TIMER;
+	assoc_mgr_lock(&locks);
+
+	for (i = 0; i < STATE_SECTION_CNT; i++) {
+		if (!state_section[i]) {
+			state_section[i] = _pack_state_section(i);
+			repacked = true;
+		}
+	}
+
+	if (repacked || !state_file_current) {
+		state_buffer = init_buf(high_buffer_size);
+		/* write header: version, time */
+		pack16(SLURM_PROTOCOL_VERSION, state_buffer);
+		pack_time(time(NULL), state_buffer);
+		for (i = 0; i < STATE_SECTION_CNT; i++) {
+			size = get_buf_offset(state_section[i]);
+			if (remaining_buf(state_buffer) < size)
+				grow_buf(state_buffer, size);
+			memcpy(get_buf_data(state_buffer) +
+			       get_buf_offset(state_buffer),
+			       get_buf_data(state_section[i]), size);
+			set_buf_offset(state_buffer,
+				       get_buf_offset(state_buffer) + size);
+		}
+	}
 
-	buffer = init_buf(high_buffer_size);
+	/* now make a buffer for assoc_usage */
+	assoc_buffer = init_buf(high_buffer_size);
 	/* write header: version, time */
-	pack16(SLURM_PROTOCOL_VERSION, buffer);
-	pack_time(time(NULL), buffer);
+	pack16(SLURM_PROTOCOL_VERSION, assoc_buffer);
+	pack_time(time(NULL), assoc_buffer);
 
 	if (assoc_mgr_assoc_list) {
 		ListIterator itr = NULL;
@@ -5203,129 +5514,63 @@ extern int dump_assoc_mgr_state(char *state_save_location)
 			if (!assoc->user)
 				continue;
 
-			pack32(assoc->id, buffer);
-			packlongdouble(assoc->usage->usage_raw, buffer);
+			pack32(assoc->id, assoc_buffer);
+			packlongdouble(assoc->usage->usage_raw, assoc_buffer);
 			tmp_char = _make_usage_tres_raw_str(
 				assoc->usage->usage_tres_raw);
-			packstr(tmp_char, buffer);
+			packstr(tmp_char, assoc_buffer);
 			xfree(tmp_char);
-			pack32(assoc->usage->grp_used_wall, buffer);
+			pack32(assoc->usage->grp_used_wall, assoc_buffer);
 		}
 		list_iterator_destroy(itr);
 	}
+	high_buffer_size = MAX(get_buf_offset(assoc_buffer), high_buffer_size);
 
-	reg_file = xstrdup_printf("%s/assoc_usage", state_save_location);
-	old_file = xstrdup_printf("%s.old", reg_file);
-	new_file = xstrdup_printf("%s.new", reg_file);
-
-	log_fd = creat(new_file, 0600);
-	if (log_fd < 0) {
-		error("Can't save state, create file %s error %m",
-		      new_file);
-		error_code = errno;
-	} else {
-		int pos = 0, nwrite = get_buf_offset(buffer), amount;
-		char *data = (char *)get_buf_data(buffer);
-		high_buffer_size = MAX(nwrite, high_buffer_size);
-		while (nwrite > 0) {
-			amount = write(log_fd, &data[pos], nwrite);
-			if ((amount < 0) && (errno != EINTR)) {
-				error("Error writing file %s, %m", new_file);
-				error_code = errno;
-				break;
-			}
-			nwrite -= amount;
-			pos    += amount;
-		}
-		fsync(log_fd);
-		close(log_fd);
-	}
-	if (error_code)
-		(void) unlink(new_file);
-	else {			/* file shuffle */
-		(void) unlink(old_file);
-		if (link(reg_file, old_file))
-			debug4("unable to create link for %s -> %s: %m",
-			       reg_file, old_file);
-		(void) unlink(reg_file);
-		if (link(new_file, reg_file))
-			debug4("unable to create link for %s -> %s: %m",
-			       new_file, reg_file);
-		(void) unlink(new_file);
-	}
-	xfree(old_file);
-	xfree(reg_file);
-	xfree(new_file);
-
-	free_buf(buffer);
-	/* now make a file for qos_usage */
-
-	buffer = init_buf(high_buffer_size);
+	/* now make a buffer for qos_usage */
+	qos_buffer = init_buf(BUF_SIZE);
 	/* write header: version, time */
-	pack16(SLURM_PROTOCOL_VERSION, buffer);
-	pack_time(time(NULL), buffer);
+	pack16(SLURM_PROTOCOL_VERSION, qos_buffer);
+	pack_time(time(NULL), qos_buffer);
 
 	if (assoc_mgr_qos_list) {
 		ListIterator itr = NULL;
 		slurmdb_qos_rec_t *qos = NULL;
 		itr = list_iterator_create(assoc_mgr_qos_list);
 		while ((qos = list_next(itr))) {
-			pack32(qos->id, buffer);
-			packlongdouble(qos->usage->usage_raw, buffer);
+			pack32(qos->id, qos_buffer);
+			packlongdouble(qos->usage->usage_raw, qos_buffer);
 			tmp_char = _make_usage_tres_raw_str(
 				qos->usage->usage_tres_raw);
-			packstr(tmp_char, buffer);
+			packstr(tmp_char, qos_buffer);
 			xfree(tmp_char);
-			pack32(qos->usage->grp_used_wall, buffer);
+			pack32(qos->usage->grp_used_wall, qos_buffer);
 		}
 		list_iterator_destroy(itr);
 	}
 
-	reg_file = xstrdup_printf("%s/qos_usage", state_save_location);
-	old_file = xstrdup_printf("%s.old", reg_file);
-	new_file = xstrdup_printf("%s.new", reg_file);
+	/* Keep the file lock so only one of us writes the files at once */
+	assoc_mgr_unlock(&list_locks);
 
-	log_fd = creat(new_file, 0600);
-	if (log_fd < 0) {
-		error("Can't save state, create file %s error %m",
-		      new_file);
-		error_code = errno;
-	} else {
-		int pos = 0, nwrite = get_buf_offset(buffer), amount;
-		char *data = (char *)get_buf_data(buffer);
-		high_buffer_size = MAX(nwrite, high_buffer_size);
-		while (nwrite > 0) {
-			amount = write(log_fd, &data[pos], nwrite);
-			if ((amount < 0) && (errno != EINTR)) {
-				error("Error writing file %s, %m", new_file);
-				error_code = errno;
-				break;
-			}
-			nwrite -= amount;
-			pos    += amount;
-		}
-		fsync(log_fd);
-		close(log_fd);
-	}
-	if (error_code)
-		(void) unlink(new_file);
-	else {			/* file shuffle */
-		(void) unlink(old_file);
-		if (link(reg_file, old_file))
-			debug4("unable to create link for %s -> %s: %m",
-			       reg_file, old_file);
-		(void) unlink(reg_file);
-		if (link(new_file, reg_file))
-			debug4("unable to create link for %s -> %s: %m",
-			       new_file, reg_file);
-		(void) unlink(new_file);
+	if (state_buffer) {
+		error_code = _write_state_file(state_buffer,
+					       state_save_location,
+					       "assoc_mgr_state");
+		state_file_current = !error_code;
+		free_buf(state_buffer);
 	}
-	xfree(old_file);
-	xfree(reg_file);
-	xfree(new_file);
-	assoc_mgr_unlock(&locks);
 
-	free_buf(buffer);
+	if ((rc = _write_state_file(assoc_buffer, state_save_location,
+				    "assoc_usage")))
+		error_code = rc;
+	free_buf(assoc_buffer);
+
+	if ((rc = _write_state_file(qos_buffer, state_save_location,
+				    "qos_usage")))
+		error_code = rc;
+	free_buf(qos_buffer);
+
+	assoc_mgr_unlock(&file_lock);
+
 	END_TIMER2("dump_assoc_mgr_state");
 	return error_code;
 
@@ -5466,7 +5711,7 @@ extern int load_qos_usage(char *state_save_location)
 	char *data = NULL, *state_file;
 	Buf buffer = NULL;
 	time_t buf_time;
-	ListIterator itr = NULL;
+	slurmdb_qos_rec_t qos_rec;
 	assoc_mgr_lock_t locks = { NO_LOCK, READ_LOCK, WRITE_LOCK,
 				   NO_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
 
@@ -5525,7 +5770,6 @@ extern int load_qos_usage(char *state_save_location)
 
 	safe_unpack_time(&buf_time, buffer);
 
-	itr = list_iterator_create(assoc_mgr_qos_list);
 	while (remaining_buf(buffer) > 0) {
 		uint32_t qos_id = 0;
 		uint32_t grp_used_wall = 0;
@@ -5546,10 +5790,9 @@ extern int load_qos_usage(char *state_save_location)
 			safe_unpack32(&grp_used_wall, buffer);
 			usage_raw = (long double)tmp64;
 		}
-		while ((qos = list_next(itr)))
-			if (qos->id == qos_id)
-				break;
-		if (qos) {
+		memset(&qos_rec, 0, sizeof(slurmdb_qos_rec_t));
+		qos_rec.id = qos_id;
+		if ((qos = _find_qos_rec(&qos_rec))) {
 			qos->usage->grp_used_wall = grp_used_wall;
 			qos->usage->usage_raw = usage_raw;
 			_set_usage_tres_raw(qos->usage->usage_tres_raw,
@@ -5557,9 +5800,7 @@ extern int load_qos_usage(char *state_save_location)
 		}
 
 		xfree(tmp_str);
-		list_iterator_reset(itr);
 	}
-	list_iterator_destroy(itr);
 	assoc_mgr_unlock(&locks);
 
 	free_buf(buffer);
@@ -5568,8 +5809,6 @@ extern int load_qos_usage(char *state_save_location)
 unpack_error:
 	if (buffer)
 		free_buf(buffer);
-	if (itr)
-		list_iterator_destroy(itr);
 	assoc_mgr_unlock(&locks);
 	return SLURM_ERROR;
 }
@@ -5691,8 +5930,10 @@ extern int load_assoc_mgr_state(char *state_save_location)
 				break;
 			}
 			FREE_NULL_LIST(assoc_mgr_user_list);
+			_state_changed(STATE_USERS);
 			assoc_mgr_user_list = msg->my_list;
 			_post_user_list(assoc_mgr_user_list);
+			_rebuild_user_hash();
 			debug("Recovered %u users",
 			      list_count(assoc_mgr_user_list));
 			msg->my_list = NULL;
@@ -5708,6 +5949,7 @@ extern int load_assoc_mgr_state(char *state_save_location)
 				break;
 			}
 			FREE_NULL_LIST(assoc_mgr_res_list);
+			_state_changed(STATE_RES);
 			assoc_mgr_res_list = msg->my_list;
 			_post_res_list(assoc_mgr_res_list);
 			debug("Recovered %u resources",
@@ -5730,8 +5972,10 @@ extern int load_assoc_mgr_state(char *state_save_location)
 				break;
 			}
 			FREE_NULL_LIST(assoc_mgr_qos_list);
+			_state_changed(STATE_QOS);
 			assoc_mgr_qos_list = msg->my_list;
 			_post_qos_list(assoc_mgr_qos_list);
+			_rebuild_qos_hash();
 			debug("Recovered %u qos",
 			      list_count(assoc_mgr_qos_list));
 			msg->my_list = NULL;
@@ -5747,6 +5991,7 @@ extern int load_assoc_mgr_state(char *state_save_location)
 				break;
 			}
 			FREE_NULL_LIST(assoc_mgr_wckey_list);
+			_state_changed(STATE_WCKEYS);
 			assoc_mgr_wckey_list = msg->my_list;
 			debug("Recovered %u wckeys",
 			      list_count(assoc_mgr_wckey_list));
@@ -5849,6 +6094,7 @@ extern int assoc_mgr_set_missing_uids()
 
 					object->uid = pw_uid;
 					_add_assoc_hash(object);
+					_state_changed(STATE_ASSOCS);
 				}
 			}
 		}
@@ -5865,8 +6111,10 @@ extern int assoc_mgr_set_missing_uids()
 					debug2("refresh wckey "
 					       "couldn't get a uid for user %s",
 					       object->user);
-				} else
+				} else {
 					object->uid = pw_uid;
+					_state_changed(STATE_WCKEYS);
+				}
 			}
 		}
 		list_iterator_destroy(itr);
@@ -5882,8 +6130,12 @@ extern int assoc_mgr_set_missing_uids()
 					debug3("refresh user couldn't get "
 					       "a uid for user %s",
 					       object->name);
-				} else
+				} else {
+					_delete_user_hash(object);
 					object->uid = pw_uid;
+					_add_user_hash(object);
+					_state_changed(STATE_USERS);
+				}
 			}
 		}
 		list_iterator_destroy(itr);
@@ -105,6 +105,7 @@ strong_alias(hostlist_iterator_reset,	slurm_hostlist_iterator_reset);
 strong_alias(hostlist_next,		slurm_hostlist_next);
 strong_alias(hostlist_next_range,	slurm_hostlist_next_range);
 strong_alias(hostlist_nth,		slurm_hostlist_nth);
+strong_alias(hostlist_nth_range,	slurm_hostlist_nth_range);
 strong_alias(hostlist_pop,		slurm_hostlist_pop);
 strong_alias(hostlist_pop_range,	slurm_hostlist_pop_range);
 strong_alias(hostlist_push,		slurm_hostlist_push);
@@ -2378,6 +2379,34 @@ char * hostlist_nth(hostlist_t hl, int n)
 }
 
 
+int hostlist_nth_range(hostlist_t hl, int n, char **prefix,
+		       unsigned long *lo, unsigned long *hi, int *width)
+{
+	hostrange_t hr;
+	int rc = -1;
+
+	if (!hl)
+		return -1;
+	LOCK_HOSTLIST(hl);
+	if ((n >= 0) && (n < hl->nranges)) {
+		hr = hl->hr[n];
+		*prefix = hr->prefix;
+		if (hr->singlehost) {
+			*lo = *hi = 0;
+			*width = -1;
+		} else {
+			*lo = hr->lo;
+			*hi = hr->hi;
+			*width = hr->width;
+		}
+		rc = 0;
+	}
+	UNLOCK_HOSTLIST(hl);
+
+	return rc;
+}
+
+
 int hostlist_delete_nth(hostlist_t hl, int n)
 {
 	int i, count;
@@ -3698,10 +3727,46 @@ int hostset_intersects(hostset_t set, const char *hosts)
 	return retval;
 }
 
+/* Return 1 if every host in range hr is in the set, tested a range at a
+ * time rather than by expanding hr into individual names. Only set ranges
+ * with the same prefix and suffix width are considered, so a 0 return
+ * means the hosts must be tested individually.
+ * Assumes that the set->hl lock is already held. */
+static int hostset_range_within(hostset_t set, hostrange_t hr)
+{
+	hostrange_t set_hr;
+	unsigned long next;
+	int i, progress = 1;
+
+	if (hr->singlehost)
+		return 0;
+
+	next = hr->lo;
+	while ((next <= hr->hi) && progress) {
+		progress = 0;
+		for (i = 0; i < set->hl->nranges; i++) {
+			set_hr = set->hl->hr[i];
+			if (set_hr->singlehost ||
+			    (set_hr->width != hr->width) ||
+			    (set_hr->lo > next) || (set_hr->hi < next) ||
+			    strcmp(set_hr->prefix, hr->prefix))
+				continue;
+			progress = 1;
+			if (set_hr->hi >= hr->hi)
+				return 1;
+			next = set_hr->hi + 1;
+		}
+	}
+
+	return (next > hr->hi);
+}
+
 int hostset_within(hostset_t set, const char *hosts)
 {
-	int nhosts, nfound;
+	int nhosts, nfound, i, covered;
+	unsigned long j;
 	hostlist_t hl;
+	hostrange_t hr;
 	char *hostname;
 
 	assert(set->hl->magic == HOSTLIST_MAGIC);
@@ -3711,11 +3776,27 @@ int hostset_within(hostset_t set, const char *hosts)
 	nhosts = hostlist_count(hl);
 	nfound = 0;
 
-	while ((hostname = hostlist_pop(hl)) != NULL) {
-		nfound += hostset_find_host(set, hostname);
-		free(hostname);
+	for (i = 0; i < hl->nranges; i++) {
+		hr = hl->hr[i];
+		LOCK_HOSTLIST(set->hl);
+		covered = hostset_range_within(set, hr);
+		UNLOCK_HOSTLIST(set->hl);
+		if (covered) {
+			nfound += hostrange_count(hr);
+			continue;
+		}
+		for (j = 0; j < hostrange_count(hr); j++) {
+			hostname = _hostrange_string(hr, j);
+			if (!hostname || !hostset_find_host(set, hostname)) {
+				free(hostname);
+				goto fini;	/* A host is missing */
+			}
+			free(hostname);
+			nfound++;
+		}
 	}
 
+fini:
 	hostlist_destroy(hl);
 
 	return (nhosts == nfound);
@@ -224,6 +224,21 @@ char * hostlist_pop(hostlist_t hl);
 
 char * hostlist_nth(hostlist_t hl, int n);
 
+/* hostlist_nth_range():
+ *
+ * Get the components of the n'th range (zero origin) in hostlist hl:
+ * the hostname prefix, the lowest and highest numeric suffix and the
+ * zero padded width of the suffix. A range holding a single host without
+ * a numeric suffix sets lo and hi to zero and width to -1.
+ *
+ * The prefix points into the hostlist and is only valid until the
+ * hostlist is next modified. It must not be freed.
+ *
+ * Returns 0 on success, or -1 if hl contains n or fewer ranges.
+ */
+int hostlist_nth_range(hostlist_t hl, int n, char **prefix,
+		       unsigned long *lo, unsigned long *hi, int *width);
+
 /* hostlist_shift():
  *
  * Returns the string representation of the first host in the hostlist
@@ -148,6 +148,15 @@ static void * lsd_nomem_error(char *file, int line, char *mesg)
 #endif
 #define LIST_MAGIC 0xDEADBEEF
 
+/*  Each thread keeps a small cache of free objects of each type so that
+ *  list_alloc_aux() and list_free_aux() normally run without taking
+ *  list_free_lock. Objects move between a thread's cache and the shared
+ *  freelists LIST_CACHE_BATCH at a time, and a thread's cache is returned
+ *  to the shared freelists when the thread exits.
+ */
+#define LIST_CACHE_BATCH 32
+#define LIST_CACHE_MAX (4 * LIST_CACHE_BATCH)
+
 
 /****************
  *  Data Types  *
@@ -184,6 +193,18 @@ struct list {
 
 typedef struct listNode * ListNode;
 
+enum list_free_type {
+	LIST_FREE_LISTS,
+	LIST_FREE_NODES,
+	LIST_FREE_ITERATORS,
+	LIST_FREE_TYPES
+};
+
+struct listCache {
+	void                 *free[LIST_FREE_TYPES];  /* cached free objects */
+	int                   count[LIST_FREE_TYPES]; /* objects in free[]   */
+};
+
 
 /****************
  *  Prototypes  *
@@ -197,8 +218,8 @@ static ListNode list_node_alloc (void);
 static void list_node_free (ListNode p);
 static ListIterator list_iterator_alloc (void);
 static void list_iterator_free (ListIterator i);
-static void * list_alloc_aux (int size, void *pfreelist);
-static void list_free_aux (void *x, void *pfreelist);
+static void * list_alloc_aux (int type);
+static void list_free_aux (void *x, int type);
 static void *_list_pop_locked(List l);
 static void *_list_append_locked(List l, void *x);
 
@@ -206,12 +227,17 @@ static void *_list_append_locked(List l, void *x);
  *  Variables  *
  ***************/
 
-static List list_free_lists = NULL;
-static ListNode list_free_nodes = NULL;
-static ListIterator list_free_iterators = NULL;
+static void *list_free_objs[LIST_FREE_TYPES] = { NULL };
+static const int list_free_size[LIST_FREE_TYPES] = {
+	sizeof(struct list),
+	sizeof(struct listNode),
+	sizeof(struct listIterator)
+};
 
 #ifdef WITH_PTHREADS
 static pthread_mutex_t list_free_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t list_cache_key;
+static pthread_once_t list_cache_once = PTHREAD_ONCE_INIT;
 #endif /* WITH_PTHREADS */
 
 
@@ -973,7 +999,7 @@ list_node_destroy (List l, ListNode *pp)
 static List
 list_alloc (void)
 {
-	return(list_alloc_aux(sizeof(struct list), &list_free_lists));
+	return(list_alloc_aux(LIST_FREE_LISTS));
 }
 
 /* list_free()
@@ -981,7 +1007,7 @@ list_alloc (void)
 static void
 list_free (List l)
 {
-	list_free_aux(l, &list_free_lists);
+	list_free_aux(l, LIST_FREE_LISTS);
 }
 
 /* list_node_alloc()
@@ -989,7 +1015,7 @@ list_free (List l)
 static ListNode
 list_node_alloc (void)
 {
-	return(list_alloc_aux(sizeof(struct listNode), &list_free_nodes));
+	return(list_alloc_aux(LIST_FREE_NODES));
 }
 
 /* list_node_free()
@@ -997,7 +1023,7 @@ list_node_alloc (void)
 static void
 list_node_free (ListNode p)
 {
-	list_free_aux(p, &list_free_nodes);
+	list_free_aux(p, LIST_FREE_NODES);
 }
 
 /* list_iterator_alloc()
@@ -1005,7 +1031,7 @@ list_node_free (ListNode p)
 static ListIterator
 list_iterator_alloc (void)
 {
-	return(list_alloc_aux(sizeof(struct listIterator), &list_free_iterators));
+	return(list_alloc_aux(LIST_FREE_ITERATORS));
 }
 
 /* list_iterator_free()
@@ -1013,27 +1039,25 @@ list_iterator_alloc (void)
 static void
 list_iterator_free (ListIterator i)
 {
-	list_free_aux(i, &list_free_iterators);
+	list_free_aux(i, LIST_FREE_ITERATORS);
 }
 
-/* list_alloc_aux()
+/* list_free_get()
  */
 static void *
-list_alloc_aux (int size, void *pfreelist)
+list_free_get (int type, int cnt, int *got)
 {
-/*  Allocates an object of [size] bytes from the freelist [*pfreelist].
- *  Memory is added to the freelist in chunks of size LIST_ALLOC.
- *  Returns a ptr to the object, or NULL if the memory request fails.
+/*  Removes up to [cnt] objects of [type] from the shared freelist, adding
+ *  a chunk of LIST_ALLOC objects to it first if it is empty.
+ *  Returns the objects as a NULL terminated chain and sets [*got] to their
+ *  count, or returns NULL if the memory request fails.
+ *  The caller must hold list_free_lock.
  */
-	void **px;
-	void **pfree = pfreelist;
-	void **plast;
-
-	assert(sizeof(char) == 1);
-	assert(size >= sizeof(void *));
-	assert(pfreelist != NULL);
-	assert(LIST_ALLOC > 0);
-	list_mutex_lock(&list_free_lock);
+	int size = list_free_size[type];
+	void **pfree = &list_free_objs[type];
+	void **px, **plast;
+	void *chain;
+	int n = 0;
 
 	if (!*pfree) {
 		if ((*pfree = xmalloc(LIST_ALLOC * size))) {
@@ -1044,36 +1068,177 @@ list_alloc_aux (int size, void *pfreelist)
 			*plast = NULL;
 		}
 	}
-	if ((px = *pfree))
-		*pfree = *px;
-	else
+	if (!(chain = *pfree)) {
+		*got = 0;
+		return NULL;
+	}
+	px = chain;
+	while ((++n < cnt) && *px)
+		px = *px;
+	*pfree = *px;
+	*px = NULL;
+	*got = n;
+
+	return chain;
+}
+
+#ifndef MEMORY_LEAK_DEBUG
+/* list_free_put()
+ */
+static void
+list_free_put (int type, void *first, void *last)
+{
+/*  Returns the chain of objects from [first] to [last] to the shared
+ *  freelist of [type].
+ */
+	list_mutex_lock(&list_free_lock);
+	*(void **) last = list_free_objs[type];
+	list_free_objs[type] = first;
+	list_mutex_unlock(&list_free_lock);
+}
+#endif /* !MEMORY_LEAK_DEBUG */
+
+#if defined(WITH_PTHREADS) && !defined(MEMORY_LEAK_DEBUG)
+/* list_cache_destroy()
+ */
+static void
+list_cache_destroy (void *arg)
+{
+/*  Returns a thread's cached objects to the shared freelists when the
+ *  thread exits.
+ */
+	struct listCache *c = arg;
+	void **px;
+	int type;
+
+	for (type = 0; type < LIST_FREE_TYPES; type++) {
+		if (!(px = c->free[type]))
+			continue;
+		while (*px)
+			px = *px;
+		list_free_put(type, c->free[type], px);
+	}
+	xfree(c);
+}
+
+/* list_cache_key_init()
+ */
+static void
+list_cache_key_init (void)
+{
+	int e;
+
+	if ((e = pthread_key_create(&list_cache_key, list_cache_destroy))) {
+		errno = e;
+		lsd_fatal_error(__FILE__, __LINE__, "list cache key create");
+		abort();
+	}
+}
+
+/* list_cache_get()
+ */
+static struct listCache *
+list_cache_get (void)
+{
+/*  Returns the calling thread's object cache, creating it if needed.
+ */
+	struct listCache *c;
+
+	pthread_once(&list_cache_once, list_cache_key_init);
+	if (!(c = pthread_getspecific(list_cache_key))) {
+		c = xmalloc(sizeof(struct listCache));
+		if (pthread_setspecific(list_cache_key, c)) {
+			lsd_fatal_error(__FILE__, __LINE__, "list cache set");
+			abort();
+		}
+	}
+	return c;
+}
+#endif /* WITH_PTHREADS && !MEMORY_LEAK_DEBUG */
+
+/* list_alloc_aux()
+ */
+static void *
+list_alloc_aux (int type)
+{
+/*  Allocates an object of [type], taking it from the thread's cache when
+ *  possible and otherwise from the shared freelist.
+ *  Memory is added to the freelist in chunks of size LIST_ALLOC.
+ *  Returns a ptr to the object, or NULL if the memory request fails.
+ */
+	void **px;
+	int got;
+
+	assert(sizeof(char) == 1);
+	assert(list_free_size[type] >= sizeof(void *));
+	assert((type >= 0) && (type < LIST_FREE_TYPES));
+	assert(LIST_ALLOC > 0);
+
+#if defined(WITH_PTHREADS) && !defined(MEMORY_LEAK_DEBUG)
+	{
+		struct listCache *c = list_cache_get();
+
+		if (!c->free[type]) {
+			list_mutex_lock(&list_free_lock);
+			c->free[type] = list_free_get(type, LIST_CACHE_BATCH,
+						      &got);
+			list_mutex_unlock(&list_free_lock);
+			c->count[type] = got;
+		}
+		if ((px = c->free[type])) {
+			c->free[type] = *px;
+			c->count[type]--;
+		} else
+			errno = ENOMEM;
+		return px;
+	}
+#else
+	list_mutex_lock(&list_free_lock);
+	if (!(px = list_free_get(type, 1, &got)))
 		errno = ENOMEM;
 	list_mutex_unlock(&list_free_lock);
 
 	return px;
+#endif
 }
 
 /* list_free_aux()
  */
 static void
-list_free_aux (void *x, void *pfreelist)
+list_free_aux (void *x, int type)
 {
-/*  Frees the object [x], returning it to the freelist [*pfreelist].
+/*  Frees the object [x], returning it to the thread's cache. When the
+ *  cache grows past LIST_CACHE_MAX objects, LIST_CACHE_BATCH of them are
+ *  returned to the shared freelist.
  */
 #ifdef MEMORY_LEAK_DEBUG
 	xfree(x);
 #else
 	void **px = x;
-	void **pfree = pfreelist;
 
 	assert(x != NULL);
-	assert(pfreelist != NULL);
-	list_mutex_lock(&list_free_lock);
-
-	*px = *pfree;
-	*pfree = px;
-
-	list_mutex_unlock(&list_free_lock);
+	assert((type >= 0) && (type < LIST_FREE_TYPES));
+#  ifdef WITH_PTHREADS
+	{
+		struct listCache *c = list_cache_get();
+		void **plast;
+		int n;
+
+		*px = c->free[type];
+		c->free[type] = px;
+		if (++c->count[type] <= LIST_CACHE_MAX)
+			return;
+
+		plast = px;
+		for (n = 1; n < LIST_CACHE_BATCH; n++)
+			plast = *plast;
+		c->free[type] = *plast;
+		c->count[type] -= LIST_CACHE_BATCH;
+		list_free_put(type, px, plast);
+	}
+#  else
+	list_free_put(type, px, px);
+#  endif
 #endif
 }
 
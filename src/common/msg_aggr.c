@@ -59,8 +59,12 @@
 #  include <pthread.h>
 #endif /* WITH_PTHREADS */
 
+/* Seconds to bypass a collector after a failed send before trying it again */
+#define COLLECTOR_RETRY_TIME 60
+
 typedef struct {
 	pthread_mutex_t	aggr_mutex;
+	time_t		backup_retry;
 	pthread_cond_t	cond;
 	uint32_t        debug_flags;
 	bool		max_msgs;
@@ -69,6 +73,7 @@ typedef struct {
 	List            msg_list;
 	pthread_mutex_t	mutex;
 	slurm_addr_t    node_addr;
+	time_t		primary_retry;
 	bool            running;
 	pthread_t       thread_id;
 	uint64_t        window;
@@ -126,6 +131,45 @@ static msg_aggr_t *_handle_msg_aggr_ret(uint32_t msg_index, bool locked)
 	return msg_aggr;
 }
 
+/*
+ * Return true if a collector failed recently and should be bypassed.
+ * Once its retry time has passed the collector is tried again, so
+ * aggregation returns to it as soon as it recovers.
+ */
+static bool _collector_down(time_t retry_time)
+{
+	return (retry_time && (time(NULL) < retry_time));
+}
+
+/*
+ * Record the result of sending to a collector. A failed collector is
+ * bypassed for COLLECTOR_RETRY_TIME seconds rather than costing a full
+ * message timeout on every collection window.
+ */
+static void _collector_status(time_t *retry_time, slurm_addr_t *addr,
+			      char *type, int rc)
+{
+	char addrbuf[100];
+
+	if (rc == SLURM_SUCCESS) {
+		if (*retry_time) {
+			slurm_print_slurm_addr(addr, addrbuf, 32);
+			info("msg aggr: %s collector %s is responding again",
+			     type, addrbuf);
+			*retry_time = 0;
+		}
+		return;
+	}
+
+	if (!_collector_down(*retry_time)) {
+		slurm_print_slurm_addr(addr, addrbuf, 32);
+		info("msg aggr: %s collector %s can't be reached, "
+		     "bypassing it for %d seconds",
+		     type, addrbuf, COLLECTOR_RETRY_TIME);
+	}
+	*retry_time = time(NULL) + COLLECTOR_RETRY_TIME;
+}
+
 static int _send_to_backup_collector(slurm_msg_t *msg, int rc)
 {
 	slurm_addr_t *next_dest = NULL;
@@ -136,7 +180,13 @@ static int _send_to_backup_collector(slurm_msg_t *msg, int rc)
 		     rc ? "can't be reached" : "is null");
 	}
 
-	if ((next_dest = route_g_next_collector_backup())) {
+	if ((next_dest = route_g_next_collector_backup()) &&
+	    _collector_down(msg_collection.backup_retry)) {
+		if (msg_collection.debug_flags & DEBUG_FLAG_ROUTE)
+			info("_send_to_backup_collector: backup is down, "
+			     "skipping it");
+		rc = SLURM_ERROR;
+	} else if (next_dest) {
 		if (msg_collection.debug_flags & DEBUG_FLAG_ROUTE) {
 			char addrbuf[100];
 			slurm_print_slurm_addr(next_dest, addrbuf, 32);
@@ -145,6 +195,8 @@ static int _send_to_backup_collector(slurm_msg_t *msg, int rc)
 		}
 		memcpy(&msg->address, next_dest, sizeof(slurm_addr_t));
 		rc = slurm_send_only_node_msg(msg);
+		_collector_status(&msg_collection.backup_retry, next_dest,
+				  "backup", rc);
 	}
 
 	if (!next_dest ||  (rc != SLURM_SUCCESS)) {
@@ -162,7 +214,8 @@ static int _send_to_backup_collector(slurm_msg_t *msg, int rc)
  *  Send a msg to the next msg aggregation collector node. If primary
  *  collector is unavailable or returns error, try backup collector.
  *  If backup collector is unavailable or returns error, send msg
- *  directly to controller.
+ *  directly to controller. A collector that failed recently is
+ *  skipped until its retry time passes.
  */
 static int _send_to_next_collector(slurm_msg_t *msg)
 {
@@ -173,7 +226,13 @@ static int _send_to_next_collector(slurm_msg_t *msg)
 	if (msg_collection.debug_flags & DEBUG_FLAG_ROUTE)
 		info("msg aggr: send_to_next_collector: getting primary next "
 		     "collector");
-	if ((next_dest = route_g_next_collector(&i_am_collector))) {
+	if ((next_dest = route_g_next_collector(&i_am_collector)) &&
+	    _collector_down(msg_collection.primary_retry)) {
+		if (msg_collection.debug_flags & DEBUG_FLAG_ROUTE)
+			info("msg aggr: send_to_next_collector: primary is "
+			     "down, skipping it");
+		rc = SLURM_ERROR;
+	} else if (next_dest) {
 		if (msg_collection.debug_flags & DEBUG_FLAG_ROUTE) {
 			char addrbuf[100];
 			slurm_print_slurm_addr(next_dest, addrbuf, 32);
@@ -182,6 +241,8 @@ static int _send_to_next_collector(slurm_msg_t *msg)
 		}
 		memcpy(&msg->address, next_dest, sizeof(slurm_addr_t));
 		rc = slurm_send_only_node_msg(msg);
+		_collector_status(&msg_collection.primary_retry, next_dest,
+				  "primary", rc);
 	}
 
 	if (!next_dest || (rc != SLURM_SUCCESS))
@@ -80,6 +80,26 @@
 
 #define _DEBUG 0
 
+/* Longest numeric node name suffix placed in node_range_table */
+#define NODE_RANGE_MAX_WIDTH 9
+
+/*
+ * A run of node records with consecutive table indexes whose names share a
+ * prefix and have consecutive numeric suffixes with the same number of
+ * digits (e.g. "nid00001" through "nid50000"). node_range_table is sorted
+ * by prefix, then suffix width, then suffix, so that a hostlist range can be
+ * mapped directly to bits in a node bitmap without expanding it into
+ * individual names. Runs of one prefix and width never overlap, so their
+ * suffixes can be binary searched.
+ */
+typedef struct node_range {
+	int first_inx;		/* node_record_table_ptr index of lo */
+	unsigned long hi;	/* numeric suffix of last node in run */
+	unsigned long lo;	/* numeric suffix of first node in run */
+	char *prefix;		/* node name without numeric suffix */
+	int width;		/* digits in numeric suffix */
+} node_range_t;
+
 /* Global variables */
 List config_list  = NULL;	/* list of config_record entries */
 List front_end_list = NULL;	/* list of slurm_conf_frontend_t entries */
@@ -87,6 +107,8 @@ time_t last_node_update = (time_t) 0;	/* time of last update */
 struct node_record *node_record_table_ptr = NULL;	/* node records */
 xhash_t* node_hash_table = NULL;
 int node_record_count = 0;		/* count in node_record_table_ptr */
+static node_range_t *node_range_table = NULL;
+static int node_range_count = 0;	/* count in node_range_table */
 uint16_t *cr_node_num_cores = NULL;
 uint32_t *cr_node_cores_offset = NULL;
 
@@ -103,6 +125,11 @@ static struct node_record *
 		_find_node_record (char *name,bool test_alias,bool log_missing);
 static void	_list_delete_config (void *config_entry);
 static int	_list_find_config (void *config_entry, void *key);
+static void	_node_range_free(void);
+static int	_node_range2bitmap(char *prefix, unsigned long lo,
+				   unsigned long hi, int width,
+				   bitstr_t *bitmap);
+static void	_rebuild_node_range(void);
 
 /*
  * _build_single_nodeline_info - From the slurm.conf reader, build table,
@@ -822,6 +849,7 @@ extern int init_node_conf (void)
 	node_record_count = 0;
 	xfree(node_record_table_ptr);
 	xhash_free(node_hash_table);
+	_node_range_free();
 
 	if (config_list)	/* delete defunct configuration entries */
 		(void) _delete_config_record ();
@@ -846,6 +874,7 @@ extern void node_fini2 (void)
 	}
 
 	xhash_free(node_hash_table);
+	_node_range_free();
 	node_ptr = node_record_table_ptr;
 	for (i = 0; i < node_record_count; i++, node_ptr++)
 		purge_node_rec(node_ptr);
@@ -855,6 +884,74 @@ extern void node_fini2 (void)
 }
 
 
+/*
+ * _hostlist2bitmap - set the bits in bitmap for every node in hostlist hl
+ * IN hl          - hostlist
+ * IN best_effort - if set don't return an error on invalid node name entries
+ * IN caller      - name of calling function, for error messages
+ * IN/OUT bitmap  - bitmap sized to node_record_count
+ * RET 0 if no error, otherwise EINVAL
+ */
+static int _hostlist2bitmap(hostlist_t hl, bool best_effort, char *caller,
+			    bitstr_t *bitmap)
+{
+	int rc = SLURM_SUCCESS;
+	char *prefix, *this_node_name, name[MAX_SLURM_NAME + 32];
+	unsigned long lo, hi, num;
+	int i, width;
+	hostlist_iterator_t hi_iter;
+	struct node_record *node_ptr;
+
+	if (slurmdb_setup_cluster_name_dims() > 1) {
+		/* Names are not a prefix with a decimal suffix */
+		hi_iter = hostlist_iterator_create(hl);
+		while ((this_node_name = hostlist_next(hi_iter))) {
+			node_ptr = _find_node_record(this_node_name,
+						     best_effort, true);
+			if (node_ptr) {
+				bit_set(bitmap, (bitoff_t) (node_ptr -
+						node_record_table_ptr));
+			} else {
+				error("%s: invalid node specified %s",
+				      caller, this_node_name);
+				if (!best_effort)
+					rc = EINVAL;
+			}
+			free(this_node_name);
+		}
+		hostlist_iterator_destroy(hi_iter);
+		return rc;
+	}
+
+	for (i = 0; hostlist_nth_range(hl, i, &prefix, &lo, &hi, &width) == 0;
+	     i++) {
+		if ((width >= 0) &&
+		    _node_range2bitmap(prefix, lo, hi, width, bitmap))
+			continue;
+
+		/* Not all names are in node_range_table, look up each one */
+		for (num = lo; num <= hi; num++) {
+			if (width < 0)
+				snprintf(name, sizeof(name), "%s", prefix);
+			else
+				snprintf(name, sizeof(name), "%s%0*lu",
+					 prefix, width, num);
+			node_ptr = _find_node_record(name, best_effort, true);
+			if (node_ptr) {
+				bit_set(bitmap, (bitoff_t) (node_ptr -
+						node_record_table_ptr));
+			} else {
+				error("%s: invalid node specified %s",
+				      caller, name);
+				if (!best_effort)
+					rc = EINVAL;
+			}
+		}
+	}
+
+	return rc;
+}
+
 /*
  * node_name2bitmap - given a node name regular expression, build a bitmap
  *	representation
@@ -868,7 +965,6 @@ extern int node_name2bitmap (char *node_names, bool best_effort,
 			     bitstr_t **bitmap)
 {
 	int rc = SLURM_SUCCESS;
-	char *this_node_name;
 	bitstr_t *my_bitmap;
 	hostlist_t host_list;
 
@@ -888,20 +984,8 @@ extern int node_name2bitmap (char *node_names, bool best_effort,
 		return rc;
 	}
 
-	while ( (this_node_name = hostlist_shift (host_list)) ) {
-		struct node_record *node_ptr;
-		node_ptr = _find_node_record(this_node_name, best_effort, true);
-		if (node_ptr) {
-			bit_set (my_bitmap, (bitoff_t) (node_ptr -
-							node_record_table_ptr));
-		} else {
-			error ("node_name2bitmap: invalid node specified %s",
-			       this_node_name);
-			if (!best_effort)
-				rc = EINVAL;
-		}
-		free (this_node_name);
-	}
+	rc = _hostlist2bitmap(host_list, best_effort, "node_name2bitmap",
+			      my_bitmap);
 	hostlist_destroy (host_list);
 
 	return rc;
@@ -916,34 +1000,13 @@ extern int node_name2bitmap (char *node_names, bool best_effort,
  */
 extern int hostlist2bitmap (hostlist_t hl, bool best_effort, bitstr_t **bitmap)
 {
-	int rc = SLURM_SUCCESS;
 	bitstr_t *my_bitmap;
-	char *name;
-	hostlist_iterator_t hi;
 
 	FREE_NULL_BITMAP(*bitmap);
 	my_bitmap = (bitstr_t *) bit_alloc (node_record_count);
 	*bitmap = my_bitmap;
 
-	hi = hostlist_iterator_create(hl);
-	while ((name = hostlist_next(hi)) != NULL) {
-		struct node_record *node_ptr;
-		node_ptr = _find_node_record(name, best_effort, true);
-		if (node_ptr) {
-			bit_set (my_bitmap, (bitoff_t) (node_ptr -
-							node_record_table_ptr));
-		} else {
-			error ("hostlist2bitmap: invalid node specified %s",
-			       name);
-			if (!best_effort)
-				rc = EINVAL;
-		}
-		free (name);
-	}
-
-	hostlist_iterator_destroy(hi);
-	return rc;
-
+	return _hostlist2bitmap(hl, best_effort, "hostlist2bitmap", my_bitmap);
 }
 
 /* Purge the contents of a node record */
@@ -990,6 +1053,7 @@ extern void rehash_node (void)
 			continue;	/* vestigial record */
 		xhash_add(node_hash_table, node_ptr);
 	}
+	_rebuild_node_range();
 
 #if _DEBUG
 	_dump_hash();
@@ -997,6 +1061,159 @@ extern void rehash_node (void)
 	return;
 }
 
+static void _node_range_free(void)
+{
+	int i;
+
+	for (i = 0; i < node_range_count; i++)
+		xfree(node_range_table[i].prefix);
+	xfree(node_range_table);
+	node_range_count = 0;
+}
+
+static int _node_range_cmp(const void *x, const void *y)
+{
+	const node_range_t *r1 = (const node_range_t *) x;
+	const node_range_t *r2 = (const node_range_t *) y;
+	int rc;
+
+	if ((rc = strcmp(r1->prefix, r2->prefix)))
+		return rc;
+	if (r1->width != r2->width)
+		return r1->width - r2->width;
+	if (r1->lo != r2->lo)
+		return (r1->lo < r2->lo) ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Split a node name into its prefix length, numeric suffix and suffix width.
+ * RET false if the name has no usable prefix and numeric suffix
+ */
+static bool _node_name_split(char *name, int *prefix_len, unsigned long *num,
+			     int *width)
+{
+	int len = strlen(name), i = len;
+
+	while ((i > 0) && isdigit((int) name[i - 1]))
+		i--;
+	if ((i == 0) || (i == len) || ((len - i) > NODE_RANGE_MAX_WIDTH))
+		return false;
+
+	*prefix_len = i;
+	*num = strtoul(name + i, NULL, 10);
+	*width = len - i;
+	return true;
+}
+
+/*
+ * Build node_range_table from node_record_table_ptr. Node records whose
+ * names do not end in a number are left out and found by name instead.
+ */
+static void _rebuild_node_range(void)
+{
+	struct node_record *node_ptr = node_record_table_ptr;
+	node_range_t *range = NULL;
+	unsigned long num;
+	int i, prefix_len, width;
+
+	_node_range_free();
+	if (slurmdb_setup_cluster_name_dims() > 1)
+		return;
+
+	node_range_table = xmalloc(sizeof(node_range_t) *
+				   MAX(node_record_count, 1));
+	for (i = 0; i < node_record_count; i++, node_ptr++) {
+		if (!node_ptr->name ||
+		    !_node_name_split(node_ptr->name, &prefix_len, &num,
+				      &width)) {
+			range = NULL;
+			continue;
+		}
+		if (range && (range->width == width) &&
+		    (range->hi + 1 == num) &&
+		    (range->first_inx + (range->hi - range->lo) + 1 == i) &&
+		    !strncmp(range->prefix, node_ptr->name, prefix_len) &&
+		    (range->prefix[prefix_len] == '\0')) {
+			range->hi = num;
+			continue;
+		}
+		range = &node_range_table[node_range_count++];
+		range->first_inx = i;
+		range->lo = range->hi = num;
+		range->prefix = xstrndup(node_ptr->name, prefix_len);
+		range->width = width;
+	}
+	qsort(node_range_table, node_range_count, sizeof(node_range_t),
+	      _node_range_cmp);
+}
+
+/*
+ * _node_range2bitmap - set the bits for the node records named by a hostlist
+ *	range using node_range_table
+ * IN prefix - hostname prefix of the range
+ * IN lo, hi - numeric suffix bounds of the range
+ * IN width  - zero padded width of the numeric suffix
+ * IN/OUT bitmap - bitmap sized to node_record_count
+ * RET true if every name in the range was found, false if some names must
+ *	still be looked up individually
+ */
+static int _node_range2bitmap(char *prefix, unsigned long lo,
+			      unsigned long hi, int width, bitstr_t *bitmap)
+{
+	node_range_t *range;
+	unsigned long first, start, last, found = 0, min_num = 0;
+	int i, lower, upper, rc, w;
+
+	/*
+	 * The name printed for a number has max(width, digits) digits, which
+	 * must match the digits in the node name. Wider names only match
+	 * numbers without zero padding, so search each wider group from its
+	 * smallest number.
+	 */
+	for (w = width; w <= NODE_RANGE_MAX_WIDTH; w++) {
+		if (w > width) {
+			for (i = 1, min_num = 1; i < w; i++)
+				min_num *= 10;
+		}
+		first = MAX(lo, min_num);
+		if (first > hi)
+			break;
+
+		/* Find the first run of this prefix and width not entirely
+		 * below first */
+		lower = 0;
+		upper = node_range_count;
+		while (lower < upper) {
+			i = (lower + upper) / 2;
+			range = &node_range_table[i];
+			if (((rc = strcmp(range->prefix, prefix)) < 0) ||
+			    ((rc == 0) && (range->width < w)) ||
+			    ((rc == 0) && (range->width == w) &&
+			     (range->hi < first)))
+				lower = i + 1;
+			else
+				upper = i;
+		}
+
+		for (i = lower; i < node_range_count; i++) {
+			range = &node_range_table[i];
+			if (strcmp(range->prefix, prefix) ||
+			    (range->width != w) || (range->lo > hi))
+				break;
+			start = MAX(first, range->lo);
+			last  = MIN(hi, range->hi);
+			if (start > last)
+				continue;
+			bit_nset(bitmap, range->first_inx + (start - range->lo),
+				 range->first_inx + (last - range->lo));
+			found += last - start + 1;
+		}
+	}
+
+	return (found == (hi - lo + 1));
+}
+
 /* Convert a node state string to it's equivalent enum value */
 extern int state_str2int(const char *state_str, char *node_name)
 {
@@ -94,6 +94,14 @@ strong_alias(unpackstr_array,	slurm_unpackstr_array);
 strong_alias(packmem_array,	slurm_packmem_array);
 strong_alias(unpackmem_array,	slurm_unpackmem_array);
 
+/* Allocate memory for unpacked data, from the buffer's arena if it has one */
+static inline void *_unpack_alloc(Buf buffer, size_t size)
+{
+	if (buffer->arena)
+		return xarena_alloc_nz(buffer->arena, size);
+	return xmalloc_nz(size);
+}
+
 /* Basic buffer management routines */
 /* create_buf - create a buffer with the supplied contents, contents must
  * be xalloc'ed */
@@ -112,6 +120,7 @@ Buf create_buf(char *data, int size)
 	my_buf->size = size;
 	my_buf->processed = 0;
 	my_buf->head = data;
+	my_buf->arena = NULL;
 
 	return my_buf;
 }
@@ -154,6 +163,7 @@ Buf init_buf(int size)
 	my_buf->size = size;
 	my_buf->processed = 0;
 	my_buf->head = xmalloc(sizeof(char)*size);
+	my_buf->arena = NULL;
 	return my_buf;
 }
 
@@ -396,7 +406,7 @@ int unpack16_array(uint16_t ** valp, uint32_t * size_val, Buf buffer)
 	if (unpack32(size_val, buffer))
 		return SLURM_ERROR;
 
-	*valp = xmalloc_nz((*size_val) * sizeof(uint16_t));
+	*valp = _unpack_alloc(buffer, (*size_val) * sizeof(uint16_t));
 	for (i = 0; i < *size_val; i++) {
 		if (unpack16((*valp) + i, buffer))
 			return SLURM_ERROR;
@@ -425,7 +435,7 @@ int unpack32_array(uint32_t ** valp, uint32_t * size_val, Buf buffer)
 	if (unpack32(size_val, buffer))
 		return SLURM_ERROR;
 
-	*valp = xmalloc_nz((*size_val) * sizeof(uint32_t));
+	*valp = _unpack_alloc(buffer, (*size_val) * sizeof(uint32_t));
 	for (i = 0; i < *size_val; i++) {
 		if (unpack32((*valp) + i, buffer))
 			return SLURM_ERROR;
@@ -454,7 +464,7 @@ int unpack64_array(uint64_t ** valp, uint32_t * size_val, Buf buffer)
 	if (unpack32(size_val, buffer))
 		return SLURM_ERROR;
 
-	*valp = xmalloc_nz((*size_val) * sizeof(uint64_t));
+	*valp = _unpack_alloc(buffer, (*size_val) * sizeof(uint64_t));
 	for (i = 0; i < *size_val; i++) {
 		if (unpack64((*valp) + i, buffer))
 			return SLURM_ERROR;
@@ -480,7 +490,7 @@ int unpackdouble_array(double **valp, uint32_t* size_val, Buf buffer)
 	if (unpack32(size_val, buffer))
 		return SLURM_ERROR;
 
-	*valp = xmalloc_nz((*size_val) * sizeof(double));
+	*valp = _unpack_alloc(buffer, (*size_val) * sizeof(double));
 	for (i = 0; i < *size_val; i++) {
 		if (unpackdouble((*valp) + i, buffer))
 			return SLURM_ERROR;
@@ -506,7 +516,7 @@ int unpacklongdouble_array(long double **valp, uint32_t* size_val, Buf buffer)
 	if (unpack32(size_val, buffer))
 		return SLURM_ERROR;
 
-	*valp = xmalloc_nz((*size_val) * sizeof(long double));
+	*valp = _unpack_alloc(buffer, (*size_val) * sizeof(long double));
 	for (i = 0; i < *size_val; i++) {
 		if (unpacklongdouble((*valp) + i, buffer))
 			return SLURM_ERROR;
@@ -723,7 +733,7 @@ int unpackmem_xmalloc(char **valp, uint32_t * size_valp, Buf buffer)
 	else if (*size_valp > 0) {
 		if (remaining_buf(buffer) < *size_valp)
 			return SLURM_ERROR;
-		*valp = xmalloc_nz(*size_valp);
+		*valp = _unpack_alloc(buffer, *size_valp);
 		memcpy(*valp, &buffer->head[buffer->processed],
 		       *size_valp);
 		buffer->processed += *size_valp;
@@ -829,7 +839,8 @@ int unpackstr_array(char ***valp, uint32_t * size_valp, Buf buffer)
 		return SLURM_ERROR;
 	}
 	else if (*size_valp > 0) {
-		*valp = xmalloc_nz(sizeof(char *) * (*size_valp + 1));
+		*valp = _unpack_alloc(buffer,
+				      sizeof(char *) * (*size_valp + 1));
 		for (i = 0; i < *size_valp; i++) {
 			if (unpackmem_xmalloc(&(*valp)[i], &uint32_tmp, buffer))
 				return SLURM_ERROR;
@@ -69,11 +69,15 @@
 #define MAX_PACK_ARRAY_LEN	(128 * 1024)
 #define MAX_PACK_MEM_LEN	(1024 * 1024 * 1024)
 
+/* See xarena_create() in xmalloc.h */
+struct xarena;
+
 struct slurm_buf {
 	uint32_t magic;
 	char *head;
 	uint32_t size;
 	uint32_t processed;
+	struct xarena *arena;	/* if set, unpacked memory is allocated here */
 };
 
 typedef struct slurm_buf * Buf;
@@ -0,0 +1,62 @@
+/*****************************************************************************\
+ *  sha256.h - SHA-256 message digest
+ *****************************************************************************
+ *  Copyright (C) 2016 SchedMD LLC.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURM_SHA256_H
+#define _SLURM_SHA256_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#define SHA256_LEN 32		/* bytes in a digest */
+
+typedef struct sha256_ctx {
+	uint32_t state[8];
+	uint64_t len;		/* bytes hashed so far */
+	uint8_t block[64];	/* partial block not yet hashed */
+} sha256_ctx_t;
+
+/* Start a new digest */
+extern void sha256_init(sha256_ctx_t *ctx);
+
+/* Add len bytes of data to a digest */
+extern void sha256_update(sha256_ctx_t *ctx, const void *data, size_t len);
+
+/* Complete a digest, writing SHA256_LEN bytes to digest */
+extern void sha256_final(sha256_ctx_t *ctx, uint8_t *digest);
+
+/* Compute the digest of len bytes of data */
+extern void sha256(const void *data, size_t len, uint8_t *digest);
+
+#endif	/* _SLURM_SHA256_H */
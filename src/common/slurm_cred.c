@@ -230,17 +230,32 @@ static const char *syms[] = {
 	"crypto_str_error"
 };
 
-struct sbcast_cache {
-	time_t       expire;	/* Time that the cred was created	*/
-	uint32_t     value;	/* SLURM job id for this credential	*/
-};
+/*
+ * Cache of recently verified signatures. A credential with the same signed
+ * data and signature as a cached record was already verified on this node
+ * and is accepted without calling the crypto plugin again. Records are
+ * hashed on the signature and chained through "next".
+ */
+#define SIG_CACHE_HASH_SIZE	1024
+#define SIG_CACHE_PURGE_TIME	60
+
+typedef struct sig_cache_rec {
+	char        *data;	/* signed data, as packed		*/
+	uint32_t     data_len;	/* signed data length in bytes		*/
+	time_t       expire;	/* Time at which record can be purged	*/
+	struct sig_cache_rec *next;
+	char        *signature;	/* credential signature			*/
+	unsigned int siglen;	/* signature length in bytes		*/
+} sig_cache_rec_t;
 
 static slurm_crypto_ops_t ops;
 static plugin_context_t *g_context = NULL;
 static pthread_mutex_t g_context_lock = PTHREAD_MUTEX_INITIALIZER;
 static bool init_run = false;
 static time_t crypto_restart_time = (time_t) 0;
-static List sbcast_cache_list = NULL;
+static sig_cache_rec_t **sig_cache_hash = NULL;
+static pthread_mutex_t sig_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static time_t sig_cache_purge_time = (time_t) 0;
 static int cred_expire = DEFAULT_EXPIRATION_WINDOW;
 
 /*
@@ -291,8 +306,11 @@ static void _cred_state_pack(slurm_cred_ctx_t ctx, Buf buffer);
 static void _job_state_pack_one(job_state_t *j, Buf buffer);
 static void _cred_state_pack_one(cred_state_t *s, Buf buffer);
 
-static void _sbast_cache_add(sbcast_cred_t *sbcast_cred);
-static void _sbcast_cache_del(void *x);
+static void _sig_cache_add(Buf buffer, char *signature, unsigned int siglen,
+			   time_t expire);
+static bool _sig_cache_find(Buf buffer, char *signature, unsigned int siglen);
+static void _sig_cache_purge(void);
+static void _sig_cache_flush(void);
 
 #ifndef DISABLE_LOCALTIME
 static char * timestr (const time_t *tp, char *buf, size_t n);
@@ -335,7 +353,10 @@ static int _slurm_crypto_init(void)
 		retval = SLURM_ERROR;
 		goto done;
 	}
-	sbcast_cache_list = list_create(_sbcast_cache_del);
+	slurm_mutex_lock(&sig_cache_lock);
+	sig_cache_hash = xmalloc(sizeof(sig_cache_rec_t *) *
+				 SIG_CACHE_HASH_SIZE);
+	slurm_mutex_unlock(&sig_cache_lock);
 	init_run = true;
 
 done:
@@ -362,8 +383,10 @@ static int _slurm_crypto_fini(void)
 		return SLURM_SUCCESS;
 
 	init_run = false;
-	FREE_NULL_LIST(sbcast_cache_list);
-	sbcast_cache_list = NULL;
+	_sig_cache_flush();
+	slurm_mutex_lock(&sig_cache_lock);
+	xfree(sig_cache_hash);
+	slurm_mutex_unlock(&sig_cache_lock);
 	rc = plugin_context_destroy(g_context);
 	g_context = NULL;
 	return rc;
@@ -532,6 +555,9 @@ slurm_cred_ctx_key_update(slurm_cred_ctx_t ctx, const char *path)
 	if (_slurm_crypto_init() < 0)
 		return SLURM_ERROR;
 
+	/* Signatures verified with the old key must be verified again */
+	_sig_cache_flush();
+
 	if (ctx->type == SLURM_CRED_CREATOR)
 		return _ctx_update_private_key(ctx, path);
 	else
@@ -1717,6 +1743,13 @@ _slurm_cred_verify_signature(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
 	buffer = init_buf(4096);
 	_pack_cred(cred, buffer, protocol_version);
 
+	/* A retried launch request carries a credential we already verified */
+	if (_sig_cache_find(buffer, cred->signature, cred->siglen)) {
+		debug2("Credential signature found in cache");
+		free_buf(buffer);
+		return SLURM_SUCCESS;
+	}
+
 	rc = (*(ops.crypto_verify_sign))(ctx->key,
 					 get_buf_data(buffer),
 					 get_buf_offset(buffer),
@@ -1729,6 +1762,10 @@ _slurm_cred_verify_signature(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
 						 cred->signature,
 						 cred->siglen);
 	}
+	if (rc == 0) {
+		_sig_cache_add(buffer, cred->signature, cred->siglen,
+			       cred->ctime + ctx->expiry_window);
+	}
 	free_buf(buffer);
 
 	if (rc) {
@@ -2318,28 +2355,127 @@ void delete_sbcast_cred(sbcast_cred_t *sbcast_cred)
 	}
 }
 
-static void _sbast_cache_add(sbcast_cred_t *sbcast_cred)
+/* Hash a signature to its sig_cache_hash index */
+static int _sig_cache_inx(char *signature, unsigned int siglen)
+{
+	uint32_t hash = 0;
+	int i;
+
+	for (i = 0; i < siglen; i++)
+		hash = (hash * 31) + (unsigned char) signature[i];
+
+	return (hash % SIG_CACHE_HASH_SIZE);
+}
+
+static void _sig_cache_rec_del(sig_cache_rec_t *cache_rec)
+{
+	xfree(cache_rec->data);
+	xfree(cache_rec->signature);
+	xfree(cache_rec);
+}
+
+/* Remove expired records, at most once every SIG_CACHE_PURGE_TIME seconds.
+ * Resetting sig_cache_purge_time to zero removes all records.
+ * Caller must hold sig_cache_lock. */
+static void _sig_cache_purge(void)
 {
+	sig_cache_rec_t **cache_pptr, *cache_rec;
+	time_t now = time(NULL);
 	int i;
-	uint32_t sig_num = 0;
-	struct sbcast_cache *new_cache_rec;
-
-	/* Using two bytes at a time gives us a larger number
-	 * and reduces the possibility of a duplicate value */
-	for (i = 0; i < sbcast_cred->siglen; i += 2) {
-		sig_num += (sbcast_cred->signature[i] << 8) +
-			   sbcast_cred->signature[i+1];
+
+	if (!sig_cache_hash)
+		return;
+	if (sig_cache_purge_time &&
+	    (now < (sig_cache_purge_time + SIG_CACHE_PURGE_TIME)))
+		return;
+
+	for (i = 0; i < SIG_CACHE_HASH_SIZE; i++) {
+		cache_pptr = &sig_cache_hash[i];
+		while ((cache_rec = *cache_pptr)) {
+			if (!sig_cache_purge_time ||
+			    (cache_rec->expire <= now)) {
+				*cache_pptr = cache_rec->next;
+				_sig_cache_rec_del(cache_rec);
+			} else
+				cache_pptr = &cache_rec->next;
+		}
 	}
+	sig_cache_purge_time = now;
+}
 
-	new_cache_rec = xmalloc(sizeof(struct sbcast_cache));
-	new_cache_rec->expire = sbcast_cred->expiration;
-	new_cache_rec->value  = sig_num;
-	list_append(sbcast_cache_list, new_cache_rec);
+/* Remove all records */
+static void _sig_cache_flush(void)
+{
+	slurm_mutex_lock(&sig_cache_lock);
+	sig_cache_purge_time = (time_t) 0;
+	_sig_cache_purge();	/* purge time reset, so remove all records */
+	slurm_mutex_unlock(&sig_cache_lock);
 }
 
-static void _sbcast_cache_del(void *x)
+/* Record that the signed data in buffer was verified with this signature */
+static void _sig_cache_add(Buf buffer, char *signature, unsigned int siglen,
+			   time_t expire)
 {
-	xfree(x);
+	sig_cache_rec_t *cache_rec;
+	int inx;
+
+	if (!signature || !siglen)
+		return;
+
+	cache_rec = xmalloc(sizeof(sig_cache_rec_t));
+	cache_rec->data_len = get_buf_offset(buffer);
+	cache_rec->data = xmalloc(cache_rec->data_len);
+	memcpy(cache_rec->data, get_buf_data(buffer), cache_rec->data_len);
+	cache_rec->expire = expire;
+	cache_rec->siglen = siglen;
+	cache_rec->signature = xmalloc(siglen);
+	memcpy(cache_rec->signature, signature, siglen);
+
+	inx = _sig_cache_inx(signature, siglen);
+	slurm_mutex_lock(&sig_cache_lock);
+	if (sig_cache_hash) {
+		_sig_cache_purge();
+		cache_rec->next = sig_cache_hash[inx];
+		sig_cache_hash[inx] = cache_rec;
+		cache_rec = NULL;
+	}
+	slurm_mutex_unlock(&sig_cache_lock);
+
+	if (cache_rec)
+		_sig_cache_rec_del(cache_rec);
+}
+
+/* Return true if the signed data in buffer was already verified with this
+ * signature and the record has not yet expired */
+static bool _sig_cache_find(Buf buffer, char *signature, unsigned int siglen)
+{
+	sig_cache_rec_t *cache_rec;
+	uint32_t data_len = get_buf_offset(buffer);
+	time_t now = time(NULL);
+	bool found = false;
+	int inx;
+
+	if (!signature || !siglen)
+		return false;
+
+	inx = _sig_cache_inx(signature, siglen);
+	slurm_mutex_lock(&sig_cache_lock);
+	if (!sig_cache_hash)
+		goto fini;
+	for (cache_rec = sig_cache_hash[inx]; cache_rec;
+	     cache_rec = cache_rec->next) {
+		if ((cache_rec->siglen   == siglen)   &&
+		    (cache_rec->data_len == data_len) &&
+		    (cache_rec->expire   >  now)      &&
+		    !memcmp(cache_rec->signature, signature, siglen) &&
+		    !memcmp(cache_rec->data, get_buf_data(buffer), data_len)) {
+			found = true;
+			break;
+		}
+	}
+fini:	slurm_mutex_unlock(&sig_cache_lock);
+
+	return found;
 }
 
 /* Extract contents of an sbcast credential verifying the digital signature.
@@ -2353,9 +2489,7 @@ int extract_sbcast_cred(slurm_cred_ctx_t ctx,
 			sbcast_cred_t *sbcast_cred, uint16_t block_no,
 			uint32_t *job_id, char **nodes)
 {
-	struct sbcast_cache *next_cache_rec;
-	uint32_t sig_num = 0;
-	int i, rc;
+	int rc;
 	time_t now = time(NULL);
 	Buf buffer;
 
@@ -2369,66 +2503,52 @@ int extract_sbcast_cred(slurm_cred_ctx_t ctx,
 	if (now > sbcast_cred->expiration)
 		return -1;
 
-	if (block_no == 1) {
-		buffer = init_buf(4096);
-		_pack_sbcast_cred(sbcast_cred, buffer);
+	buffer = init_buf(4096);
+	_pack_sbcast_cred(sbcast_cred, buffer);
+
+	if (_sig_cache_find(buffer, sbcast_cred->signature,
+			    sbcast_cred->siglen)) {
+		/* Verified with an earlier block */
+	} else if (block_no == 1) {
 		/* NOTE: the verification checks that the credential was
 		 * created by SlurmUser or root */
 		rc = (*(ops.crypto_verify_sign)) (
 			ctx->key, get_buf_data(buffer), get_buf_offset(buffer),
 			sbcast_cred->signature, sbcast_cred->siglen);
-		free_buf(buffer);
 
 		if (rc) {
 			error("sbcast_cred verify: %s",
 			      (*(ops.crypto_str_error))(rc));
+			free_buf(buffer);
 			return -1;
 		}
-		_sbast_cache_add(sbcast_cred);
+		_sig_cache_add(buffer, sbcast_cred->signature,
+			       sbcast_cred->siglen, sbcast_cred->expiration);
 
 	} else {
 		char *err_str = NULL;
-		bool cache_match_found = false;
-		ListIterator sbcast_iter;
-		for (i = 0; i < sbcast_cred->siglen; i += 2) {
-			sig_num += (sbcast_cred->signature[i] << 8) +
-				   sbcast_cred->signature[i+1];
-		}
 
-		sbcast_iter = list_iterator_create(sbcast_cache_list);
-		while ((next_cache_rec = 
-			(struct sbcast_cache *) list_next(sbcast_iter))) {
-			if ((next_cache_rec->expire == sbcast_cred->expiration) &&
-			    (next_cache_rec->value  == sig_num)) {
-				cache_match_found = true;
-				break;
-			}
-			if (next_cache_rec->expire <= now)
-				list_delete_item(sbcast_iter);
+		error("sbcast_cred verify: signature not in cache");
+		if (SLURM_DIFFTIME(now, crypto_restart_time) > 60) {
+			free_buf(buffer);
+			return -1;	/* restarted >60 secs ago */
 		}
-		list_iterator_destroy(sbcast_iter);
-
-		if (!cache_match_found) {
-			error("sbcast_cred verify: signature not in cache");
-			if (SLURM_DIFFTIME(now, crypto_restart_time) > 60)
-				return -1;	/* restarted >60 secs ago */
-			buffer = init_buf(4096);
-			_pack_sbcast_cred(sbcast_cred, buffer);
-			rc = (*(ops.crypto_verify_sign)) (
-				ctx->key, get_buf_data(buffer),
-				get_buf_offset(buffer),
-				sbcast_cred->signature, sbcast_cred->siglen);
+		rc = (*(ops.crypto_verify_sign)) (
+			ctx->key, get_buf_data(buffer),
+			get_buf_offset(buffer),
+			sbcast_cred->signature, sbcast_cred->siglen);
+		if (rc)
+			err_str = (char *)(*(ops.crypto_str_error))(rc);
+		if (err_str && xstrcmp(err_str, "Credential replayed")){
+			error("sbcast_cred verify: %s", err_str);
 			free_buf(buffer);
-			if (rc)
-				err_str = (char *)(*(ops.crypto_str_error))(rc);
-			if (err_str && xstrcmp(err_str, "Credential replayed")){
-				error("sbcast_cred verify: %s", err_str);
-				return -1;
-			}
-			info("sbcast_cred verify: signature revalidated");
-			_sbast_cache_add(sbcast_cred);
+			return -1;
 		}
+		info("sbcast_cred verify: signature revalidated");
+		_sig_cache_add(buffer, sbcast_cred->signature,
+			       sbcast_cred->siglen, sbcast_cred->expiration);
 	}
+	free_buf(buffer);
 
 	*job_id = sbcast_cred->jobid;
 	*nodes  = xstrdup(sbcast_cred->nodes);
@@ -109,6 +109,7 @@ static const char *syms[] = {
 static slurm_jobacct_gather_ops_t ops;
 static plugin_context_t *g_context = NULL;
 static pthread_mutex_t g_context_lock = PTHREAD_MUTEX_INITIALIZER;
+static void (*poll_hook)(void) = NULL;	/* under g_context_lock */
 static bool init_run = false;
 static pthread_mutex_t init_run_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_t watch_tasks_thread_id = 0;
@@ -249,6 +250,8 @@ static void *_watch_tasks(void *arg)
 		slurm_mutex_lock(&g_context_lock);
 		/* The initial poll is done after the last task is added */
 		_poll_data(1);
+		if (poll_hook)
+			(*poll_hook)();
 		slurm_mutex_unlock(&g_context_lock);
 
 	}
@@ -491,6 +494,36 @@ extern jobacctinfo_t *jobacct_gather_stat_task(pid_t pid)
 	}
 }
 
+extern void jobacct_gather_set_poll_hook(void (*hook)(void))
+{
+	slurm_mutex_lock(&g_context_lock);
+	poll_hook = hook;
+	slurm_mutex_unlock(&g_context_lock);
+}
+
+extern int jobacct_gather_stat_all_task(jobacctinfo_t *jobacct)
+{
+	struct jobacctinfo *task_jobacct;
+	ListIterator itr;
+	int num_tasks = 0;
+
+	if (!plugin_polling || _jobacct_shutdown_test())
+		return 0;
+
+	slurm_mutex_lock(&task_list_lock);
+	if (task_list) {
+		itr = list_iterator_create(task_list);
+		while ((task_jobacct = list_next(itr))) {
+			jobacctinfo_aggregate(jobacct, task_jobacct);
+			num_tasks++;
+		}
+		list_iterator_destroy(itr);
+	}
+	slurm_mutex_unlock(&task_list_lock);
+
+	return num_tasks;
+}
+
 extern jobacctinfo_t *jobacct_gather_remove_task(pid_t pid)
 {
 	struct jobacctinfo *jobacct = NULL;
@@ -159,6 +159,13 @@ extern jobacctinfo_t *jobacct_gather_stat_task(pid_t pid);
 /* must free jobacctinfo_t if not NULL */
 extern jobacctinfo_t *jobacct_gather_remove_task(pid_t pid);
 
+/* Set a function for the polling thread to call after each poll,
+ * NULL to remove it. Does not return while the function is running. */
+extern void jobacct_gather_set_poll_hook(void (*hook)(void));
+/* Add the data of the last poll of every task to jobacct without polling,
+ * RET the number of tasks */
+extern int jobacct_gather_stat_all_task(jobacctinfo_t *jobacct);
+
 extern int jobacct_gather_set_proctrack_container_id(uint64_t id);
 extern int jobacct_gather_set_mem_limit(uint32_t job_id, uint32_t step_id,
 					uint32_t mem_limit);
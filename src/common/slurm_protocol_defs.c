@@ -2983,10 +2983,14 @@ extern void slurm_free_slurmd_status(slurmd_status_t* slurmd_status_ptr)
  */
 extern void slurm_free_job_info_msg(job_info_msg_t * job_buffer_ptr)
 {
+	xarena_t *arena;
+
 	if (job_buffer_ptr) {
 		if (job_buffer_ptr->job_array) {
+			arena = xarena_find(job_buffer_ptr->job_array);
 			_free_all_job_info(job_buffer_ptr);
 			xfree(job_buffer_ptr->job_array);
+			xarena_destroy(arena);
 		}
 		xfree(job_buffer_ptr);
 	}
@@ -3800,6 +3804,8 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 		slurm_free_job_id_request_msg(data);
 		break;
 	case REQUEST_FILE_BCAST:
+	case REQUEST_FILE_BCAST_CACHED:
+	case REQUEST_FILE_BCAST_PIPELINE:
 		slurm_free_file_bcast_msg(data);
 		break;
 	case RESPONSE_SLURM_RC:
@@ -4356,6 +4362,10 @@ rpc_num2string(uint16_t opcode)
 		return "REQUEST_ABORT_JOB";
 	case REQUEST_FILE_BCAST:
 		return "REQUEST_FILE_BCAST";
+	case REQUEST_FILE_BCAST_CACHED:
+		return "REQUEST_FILE_BCAST_CACHED";
+	case REQUEST_FILE_BCAST_PIPELINE:
+		return "REQUEST_FILE_BCAST_PIPELINE";
 	case TASK_USER_MANAGED_IO_STREAM:
 		return "TASK_USER_MANAGED_IO_STREAM";
 	case REQUEST_KILL_PREEMPTED:
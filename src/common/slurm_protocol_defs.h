@@ -62,6 +62,7 @@
 #include "src/common/job_options.h"
 #include "src/common/list.h"
 #include "src/common/macros.h"
+#include "src/common/sha256.h"
 #include "src/common/slurm_cred.h"
 #include "src/common/slurm_protocol_common.h"
 #include "src/common/slurm_step_layout.h"
@@ -355,6 +356,8 @@ typedef enum {
 	REQUEST_LAUNCH_PROLOG,
 	REQUEST_COMPLETE_PROLOG,
 	RESPONSE_PROLOG_EXECUTING,	/* 6019 */
+	REQUEST_FILE_BCAST_CACHED,	/* 6020 */
+	REQUEST_FILE_BCAST_PIPELINE,	/* 6021 */
 
 	SRUN_PING = 7001,
 	SRUN_TIMEOUT,
@@ -1086,6 +1089,8 @@ typedef struct file_bcast_msg {
 	uint32_t uncomp_len;	/* uncompressed length of this data block */
 	char *block;		/* data for this block */
 	uint64_t file_size;	/* file size */
+	uint8_t file_hash[SHA256_LEN]; /* SHA-256 of file contents, only
+					* sent with REQUEST_FILE_BCAST_CACHED */
 } file_bcast_msg_t;
 
 typedef struct multi_core_data {
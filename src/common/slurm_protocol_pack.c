@@ -598,6 +598,10 @@ static void _pack_file_bcast(file_bcast_msg_t * msg , Buf buffer,
 			     uint16_t protocol_version);
 static int _unpack_file_bcast(file_bcast_msg_t ** msg_ptr , Buf buffer,
 			      uint16_t protocol_version);
+static void _pack_file_bcast_cached(file_bcast_msg_t *msg, Buf buffer,
+				    uint16_t protocol_version);
+static int _unpack_file_bcast_cached(file_bcast_msg_t **msg_ptr, Buf buffer,
+				     uint16_t protocol_version);
 
 static void _pack_trigger_msg(trigger_info_msg_t *msg , Buf buffer,
 			      uint16_t protocol_version);
@@ -1530,9 +1534,14 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 		_pack_burst_buffer_info_resp_msg((slurm_msg_t *) msg, buffer);
 		break;
 	case REQUEST_FILE_BCAST:
+	case REQUEST_FILE_BCAST_PIPELINE:
 		_pack_file_bcast((file_bcast_msg_t *) msg->data, buffer,
 				 msg->protocol_version);
 		break;
+	case REQUEST_FILE_BCAST_CACHED:
+		_pack_file_bcast_cached((file_bcast_msg_t *) msg->data, buffer,
+					msg->protocol_version);
+		break;
 	case PMI_KVS_PUT_REQ:
 	case PMI_KVS_GET_RESP:
 		_pack_kvs_data((kvs_comm_set_t *) msg->data, buffer,
@@ -2219,10 +2228,16 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 			msg->protocol_version);
 		break;
 	case REQUEST_FILE_BCAST:
+	case REQUEST_FILE_BCAST_PIPELINE:
 		rc = _unpack_file_bcast( (file_bcast_msg_t **)
 					 & msg->data, buffer,
 					 msg->protocol_version);
 		break;
+	case REQUEST_FILE_BCAST_CACHED:
+		rc = _unpack_file_bcast_cached((file_bcast_msg_t **)
+					       &msg->data, buffer,
+					       msg->protocol_version);
+		break;
 	case PMI_KVS_PUT_REQ:
 	case PMI_KVS_GET_RESP:
 		rc = _unpack_kvs_data((kvs_comm_set_t **) &msg->data,
@@ -6242,14 +6257,21 @@ _unpack_job_info_msg(job_info_msg_t ** msg, Buf buffer,
 		safe_unpack32(&((*msg)->record_count), buffer);
 		safe_unpack_time(&((*msg)->last_update), buffer);
 
-		job = (*msg)->job_array = xmalloc(sizeof(job_info_t) *
-						  (*msg)->record_count);
+		/* The job records and the strings and arrays unpacked into
+		 * them all live until slurm_free_job_info_msg(), so allocate
+		 * them from one arena which is released there. */
+		xassert(!buffer->arena);
+		buffer->arena = xarena_create();
+		job = (*msg)->job_array = xarena_alloc(buffer->arena,
+						       sizeof(job_info_t) *
+						       (*msg)->record_count);
 		/* load individual job info */
 		for (i = 0; i < (*msg)->record_count; i++) {
 			if (_unpack_job_info_members(&job[i], buffer,
 						     protocol_version))
 				goto unpack_error;
 		}
+		buffer->arena = NULL;
 	} else {
 		error("_unpack_job_info_msg: protocol_version "
 		      "%hu not supported", protocol_version);
@@ -6258,6 +6280,7 @@ _unpack_job_info_msg(job_info_msg_t ** msg, Buf buffer,
 	return SLURM_SUCCESS;
 
 unpack_error:
+	buffer->arena = NULL;
 	slurm_free_job_info_msg(*msg);
 	*msg = NULL;
 	return SLURM_ERROR;
@@ -13658,6 +13681,38 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+/* REQUEST_FILE_BCAST_CACHED is a file_bcast_msg_t without data, followed
+ * by the SHA-256 of the file's contents */
+static void _pack_file_bcast_cached(file_bcast_msg_t *msg, Buf buffer,
+				    uint16_t protocol_version)
+{
+	_pack_file_bcast(msg, buffer, protocol_version);
+	packmem((char *) msg->file_hash, SHA256_LEN, buffer);
+}
+
+static int _unpack_file_bcast_cached(file_bcast_msg_t **msg_ptr, Buf buffer,
+				     uint16_t protocol_version)
+{
+	file_bcast_msg_t *msg;
+	char *hash;
+	uint32_t hash_len;
+
+	if (_unpack_file_bcast(msg_ptr, buffer, protocol_version))
+		return SLURM_ERROR;
+	msg = *msg_ptr;
+	safe_unpackmem_ptr(&hash, &hash_len, buffer);
+	if (hash_len != SHA256_LEN)
+		goto unpack_error;
+	memcpy(msg->file_hash, hash, SHA256_LEN);
+
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_file_bcast_msg(msg);
+	*msg_ptr = NULL;
+	return SLURM_ERROR;
+}
+
 static void _pack_trigger_msg(trigger_info_msg_t *msg, Buf buffer,
 			      uint16_t protocol_version)
 {
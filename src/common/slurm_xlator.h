@@ -144,6 +144,7 @@
 #define	hostlist_next		slurm_hostlist_next
 #define	hostlist_next_range	slurm_hostlist_next_range
 #define	hostlist_nth		slurm_hostlist_nth
+#define	hostlist_nth_range	slurm_hostlist_nth_range
 #define	hostlist_pop            slurm_hostlist_pop
 #define	hostlist_pop_range      slurm_hostlist_pop_range
 #define	hostlist_push		slurm_hostlist_push
@@ -1092,6 +1092,7 @@ extern void slurmdb_destroy_job_cond(void *object)
 		FREE_NULL_LIST(job_cond->acct_list);
 		FREE_NULL_LIST(job_cond->associd_list);
 		FREE_NULL_LIST(job_cond->cluster_list);
+		xfree(job_cond->cursor_cluster);
 		FREE_NULL_LIST(job_cond->groupid_list);
 		FREE_NULL_LIST(job_cond->jobname_list);
 		FREE_NULL_LIST(job_cond->partition_list);
@@ -0,0 +1,410 @@
+/*****************************************************************************\
+ *  slurmdb_export.c - columnar export files of completed jobs and steps
+ *****************************************************************************
+ *  Copyright (C) 2016 SchedMD LLC.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#if HAVE_LIBZ
+#  include <zlib.h>
+#endif
+
+#include "src/common/log.h"
+#include "src/common/slurm_protocol_defs.h"
+#include "src/common/slurm_time.h"
+#include "src/common/slurmdb_export.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#define EXPORT_MAGIC		0x534c4558	/* "SLEX" */
+#define EXPORT_VERSION		1
+#define EXPORT_PREAMBLE_SIZE	10		/* magic, version, header size */
+
+#define EXPORT_FLAG_ZLIB	0x0001
+
+/* Layout of one column block in the file, from the header */
+typedef struct {
+	uint16_t flags;
+	uint32_t raw_size;
+	uint32_t stored_size;
+} export_block_t;
+
+static void _destroy_col(void *object)
+{
+	slurmdb_export_col_t *col = (slurmdb_export_col_t *)object;
+
+	if (col) {
+		if (col->buffer)
+			free_buf(col->buffer);
+		xfree(col->name);
+		xfree(col);
+	}
+}
+
+static int _find_col(void *x, void *key)
+{
+	slurmdb_export_col_t *col = (slurmdb_export_col_t *)x;
+
+	if (!xstrcmp(col->name, (char *)key))
+		return 1;
+	return 0;
+}
+
+static int _find_char(void *x, void *key)
+{
+	if (!xstrcmp((char *)x, (char *)key))
+		return 1;
+	return 0;
+}
+
+/*
+ * Compress a column block, return the xmalloc'ed data to store or NULL to
+ * store the block as it is
+ */
+static char *_compress(char *raw, uint32_t raw_size, export_block_t *block)
+{
+#if HAVE_LIBZ
+	uLongf size = compressBound(raw_size);
+	char *data = xmalloc(size);
+
+	if ((compress2((Bytef *)data, &size, (Bytef *)raw, raw_size,
+		       Z_DEFAULT_COMPRESSION) == Z_OK)
+	    && (size < raw_size)) {
+		block->flags |= EXPORT_FLAG_ZLIB;
+		block->stored_size = size;
+		return data;
+	}
+	xfree(data);
+#endif
+	block->stored_size = raw_size;
+	return NULL;
+}
+
+static char *_uncompress(char *stored, export_block_t *block)
+{
+	char *data;
+
+	if (!(block->flags & EXPORT_FLAG_ZLIB)) {
+		if (block->stored_size != block->raw_size)
+			return NULL;
+		data = xmalloc(block->raw_size);
+		memcpy(data, stored, block->raw_size);
+		return data;
+	}
+#if HAVE_LIBZ
+	{
+		uLongf size = block->raw_size;
+
+		data = xmalloc(block->raw_size);
+		if ((uncompress((Bytef *)data, &size, (Bytef *)stored,
+				block->stored_size) == Z_OK)
+		    && (size == block->raw_size))
+			return data;
+		xfree(data);
+	}
+#else
+	error("%s: column is compressed, but zlib is not available", __func__);
+#endif
+	return NULL;
+}
+
+extern slurmdb_export_t *slurmdb_export_create(char *cluster,
+					       time_t period_start,
+					       time_t period_end)
+{
+	slurmdb_export_t *table = xmalloc(sizeof(slurmdb_export_t));
+
+	table->cluster = xstrdup(cluster);
+	table->col_list = list_create(_destroy_col);
+	table->period_start = period_start;
+	table->period_end = period_end;
+
+	return table;
+}
+
+extern void slurmdb_export_destroy(void *object)
+{
+	slurmdb_export_t *table = (slurmdb_export_t *)object;
+
+	if (table) {
+		xfree(table->cluster);
+		FREE_NULL_LIST(table->col_list);
+		xfree(table);
+	}
+}
+
+extern slurmdb_export_col_t *slurmdb_export_add_col(slurmdb_export_t *table,
+						    char *name, uint16_t type)
+{
+	slurmdb_export_col_t *col = xmalloc(sizeof(slurmdb_export_col_t));
+
+	col->buffer = init_buf(BUF_SIZE);
+	col->name = xstrdup(name);
+	col->type = type;
+	list_append(table->col_list, col);
+
+	return col;
+}
+
+extern slurmdb_export_col_t *slurmdb_export_find_col(slurmdb_export_t *table,
+						     char *name)
+{
+	return list_find_first(table->col_list, _find_col, name);
+}
+
+extern char *slurmdb_export_file_name(char *dir, char *cluster,
+				      char *table_name, time_t period_start)
+{
+	struct tm time_tm;
+
+	if (!slurm_localtime_r(&period_start, &time_tm)) {
+		error("Couldn't get localtime from %ld", (long)period_start);
+		return NULL;
+	}
+
+	return xstrdup_printf("%s/%s/%s_%04d-%02d", dir, cluster, table_name,
+			      time_tm.tm_year + 1900, time_tm.tm_mon + 1);
+}
+
+extern int slurmdb_export_write(slurmdb_export_t *table, char *file)
+{
+	ListIterator itr;
+	slurmdb_export_col_t *col;
+	int col_cnt = list_count(table->col_list), i = 0, fd;
+	export_block_t *blocks = xmalloc(sizeof(export_block_t) * col_cnt);
+	char **data = xmalloc(sizeof(char *) * col_cnt);
+	char *new_file = NULL, *dir, *sep;
+	Buf header = init_buf(BUF_SIZE), preamble = init_buf(BUF_SIZE);
+	int rc = SLURM_ERROR;
+
+	packstr(table->cluster, header);
+	pack_time(table->period_start, header);
+	pack_time(table->period_end, header);
+	pack32(table->rows, header);
+	pack32(col_cnt, header);
+
+	itr = list_iterator_create(table->col_list);
+	while ((col = list_next(itr))) {
+		blocks[i].raw_size = get_buf_offset(col->buffer);
+		data[i] = _compress(get_buf_data(col->buffer),
+				    blocks[i].raw_size, &blocks[i]);
+		packstr(col->name, header);
+		pack16(col->type, header);
+		pack16(blocks[i].flags, header);
+		pack32(blocks[i].raw_size, header);
+		pack32(blocks[i].stored_size, header);
+		i++;
+	}
+
+	pack32(EXPORT_MAGIC, preamble);
+	pack16(EXPORT_VERSION, preamble);
+	pack32(get_buf_offset(header), preamble);
+
+	/* Each cluster has its own directory. The export holds every user's
+	 * jobs, so only SlurmUser may read it. */
+	dir = xstrdup(file);
+	if ((sep = strrchr(dir, '/'))) {
+		*sep = '\0';
+		if (mkdir(dir, 0700) < 0) {
+			if (errno != EEXIST)
+				error("%s: mkdir(%s): %m", __func__, dir);
+			else if (chmod(dir, 0700) < 0)
+				error("%s: chmod(%s): %m", __func__, dir);
+		}
+	}
+	xfree(dir);
+
+	new_file = xstrdup_printf("%s.new", file);
+	(void) unlink(new_file);	/* creat() keeps an old file's mode */
+	if ((fd = creat(new_file, 0600)) < 0) {
+		error("Can't save export, create file %s error %m", new_file);
+		goto end_it;
+	}
+
+	safe_write(fd, get_buf_data(preamble), get_buf_offset(preamble));
+	safe_write(fd, get_buf_data(header), get_buf_offset(header));
+	i = 0;
+	list_iterator_reset(itr);
+	while ((col = list_next(itr))) {
+		safe_write(fd, data[i] ? data[i] : get_buf_data(col->buffer),
+			   blocks[i].stored_size);
+		i++;
+	}
+
+	fsync(fd);
+	close(fd);
+	if (rename(new_file, file) < 0)
+		error("Can't rename export file %s to %s: %m", new_file, file);
+	else
+		rc = SLURM_SUCCESS;
+	goto end_it;
+
+rwfail:
+	error("Error writing file %s, %m", new_file);
+	close(fd);
+	(void) unlink(new_file);
+end_it:
+	list_iterator_destroy(itr);
+	for (i = 0; i < col_cnt; i++)
+		xfree(data[i]);
+	xfree(data);
+	xfree(blocks);
+	xfree(new_file);
+	free_buf(header);
+	free_buf(preamble);
+
+	return rc;
+}
+
+extern slurmdb_export_t *slurmdb_export_read(char *file, List col_names)
+{
+	slurmdb_export_t *table = NULL;
+	slurmdb_export_col_t *col;
+	export_block_t *blocks = NULL;
+	char **names = NULL, *data = NULL, *raw;
+	uint16_t *types = NULL;
+	uint32_t magic, header_size, col_cnt = 0, uint32_tmp, i;
+	uint16_t version;
+	off_t offset;
+	struct stat stat_buf;
+	Buf buffer = NULL;
+	int fd;
+
+	if ((fd = open(file, O_RDONLY)) < 0) {
+		if (errno == ENOENT)
+			debug("%s: can't open %s: %m", __func__, file);
+		else
+			error("Can't open export file %s: %m", file);
+		return NULL;
+	}
+	if (fstat(fd, &stat_buf) < 0)
+		goto rwfail;
+
+	data = xmalloc(EXPORT_PREAMBLE_SIZE);
+	safe_read(fd, data, EXPORT_PREAMBLE_SIZE);
+	buffer = create_buf(data, EXPORT_PREAMBLE_SIZE);
+	data = NULL;
+	safe_unpack32(&magic, buffer);
+	safe_unpack16(&version, buffer);
+	safe_unpack32(&header_size, buffer);
+	free_buf(buffer);
+	buffer = NULL;
+	if ((magic != EXPORT_MAGIC) || (version != EXPORT_VERSION) ||
+	    (header_size > stat_buf.st_size)) {
+		error("%s: %s is not an export file of version %u",
+		      __func__, file, EXPORT_VERSION);
+		goto unpack_error;
+	}
+
+	data = xmalloc(header_size);
+	safe_read(fd, data, header_size);
+	buffer = create_buf(data, header_size);
+	data = NULL;
+
+	table = xmalloc(sizeof(slurmdb_export_t));
+	table->col_list = list_create(_destroy_col);
+	safe_unpackstr_xmalloc(&table->cluster, &uint32_tmp, buffer);
+	safe_unpack_time(&table->period_start, buffer);
+	safe_unpack_time(&table->period_end, buffer);
+	safe_unpack32(&table->rows, buffer);
+	safe_unpack32(&col_cnt, buffer);
+	if (col_cnt > header_size)
+		goto unpack_error;
+
+	blocks = xmalloc(sizeof(export_block_t) * col_cnt);
+	names = xmalloc(sizeof(char *) * col_cnt);
+	types = xmalloc(sizeof(uint16_t) * col_cnt);
+	for (i = 0; i < col_cnt; i++) {
+		safe_unpackstr_xmalloc(&names[i], &uint32_tmp, buffer);
+		safe_unpack16(&types[i], buffer);
+		safe_unpack16(&blocks[i].flags, buffer);
+		safe_unpack32(&blocks[i].raw_size, buffer);
+		safe_unpack32(&blocks[i].stored_size, buffer);
+		if (blocks[i].stored_size > stat_buf.st_size)
+			goto unpack_error;
+	}
+
+	/* Only read the blocks of the columns asked for */
+	offset = EXPORT_PREAMBLE_SIZE + header_size;
+	for (i = 0; i < col_cnt; offset += blocks[i].stored_size, i++) {
+		if (col_names &&
+		    !list_find_first(col_names, _find_char, names[i]))
+			continue;
+		if (lseek(fd, offset, SEEK_SET) < 0) {
+			error("%s: lseek(%s): %m", __func__, file);
+			goto unpack_error;
+		}
+		data = xmalloc(blocks[i].stored_size);
+		safe_read(fd, data, blocks[i].stored_size);
+		if (!(raw = _uncompress(data, &blocks[i]))) {
+			error("%s: column %s of %s is corrupted",
+			      __func__, names[i], file);
+			goto unpack_error;
+		}
+		xfree(data);
+
+		col = xmalloc(sizeof(slurmdb_export_col_t));
+		col->buffer = create_buf(raw, blocks[i].raw_size);
+		col->name = names[i];
+		names[i] = NULL;
+		col->type = types[i];
+		list_append(table->col_list, col);
+	}
+	goto end_it;
+
+rwfail:
+	error("%s: can't read %s: %m", __func__, file);
+unpack_error:
+	slurmdb_export_destroy(table);
+	table = NULL;
+end_it:
+	close(fd);
+	if (names) {
+		for (i = 0; i < col_cnt; i++)
+			xfree(names[i]);
+		xfree(names);
+	}
+	xfree(types);
+	xfree(blocks);
+	xfree(data);
+	if (buffer)
+		free_buf(buffer);
+
+	return table;
+}
@@ -0,0 +1,114 @@
+/*****************************************************************************\
+ *  slurmdb_export.h - columnar export files of completed jobs and steps
+ *****************************************************************************
+ *  Copyright (C) 2016 SchedMD LLC.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURMDB_EXPORT_H
+#define _SLURMDB_EXPORT_H
+
+#include <time.h>
+
+#include "src/common/list.h"
+#include "src/common/pack.h"
+
+/*
+ * An export file holds one table (the jobs or the steps of one cluster that
+ * ended in one month). Each column is stored as its own block, compressed
+ * with zlib when available, so a reader only reads and inflates the columns
+ * it asks for.
+ */
+
+#define EXPORT_TABLE_JOB	"job"
+#define EXPORT_TABLE_STEP	"step"
+
+/* Prefix of the columns holding one TRES each, e.g. "tres_alloc:cpu" */
+#define EXPORT_TRES_ALLOC	"tres_alloc:"
+
+typedef enum {
+	EXPORT_COL_UINT32,
+	EXPORT_COL_UINT64,
+	EXPORT_COL_STRING,
+} export_col_type_t;
+
+typedef struct {
+	Buf buffer;		/* one packed value per row */
+	char *name;
+	uint16_t type;		/* export_col_type_t */
+} slurmdb_export_col_t;
+
+typedef struct {
+	char *cluster;
+	List col_list;		/* list of slurmdb_export_col_t * */
+	time_t period_end;
+	time_t period_start;
+	uint32_t rows;		/* values packed into each column */
+} slurmdb_export_t;
+
+/* Create an empty table of the given cluster and period */
+extern slurmdb_export_t *slurmdb_export_create(char *cluster,
+					       time_t period_start,
+					       time_t period_end);
+
+extern void slurmdb_export_destroy(void *object);
+
+/*
+ * Add a column to a table being built. Values are added to it with pack32(),
+ * pack64() or packstr() on the buffer of the column, one for each row.
+ */
+extern slurmdb_export_col_t *slurmdb_export_add_col(slurmdb_export_t *table,
+						    char *name, uint16_t type);
+
+/* Find a column of a table by name, NULL if it is not there */
+extern slurmdb_export_col_t *slurmdb_export_find_col(slurmdb_export_t *table,
+						     char *name);
+
+/*
+ * Return the xmalloc'ed name of the file holding the given table of a
+ * cluster for the month starting at period_start
+ */
+extern char *slurmdb_export_file_name(char *dir, char *cluster,
+				      char *table_name, time_t period_start);
+
+/* Write a table to a file, replacing any older copy of it */
+extern int slurmdb_export_write(slurmdb_export_t *table, char *file);
+
+/*
+ * Read a table from a file
+ * IN col_names - names of the columns to read, or NULL for all of them.
+ *                Other columns are skipped without being read.
+ * RET table, with the buffer of each column positioned at the first row,
+ *     or NULL on error
+ */
+extern slurmdb_export_t *slurmdb_export_read(char *file, List col_names);
+
+#endif
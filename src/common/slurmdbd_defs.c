@@ -55,7 +55,9 @@
 #include <stdio.h>
 #include <syslog.h>
 #include <poll.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <time.h>
@@ -88,18 +90,62 @@ strong_alias(slurmdbd_free_id_rc_msg,	slurmdb_slurmdbd_free_id_rc_msg);
 #define DBD_MAGIC		0xDEAD3219
 #define MAX_AGENT_QUEUE		10000
 #define MAX_DBD_MSG_LEN		16384
+
+/* Bounds on the records the agent sends in one DBD_SEND_MULT_MSG, the
+ * size must stay well below the slurmdbd's 16MB message limit */
+#define AGENT_BATCH_DELAY	50	/* msec to wait for a full batch */
+#define MAX_AGENT_BATCH_CNT	1000
+#define MAX_AGENT_BATCH_SIZE	(4 * 1024 * 1024)
 #define SLURMDBD_TIMEOUT	900	/* Seconds SlurmDBD for response */
 
+/* The agent queue is an append-only spool file in StateSaveLocation which
+ * is mapped into memory. Records are appended at the tail and the head is
+ * advanced as the SlurmDBD acknowledges them, so pending records survive a
+ * failure of the slurmctld and a large backlog does not grow its heap.
+ * If the file can not be opened the same layout is kept in anonymous
+ * memory, and moved into the file once it can be opened. */
+#define SPOOL_MAGIC		0x44424453	/* "DBDS" */
+#define SPOOL_CHUNK		(1024 * 1024)	/* file size increment */
+#define SPOOL_RETRY		60	/* secs between opens of the file */
+#define SPOOL_REC_PURGED	0x0001
+#define SPOOL_REC_LEN(s)	((sizeof(spool_rec_t) + (s) + 7) & (~7))
+
+typedef struct {
+	uint32_t magic;		/* SPOOL_MAGIC */
+	uint16_t rpc_version;	/* protocol version of the spooled records */
+	uint16_t flags;
+	uint32_t count;		/* records neither consumed nor purged */
+	uint32_t head;		/* offset of the oldest record */
+	uint32_t tail;		/* offset past the newest record */
+	uint32_t pad;
+} spool_hdr_t;
+
+typedef struct {
+	uint32_t magic;		/* DBD_MAGIC */
+	uint32_t size;		/* size of the packed message that follows */
+	uint32_t flags;		/* SPOOL_REC_* */
+	uint32_t pad;
+} spool_rec_t;
+
 uint16_t running_cache = 0;
 pthread_mutex_t assoc_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
 pthread_cond_t assoc_cache_cond = PTHREAD_COND_INITIALIZER;
 
 static pthread_mutex_t agent_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  agent_cond = PTHREAD_COND_INITIALIZER;
-static List      agent_list     = (List) NULL;
 static pthread_t agent_tid      = 0;
 static time_t    agent_shutdown = 0;
 
+/* Agent spool, protected by agent_lock */
+static int       spool_fd       = -1;	/* -1 if kept in memory */
+static time_t    spool_open_time = 0;	/* last try to open the file */
+static spool_hdr_t *spool_hdr   = NULL;
+static char *    spool_map      = NULL;
+static uint32_t  spool_size     = 0;
+static uint32_t  batch_off[MAX_AGENT_BATCH_CNT]; /* records being sent */
+static int       batch_acked    = 0;
+static int       batch_cnt      = 0;
+
 static pthread_mutex_t slurmdbd_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  slurmdbd_cond = PTHREAD_COND_INITIALIZER;
 static slurm_fd_t  slurmdbd_fd         = -1;
@@ -124,13 +170,21 @@ static void   _open_slurmdbd_fd(bool db_needed);
 static int    _purge_job_start_req(void);
 static Buf    _recv_msg(int read_timeout);
 static void   _reopen_slurmdbd_fd(void);
-static int    _save_dbd_rec(int fd, Buf buffer);
-static void   _save_dbd_state(void);
 static int    _send_init_msg(void);
 static int    _send_fini_msg(void);
 static int    _send_msg(Buf buffer);
 static void   _sig_handler(int signal);
 static void   _shutdown_agent(void);
+static int    _spool_ack(void);
+static int    _spool_append(Buf buffer);
+static List   _spool_batch(void);
+static void   _spool_close(void);
+static void   _spool_compact(void);
+static uint16_t _spool_msg_type(spool_rec_t *rec);
+static int    _spool_open(void);
+static int    _spool_open_file(void);
+static void   _spool_retry_file(void);
+static spool_rec_t *_spool_rec(uint32_t offset);
 static void   _slurmdbd_packstr(void *str, uint16_t rpc_version, Buf buffer);
 static int    _slurmdbd_unpackstr(void **str, uint16_t rpc_version, Buf buffer);
 static int    _tot_wait (struct timeval *start_time);
@@ -179,9 +233,9 @@ extern int slurm_open_slurmdbd_conn(char *auth_info,
 		callbacks_requested = false;
 	}
 
-	if ((callbacks != NULL) && ((agent_tid == 0) || (agent_list == NULL)))
+	if ((callbacks != NULL) && ((agent_tid == 0) || (spool_map == NULL)))
 		_create_agent();
-	else if (agent_list)
+	else if (spool_map)
 		_load_dbd_state();
 
 	slurm_mutex_unlock(&agent_lock);
@@ -366,15 +420,15 @@ extern int slurm_send_slurmdbd_msg(uint16_t rpc_version, slurmdbd_msg_t *req)
 	buffer = pack_slurmdbd_msg(req, rpc_version);
 
 	slurm_mutex_lock(&agent_lock);
-	if ((agent_tid == 0) || (agent_list == NULL)) {
+	if ((agent_tid == 0) || (spool_map == NULL)) {
 		_create_agent();
-		if ((agent_tid == 0) || (agent_list == NULL)) {
+		if ((agent_tid == 0) || (spool_map == NULL)) {
 			slurm_mutex_unlock(&agent_lock);
 			free_buf(buffer);
 			return SLURM_ERROR;
 		}
 	}
-	cnt = list_count(agent_list);
+	cnt = spool_hdr->count;
 	if ((cnt >= (max_agent_queue / 2)) &&
 	    (difftime(time(NULL), syslog_time) > 120)) {
 		/* Record critical error every 120 seconds */
@@ -386,10 +440,8 @@ extern int slurm_send_slurmdbd_msg(uint16_t rpc_version, slurmdbd_msg_t *req)
 	}
 	if (cnt == (max_agent_queue - 1))
 		cnt -= _purge_job_start_req();
-	if (cnt < max_agent_queue) {
-		if (list_enqueue(agent_list, buffer) == NULL)
-			fatal("list_enqueue: memory allocation failure");
-	} else {
+	if ((cnt >= max_agent_queue) ||
+	    (_spool_append(buffer) != SLURM_SUCCESS)) {
 		error("slurmdbd: agent queue is full, discarding request");
 		if (callbacks_requested)
 			(callback.acct_full)();
@@ -398,6 +450,7 @@ extern int slurm_send_slurmdbd_msg(uint16_t rpc_version, slurmdbd_msg_t *req)
 
 	pthread_cond_broadcast(&agent_cond);
 	slurm_mutex_unlock(&agent_lock);
+	free_buf(buffer);
 	return rc;
 }
 
@@ -547,6 +600,7 @@ extern Buf pack_slurmdbd_msg(slurmdbd_msg_t *req, uint16_t rpc_version)
 	case DBD_GET_CLUSTERS:
 	case DBD_GET_EVENTS:
 	case DBD_GET_JOBS_COND:
+	case DBD_GET_JOBS_PAGE:
 	case DBD_GET_PROBS:
 	case DBD_GET_QOS:
 	case DBD_GET_RESVS:
@@ -732,6 +786,7 @@ extern int unpack_slurmdbd_msg(slurmdbd_msg_t *resp,
 	case DBD_GET_CLUSTERS:
 	case DBD_GET_EVENTS:
 	case DBD_GET_JOBS_COND:
+	case DBD_GET_JOBS_PAGE:
 	case DBD_GET_PROBS:
 	case DBD_GET_QOS:
 	case DBD_GET_RESVS:
@@ -980,6 +1035,8 @@ extern slurmdbd_msg_type_t str_2_slurmdbd_msg_type(char *msg_type)
 		return DBD_STEP_START;
 	} else if (!xstrcasecmp(msg_type, "Get Jobs Conditional")) {
 		return DBD_GET_JOBS_COND;
+	} else if (!xstrcasecmp(msg_type, "Get Jobs Page")) {
+		return DBD_GET_JOBS_PAGE;
 	} else if (!xstrcasecmp(msg_type, "Get Transations")) {
 		return DBD_GET_TXN;
 	} else if (!xstrcasecmp(msg_type, "Got Transations")) {
@@ -1396,6 +1453,12 @@ extern char *slurmdbd_msg_type_2_str(slurmdbd_msg_type_t msg_type, int get_enum)
 		} else
 			return "Get Jobs Conditional";
 		break;
+	case DBD_GET_JOBS_PAGE:
+		if (get_enum) {
+			return "DBD_GET_JOBS_PAGE";
+		} else
+			return "Get Jobs Page";
+		break;
 	case DBD_GET_TXN:
 		if (get_enum) {
 			return "DBD_GET_TXN";
@@ -1782,19 +1845,16 @@ static int _handle_mult_rc_ret(uint16_t rpc_version, int read_timeout)
 		}
 
 		slurm_mutex_lock(&agent_lock);
-		if (agent_list) {
+		if (spool_map) {
 			ListIterator itr =
 				list_iterator_create(list_msg->my_list);
 			while ((out_buf = list_next(itr))) {
-				Buf b;
 				if ((rc = _unpack_return_code(
 					    rpc_version, out_buf))
 				    != SLURM_SUCCESS)
 					break;
 
-				if ((b = list_dequeue(agent_list))) {
-					free_buf(b);
-				} else {
+				if (_spool_ack() != SLURM_SUCCESS) {
 					error("slurmdbd: DBD_GOT_MULT_MSG "
 					      "unpack message error");
 				}
@@ -2033,10 +2093,8 @@ static void _create_agent(void)
 	   nothing if the connection was closed and then opened again */
 	agent_shutdown = 0;
 
-	if (agent_list == NULL) {
-		agent_list = list_create(slurmdbd_free_buffer);
+	if ((spool_map == NULL) && (_spool_open() == SLURM_SUCCESS))
 		_load_dbd_state();
-	}
 
 	if (agent_tid == 0) {
 		pthread_attr_t agent_attr;
@@ -2089,10 +2147,39 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+/* Wait up to AGENT_BATCH_DELAY msec for a full batch of records to be
+ * queued, so that records generated together are sent together */
+static void _agent_batch_wait(void)
+{
+	struct timespec abs_time;
+	struct timeval now;
+	int cnt;
+
+	slurm_mutex_lock(&agent_lock);
+	cnt = spool_map ? spool_hdr->count : 0;
+	if ((cnt > 0) && (cnt < MAX_AGENT_BATCH_CNT)) {
+		gettimeofday(&now, NULL);
+		abs_time.tv_sec  = now.tv_sec;
+		abs_time.tv_nsec = (now.tv_usec + AGENT_BATCH_DELAY * 1000) *
+				   1000;
+		if (abs_time.tv_nsec >= 1000000000) {
+			abs_time.tv_sec++;
+			abs_time.tv_nsec -= 1000000000;
+		}
+		while ((agent_shutdown == 0) && spool_map &&
+		       (spool_hdr->count < MAX_AGENT_BATCH_CNT)) {
+			if (pthread_cond_timedwait(&agent_cond, &agent_lock,
+						   &abs_time) == ETIMEDOUT)
+				break;
+		}
+	}
+	slurm_mutex_unlock(&agent_lock);
+}
+
 static void *_agent(void *x)
 {
 	int cnt, rc;
-	Buf buffer;
+	Buf buffer = NULL;
 	struct timespec abs_time;
 	static time_t fail_time = 0;
 	int sigarray[] = {SIGUSR1, 0};
@@ -2112,6 +2199,7 @@ static void *_agent(void *x)
 
 	while (agent_shutdown == 0) {
 		/* START_TIMER; */
+		_agent_batch_wait();
 		slurm_mutex_lock(&slurmdbd_lock);
 		if (halt_agent)
 			pthread_cond_wait(&slurmdbd_cond, &slurmdbd_lock);
@@ -2125,8 +2213,10 @@ static void *_agent(void *x)
 		}
 
 		slurm_mutex_lock(&agent_lock);
-		if (agent_list && slurmdbd_fd)
-			cnt = list_count(agent_list);
+		if (spool_map && (spool_fd < 0))
+			_spool_retry_file();
+		if (spool_map && slurmdbd_fd)
+			cnt = spool_hdr->count;
 		else
 			cnt = 0;
 		if ((cnt == 0) || (slurmdbd_fd < 0) ||
@@ -2140,29 +2230,17 @@ static void *_agent(void *x)
 			continue;
 		} else if ((cnt > 0) && ((cnt % 100) == 0))
 			info("slurmdbd: agent queue size %u", cnt);
-		/* Leave item on the queue until processing complete */
-		if (agent_list) {
-			int handle_agent_count = 1000;
-			if (cnt > handle_agent_count) {
-				int agent_count = 0;
-				ListIterator agent_itr =
-					list_iterator_create(agent_list);
-				list_msg.my_list = list_create(NULL);
-				while ((buffer = list_next(agent_itr))) {
-					list_enqueue(list_msg.my_list, buffer);
-					agent_count++;
-					if (agent_count > handle_agent_count)
-						break;
-				}
-				list_iterator_destroy(agent_itr);
+		/* Leave records in the spool until processing complete */
+		if (spool_map) {
+			_spool_compact();
+			list_msg.my_list = _spool_batch();
+			if (list_count(list_msg.my_list) > 1) {
 				buffer = pack_slurmdbd_msg(
 					&list_req, SLURM_PROTOCOL_VERSION);
-			} else if (cnt > 1) {
-				list_msg.my_list = agent_list;
-				buffer = pack_slurmdbd_msg(
-					&list_req, SLURM_PROTOCOL_VERSION);
-			} else
-				buffer = (Buf) list_peek(agent_list);
+			} else {
+				buffer = (Buf) list_pop(list_msg.my_list);
+				FREE_NULL_LIST(list_msg.my_list);
+			}
 		} else
 			buffer = NULL;
 		slurm_mutex_unlock(&agent_lock);
@@ -2209,34 +2287,20 @@ static void *_agent(void *x)
 		slurm_mutex_unlock(&assoc_cache_mutex);
 
 		slurm_mutex_lock(&agent_lock);
-		if (agent_list && (rc == SLURM_SUCCESS)) {
-			/* If we sent a mult_msg we just need to free
-			   buffer, we don't need to requeue, just mark
-			   list_msg.my_list as NULL as that is the
-			   sign we sent a mult_msg.
-			*/
-			if (list_msg.my_list) {
-				if (list_msg.my_list != agent_list)
-					FREE_NULL_LIST(list_msg.my_list);
-				list_msg.my_list = NULL;
-			} else
-				buffer = (Buf) list_dequeue(agent_list);
-
-			free_buf(buffer);
+		if (spool_map && (rc == SLURM_SUCCESS)) {
+			/* The records of a mult_msg were consumed as
+			   their return codes were processed. */
+			if (!list_msg.my_list)
+				(void) _spool_ack();
 			fail_time = 0;
-		} else {
-			/* We still need to free a mult_msg even if we
-			   got a failure.
-			*/
-			if (list_msg.my_list) {
-				if (list_msg.my_list != agent_list)
-					FREE_NULL_LIST(list_msg.my_list);
-				list_msg.my_list = NULL;
-				free_buf(buffer);
-			}
-
+		} else
 			fail_time = time(NULL);
-		}
+		/* Unacknowledged records stay in the spool to be
+		   sent again, the buffers only held copies. */
+		FREE_NULL_LIST(list_msg.my_list);
+		free_buf(buffer);
+		buffer = NULL;
+		batch_cnt = batch_acked = 0;
 		slurm_mutex_unlock(&agent_lock);
 		/* END_TIMER; */
 		/* info("at the end with %s", TIME_STR); */
@@ -2252,80 +2316,28 @@ static void *_agent(void *x)
 	}
 
 	slurm_mutex_lock(&agent_lock);
-	_save_dbd_state();
-	FREE_NULL_LIST(agent_list);
+	FREE_NULL_LIST(list_msg.my_list);
+	if (buffer)
+		free_buf(buffer);
+	batch_cnt = batch_acked = 0;
+	_spool_close();
 	slurm_mutex_unlock(&agent_lock);
 	return NULL;
 }
 
-static void _save_dbd_state(void)
-{
-	char *dbd_fname;
-	Buf buffer;
-	int fd, rc, wrote = 0;
-	uint16_t msg_type;
-	uint32_t offset;
-
-	dbd_fname = slurm_get_state_save_location();
-	xstrcat(dbd_fname, "/dbd.messages");
-	(void) unlink(dbd_fname);	/* clear save state */
-	fd = open(dbd_fname, O_WRONLY | O_CREAT | O_TRUNC, 0600);
-	if (fd < 0) {
-		error("slurmdbd: Creating state save file %s", dbd_fname);
-	} else if (agent_list && list_count(agent_list)) {
-		char curr_ver_str[10];
-		snprintf(curr_ver_str, sizeof(curr_ver_str),
-			 "VER%d", SLURM_PROTOCOL_VERSION);
-		buffer = init_buf(strlen(curr_ver_str));
-		packstr(curr_ver_str, buffer);
-		rc = _save_dbd_rec(fd, buffer);
-		free_buf(buffer);
-		if (rc != SLURM_SUCCESS)
-			goto end_it;
-
-		while ((buffer = list_dequeue(agent_list))) {
-			/* We do not want to store registration
-			   messages.  If an admin puts in an incorrect
-			   cluster name we can get a deadlock unless
-			   they add the bogus cluster name to the
-			   accounting system.
-			*/
-			offset = get_buf_offset(buffer);
-			if (offset < 2) {
-				free_buf(buffer);
-				continue;
-			}
-			set_buf_offset(buffer, 0);
-			unpack16(&msg_type, buffer);
-			set_buf_offset(buffer, offset);
-			if (msg_type == DBD_REGISTER_CTLD) {
-				free_buf(buffer);
-				continue;
-			}
-
-			rc = _save_dbd_rec(fd, buffer);
-			free_buf(buffer);
-			if (rc != SLURM_SUCCESS)
-				break;
-			wrote++;
-		}
-	}
-
-end_it:
-	if (fd >= 0) {
-		verbose("slurmdbd: saved %d pending RPCs", wrote);
-		(void) close(fd);
-	}
-	xfree(dbd_fname);
-}
-
+/* Move the records of a dbd.messages file, written by the slurmctld before
+ * the agent queue was spooled, into the spool */
 static void _load_dbd_state(void)
 {
 	char *dbd_fname;
 	Buf buffer;
-	int fd, recovered = 0;
+	int fd, rc, recovered = 0;
 	uint16_t rpc_version = 0;
 
+	/* Leave the file until its records can be spooled to disk */
+	if (spool_fd < 0)
+		return;
+
 	dbd_fname = slurm_get_state_save_location();
 	xstrcat(dbd_fname, "/dbd.messages");
 	fd = open(dbd_fname, O_RDONLY);
@@ -2378,7 +2390,6 @@ static void _load_dbd_state(void)
 				 * things up to date.
 				 */
 				slurmdbd_msg_t msg;
-				int rc;
 				set_buf_offset(buffer, 0);
 				rc = unpack_slurmdbd_msg(
 					&msg, rpc_version, buffer);
@@ -2393,8 +2404,10 @@ static void _load_dbd_state(void)
 				error("no buffer given");
 				continue;
 			}
-			if (!list_enqueue(agent_list, buffer))
-				fatal("slurmdbd: list_enqueue, no memory");
+			rc = _spool_append(buffer);
+			free_buf(buffer);
+			if (rc != SLURM_SUCCESS)
+				break;
 			recovered++;
 			buffer = NULL;
 		}
@@ -2402,48 +2415,11 @@ static void _load_dbd_state(void)
 	end_it:
 		verbose("slurmdbd: recovered %d pending RPCs", recovered);
 		(void) close(fd);
+		(void) unlink(dbd_fname);
 	}
 	xfree(dbd_fname);
 }
 
-static int _save_dbd_rec(int fd, Buf buffer)
-{
-	ssize_t size, wrote;
-	uint32_t msg_size = get_buf_offset(buffer);
-	uint32_t magic = DBD_MAGIC;
-	char *msg = get_buf_data(buffer);
-
-	size = sizeof(msg_size);
-	wrote = write(fd, &msg_size, size);
-	if (wrote != size) {
-		error("slurmdbd: state save error: %m");
-		return SLURM_ERROR;
-	}
-
-	wrote = 0;
-	while (wrote < msg_size) {
-		wrote = write(fd, msg, msg_size);
-		if (wrote > 0) {
-			msg += wrote;
-			msg_size -= wrote;
-		} else if ((wrote == -1) && (errno == EINTR))
-			continue;
-		else {
-			error("slurmdbd: state save error: %m");
-			return SLURM_ERROR;
-		}
-	}
-
-	size = sizeof(magic);
-	wrote = write(fd, &magic, size);
-	if (wrote != size) {
-		error("slurmdbd: state save error: %m");
-		return SLURM_ERROR;
-	}
-
-	return SLURM_SUCCESS;
-}
-
 static Buf _load_dbd_rec(int fd)
 {
 	ssize_t size, rd_size;
@@ -2502,31 +2478,447 @@ static void _sig_handler(int signal)
 static int _purge_job_start_req(void)
 {
 	int purged = 0;
-	ListIterator iter;
 	uint16_t msg_type;
 	uint32_t offset;
-	Buf buffer;
+	spool_rec_t *rec;
 
-	iter = list_iterator_create(agent_list);
-	while ((buffer = list_next(iter))) {
-		offset = get_buf_offset(buffer);
-		if (offset < 2)
+	for (offset = spool_hdr->head; offset < spool_hdr->tail;
+	     offset += SPOOL_REC_LEN(rec->size)) {
+		rec = _spool_rec(offset);
+		if (rec->flags & SPOOL_REC_PURGED)
 			continue;
-		set_buf_offset(buffer, 0);
-		unpack16(&msg_type, buffer);
-		set_buf_offset(buffer, offset);
+		msg_type = _spool_msg_type(rec);
 		if ((msg_type == DBD_JOB_START) ||
 		    (msg_type == DBD_STEP_START) ||
 		    (msg_type == DBD_STEP_COMPLETE)) {
-			list_remove(iter);
+			rec->flags |= SPOOL_REC_PURGED;
+			spool_hdr->count--;
 			purged++;
 		}
 	}
-	list_iterator_destroy(iter);
 	info("slurmdbd: purge %d job/step start records", purged);
 	return purged;
 }
 
+static spool_rec_t *_spool_rec(uint32_t offset)
+{
+	return (spool_rec_t *) (spool_map + offset);
+}
+
+/* Return the message type of a spooled record, 0 if it has none */
+static uint16_t _spool_msg_type(spool_rec_t *rec)
+{
+	uint16_t msg_type;
+
+	if (rec->size < sizeof(msg_type))
+		return 0;
+	memcpy(&msg_type, rec + 1, sizeof(msg_type));
+	return ntohs(msg_type);
+}
+
+/* Resize the spool kept in memory to size bytes */
+static int _spool_map_mem(uint32_t size)
+{
+	void *map;
+
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (map == MAP_FAILED) {
+		error("slurmdbd: unable to allocate agent queue: %m");
+		return SLURM_ERROR;
+	}
+	if (spool_map) {
+		memcpy(map, spool_map, MIN(size, spool_size));
+		(void) munmap(spool_map, spool_size);
+	}
+	spool_map  = map;
+	spool_hdr  = (spool_hdr_t *) map;
+	spool_size = size;
+	return SLURM_SUCCESS;
+}
+
+/* Map the first size bytes of the spool file, resizing the file to match.
+ * The blocks of the file are allocated before it is mapped, since a write
+ * to a hole of a sparse file on a full file system raises SIGBUS. If they
+ * can not be, an existing spool is moved into memory. */
+static int _spool_map(uint32_t size)
+{
+	void *map;
+	int rc;
+
+	if (spool_fd < 0)
+		return _spool_map_mem(size);
+	if ((size > spool_size) &&
+	    ((rc = posix_fallocate(spool_fd, 0, size)) != 0)) {
+		errno = rc;
+		error("slurmdbd: unable to extend agent spool to %u bytes: %m",
+		      size);
+		if (!spool_map || (_spool_map_mem(size) != SLURM_SUCCESS))
+			return SLURM_ERROR;
+		/* The records are only kept in memory until the spool file
+		 * can be opened again, so don't leave them in it twice */
+		error("slurmdbd: keeping the agent queue in memory until the "
+		      "spool can be extended");
+		if (ftruncate(spool_fd, 0) < 0)
+			error("slurmdbd: unable to truncate agent spool: %m");
+		(void) close(spool_fd);
+		spool_fd = -1;
+		spool_open_time = time(NULL);
+		return SLURM_SUCCESS;
+	}
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		   spool_fd, 0);
+	if (map == MAP_FAILED) {
+		error("slurmdbd: unable to map agent spool: %m");
+		return SLURM_ERROR;
+	}
+	if (spool_map)
+		(void) munmap(spool_map, spool_size);
+	if ((size < spool_size) && (ftruncate(spool_fd, size) < 0))
+		error("slurmdbd: unable to shrink agent spool: %m");
+	spool_map  = map;
+	spool_hdr  = (spool_hdr_t *) map;
+	spool_size = size;
+	return SLURM_SUCCESS;
+}
+
+/* Discard all spooled records */
+static void _spool_reset(void)
+{
+	spool_hdr->magic = SPOOL_MAGIC;
+	spool_hdr->rpc_version = SLURM_PROTOCOL_VERSION;
+	spool_hdr->flags = 0;
+	spool_hdr->count = 0;
+	spool_hdr->head  = sizeof(spool_hdr_t);
+	spool_hdr->tail  = sizeof(spool_hdr_t);
+	if (spool_size > SPOOL_CHUNK)
+		(void) _spool_map(SPOOL_CHUNK);
+}
+
+/* Repack spooled records written with another protocol version */
+static void _spool_convert(void)
+{
+	List conv_list = list_create(slurmdbd_free_buffer);
+	uint16_t rpc_version = spool_hdr->rpc_version;
+	slurmdbd_msg_t msg;
+	spool_rec_t *rec;
+	uint32_t offset;
+	Buf buffer;
+
+	for (offset = spool_hdr->head; offset < spool_hdr->tail;
+	     offset += SPOOL_REC_LEN(rec->size)) {
+		rec = _spool_rec(offset);
+		if (rec->flags & SPOOL_REC_PURGED)
+			continue;
+		buffer = init_buf(rec->size);
+		memcpy(get_buf_data(buffer), rec + 1, rec->size);
+		if (unpack_slurmdbd_msg(&msg, rpc_version, buffer) ==
+		    SLURM_SUCCESS) {
+			list_enqueue(conv_list, pack_slurmdbd_msg(
+					     &msg, SLURM_PROTOCOL_VERSION));
+		} else
+			error("slurmdbd: unable to convert spooled record");
+		free_buf(buffer);
+	}
+
+	_spool_reset();
+	while ((buffer = list_pop(conv_list))) {
+		(void) _spool_append(buffer);
+		free_buf(buffer);
+	}
+	FREE_NULL_LIST(conv_list);
+}
+
+/* Open the agent spool, or keep it in memory if the file can't be opened
+ * so that records are not lost while StateSaveLocation is unusable */
+static int _spool_open(void)
+{
+	if (_spool_open_file() == SLURM_SUCCESS)
+		return SLURM_SUCCESS;
+
+	error("slurmdbd: keeping the agent queue in memory until the spool "
+	      "can be opened");
+	spool_open_time = time(NULL);
+	if (_spool_map(SPOOL_CHUNK) != SLURM_SUCCESS)
+		return SLURM_ERROR;
+	_spool_reset();
+	return SLURM_SUCCESS;
+}
+
+/* Move the records of a spool kept in memory into the spool file, if it can
+ * be opened now. Not called while a batch is being sent. */
+static void _spool_retry_file(void)
+{
+	spool_hdr_t *mem_hdr = spool_hdr;
+	char *mem_map = spool_map;
+	uint32_t mem_size = spool_size, need, offset;
+	spool_rec_t *rec;
+	Buf buffer;
+	int moved = 0;
+
+	if (difftime(time(NULL), spool_open_time) < SPOOL_RETRY)
+		return;
+	spool_open_time = time(NULL);
+
+	spool_hdr  = NULL;
+	spool_map  = NULL;
+	spool_size = 0;
+	if (_spool_open_file() != SLURM_SUCCESS)
+		goto keep_mem;
+	/* Make room for all of the records first, so that none is lost */
+	need = spool_hdr->tail + mem_hdr->tail - mem_hdr->head;
+	if ((need > spool_size) &&
+	    (_spool_map((need / SPOOL_CHUNK + 1) * SPOOL_CHUNK) !=
+	     SLURM_SUCCESS)) {
+		_spool_close();
+		goto keep_mem;
+	}
+
+	for (offset = mem_hdr->head; offset < mem_hdr->tail;
+	     offset += SPOOL_REC_LEN(rec->size)) {
+		rec = (spool_rec_t *) (mem_map + offset);
+		if (rec->flags & SPOOL_REC_PURGED)
+			continue;
+		buffer = init_buf(rec->size);
+		memcpy(get_buf_data(buffer), rec + 1, rec->size);
+		set_buf_offset(buffer, rec->size);
+		if (_spool_append(buffer) != SLURM_SUCCESS)
+			error("slurmdbd: unable to spool a queued record");
+		else
+			moved++;
+		free_buf(buffer);
+	}
+	(void) munmap(mem_map, mem_size);
+	if (spool_fd < 0)	/* The file could not be extended */
+		return;
+	info("slurmdbd: agent spool opened, %d queued RPCs moved to it",
+	     moved);
+	_load_dbd_state();
+	return;
+
+keep_mem:
+	spool_hdr  = mem_hdr;
+	spool_map  = mem_map;
+	spool_size = mem_size;
+}
+
+/* Open and map the agent spool file, recovering the records it holds */
+static int _spool_open_file(void)
+{
+	char *spool_fname;
+	struct stat stat_buf;
+	uint32_t head, tail, offset, size = SPOOL_CHUNK;
+	spool_rec_t *rec;
+
+	spool_fname = slurm_get_state_save_location();
+	xstrcat(spool_fname, "/dbd.spool");
+	spool_fd = open(spool_fname, O_RDWR | O_CREAT, 0600);
+	if (spool_fd < 0) {
+		error("slurmdbd: Opening agent spool %s: %m", spool_fname);
+		xfree(spool_fname);
+		return SLURM_ERROR;
+	}
+	xfree(spool_fname);
+	fd_set_close_on_exec(spool_fd);
+	/* A backup slurmctld shares the StateSaveLocation */
+	if (fd_get_write_lock(spool_fd) < 0) {
+		error("slurmdbd: agent spool in use by another process");
+		(void) close(spool_fd);
+		spool_fd = -1;
+		return SLURM_ERROR;
+	}
+
+	if (fstat(spool_fd, &stat_buf) < 0)
+		stat_buf.st_size = 0;
+	if ((stat_buf.st_size > SPOOL_CHUNK) &&
+	    (stat_buf.st_size < (INFINITE - SPOOL_CHUNK)))
+		size = (stat_buf.st_size + SPOOL_CHUNK - 1) &
+		       (~(SPOOL_CHUNK - 1));
+	if (_spool_map(size) != SLURM_SUCCESS) {
+		(void) close(spool_fd);
+		spool_fd = -1;
+		return SLURM_ERROR;
+	}
+
+	head = spool_hdr->head;
+	tail = spool_hdr->tail;
+	/* Compaction interrupted after the records were moved */
+	if (head > tail)
+		head = sizeof(spool_hdr_t);
+	if ((stat_buf.st_size < sizeof(spool_hdr_t)) ||
+	    (spool_hdr->magic != SPOOL_MAGIC) ||
+	    (head < sizeof(spool_hdr_t)) || (tail > spool_size)) {
+		if (stat_buf.st_size)
+			error("slurmdbd: agent spool corrupted, discarding it");
+		_spool_reset();
+		return SLURM_SUCCESS;
+	}
+
+	/* Validate the records, a record is only counted in the tail once
+	 * it is complete. We do not want to resend registration messages.
+	 * If an admin puts in an incorrect cluster name we can get a
+	 * deadlock unless they add the bogus cluster name to the
+	 * accounting system. */
+	spool_hdr->count = 0;
+	for (offset = head; offset < tail; offset += SPOOL_REC_LEN(rec->size)) {
+		rec = _spool_rec(offset);
+		if (((tail - offset) < sizeof(spool_rec_t)) ||
+		    (rec->magic != DBD_MAGIC) ||
+		    (SPOOL_REC_LEN(rec->size) > (tail - offset))) {
+			error("slurmdbd: agent spool corrupted at offset %u",
+			      offset);
+			tail = offset;
+			break;
+		}
+		if (rec->flags & SPOOL_REC_PURGED)
+			continue;
+		if (_spool_msg_type(rec) == DBD_REGISTER_CTLD)
+			rec->flags |= SPOOL_REC_PURGED;
+		else
+			spool_hdr->count++;
+	}
+	spool_hdr->head = head;
+	spool_hdr->tail = tail;
+
+	if (spool_hdr->rpc_version != SLURM_PROTOCOL_VERSION)
+		_spool_convert();
+	verbose("slurmdbd: recovered %u spooled RPCs", spool_hdr->count);
+	return SLURM_SUCCESS;
+}
+
+static void _spool_close(void)
+{
+	if (!spool_map)
+		return;
+
+	if (spool_fd < 0) {
+		spool_open_time = 0;
+		_spool_retry_file();
+	}
+	if (spool_fd < 0) {
+		error("slurmdbd: unable to save %u pending RPCs",
+		      spool_hdr->count);
+		(void) munmap(spool_map, spool_size);
+		spool_hdr  = NULL;
+		spool_map  = NULL;
+		spool_size = 0;
+		return;
+	}
+
+	verbose("slurmdbd: saved %u pending RPCs", spool_hdr->count);
+	if (msync(spool_map, spool_size, MS_SYNC) < 0)
+		error("slurmdbd: agent spool sync error: %m");
+	(void) munmap(spool_map, spool_size);
+	(void) close(spool_fd);
+	spool_fd   = -1;
+	spool_hdr  = NULL;
+	spool_map  = NULL;
+	spool_size = 0;
+}
+
+/* Append a packed message to the tail of the spool */
+static int _spool_append(Buf buffer)
+{
+	uint32_t size = get_buf_offset(buffer);
+	uint32_t len = SPOOL_REC_LEN(size);
+	uint32_t tail = spool_hdr->tail;
+	spool_rec_t *rec;
+
+	if (len > (INFINITE - SPOOL_CHUNK - tail))
+		return SLURM_ERROR;
+	if (((tail + len) > spool_size) &&
+	    (_spool_map(((tail + len) / SPOOL_CHUNK + 1) * SPOOL_CHUNK) !=
+	     SLURM_SUCCESS))
+		return SLURM_ERROR;
+
+	rec = _spool_rec(tail);
+	rec->magic = DBD_MAGIC;
+	rec->size  = size;
+	rec->flags = 0;
+	rec->pad   = 0;
+	memcpy(rec + 1, get_buf_data(buffer), size);
+	/* Only publish the record once it is complete */
+	spool_hdr->tail = tail + len;
+	spool_hdr->count++;
+	return SLURM_SUCCESS;
+}
+
+/* Reclaim the space of consumed records. Once half of the spool has been
+ * consumed the pending records are moved to its start, they can not
+ * overlap their old copy which remains valid until the header is updated.
+ * Only called by the agent when no batch is being sent. */
+static void _spool_compact(void)
+{
+	uint32_t head = spool_hdr->head, tail = spool_hdr->tail;
+	uint32_t size;
+
+	if (head == tail) {
+		if (head != sizeof(spool_hdr_t))
+			_spool_reset();
+		return;
+	}
+	if ((head - sizeof(spool_hdr_t)) < (spool_size / 2))
+		return;
+
+	memcpy(spool_map + sizeof(spool_hdr_t), spool_map + head, tail - head);
+	spool_hdr->tail = sizeof(spool_hdr_t) + tail - head;
+	spool_hdr->head = sizeof(spool_hdr_t);
+	size = (spool_hdr->tail / SPOOL_CHUNK + 1) * SPOOL_CHUNK;
+	if (size < spool_size)
+		(void) _spool_map(size);
+}
+
+/* Copy the oldest pending records, up to MAX_AGENT_BATCH_CNT records and
+ * MAX_AGENT_BATCH_SIZE bytes, into buffers to be sent. Their offsets are
+ * kept for _spool_ack().
+ * RET list of buffers, free with FREE_NULL_LIST() */
+static List _spool_batch(void)
+{
+	List batch_list = list_create(slurmdbd_free_buffer);
+	uint32_t offset, batch_size = 0;
+	spool_rec_t *rec;
+	Buf buffer;
+
+	batch_cnt = batch_acked = 0;
+	for (offset = spool_hdr->head; offset < spool_hdr->tail;
+	     offset += SPOOL_REC_LEN(rec->size)) {
+		rec = _spool_rec(offset);
+		if (rec->flags & SPOOL_REC_PURGED)
+			continue;
+		batch_size += rec->size;
+		if (batch_cnt && ((batch_cnt >= MAX_AGENT_BATCH_CNT) ||
+				  (batch_size > MAX_AGENT_BATCH_SIZE)))
+			break;
+		buffer = init_buf(rec->size);
+		memcpy(get_buf_data(buffer), rec + 1, rec->size);
+		set_buf_offset(buffer, rec->size);
+		list_enqueue(batch_list, buffer);
+		batch_off[batch_cnt++] = offset;
+	}
+
+	return batch_list;
+}
+
+/* Consume the next record of the batch being sent, along with any records
+ * purged ahead of it
+ * RET SLURM_SUCCESS or SLURM_ERROR if the batch has been consumed */
+static int _spool_ack(void)
+{
+	spool_rec_t *rec;
+	uint32_t offset;
+
+	if (batch_acked >= batch_cnt)
+		return SLURM_ERROR;
+
+	offset = batch_off[batch_acked++];
+	rec = _spool_rec(offset);
+	/* Purged while being sent, it was uncounted then */
+	if (!(rec->flags & SPOOL_REC_PURGED))
+		spool_hdr->count--;
+	spool_hdr->head = offset + SPOOL_REC_LEN(rec->size);
+	return SLURM_SUCCESS;
+}
+
 /****************************************************************************\
  * Free data structures
 \****************************************************************************/
@@ -2594,6 +2986,7 @@ extern void slurmdbd_free_cond_msg(dbd_cond_msg_t *msg,
 			my_destroy = slurmdb_destroy_cluster_cond;
 			break;
 		case DBD_GET_JOBS_COND:
+		case DBD_GET_JOBS_PAGE:
 			my_destroy = slurmdb_destroy_job_cond;
 			break;
 		case DBD_GET_QOS:
@@ -3006,6 +3399,7 @@ extern void slurmdbd_pack_cond_msg(dbd_cond_msg_t *msg,
 		my_function = slurmdb_pack_cluster_cond;
 		break;
 	case DBD_GET_JOBS_COND:
+	case DBD_GET_JOBS_PAGE:
 		my_function = slurmdb_pack_job_cond;
 		break;
 	case DBD_GET_QOS:
@@ -3042,6 +3436,22 @@ extern void slurmdbd_pack_cond_msg(dbd_cond_msg_t *msg,
 	}
 
 	(*(my_function))(msg->cond, rpc_version, buffer);
+
+	/* The paging fields follow the condition so that its own format
+	 * stays the same for slurmdbds which only know DBD_GET_JOBS_COND */
+	if (type == DBD_GET_JOBS_PAGE) {
+		slurmdb_job_cond_t *job_cond = msg->cond;
+
+		if (job_cond) {
+			packstr(job_cond->cursor_cluster, buffer);
+			pack32(job_cond->cursor_jobid, buffer);
+			pack32(job_cond->page_size, buffer);
+		} else {
+			packnull(buffer);
+			pack32(0, buffer);
+			pack32(0, buffer);
+		}
+	}
 }
 
 extern int slurmdbd_unpack_cond_msg(dbd_cond_msg_t **msg,
@@ -3069,6 +3479,7 @@ extern int slurmdbd_unpack_cond_msg(dbd_cond_msg_t **msg,
 		my_function = slurmdb_unpack_cluster_cond;
 		break;
 	case DBD_GET_JOBS_COND:
+	case DBD_GET_JOBS_PAGE:
 		my_function = slurmdb_unpack_job_cond;
 		break;
 	case DBD_GET_QOS:
@@ -3110,6 +3521,16 @@ extern int slurmdbd_unpack_cond_msg(dbd_cond_msg_t **msg,
 	if ((*(my_function))(&msg_ptr->cond, rpc_version, buffer) == SLURM_ERROR)
 		goto unpack_error;
 
+	if (type == DBD_GET_JOBS_PAGE) {
+		slurmdb_job_cond_t *job_cond = msg_ptr->cond;
+		uint32_t uint32_tmp;
+
+		safe_unpackstr_xmalloc(&job_cond->cursor_cluster, &uint32_tmp,
+				       buffer);
+		safe_unpack32(&job_cond->cursor_jobid, buffer);
+		safe_unpack32(&job_cond->page_size, buffer);
+	}
+
 	return SLURM_SUCCESS;
 
 unpack_error:
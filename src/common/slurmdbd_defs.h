@@ -157,6 +157,9 @@ typedef enum {
 	DBD_GET_TRES,         /* Get tres from the database         */
 	DBD_GOT_TRES,         /* Got tres from the database         */
 	DBD_FIX_RUNAWAY_JOB,    /* Fix any runaway jobs */
+	DBD_GET_JOBS_PAGE,	/* Get a page of job information with a
+				 * condition, see page_size in
+				 * slurmdb_job_cond_t */
 } slurmdbd_msg_type_t;
 
 /*****************************************************************************\
@@ -49,6 +49,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/param.h>	/* MAXPATHLEN */
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -95,6 +96,17 @@ _slurm_authorized_user()
  * side of the unix domain socket.
  * If the socket is at least 10 minutes old, then unlink it.
  */
+/* Remove the state file of a step whose socket is stray */
+static void _handle_stray_shm(const char *socket_name)
+{
+	char *shm_name = xstrdup_printf("%s.shm", socket_name);
+
+	if ((unlink(shm_name) == -1) && (errno != ENOENT)) {
+		error("%s: unable to clean up %s: %m", __func__, shm_name);
+	}
+	xfree(shm_name);
+}
+
 static void
 _handle_stray_socket(const char *socket_name)
 {
@@ -130,6 +142,7 @@ _handle_stray_socket(const char *socket_name)
 		} else {
 			debug("Cleaned up stray socket %s", socket_name);
 		}
+		_handle_stray_shm(socket_name);
 	}
 }
 
@@ -702,6 +715,7 @@ stepd_cleanup_sockets(const char *directory, const char *nodename)
 				      path);
 				rc = SLURM_ERROR;
 			}
+			_handle_stray_shm(path);
 			xfree(path);
 		}
 	}
@@ -1009,6 +1023,102 @@ rwfail:
 	return rc;
 }
 
+extern char *stepd_shm_name(const char *directory, const char *nodename,
+			    uint32_t jobid, uint32_t stepid)
+{
+	return xstrdup_printf("%s/%s_%u.%u.shm", directory, nodename,
+			      jobid, stepid);
+}
+
+extern int stepd_shm_stat(const char *directory, const char *nodename,
+			  uint32_t jobid, uint32_t stepid, time_t max_age,
+			  uid_t *uid, job_step_stat_t *resp)
+{
+	volatile stepd_shm_t *shm;
+	stepd_shm_t hdr;
+	struct stat stat_buf;
+	char *name, *data = NULL;
+	uint32_t seq, data_len = 0, *pids;
+	int fd, i, rc = SLURM_ERROR;
+	void *map;
+	Buf buffer;
+
+	name = stepd_shm_name(directory, nodename, jobid, stepid);
+	fd = open(name, O_RDONLY | O_CLOEXEC);
+	xfree(name);
+	if (fd < 0)
+		return SLURM_ERROR;
+	if ((fstat(fd, &stat_buf) < 0) ||
+	    (stat_buf.st_size < sizeof(stepd_shm_t))) {
+		close(fd);
+		return SLURM_ERROR;
+	}
+	map = mmap(NULL, stat_buf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return SLURM_ERROR;
+	shm = (volatile stepd_shm_t *) map;
+	memset(&hdr, 0, sizeof(stepd_shm_t));
+
+	/* Copy a consistent snapshot, retry if updated while copying */
+	for (i = 0; i < 10; i++) {
+		seq = shm->seq;
+		if (seq & 1) {
+			sched_yield();
+			continue;
+		}
+		__sync_synchronize();
+		memcpy(&hdr, (void *) shm, sizeof(stepd_shm_t));
+		data_len = hdr.jobacct_len + hdr.pid_cnt * sizeof(uint32_t);
+		if ((hdr.magic != STEPD_SHM_MAGIC) ||
+		    (hdr.version != STEPD_SHM_VERSION) ||
+		    (hdr.hdr_size != sizeof(stepd_shm_t)) ||
+		    (data_len > (stat_buf.st_size - sizeof(stepd_shm_t))))
+			break;
+		xrealloc(data, MAX(data_len, 1));
+		memcpy(data, (char *) map + sizeof(stepd_shm_t), data_len);
+		__sync_synchronize();
+		if (shm->seq == seq) {
+			rc = SLURM_SUCCESS;
+			break;
+		}
+	}
+	munmap(map, stat_buf.st_size);
+
+	if ((rc != SLURM_SUCCESS) || !hdr.sample_time || !hdr.jobacct_len ||
+	    (hdr.state != SLURMSTEPD_STEP_RUNNING) ||
+	    ((time(NULL) - hdr.sample_time) > max_age)) {
+		xfree(data);
+		return SLURM_ERROR;
+	}
+
+	if (!(resp->jobacct = jobacctinfo_create(NULL))) {
+		xfree(data);
+		return SLURM_ERROR;
+	}
+	buffer = create_buf(data, hdr.jobacct_len);
+	rc = jobacctinfo_unpack((jobacctinfo_t **) &resp->jobacct,
+				hdr.protocol_version, PROTOCOL_TYPE_SLURM,
+				buffer, 0);
+	if (rc == SLURM_SUCCESS) {
+		*uid = (uid_t) hdr.uid;
+		resp->num_tasks = hdr.num_tasks;
+		if (resp->step_pids && hdr.pid_cnt) {
+			pids = xmalloc(hdr.pid_cnt * sizeof(uint32_t));
+			memcpy(pids, data + hdr.jobacct_len,
+			       hdr.pid_cnt * sizeof(uint32_t));
+			resp->step_pids->pid = pids;
+			resp->step_pids->pid_cnt = hdr.pid_cnt;
+		}
+	} else {
+		jobacctinfo_destroy(resp->jobacct);
+		resp->jobacct = NULL;
+	}
+	free_buf(buffer);		/* frees data */
+
+	return rc;
+}
+
 /*
  * List all of task process IDs and their local and global SLURM IDs.
  *
@@ -104,6 +104,33 @@ typedef struct {
 	int             estatus;    /* exit status if exited is true*/
 } slurmstepd_task_info_t;
 
+#define STEPD_SHM_MAGIC	0x5354504d	/* "STPM" */
+#define STEPD_SHM_VERSION 1		/* change with stepd_shm_t's layout */
+#define STEPD_SHM_SIZE	(64 * 1024)	/* bytes */
+
+/*
+ * Step state published by slurmstepd after each accounting poll in a file
+ * next to its socket, so that local readers need not connect to it.
+ * Written by a single thread as a sequence lock: seq is odd while the
+ * record is being updated. Followed by jobacct_len bytes of packed
+ * jobacctinfo_t and pid_cnt uint32_t process IDs. magic, version and
+ * hdr_size must stay first so that a reader from another Slurm version
+ * can tell it does not understand the rest.
+ */
+typedef struct {
+	uint32_t magic;
+	uint16_t version;		/* STEPD_SHM_VERSION */
+	uint16_t hdr_size;		/* sizeof(stepd_shm_t) */
+	uint32_t seq;
+	uint16_t protocol_version;	/* of the packed jobacct */
+	uint32_t uid;
+	uint32_t state;			/* slurmstepd_state_t */
+	time_t   sample_time;		/* 0 until the first poll */
+	uint32_t num_tasks;
+	uint32_t pid_cnt;
+	uint32_t jobacct_len;
+} stepd_shm_t;
+
 typedef struct step_location {
 	uint32_t jobid;
 	uint32_t stepid;
@@ -266,6 +293,27 @@ int stepd_stat_jobacct(int fd, uint16_t protocol_version,
 		       job_step_id_msg_t *sent, job_step_stat_t *resp);
 
 
+/*
+ * Name of the file in which a step's slurmstepd publishes its state,
+ * must be xfree'd
+ */
+extern char *stepd_shm_name(const char *directory, const char *nodename,
+			    uint32_t jobid, uint32_t stepid);
+
+/*
+ * Read a step's accounting data and process IDs from the file published
+ * by its slurmstepd, without connecting to it.
+ * IN max_age - seconds since the last poll after which the data is stale
+ * OUT uid - owner of the step
+ * OUT resp - jobacct, num_tasks and, if step_pids is set, the pids
+ * RET SLURM_SUCCESS, or SLURM_ERROR if not published, stale or written
+ *     with another layout version, in which case stepd_stat_jobacct()
+ *     must be used
+ */
+extern int stepd_shm_stat(const char *directory, const char *nodename,
+			  uint32_t jobid, uint32_t stepid, time_t max_age,
+			  uid_t *uid, job_step_stat_t *resp);
+
 int stepd_task_info(int fd, uint16_t protocol_version,
 		    slurmstepd_task_info_t **task_info,
 		    uint32_t *task_info_count);
@@ -53,6 +53,23 @@
 #include "src/common/macros.h"
 #include "src/common/xmalloc.h"
 
+/* Size of the chunks arena memory is carved from. Larger requests are
+ * given a chunk of their own. */
+#define XARENA_CHUNK_SIZE	(64 * 1024)
+#define XARENA_LARGE_SIZE	(XARENA_CHUNK_SIZE / 4)
+
+/* Each arena block is preceded by four words: padding, the owning arena,
+ * XARENA_MAGIC and the block size. The last two are laid out as in an
+ * xmalloc() header, so xsize() and xfree() work on arena memory too. */
+#define XARENA_HDR_WORDS	4
+#define XARENA_ALIGN		(2 * sizeof(size_t))
+
+struct xarena {
+	void *chunks;		/* chunk list, linked through first word */
+	char *next;		/* next free byte in current chunk */
+	size_t left;		/* bytes left in current chunk */
+};
+
 #if NDEBUG
 #  define xmalloc_assert(expr)  ((void) (0))
 #else
@@ -128,7 +145,19 @@ extern void * slurm_xrealloc(void **item, size_t newsize, bool clear,
 {
 	size_t *p = NULL;
 
-	if (*item != NULL) {
+	if ((*item != NULL) && (((size_t *)*item)[-2] == XARENA_MAGIC)) {
+		/* arena memory can not grow in place, move it to the heap */
+		size_t old_size = ((size_t *)*item)[-1];
+
+		p = malloc(newsize + 2*sizeof(size_t));
+		if (p == NULL)
+			goto error;
+		p[0] = XMALLOC_MAGIC;
+		memcpy(&p[2], *item, MIN(old_size, newsize));
+		if (clear && (old_size < newsize))
+			memset((char *)(&p[2]) + old_size, 0,
+			       (newsize - old_size));
+	} else if (*item != NULL) {
 		size_t old_size;
 		p = (size_t *)*item - 2;
 
@@ -177,7 +206,19 @@ int slurm_try_xrealloc(void **item, size_t newsize,
 {
 	size_t *p = NULL;
 
-	if (*item != NULL) {
+	if ((*item != NULL) && (((size_t *)*item)[-2] == XARENA_MAGIC)) {
+		/* arena memory can not grow in place, move it to the heap */
+		size_t old_size = ((size_t *)*item)[-1];
+
+		p = malloc(newsize + 2*sizeof(size_t));
+		if (p == NULL)
+			return 0;
+		p[0] = XMALLOC_MAGIC;
+		memcpy(&p[2], *item, MIN(old_size, newsize));
+		if (old_size < newsize)
+			memset((char *)(&p[2]) + old_size, 0,
+			       (newsize - old_size));
+	} else if (*item != NULL) {
 		size_t old_size;
 		p = (size_t *)*item - 2;
 
@@ -218,7 +259,8 @@ size_t slurm_xsize(void *item, const char *file, int line, const char *func)
 {
 	size_t *p = (size_t *)item - 2;
 	xmalloc_assert(item != NULL);
-	xmalloc_assert(p[0] == XMALLOC_MAGIC); /* CLANG false positive here */
+	/* CLANG false positive here */
+	xmalloc_assert((p[0] == XMALLOC_MAGIC) || (p[0] == XARENA_MAGIC));
 	return p[1];
 }
 
@@ -231,6 +273,12 @@ void slurm_xfree(void **item, const char *file, int line, const char *func)
 {
 	if (*item != NULL) {
 		size_t *p = (size_t *)*item - 2;
+		if (p[0] == XARENA_MAGIC) {
+			/* released by xarena_destroy() */
+			p[0] = 0;
+			*item = NULL;
+			return;
+		}
 		/* magic cookie still there? */
 		xmalloc_assert(p[0] == XMALLOC_MAGIC);
 		p[0] = 0;	/* make sure xfree isn't called twice */
@@ -239,6 +287,99 @@ void slurm_xfree(void **item, const char *file, int line, const char *func)
 	}
 }
 
+/*
+ * Create an arena for memory which is all released at the same time.
+ * RETURN	arena to pass to xarena_alloc(), free with xarena_destroy()
+ */
+xarena_t *xarena_create(void)
+{
+	return xmalloc(sizeof(xarena_t));
+}
+
+/*
+ * Release an arena and all memory allocated from it.
+ */
+void xarena_destroy(xarena_t *arena)
+{
+	void *chunk;
+
+	if (!arena)
+		return;
+	while ((chunk = arena->chunks)) {
+		arena->chunks = *(void **) chunk;
+		free(chunk);
+	}
+	xfree(arena);
+}
+
+/*
+ * Return the arena from which item was allocated, NULL if item is not
+ * arena memory.
+ */
+xarena_t *xarena_find(void *item)
+{
+	size_t *p = (size_t *)item - XARENA_HDR_WORDS;
+
+	if (!item || (p[2] != XARENA_MAGIC))
+		return NULL;
+	return (xarena_t *) p[1];
+}
+
+/* Add a chunk with room for at least size bytes to the arena */
+static char *_xarena_chunk(xarena_t *arena, size_t size,
+			   const char *file, int line, const char *func)
+{
+	char *chunk;
+
+	if (!(chunk = malloc(XARENA_ALIGN + size))) {
+		log_oom(file, line, func);
+		abort();
+	}
+	*(void **) chunk = arena->chunks;
+	arena->chunks = chunk;
+	return chunk + XARENA_ALIGN;
+}
+
+/*
+ * Allocate memory from an arena. The memory is released by
+ * xarena_destroy(), xfree() only clears the pointer to it.
+ *   arena (IN)	arena from xarena_create()
+ *   size (IN)	number of bytes to allocate
+ *   clear (IN)	initialize to zero
+ *   RETURN	pointer to allocated space
+ */
+void *slurm_xarena_alloc(xarena_t *arena, size_t size, bool clear,
+			 const char *file, int line, const char *func)
+{
+	size_t total_size;
+	size_t *p;
+
+	total_size = XARENA_HDR_WORDS * sizeof(size_t) + size;
+	total_size = (total_size + XARENA_ALIGN - 1) & ~(XARENA_ALIGN - 1);
+
+	if (total_size > XARENA_LARGE_SIZE) {
+		p = (size_t *) _xarena_chunk(arena, total_size,
+					     file, line, func);
+	} else {
+		if (total_size > arena->left) {
+			arena->next = _xarena_chunk(arena, XARENA_CHUNK_SIZE,
+						    file, line, func);
+			arena->left = XARENA_CHUNK_SIZE;
+		}
+		p = (size_t *) arena->next;
+		arena->next += total_size;
+		arena->left -= total_size;
+	}
+
+	p[0] = 0;
+	p[1] = (size_t) arena;
+	p[2] = XARENA_MAGIC;
+	p[3] = size;
+	if (clear)
+		memset(&p[XARENA_HDR_WORDS], 0, size);
+	return &p[XARENA_HDR_WORDS];
+}
+
 #ifndef NDEBUG
 static void malloc_assert_failed(char *expr, const char *file,
 		                 int line, const char *caller, const char *func)
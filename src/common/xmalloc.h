@@ -71,6 +71,14 @@
  * p. The memory must have been allocated with [try_]xmalloc() or
  * [try_]xrealloc().
  *
+ * xarena_create() returns an arena from which xarena_alloc(arena, size) and
+ * xarena_alloc_nz(arena, size) carve memory out of large chunks. Arena
+ * memory may be passed to xfree(), which only clears the pointer, to
+ * xrealloc(), which moves it to a regular xmalloc() allocation, and to
+ * xsize(). The memory is released all at once by xarena_destroy(arena).
+ * xarena_find(p) returns the arena p was allocated from, or NULL if p is a
+ * regular allocation.
+ *
 \*****************************************************************************/
 
 #ifndef _XMALLOC_H
@@ -116,6 +124,23 @@ void *slurm_xrealloc(void **, size_t, bool, const char *, int, const char *);
 int  slurm_try_xrealloc(void **, size_t, const char *, int, const char *);
 size_t slurm_xsize(void *, const char *, int, const char *);
 
+#define xarena_alloc(__arena, __sz) \
+	slurm_xarena_alloc(__arena, __sz, true, \
+			   __FILE__, __LINE__, __CURRENT_FUNC__)
+
+#define xarena_alloc_nz(__arena, __sz) \
+	slurm_xarena_alloc(__arena, __sz, false, \
+			   __FILE__, __LINE__, __CURRENT_FUNC__)
+
+typedef struct xarena xarena_t;
+
+xarena_t *xarena_create(void);
+void xarena_destroy(xarena_t *arena);
+xarena_t *xarena_find(void *item);
+void *slurm_xarena_alloc(xarena_t *, size_t, bool, const char *, int,
+			 const char *);
+
 #define XMALLOC_MAGIC 0x42
+#define XARENA_MAGIC 0x43
 
 #endif /* !_XMALLOC_H */
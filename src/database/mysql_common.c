@@ -48,6 +48,11 @@
 
 static char *table_defs_table = "table_defs_table";
 
+/* Bounds on a multi-row insert built by mysql_db_batch_insert(), the size
+ * must stay well below MySQL's default max_allowed_packet */
+#define MAX_BATCH_ROWS	500
+#define MAX_BATCH_SIZE	(1024 * 1024)
+
 typedef struct {
 	char *name;
 	char *columns;
@@ -172,6 +177,37 @@ end_it:
 	return rc;
 }
 
+/* NOTE: Insure that mysql_conn->lock is set on function entry */
+static void _batch_clear(mysql_conn_t *mysql_conn)
+{
+	xfree(mysql_conn->batch_prefix);
+	xfree(mysql_conn->batch_query);
+	xfree(mysql_conn->batch_suffix);
+	mysql_conn->batch_rows = 0;
+}
+
+/* Run the pending multi-row insert, if any, see mysql_db_batch_insert().
+ * Errors are logged by _mysql_query_internal(). The rows of a failed
+ * insert were already reported as added, so the transaction is marked
+ * as failed until the next commit or rollback.
+ * NOTE: Insure that mysql_conn->lock is set on function entry */
+static int _batch_flush(mysql_conn_t *mysql_conn)
+{
+	int rc;
+
+	if (!mysql_conn->batch_query)
+		return SLURM_SUCCESS;
+
+	if (mysql_conn->batch_suffix)
+		xstrcat(mysql_conn->batch_query, mysql_conn->batch_suffix);
+	rc = _mysql_query_internal(mysql_conn->db_conn,
+				   mysql_conn->batch_query);
+	_batch_clear(mysql_conn);
+	if (rc != SLURM_SUCCESS)
+		mysql_conn->batch_failed = true;
+	return rc;
+}
+
 /* NOTE: Insure that mysql_conn->lock is NOT set on function entry */
 static int _mysql_make_table_current(mysql_conn_t *mysql_conn, char *table_name,
 				     storage_field_t *fields, char *ending)
@@ -611,6 +647,7 @@ extern int destroy_mysql_conn(mysql_conn_t *mysql_conn)
 {
 	if (mysql_conn) {
 		mysql_db_close_db_connection(mysql_conn);
+		_batch_clear(mysql_conn);
 		xfree(mysql_conn->pre_commit_query);
 		xfree(mysql_conn->cluster_name);
 		slurm_mutex_destroy(&mysql_conn->lock);
@@ -666,8 +703,10 @@ extern int destroy_mysql_db_info(mysql_db_info_t *db_info)
 	return SLURM_SUCCESS;
 }
 
-extern int mysql_db_get_db_connection(mysql_conn_t *mysql_conn, char *db_name,
-				      mysql_db_info_t *db_info)
+/* Connect to db_name, creating it if create is set, otherwise any failure
+ * leaves mysql_conn without a connection */
+static int _get_db_connection(mysql_conn_t *mysql_conn, char *db_name,
+			      mysql_db_info_t *db_info, bool create)
 {
 	int rc = SLURM_SUCCESS;
 	bool storage_init = false;
@@ -702,7 +741,7 @@ extern int mysql_db_get_db_connection(mysql_conn_t *mysql_conn, char *db_name,
 					        db_name, db_info->port, NULL,
 					        CLIENT_MULTI_STATEMENTS)) {
 				int err = mysql_errno(mysql_conn->db_conn);
-				if (err == ER_BAD_DB_ERROR) {
+				if ((err == ER_BAD_DB_ERROR) && create) {
 					debug("Database %s not created.  "
 					      "Creating", db_name);
 					rc = _create_db(db_name, db_info);
@@ -732,6 +771,11 @@ extern int mysql_db_get_db_connection(mysql_conn_t *mysql_conn, char *db_name,
 					mysql_conn->db_conn,
 					"SET session sql_mode='ANSI_QUOTES,"
 					"NO_ENGINE_SUBSTITUTION';");
+				if ((rc != SLURM_SUCCESS) && !create) {
+					rc = ESLURM_DB_CONNECTION;
+					mysql_close(mysql_conn->db_conn);
+					mysql_conn->db_conn = NULL;
+				}
 			}
 		}
 	}
@@ -740,9 +784,24 @@ extern int mysql_db_get_db_connection(mysql_conn_t *mysql_conn, char *db_name,
 	return rc;
 }
 
+extern int mysql_db_get_db_connection(mysql_conn_t *mysql_conn, char *db_name,
+				      mysql_db_info_t *db_info)
+{
+	return _get_db_connection(mysql_conn, db_name, db_info, true);
+}
+
+extern int mysql_db_get_replica_connection(mysql_conn_t *mysql_conn,
+					   char *db_name,
+					   mysql_db_info_t *db_info)
+{
+	return _get_db_connection(mysql_conn, db_name, db_info, false);
+}
+
 extern int mysql_db_close_db_connection(mysql_conn_t *mysql_conn)
 {
 	slurm_mutex_lock(&mysql_conn->lock);
+	_batch_clear(mysql_conn);	/* transaction is lost */
+	mysql_conn->batch_failed = false;
 	if (mysql_conn && mysql_conn->db_conn) {
 		if (mysql_thread_safe())
 			mysql_thread_end();
@@ -775,7 +834,56 @@ extern int mysql_db_query(mysql_conn_t *mysql_conn, char *query)
 		return 0;	/* For CLANG false positive */
 	}
 	slurm_mutex_lock(&mysql_conn->lock);
-	rc = _mysql_query_internal(mysql_conn->db_conn, query);
+	if ((rc = _batch_flush(mysql_conn)) == SLURM_SUCCESS)
+		rc = _mysql_query_internal(mysql_conn->db_conn, query);
+	slurm_mutex_unlock(&mysql_conn->lock);
+	return rc;
+}
+
+extern int mysql_db_batch_insert(mysql_conn_t *mysql_conn, char *prefix,
+				 char *row, char *suffix)
+{
+	int rc = SLURM_SUCCESS;
+
+	if (!mysql_conn || !mysql_conn->db_conn) {
+		fatal("You haven't inited this storage yet.");
+		return 0;	/* For CLANG false positive */
+	}
+	slurm_mutex_lock(&mysql_conn->lock);
+	if (mysql_conn->batch_query &&
+	    (xstrcmp(prefix, mysql_conn->batch_prefix) ||
+	     xstrcmp(suffix, mysql_conn->batch_suffix)))
+		rc = _batch_flush(mysql_conn);
+
+	if (!mysql_conn->batch_query) {
+		mysql_conn->batch_prefix = xstrdup(prefix);
+		mysql_conn->batch_suffix = xstrdup(suffix);
+		mysql_conn->batch_query = xstrdup_printf("%s(%s)", prefix, row);
+	} else
+		xstrfmtcat(mysql_conn->batch_query, ", (%s)", row);
+	mysql_conn->batch_rows++;
+
+	/* Without a transaction to end with a commit, run right away */
+	if (!mysql_conn->rollback ||
+	    (mysql_conn->batch_rows >= MAX_BATCH_ROWS) ||
+	    (strlen(mysql_conn->batch_query) >= MAX_BATCH_SIZE)) {
+		if (_batch_flush(mysql_conn) != SLURM_SUCCESS)
+			rc = SLURM_ERROR;
+	}
+	slurm_mutex_unlock(&mysql_conn->lock);
+	return rc;
+}
+
+extern int mysql_db_batch_flush(mysql_conn_t *mysql_conn)
+{
+	int rc;
+
+	if (!mysql_conn || !mysql_conn->db_conn) {
+		fatal("You haven't inited this storage yet.");
+		return 0;	/* For CLANG false positive */
+	}
+	slurm_mutex_lock(&mysql_conn->lock);
+	rc = _batch_flush(mysql_conn);
 	slurm_mutex_unlock(&mysql_conn->lock);
 	return rc;
 }
@@ -793,7 +901,8 @@ extern int mysql_db_delete_affected_rows(mysql_conn_t *mysql_conn, char *query)
 		return 0;	/* For CLANG false positive */
 	}
 	slurm_mutex_lock(&mysql_conn->lock);
-	if (!(rc = _mysql_query_internal(mysql_conn->db_conn, query)))
+	if (((rc = _batch_flush(mysql_conn)) == SLURM_SUCCESS) &&
+	    !(rc = _mysql_query_internal(mysql_conn->db_conn, query)))
 		rc = mysql_affected_rows(mysql_conn->db_conn);
 	slurm_mutex_unlock(&mysql_conn->lock);
 	return rc;
@@ -822,9 +931,18 @@ extern int mysql_db_commit(mysql_conn_t *mysql_conn)
 		return SLURM_ERROR;
 
 	slurm_mutex_lock(&mysql_conn->lock);
+	(void) _batch_flush(mysql_conn);
 	/* clear out the old results so we don't get a 2014 error */
 	_clear_results(mysql_conn->db_conn);
-	if (mysql_commit(mysql_conn->db_conn)) {
+	if (mysql_conn->batch_failed) {
+		/* Rows reported as added were lost, so nothing is kept
+		 * and the caller must redo the whole transaction. */
+		error("mysql_commit: a deferred insert failed, "
+		      "rolling back");
+		mysql_conn->batch_failed = false;
+		(void) mysql_rollback(mysql_conn->db_conn);
+		rc = SLURM_ERROR;
+	} else if (mysql_commit(mysql_conn->db_conn)) {
 		error("mysql_commit failed: %d %s",
 		      mysql_errno(mysql_conn->db_conn),
 		      mysql_error(mysql_conn->db_conn));
@@ -843,6 +961,8 @@ extern int mysql_db_rollback(mysql_conn_t *mysql_conn)
 		return SLURM_ERROR;
 
 	slurm_mutex_lock(&mysql_conn->lock);
+	_batch_clear(mysql_conn);
+	mysql_conn->batch_failed = false;
 	/* clear out the old results so we don't get a 2014 error */
 	_clear_results(mysql_conn->db_conn);
 	if (mysql_rollback(mysql_conn->db_conn)) {
@@ -863,6 +983,8 @@ extern MYSQL_RES *mysql_db_query_ret(mysql_conn_t *mysql_conn,
 	MYSQL_RES *result = NULL;
 
 	slurm_mutex_lock(&mysql_conn->lock);
+	if (_batch_flush(mysql_conn) != SLURM_SUCCESS)
+		goto fini;
 	if (_mysql_query_internal(mysql_conn->db_conn, query) != SLURM_ERROR)  {
 		if (mysql_errno(mysql_conn->db_conn) == ER_NO_SUCH_TABLE)
 			goto fini;
@@ -887,8 +1009,9 @@ extern int mysql_db_query_check_after(mysql_conn_t *mysql_conn, char *query)
 	int rc = SLURM_SUCCESS;
 
 	slurm_mutex_lock(&mysql_conn->lock);
-	if ((rc = _mysql_query_internal(
-		     mysql_conn->db_conn, query)) != SLURM_ERROR)
+	if (((rc = _batch_flush(mysql_conn)) == SLURM_SUCCESS) &&
+	    ((rc = _mysql_query_internal(
+		      mysql_conn->db_conn, query)) != SLURM_ERROR))
 		rc = _clear_results(mysql_conn->db_conn);
 	slurm_mutex_unlock(&mysql_conn->lock);
 	return rc;
@@ -899,7 +1022,9 @@ extern int mysql_db_insert_ret_id(mysql_conn_t *mysql_conn, char *query)
 	int new_id = 0;
 
 	slurm_mutex_lock(&mysql_conn->lock);
-	if (_mysql_query_internal(mysql_conn->db_conn, query) != SLURM_ERROR)  {
+	if ((_batch_flush(mysql_conn) == SLURM_SUCCESS) &&
+	    (_mysql_query_internal(mysql_conn->db_conn, query) !=
+	     SLURM_ERROR)) {
 		new_id = mysql_insert_id(mysql_conn->db_conn);
 		if (!new_id) {
 			/* should have new id */
@@ -70,11 +70,19 @@ typedef enum {
 } slurm_mysql_plugin_type_t;
 
 typedef struct {
+	bool batch_failed;	/* a deferred insert failed, so the
+				 * transaction can't be committed */
+	char *batch_prefix;	/* multi-row insert being built, see */
+	char *batch_query;	/* mysql_db_batch_insert() */
+	uint32_t batch_rows;
+	char *batch_suffix;
 	bool cluster_deleted;
 	char *cluster_name;
 	MYSQL *db_conn;
 	pthread_mutex_t lock;
 	char *pre_commit_query;
+	bool replica;		/* connected to a read only replica, see
+				 * mysql_db_get_replica_connection() */
 	bool rollback;
 	List update_list;
 	int conn;
@@ -101,6 +109,14 @@ extern int destroy_mysql_db_info(mysql_db_info_t *db_info);
 
 extern int mysql_db_get_db_connection(mysql_conn_t *mysql_conn, char *db_name,
 				   mysql_db_info_t *db_info);
+/*
+ * Connect to an existing database, such as a replica, which must never be
+ * created or written to. Every failure, including a missing database,
+ * returns ESLURM_DB_CONNECTION and leaves mysql_conn unconnected.
+ */
+extern int mysql_db_get_replica_connection(mysql_conn_t *mysql_conn,
+					   char *db_name,
+					   mysql_db_info_t *db_info);
 extern int mysql_db_close_db_connection(mysql_conn_t *mysql_conn);
 extern int mysql_db_cleanup();
 extern int mysql_db_query(mysql_conn_t *mysql_conn, char *query);
@@ -115,6 +131,25 @@ extern int mysql_db_query_check_after(mysql_conn_t *mysql_conn, char *query);
 
 extern int mysql_db_insert_ret_id(mysql_conn_t *mysql_conn, char *query);
 
+/*
+ * Add a row to a multi-row "insert ... values" statement that is run before
+ * the next query on the connection, at commit, or once enough rows are
+ * pending, so that statements still run in the order they were issued.
+ * Rows added with a different prefix or suffix start a new statement.
+ * If the statement fails later, the query that ran it fails without being
+ * run, and mysql_db_commit() rolls the transaction back and fails.
+ * IN prefix - "insert into ... (columns) values "
+ * IN row - values of the row, without the parentheses
+ * IN suffix - optional "on duplicate key update ..." clause, which must use
+ *             VALUES(column) to refer to the values of each row
+ * RET SLURM_SUCCESS, or SLURM_ERROR if a statement had to be run and failed
+ */
+extern int mysql_db_batch_insert(mysql_conn_t *mysql_conn, char *prefix,
+				 char *row, char *suffix);
+
+/* Run the pending multi-row insert now, see mysql_db_batch_insert() */
+extern int mysql_db_batch_flush(mysql_conn_t *mysql_conn);
+
 extern int mysql_db_create_table(mysql_conn_t *mysql_conn, char *table_name,
 				 storage_field_t *fields, char *ending);
 
@@ -115,6 +115,24 @@ const uint32_t plugin_version = SLURM_VERSION_NUMBER;
 static mysql_db_info_t *mysql_db_info = NULL;
 static char *mysql_db_name = NULL;
 
+/* Idle database connections of the slurmdbd, kept for its next client */
+static List conn_pool = NULL;
+static pthread_mutex_t conn_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t conn_pool_opened = 0;
+static uint32_t conn_pool_reused = 0;
+
+/* Read only replica of the database for queries, see StorageReplicaHost */
+#define REPLICA_CHECK_INTERVAL	10	/* seconds between lag checks */
+static mysql_db_info_t *replica_db_info = NULL;
+static List replica_pool = NULL;
+static pthread_mutex_t replica_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool replica_checking = false;
+static time_t replica_checked = 0;
+static int replica_lag = -1;
+static bool replica_ok = false;
+static uint32_t replica_queries = 0;
+static uint32_t replica_fallbacks = 0;
+
 #define DELETE_SEC_BACK 86400
 
 char *acct_coord_table = "acct_coord_table";
@@ -1021,11 +1039,17 @@ extern int check_connection(mysql_conn_t *mysql_conn)
 		errno = ESLURM_DB_CONNECTION;
 		return ESLURM_DB_CONNECTION;
 	} else if (mysql_db_ping(mysql_conn) != 0) {
+		int rc;
+
 		/* avoid memory leak and end thread */
 		mysql_db_close_db_connection(mysql_conn);
-		if (mysql_db_get_db_connection(
-			    mysql_conn, mysql_db_name, mysql_db_info)
-		    != SLURM_SUCCESS) {
+		if (mysql_conn->replica)
+			rc = mysql_db_get_replica_connection(
+				mysql_conn, mysql_db_name, replica_db_info);
+		else
+			rc = mysql_db_get_db_connection(
+				mysql_conn, mysql_db_name, mysql_db_info);
+		if (rc != SLURM_SUCCESS) {
 			error("unable to re-connect to as_mysql database");
 			errno = ESLURM_DB_CONNECTION;
 			return ESLURM_DB_CONNECTION;
@@ -2368,6 +2392,15 @@ extern int init ( void )
 	mysql_db_info = create_mysql_db_info(SLURM_MYSQL_PLUGIN_AS);
 	mysql_db_name = acct_get_db_name();
 
+	if (slurmdbd_conf && slurmdbd_conf->storage_replica_host) {
+		replica_db_info = xmalloc(sizeof(mysql_db_info_t));
+		replica_db_info->host =
+			xstrdup(slurmdbd_conf->storage_replica_host);
+		replica_db_info->port = slurmdbd_conf->storage_replica_port;
+		replica_db_info->user = slurm_get_accounting_storage_user();
+		replica_db_info->pass = slurm_get_accounting_storage_pass();
+	}
+
 	debug2("mysql_connect() called for db %s", mysql_db_name);
 	mysql_conn = create_mysql_conn(0, 1, NULL);
 	while (mysql_db_get_db_connection(
@@ -2397,8 +2430,234 @@ extern int init ( void )
 	return rc;
 }
 
+static void _destroy_pooled_conn(void *object)
+{
+	destroy_mysql_conn((mysql_conn_t *)object);
+}
+
+/* Take an idle connection from the pool, NULL if there are none */
+static mysql_conn_t *_conn_pool_get(int conn_num, bool rollback,
+				    char *cluster_name)
+{
+	mysql_conn_t *mysql_conn = NULL;
+
+	if (!slurmdbd_conf)
+		return NULL;
+
+	slurm_mutex_lock(&conn_pool_lock);
+	if (conn_pool && (mysql_conn = list_pop(conn_pool)))
+		conn_pool_reused++;
+	else
+		conn_pool_opened++;
+	slurm_mutex_unlock(&conn_pool_lock);
+
+	if (!mysql_conn)
+		return NULL;
+
+	/* this thread may not have used the library yet, mysql_init()
+	 * did this for a new connection, see _conn_pool_put() */
+	if (mysql_thread_safe())
+		mysql_thread_init();
+	mysql_conn->conn = conn_num;
+	mysql_conn->rollback = rollback;
+	xfree(mysql_conn->cluster_name);
+	mysql_conn->cluster_name = xstrdup(cluster_name);
+	/* if this fails check_connection() will reconnect on first use */
+	mysql_autocommit(mysql_conn->db_conn, rollback ? 0 : 1);
+
+	return mysql_conn;
+}
+
+/* Keep an idle connection for reuse if the pool isn't full
+ * RET true if the connection was added to the pool */
+static bool _conn_pool_put(mysql_conn_t *mysql_conn)
+{
+	bool rc = false;
+
+	if (!slurmdbd_conf || !mysql_conn->db_conn)
+		return false;
+
+	slurm_mutex_lock(&conn_pool_lock);
+	if (!conn_pool)
+		conn_pool = list_create(_destroy_pooled_conn);
+	if (list_count(conn_pool) < slurmdbd_conf->max_query_threads) {
+		xfree(mysql_conn->pre_commit_query);
+		list_flush(mysql_conn->update_list);
+		list_push(conn_pool, mysql_conn);
+		rc = true;
+	}
+	slurm_mutex_unlock(&conn_pool_lock);
+
+	/* release what the library holds for this thread */
+	if (rc && mysql_thread_safe())
+		mysql_thread_end();
+
+	return rc;
+}
+
+/* Return the number of seconds the replica is behind the database,
+ * -1 if it isn't replicating */
+static int _replica_get_lag(mysql_conn_t *replica)
+{
+	MYSQL_RES *result = NULL;
+	MYSQL_ROW row;
+	MYSQL_FIELD *fields;
+	int i, lag = -1;
+
+	if (!(result = mysql_db_query_ret(replica, "show slave status", 0)))
+		return -1;
+
+	if ((row = mysql_fetch_row(result))) {
+		fields = mysql_fetch_fields(result);
+		for (i = 0; i < mysql_num_fields(result); i++) {
+			if (xstrcasecmp(fields[i].name,
+					"Seconds_Behind_Master"))
+				continue;
+			if (row[i])
+				lag = slurm_atoul(row[i]);
+			break;
+		}
+	}
+	mysql_free_result(result);
+
+	return lag;
+}
+
+/* Note whether the replica can be used, logging when that changes.
+ * Call with replica_lock held. */
+static void _replica_set_state(int lag, time_t now)
+{
+	bool ok = (lag >= 0) && (lag <= slurmdbd_conf->storage_replica_lag);
+
+	if (ok && !replica_ok)
+		info("Sending queries to database replica %s",
+		     replica_db_info->host);
+	else if (!ok && replica_ok && (lag >= 0))
+		error("Database replica %s is %d seconds behind, "
+		      "sending queries to %s",
+		      replica_db_info->host, lag, mysql_db_info->host);
+	else if (!ok && (replica_ok || !replica_checked))
+		error("Database replica %s is not available, "
+		      "sending queries to %s",
+		      replica_db_info->host, mysql_db_info->host);
+
+	replica_ok = ok;
+	replica_lag = lag;
+	replica_checked = now;
+}
+
+/* Get a connection to the replica to run a read only query on
+ * RET connection to the replica, or mysql_conn if the replica can't
+ *     be used, to be returned with _replica_put() */
+static mysql_conn_t *_replica_get(mysql_conn_t *mysql_conn)
+{
+	mysql_conn_t *replica = NULL;
+	time_t now = time(NULL);
+	bool check = false;
+
+	if (!replica_db_info)
+		return mysql_conn;
+
+	slurm_mutex_lock(&replica_lock);
+	if (!replica_checking &&
+	    ((now - replica_checked) >= REPLICA_CHECK_INTERVAL)) {
+		replica_checking = true;
+		check = true;
+	} else if (!replica_ok) {
+		replica_fallbacks++;
+		slurm_mutex_unlock(&replica_lock);
+		return mysql_conn;
+	}
+	if (replica_pool)
+		replica = list_pop(replica_pool);
+	slurm_mutex_unlock(&replica_lock);
+
+	if (replica && mysql_db_ping(replica)) {
+		destroy_mysql_conn(replica);
+		replica = NULL;
+	}
+	if (replica) {
+		replica->conn = mysql_conn->conn;
+		xfree(replica->cluster_name);
+		replica->cluster_name = xstrdup(mysql_conn->cluster_name);
+	} else {
+		replica = create_mysql_conn(mysql_conn->conn, 0,
+					    mysql_conn->cluster_name);
+		replica->replica = true;
+		if (mysql_db_get_replica_connection(replica, mysql_db_name,
+						    replica_db_info)
+		    != SLURM_SUCCESS) {
+			destroy_mysql_conn(replica);
+			replica = NULL;
+		}
+	}
+
+	slurm_mutex_lock(&replica_lock);
+	if (check) {
+		_replica_set_state(replica ? _replica_get_lag(replica) : -1,
+				   now);
+		replica_checking = false;
+	} else if (!replica)
+		_replica_set_state(-1, now);
+
+	if (!replica_ok) {
+		replica_fallbacks++;
+		slurm_mutex_unlock(&replica_lock);
+		if (replica)
+			destroy_mysql_conn(replica);
+		return mysql_conn;
+	}
+	replica_queries++;
+	slurm_mutex_unlock(&replica_lock);
+
+	return replica;
+}
+
+/* Give back the connection from _replica_get()
+ * RET true if the query failed on the replica and should be run again
+ *     on mysql_conn */
+static bool _replica_put(mysql_conn_t *mysql_conn, mysql_conn_t *replica)
+{
+	bool failed;
+
+	if (replica == mysql_conn)
+		return false;
+
+	failed = !replica->db_conn || mysql_errno(replica->db_conn);
+
+	slurm_mutex_lock(&replica_lock);
+	if (failed) {
+		_replica_set_state(-1, time(NULL));
+		replica_fallbacks++;
+	} else {
+		if (!replica_pool)
+			replica_pool = list_create(_destroy_pooled_conn);
+		if (list_count(replica_pool) <
+		    slurmdbd_conf->max_query_threads) {
+			list_push(replica_pool, replica);
+			replica = NULL;
+		}
+	}
+	slurm_mutex_unlock(&replica_lock);
+
+	if (replica)
+		destroy_mysql_conn(replica);
+
+	return failed;
+}
+
 extern int fini ( void )
 {
+	slurm_mutex_lock(&conn_pool_lock);
+	FREE_NULL_LIST(conn_pool);
+	slurm_mutex_unlock(&conn_pool_lock);
+
+	slurm_mutex_lock(&replica_lock);
+	FREE_NULL_LIST(replica_pool);
+	destroy_mysql_db_info(replica_db_info);
+	replica_db_info = NULL;
+	slurm_mutex_unlock(&replica_lock);
+
 	slurm_mutex_lock(&as_mysql_cluster_list_lock);
 	FREE_NULL_LIST(as_mysql_cluster_list);
 	FREE_NULL_LIST(as_mysql_total_cluster_list);
@@ -2424,6 +2683,11 @@ extern void *acct_storage_p_get_connection(const slurm_trigger_callbacks_t *cb,
 	debug2("acct_storage_p_get_connection: request new connection %d",
 	       rollback);
 
+	if ((mysql_conn = _conn_pool_get(conn_num, rollback, cluster_name))) {
+		errno = SLURM_SUCCESS;
+		return (void *)mysql_conn;
+	}
+
 	if (!(mysql_conn = create_mysql_conn(
 		      conn_num, rollback, cluster_name))) {
 		fatal("couldn't get a mysql_conn");
@@ -2446,8 +2710,11 @@ extern int acct_storage_p_close_connection(mysql_conn_t **mysql_conn)
 	if (!mysql_conn || !(*mysql_conn))
 		return SLURM_SUCCESS;
 
-	acct_storage_p_commit((*mysql_conn), 0);
-	rc = destroy_mysql_conn(*mysql_conn);
+	if ((acct_storage_p_commit((*mysql_conn), 0) == SLURM_SUCCESS) &&
+	    _conn_pool_put(*mysql_conn))
+		rc = SLURM_SUCCESS;
+	else
+		rc = destroy_mysql_conn(*mysql_conn);
 	*mysql_conn = NULL;
 
 	return rc;
@@ -2456,6 +2723,7 @@ extern int acct_storage_p_close_connection(mysql_conn_t **mysql_conn)
 extern int acct_storage_p_commit(mysql_conn_t *mysql_conn, bool commit)
 {
 	int rc = check_connection(mysql_conn);
+	int commit_rc = SLURM_SUCCESS;
 
 	/* always reset this here */
 	if (mysql_conn)
@@ -2490,14 +2758,19 @@ extern int acct_storage_p_commit(mysql_conn_t *mysql_conn, bool commit)
 			if (rc != SLURM_SUCCESS) {
 				if (mysql_db_rollback(mysql_conn))
 					error("rollback failed");
+				commit_rc = SLURM_ERROR;
 			} else {
-				if (mysql_db_commit(mysql_conn))
+				if (mysql_db_commit(mysql_conn)) {
 					error("commit failed");
+					commit_rc = SLURM_ERROR;
+				}
 			}
 		}
 	}
 
-	if (commit && list_count(mysql_conn->update_list)) {
+	/* Don't announce changes which were rolled back */
+	if (commit && (commit_rc == SLURM_SUCCESS) &&
+	    list_count(mysql_conn->update_list)) {
 		char *query = NULL;
 		MYSQL_RES *result = NULL;
 		MYSQL_ROW row;
@@ -2564,7 +2837,7 @@ extern int acct_storage_p_commit(mysql_conn_t *mysql_conn, bool commit)
 	xfree(mysql_conn->pre_commit_query);
 	list_flush(mysql_conn->update_list);
 
-	return SLURM_SUCCESS;
+	return commit_rc;
 }
 
 extern int acct_storage_p_add_users(mysql_conn_t *mysql_conn, uint32_t uid,
@@ -2769,7 +3042,22 @@ extern List acct_storage_p_get_accts(mysql_conn_t *mysql_conn, uid_t uid,
 extern List acct_storage_p_get_clusters(mysql_conn_t *mysql_conn, uid_t uid,
 					slurmdb_cluster_cond_t *cluster_cond)
 {
-	return as_mysql_get_clusters(mysql_conn, uid, cluster_cond);
+	List ret_list = NULL;
+	mysql_conn_t *read_conn = mysql_conn;
+
+	/* the usage of sreport cluster reports can come from the replica */
+	if (cluster_cond && cluster_cond->with_usage &&
+	    (check_connection(mysql_conn) == SLURM_SUCCESS))
+		read_conn = _replica_get(mysql_conn);
+
+	ret_list = as_mysql_get_clusters(read_conn, uid, cluster_cond);
+	if (_replica_put(mysql_conn, read_conn)) {
+		FREE_NULL_LIST(ret_list);
+		ret_list = as_mysql_get_clusters(mysql_conn, uid,
+						 cluster_cond);
+	}
+
+	return ret_list;
 }
 
 extern List acct_storage_p_get_tres(
@@ -2783,7 +3071,20 @@ extern List acct_storage_p_get_assocs(
 	mysql_conn_t *mysql_conn, uid_t uid,
 	slurmdb_assoc_cond_t *assoc_cond)
 {
-	return as_mysql_get_assocs(mysql_conn, uid, assoc_cond);
+	List ret_list = NULL;
+	mysql_conn_t *read_conn = mysql_conn;
+
+	if (assoc_cond && assoc_cond->with_usage &&
+	    (check_connection(mysql_conn) == SLURM_SUCCESS))
+		read_conn = _replica_get(mysql_conn);
+
+	ret_list = as_mysql_get_assocs(read_conn, uid, assoc_cond);
+	if (_replica_put(mysql_conn, read_conn)) {
+		FREE_NULL_LIST(ret_list);
+		ret_list = as_mysql_get_assocs(mysql_conn, uid, assoc_cond);
+	}
+
+	return ret_list;
 }
 
 extern List acct_storage_p_get_events(mysql_conn_t *mysql_conn, uint32_t uid,
@@ -2826,7 +3127,37 @@ end_it:
 
 extern List acct_storage_p_get_config(void *db_conn, char *config_name)
 {
-	return NULL;
+	config_key_pair_t *key_pair;
+	List my_list;
+
+	if (!slurmdbd_conf || xstrcmp(config_name, "slurmdbd.stats"))
+		return NULL;
+
+	my_list = list_create(destroy_config_key_pair);
+	key_pair = xmalloc(sizeof(config_key_pair_t));
+	key_pair->name = xstrdup("ConnectionPool");
+	slurm_mutex_lock(&conn_pool_lock);
+	key_pair->value = xstrdup_printf(
+		"Idle=%d MaxIdle=%u Opened=%u Reused=%u",
+		conn_pool ? list_count(conn_pool) : 0,
+		slurmdbd_conf->max_query_threads,
+		conn_pool_opened, conn_pool_reused);
+	slurm_mutex_unlock(&conn_pool_lock);
+	list_append(my_list, key_pair);
+
+	if (replica_db_info) {
+		key_pair = xmalloc(sizeof(config_key_pair_t));
+		key_pair->name = xstrdup("Replica");
+		slurm_mutex_lock(&replica_lock);
+		key_pair->value = xstrdup_printf(
+			"Host=%s Usable=%s Lag=%d Queries=%u Fallbacks=%u",
+			replica_db_info->host, replica_ok ? "yes" : "no",
+			replica_lag, replica_queries, replica_fallbacks);
+		slurm_mutex_unlock(&replica_lock);
+		list_append(my_list, key_pair);
+	}
+
+	return my_list;
 }
 
 extern List acct_storage_p_get_qos(mysql_conn_t *mysql_conn, uid_t uid,
@@ -2864,7 +3195,17 @@ extern int acct_storage_p_get_usage(mysql_conn_t *mysql_conn, uid_t uid,
 				    void *in, slurmdbd_msg_type_t type,
 				    time_t start, time_t end)
 {
-	return as_mysql_get_usage(mysql_conn, uid, in, type, start, end);
+	int rc;
+	mysql_conn_t *read_conn = mysql_conn;
+
+	if (check_connection(mysql_conn) == SLURM_SUCCESS)
+		read_conn = _replica_get(mysql_conn);
+
+	rc = as_mysql_get_usage(read_conn, uid, in, type, start, end);
+	if (_replica_put(mysql_conn, read_conn))
+		rc = as_mysql_get_usage(mysql_conn, uid, in, type, start, end);
+
+	return rc;
 }
 
 extern int acct_storage_p_roll_usage(mysql_conn_t *mysql_conn,
@@ -3043,11 +3384,18 @@ extern List jobacct_storage_p_get_jobs_cond(mysql_conn_t *mysql_conn,
 					    slurmdb_job_cond_t *job_cond)
 {
 	List job_list = NULL;
+	mysql_conn_t *read_conn;
 
 	if (check_connection(mysql_conn) != SLURM_SUCCESS) {
 		return NULL;
 	}
-	job_list = as_mysql_jobacct_process_get_jobs(mysql_conn, uid, job_cond);
+	read_conn = _replica_get(mysql_conn);
+	job_list = as_mysql_jobacct_process_get_jobs(read_conn, uid, job_cond);
+	if (_replica_put(mysql_conn, read_conn)) {
+		FREE_NULL_LIST(job_list);
+		job_list = as_mysql_jobacct_process_get_jobs(
+			mysql_conn, uid, job_cond);
+	}
 
 	return job_list;
 }
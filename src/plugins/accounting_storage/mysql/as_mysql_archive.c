@@ -55,8 +55,10 @@
 #define SLURMDBD_2_6_VERSION   12	/* slurm version 2.6 */
 #define SLURMDBD_2_5_VERSION   11	/* slurm version 2.5 */
 
-#define MAX_PURGE_LIMIT 50000 /* Number of records that are purged at a time
-				 so that locks can be periodically released. */
+#define MAX_PURGE_LIMIT 50000 /* Default number of records that are archived
+				 and purged at a time so that locks can be
+				 periodically released. */
+#define MAX_ARCHIVE_THREADS 8 /* Tables archived and purged in parallel */
 #define MAX_ARCHIVE_AGE (60 * 60 * 24 * 60) /* If archive data is older than
 					       this then archive by month to
 					       handle large datasets. */
@@ -446,6 +448,22 @@ typedef enum {
 	PURGE_STEP
 } purge_type_t;
 
+/* State shared by the threads archiving and purging tables */
+typedef struct {
+	pthread_cond_t cond;
+	pthread_mutex_t lock;
+	int rc;
+	int running;
+} archive_state_t;
+
+typedef struct {
+	slurmdb_archive_cond_t *arch_cond;
+	char *cluster_name;
+	mysql_conn_t *mysql_conn;
+	purge_type_t purge_type;
+	archive_state_t *state;
+} local_archive_t;
+
 char *purge_type_str[] = {
 	"event",
 	"suspend",
@@ -455,8 +473,10 @@ char *purge_type_str[] = {
 };
 
 static uint32_t _archive_table(purge_type_t type, mysql_conn_t *mysql_conn,
-			       char *cluster_name, time_t period_end,
-			       char *arch_dir, uint32_t archive_period);
+			       char *cluster_name, char *cond, char *order,
+			       time_t period_end, char *arch_dir,
+			       uint32_t archive_period, uint32_t batch_size,
+			       time_t *last_end);
 
 static int high_buffer_size = (1024 * 1024);
 
@@ -2232,72 +2252,62 @@ static char *_load_suspend(uint16_t rpc_version, Buf buffer,
 }
 
 /* returns count of events archived or SLURM_ERROR on error */
+/* Archive the oldest batch_size records matching cond, in the given order,
+ * to a new archive file. last_end IN/OUT: end time in the name of the last
+ * archive file written, so batches get distinct file names.
+ * RET number of records archived or SLURM_ERROR */
 static uint32_t _archive_table(purge_type_t type, mysql_conn_t *mysql_conn,
-			       char *cluster_name, time_t period_end,
-			       char *arch_dir, uint32_t archive_period)
+			       char *cluster_name, char *cond, char *order,
+			       time_t period_end, char *arch_dir,
+			       uint32_t archive_period, uint32_t batch_size,
+			       time_t *last_end)
 {
 	MYSQL_RES *result = NULL;
-	char *cols = NULL, *query = NULL;
+	MYSQL_ROW row;
+	char *cols = NULL, *query = NULL, *sql_table = NULL;
 	time_t period_start = 0;
 	uint32_t cnt = 0;
 	Buf buffer;
-	int error_code = 0;
+	int error_code = 0, time_inx;
 	Buf (*pack_func)(MYSQL_RES *result, char *cluster_name,
 			 uint32_t cnt, time_t *period_start);
 
-	cols = _get_archive_columns(type);
-
 	switch (type) {
 	case PURGE_EVENT:
 		pack_func = &_pack_archive_events;
-		query = xstrdup_printf("select %s from \"%s_%s\" where "
-				       "time_start <= %ld && time_end != 0 "
-				       "order by time_start asc "
-				       "for update",
-				       cols, cluster_name, event_table,
-				       period_end);
+		sql_table = event_table;
+		time_inx  = EVENT_REQ_START;
 		break;
 	case PURGE_SUSPEND:
 		pack_func = &_pack_archive_suspends;
-		query = xstrdup_printf("select %s from \"%s_%s\" where "
-				       "time_start <= %ld && time_end != 0 "
-				       "order by time_start asc "
-				       "for update",
-				       cols, cluster_name, suspend_table,
-				       period_end);
+		sql_table = suspend_table;
+		time_inx  = SUSPEND_REQ_START;
 		break;
 	case PURGE_RESV:
 		pack_func = &_pack_archive_resvs;
-		query = xstrdup_printf("select %s from \"%s_%s\" where "
-				       "time_start <= %ld && time_end != 0 "
-				       "order by time_start asc "
-				       "for update",
-				       cols, cluster_name, resv_table,
-				       period_end);
+		sql_table = resv_table;
+		time_inx  = RESV_REQ_START;
 		break;
 	case PURGE_JOB:
 		pack_func = &_pack_archive_jobs;
-		query = xstrdup_printf("select %s from \"%s_%s\" where "
-				       "time_submit < %ld && time_end != 0 "
-				       "&& !deleted order by time_submit asc "
-				       "for update",
-				       cols, cluster_name, job_table,
-				       period_end);
+		sql_table = job_table;
+		time_inx  = JOB_REQ_SUBMIT;
 		break;
 	case PURGE_STEP:
 		pack_func = &_pack_archive_steps;
-		query = xstrdup_printf("select %s from \"%s_%s\" where "
-				       "time_start <= %ld && time_end != 0 "
-				       "&& !deleted order by time_start asc "
-				       "for update",
-				       cols, cluster_name, step_table,
-				       period_end);
+		sql_table = step_table;
+		time_inx  = STEP_REQ_START;
 		break;
 	default:
 		fatal("Unknown purge type: %d", type);
 		return SLURM_ERROR;
 	}
 
+	cols = _get_archive_columns(type);
+	query = xstrdup_printf("select %s from \"%s_%s\" where %s "
+			       "order by %s LIMIT %u for update",
+			       cols, cluster_name, sql_table, cond, order,
+			       batch_size);
 	xfree(cols);
 
 	if (debug_flags & DEBUG_FLAG_DB_ARCHIVE)
@@ -2314,7 +2324,18 @@ static uint32_t _archive_table(purge_type_t type, mysql_conn_t *mysql_conn,
 	}
 
 	buffer = (*pack_func)(result, cluster_name, cnt, &period_start);
+
+	/* More records may follow a full batch, so its file is named
+	 * after its last record instead of the end of the period */
+	if (cnt == batch_size) {
+		mysql_data_seek(result, cnt - 1);
+		if ((row = mysql_fetch_row(result)))
+			period_end = slurm_atoul(row[time_inx]);
+	}
 	mysql_free_result(result);
+	if (period_end <= *last_end)
+		period_end = *last_end + 1;
+	*last_end = period_end;
 
 	error_code = archive_write_file(buffer, cluster_name,
 					period_start, period_end,
@@ -2389,7 +2410,62 @@ static int _get_oldest_record(mysql_conn_t *mysql_conn, char *cluster,
 	return 1; /* found one record */
 }
 
-/* Archive and purge a table.
+/* Get the condition selecting the records of a table which can be archived
+ * and purged up to period_end, and the order to process them in. The order
+ * ends with the primary key so the records purged are exactly the ones
+ * archived. */
+static void _get_purge_cond(purge_type_t purge_type, char *col_name,
+			    time_t period_end, char **cond, char **order)
+{
+	*cond = xstrdup_printf("%s <= %ld && time_end != 0",
+			       col_name, period_end);
+
+	switch (purge_type) {
+	case PURGE_EVENT:
+		*order = xstrdup_printf("%s, node_name", col_name);
+		break;
+	case PURGE_SUSPEND:
+		*order = xstrdup_printf("%s, job_db_inx", col_name);
+		break;
+	case PURGE_RESV:
+		*order = xstrdup_printf("%s, id_resv", col_name);
+		break;
+	case PURGE_JOB:
+		xstrcat(*cond, " && !deleted");
+		*order = xstrdup_printf("%s, job_db_inx", col_name);
+		break;
+	case PURGE_STEP:
+		xstrcat(*cond, " && !deleted");
+		*order = xstrdup_printf("%s, job_db_inx, id_step", col_name);
+		break;
+	default:
+		fatal("Unknown purge type: %d", purge_type);
+	}
+}
+
+/* Run a delete query with a LIMIT until it removes no more records,
+ * committing after each batch so that locks are periodically released.
+ * Returns SLURM_ERROR on error and SLURM_SUCCESS on success. */
+static int _purge_batches(mysql_conn_t *mysql_conn, char *cluster_name,
+			  char *query)
+{
+	int rc;
+
+	if (debug_flags & DEBUG_FLAG_DB_ARCHIVE)
+		DB_DEBUG(mysql_conn->conn, "query\n%s", query);
+
+	while ((rc = mysql_db_delete_affected_rows(mysql_conn, query)) > 0) {
+		if (mysql_db_commit(mysql_conn)) {
+			error("Couldn't commit cluster (%s) purge",
+			      cluster_name);
+			return SLURM_ERROR;
+		}
+	}
+
+	return rc;
+}
+
+/* Archive and purge a table, batch_size records per transaction.
  *
  * Returns SLURM_ERROR on error and SLURM_SUCCESS on success.
  */
@@ -2398,11 +2474,12 @@ static int _archive_purge_table(purge_type_t purge_type,
 				slurmdb_archive_cond_t *arch_cond)
 {
 	int      rc          = SLURM_SUCCESS;
-	uint32_t purge_attr  = 0;
+	uint32_t purge_attr  = 0, cnt, batch_size = MAX_PURGE_LIMIT;
 	time_t   last_submit = time(NULL);
 	time_t   curr_end    = 0, tmp_end = 0, record_start = 0;
+	time_t   last_end    = 0;
 	char    *query = NULL, *sql_table = NULL,
-		*col_name = NULL;
+		*col_name = NULL, *cond = NULL, *order = NULL;
 	uint32_t tmp_archive_period;
 
 	/* FIXME: the cluster usage tables need to get
@@ -2440,6 +2517,9 @@ static int _archive_purge_table(purge_type_t purge_type,
 		return SLURM_ERROR;
 	}
 
+	if (slurmdbd_conf && slurmdbd_conf->purge_batch_size)
+		batch_size = slurmdbd_conf->purge_batch_size;
+
 	if (!(curr_end = archive_setup_end_time(last_submit, purge_attr))) {
 		error("Parsing purge %s", purge_type_str[purge_type]);
 		return SLURM_ERROR;
@@ -2468,55 +2548,166 @@ static int _archive_purge_table(purge_type_t purge_type,
 			      purge_type_str[purge_type],
 			      tmp_end, cluster_name);
 
-		if (SLURMDB_PURGE_ARCHIVE_SET(purge_attr)) {
-			rc = _archive_table(purge_type, mysql_conn,
-					    cluster_name, tmp_end,
-					    arch_cond->archive_dir,
-					    tmp_archive_period);
-			if (!rc) /* no records archived */
-				continue;
-			else if (rc == SLURM_ERROR)
-				return rc;
+		if ((purge_type == PURGE_JOB) || (purge_type == PURGE_STEP)) {
+			/* Deleted records are purged without being
+			 * archived */
+			query = xstrdup_printf("delete from \"%s_%s\" where "
+					       "%s <= %ld && time_end != 0 && "
+					       "deleted LIMIT %u",
+					       cluster_name, sql_table,
+					       col_name, tmp_end, batch_size);
+			rc = _purge_batches(mysql_conn, cluster_name, query);
+			xfree(query);
+			if (rc != SLURM_SUCCESS) {
+				error("Couldn't remove old %s data",
+				      purge_type_str[purge_type]);
+				return SLURM_ERROR;
+			}
+		}
+
+		_get_purge_cond(purge_type, col_name, tmp_end, &cond, &order);
+
+		if (!SLURMDB_PURGE_ARCHIVE_SET(purge_attr)) {
+			query = xstrdup_printf("delete from \"%s_%s\" where "
+					       "%s LIMIT %u",
+					       cluster_name, sql_table, cond,
+					       batch_size);
+			rc = _purge_batches(mysql_conn, cluster_name, query);
+			xfree(query);
 		}
 
-		query = xstrdup_printf("delete from \"%s_%s\" where "
-				       "%s <= %ld && time_end != 0 LIMIT %d",
-				       cluster_name, sql_table, col_name,
-				       tmp_end, MAX_PURGE_LIMIT);
-		if (debug_flags & DEBUG_FLAG_DB_ARCHIVE)
-			DB_DEBUG(mysql_conn->conn, "query\n%s", query);
+		/* Archive a batch of records and purge it in the same
+		 * transaction, the archive query locks the records of the
+		 * batch until it is committed. */
+		while (SLURMDB_PURGE_ARCHIVE_SET(purge_attr)) {
+			cnt = _archive_table(purge_type, mysql_conn,
+					     cluster_name, cond, order, tmp_end,
+					     arch_cond->archive_dir,
+					     tmp_archive_period, batch_size,
+					     &last_end);
+			if (cnt == SLURM_ERROR) {
+				rc = SLURM_ERROR;
+				break;
+			} else if (!cnt) { /* no records archived */
+				rc = SLURM_SUCCESS;
+				break;
+			}
 
-		while ((rc = mysql_db_delete_affected_rows(
-				mysql_conn, query)) > 0) {
-			/* Commit here every time since this could create a huge
-			 * transaction.
-			 */
+			query = xstrdup_printf("delete from \"%s_%s\" where "
+					       "%s order by %s LIMIT %u",
+					       cluster_name, sql_table, cond,
+					       order, cnt);
+			if (debug_flags & DEBUG_FLAG_DB_ARCHIVE)
+				DB_DEBUG(mysql_conn->conn, "query\n%s", query);
+			rc = mysql_db_delete_affected_rows(mysql_conn, query);
+			xfree(query);
+			if (rc < 0)
+				break;
+			if (rc != cnt)
+				error("Purged %d %s records for %s, %u were "
+				      "archived", rc,
+				      purge_type_str[purge_type],
+				      cluster_name, cnt);
 			if (mysql_db_commit(mysql_conn)) {
 				error("Couldn't commit cluster (%s) purge",
 				      cluster_name);
+				rc = SLURM_ERROR;
 				break;
 			}
+			rc = SLURM_SUCCESS;
+			if (cnt < batch_size)
+				break;
 		}
 
-		xfree(query);
+		xfree(cond);
+		xfree(order);
 		if (rc != SLURM_SUCCESS) {
-			error("Couldn't remove old event data");
+			error("Couldn't remove old %s data",
+			      purge_type_str[purge_type]);
 			return SLURM_ERROR;
-		} else if (mysql_db_commit(mysql_conn)) {
-			error("Couldn't commit cluster (%s) purge",
-			      cluster_name);
-			break;
 		}
 	} while (tmp_end < curr_end);
 
 	return SLURM_SUCCESS;
 }
 
+static void *_archive_purge_thread(void *arg)
+{
+	local_archive_t *local_archive = (local_archive_t *)arg;
+	archive_state_t *state = local_archive->state;
+	mysql_conn_t mysql_conn;
+	int rc;
+
+	memset(&mysql_conn, 0, sizeof(mysql_conn_t));
+	mysql_conn.rollback = 1;
+	mysql_conn.conn = local_archive->mysql_conn->conn;
+	slurm_mutex_init(&mysql_conn.lock);
+
+	/* Each thread needs it's own connection we can't use the one
+	 * sent from the parent thread. */
+	if ((rc = check_connection(&mysql_conn)) == SLURM_SUCCESS)
+		rc = _archive_purge_table(local_archive->purge_type,
+					  &mysql_conn,
+					  local_archive->cluster_name,
+					  local_archive->arch_cond);
+	if ((rc != SLURM_SUCCESS) && mysql_conn.db_conn &&
+	    mysql_db_rollback(&mysql_conn))
+		error("rollback failed");
+
+	mysql_db_close_db_connection(&mysql_conn);
+	slurm_mutex_destroy(&mysql_conn.lock);
+
+	slurm_mutex_lock(&state->lock);
+	state->running--;
+	if ((rc != SLURM_SUCCESS) && (state->rc == SLURM_SUCCESS))
+		state->rc = rc;
+	pthread_cond_signal(&state->cond);
+	slurm_mutex_unlock(&state->lock);
+	xfree(local_archive);
+
+	return NULL;
+}
+
+/* Archive and purge a table in a thread of its own, tables of all clusters
+ * are processed in parallel, at most MAX_ARCHIVE_THREADS at a time */
+static void _start_archive_purge(purge_type_t purge_type,
+				 mysql_conn_t *mysql_conn, char *cluster_name,
+				 slurmdb_archive_cond_t *arch_cond,
+				 archive_state_t *state)
+{
+	pthread_t archive_tid;
+	pthread_attr_t archive_attr;
+	local_archive_t *local_archive = xmalloc(sizeof(local_archive_t));
+
+	local_archive->arch_cond = arch_cond;
+	local_archive->cluster_name = cluster_name;
+	local_archive->mysql_conn = mysql_conn;
+	local_archive->purge_type = purge_type;
+	local_archive->state = state;
+
+	slurm_mutex_lock(&state->lock);
+	while (state->running >= MAX_ARCHIVE_THREADS)
+		pthread_cond_wait(&state->cond, &state->lock);
+	state->running++;
+	slurm_mutex_unlock(&state->lock);
+
+	/* _archive_purge_thread is responsible for freeing
+	   this local_archive */
+	slurm_attr_init(&archive_attr);
+	if (pthread_attr_setdetachstate(&archive_attr,
+					PTHREAD_CREATE_DETACHED))
+		error("pthread_attr_setdetachstate error %m");
+	if (pthread_create(&archive_tid, &archive_attr,
+			   _archive_purge_thread, (void *)local_archive))
+		fatal("pthread_create: %m");
+	slurm_attr_destroy(&archive_attr);
+}
+
 static int _execute_archive(mysql_conn_t *mysql_conn,
 			    char *cluster_name,
-			    slurmdb_archive_cond_t *arch_cond)
+			    slurmdb_archive_cond_t *arch_cond,
+			    archive_state_t *state)
 {
-	int rc = SLURM_SUCCESS;
 	time_t last_submit = time(NULL);
 
 	if (arch_cond->archive_script)
@@ -2526,35 +2717,25 @@ static int _execute_archive(mysql_conn_t *mysql_conn,
 		return SLURM_ERROR;
 	}
 
-	if (arch_cond->purge_event != NO_VAL) {
-		if ((rc = _archive_purge_table(PURGE_EVENT, mysql_conn,
-					       cluster_name, arch_cond)))
-			return rc;
-	}
+	if (arch_cond->purge_event != NO_VAL)
+		_start_archive_purge(PURGE_EVENT, mysql_conn, cluster_name,
+				     arch_cond, state);
 
-	if (arch_cond->purge_suspend != NO_VAL) {
-		if ((rc = _archive_purge_table(PURGE_SUSPEND, mysql_conn,
-					       cluster_name, arch_cond)))
-			return rc;
-	}
+	if (arch_cond->purge_suspend != NO_VAL)
+		_start_archive_purge(PURGE_SUSPEND, mysql_conn, cluster_name,
+				     arch_cond, state);
 
-	if (arch_cond->purge_step != NO_VAL) {
-		if ((rc = _archive_purge_table(PURGE_STEP, mysql_conn,
-					       cluster_name, arch_cond)))
-			return rc;
-	}
+	if (arch_cond->purge_step != NO_VAL)
+		_start_archive_purge(PURGE_STEP, mysql_conn, cluster_name,
+				     arch_cond, state);
 
-	if (arch_cond->purge_job != NO_VAL) {
-		if ((rc = _archive_purge_table(PURGE_JOB, mysql_conn,
-					       cluster_name, arch_cond)))
-			return rc;
-	}
+	if (arch_cond->purge_job != NO_VAL)
+		_start_archive_purge(PURGE_JOB, mysql_conn, cluster_name,
+				     arch_cond, state);
 
-	if (arch_cond->purge_resv != NO_VAL) {
-		if ((rc = _archive_purge_table(PURGE_RESV, mysql_conn,
-					       cluster_name, arch_cond)))
-			return rc;
-	}
+	if (arch_cond->purge_resv != NO_VAL)
+		_start_archive_purge(PURGE_RESV, mysql_conn, cluster_name,
+				     arch_cond, state);
 
 	return SLURM_SUCCESS;
 }
@@ -2567,6 +2748,7 @@ extern int as_mysql_jobacct_process_archive(mysql_conn_t *mysql_conn,
 	List use_cluster_list;
 	bool new_cluster_list = false;
 	ListIterator itr = NULL;
+	archive_state_t state;
 
 	if (!arch_cond) {
 		error("No arch_cond was given to archive from.  returning");
@@ -2592,14 +2774,30 @@ extern int as_mysql_jobacct_process_archive(mysql_conn_t *mysql_conn,
 		slurm_mutex_unlock(&as_mysql_cluster_list_lock);
 	}
 
+	memset(&state, 0, sizeof(archive_state_t));
+	slurm_mutex_init(&state.lock);
+	pthread_cond_init(&state.cond, NULL);
+	state.rc = SLURM_SUCCESS;
+
 	itr = list_iterator_create(use_cluster_list);
 	while ((cluster_name = list_next(itr))) {
-		if ((rc = _execute_archive(mysql_conn, cluster_name, arch_cond))
+		if ((rc = _execute_archive(mysql_conn, cluster_name, arch_cond,
+					   &state))
 		    != SLURM_SUCCESS)
 			break;
 	}
 	list_iterator_destroy(itr);
 
+	/* The threads reference the cluster names, wait for them all */
+	slurm_mutex_lock(&state.lock);
+	while (state.running)
+		pthread_cond_wait(&state.cond, &state.lock);
+	if (rc == SLURM_SUCCESS)
+		rc = state.rc;
+	slurm_mutex_unlock(&state.lock);
+	slurm_mutex_destroy(&state.lock);
+	pthread_cond_destroy(&state.cond);
+
 	if (new_cluster_list)
 		FREE_NULL_LIST(use_cluster_list);
 
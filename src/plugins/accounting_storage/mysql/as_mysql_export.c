@@ -0,0 +1,375 @@
+/*****************************************************************************\
+ *  as_mysql_export.c - columnar export of completed jobs and steps
+ *****************************************************************************
+ *  Copyright (C) 2016 SchedMD LLC.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "as_mysql_export.h"
+#include "src/common/slurm_time.h"
+#include "src/common/slurmdb_export.h"
+
+/* Jobs read from the database at once */
+#define EXPORT_BATCH_SIZE 50000
+
+typedef struct {
+	char *field;	/* selected from the database */
+	char *name;	/* column of the export file, NULL if not exported */
+	uint16_t type;	/* export_col_type_t */
+} export_field_t;
+
+/*
+ * The first field of each table must be the job_db_inx, and the last its
+ * tres_alloc, which is decoded into one column per TRES.
+ */
+static export_field_t job_fields[] = {
+	{ "t1.job_db_inx", NULL, EXPORT_COL_UINT32 },
+	{ "t1.id_job", "jobid", EXPORT_COL_UINT32 },
+	{ "t1.id_array_job", "array_jobid", EXPORT_COL_UINT32 },
+	{ "t1.id_array_task", "array_taskid", EXPORT_COL_UINT32 },
+	{ "t1.id_user", "uid", EXPORT_COL_UINT32 },
+	{ "t2.user", "user", EXPORT_COL_STRING },
+	{ "t1.id_group", "gid", EXPORT_COL_UINT32 },
+	{ "t1.id_assoc", "associd", EXPORT_COL_UINT32 },
+	{ "t1.account", "account", EXPORT_COL_STRING },
+	{ "t1.partition", "partition", EXPORT_COL_STRING },
+	{ "t1.id_qos", "qosid", EXPORT_COL_UINT32 },
+	{ "t1.wckey", "wckey", EXPORT_COL_STRING },
+	{ "t1.job_name", "jobname", EXPORT_COL_STRING },
+	{ "t1.state", "state", EXPORT_COL_UINT32 },
+	{ "t1.exit_code", "exitcode", EXPORT_COL_UINT32 },
+	{ "t1.nodes_alloc", "nnodes", EXPORT_COL_UINT32 },
+	{ "t1.cpus_req", "reqcpus", EXPORT_COL_UINT32 },
+	{ "t1.timelimit", "timelimit", EXPORT_COL_UINT32 },
+	{ "t1.time_submit", "submit", EXPORT_COL_UINT64 },
+	{ "t1.time_eligible", "eligible", EXPORT_COL_UINT64 },
+	{ "t1.time_start", "start", EXPORT_COL_UINT64 },
+	{ "t1.time_end", "end", EXPORT_COL_UINT64 },
+	{ "t1.time_suspended", "suspended", EXPORT_COL_UINT64 },
+	{ "t1.tres_alloc", NULL, EXPORT_COL_STRING },
+	{ NULL, NULL, 0 }
+};
+
+static export_field_t step_fields[] = {
+	{ "t1.job_db_inx", NULL, EXPORT_COL_UINT32 },
+	{ "t2.id_job", "jobid", EXPORT_COL_UINT32 },
+	{ "t1.id_step", "stepid", EXPORT_COL_UINT32 },
+	{ "t1.step_name", "stepname", EXPORT_COL_STRING },
+	{ "t1.state", "state", EXPORT_COL_UINT32 },
+	{ "t1.exit_code", "exitcode", EXPORT_COL_UINT32 },
+	{ "t1.nodes_alloc", "nnodes", EXPORT_COL_UINT32 },
+	{ "t1.task_cnt", "ntasks", EXPORT_COL_UINT32 },
+	{ "t1.time_start", "start", EXPORT_COL_UINT64 },
+	{ "t1.time_end", "end", EXPORT_COL_UINT64 },
+	{ "t1.time_suspended", "suspended", EXPORT_COL_UINT64 },
+	{ "t1.user_sec", "user_sec", EXPORT_COL_UINT32 },
+	{ "t1.user_usec", "user_usec", EXPORT_COL_UINT32 },
+	{ "t1.sys_sec", "sys_sec", EXPORT_COL_UINT32 },
+	{ "t1.sys_usec", "sys_usec", EXPORT_COL_UINT32 },
+	{ "t1.max_rss", "maxrss", EXPORT_COL_UINT64 },
+	{ "t1.max_vsize", "maxvmsize", EXPORT_COL_UINT64 },
+	{ "t1.tres_alloc", NULL, EXPORT_COL_STRING },
+	{ NULL, NULL, 0 }
+};
+
+/* The TRES known when the export started */
+typedef struct {
+	int cnt;
+	uint32_t *ids;
+	char **names;
+} export_tres_t;
+
+static void _get_tres(export_tres_t *tres)
+{
+	ListIterator itr;
+	slurmdb_tres_rec_t *tres_rec;
+	assoc_mgr_lock_t locks = { NO_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
+				   READ_LOCK, NO_LOCK, NO_LOCK };
+
+	memset(tres, 0, sizeof(export_tres_t));
+	assoc_mgr_lock(&locks);
+	if (assoc_mgr_tres_list) {
+		tres->ids = xmalloc(sizeof(uint32_t) *
+				    list_count(assoc_mgr_tres_list));
+		tres->names = xmalloc(sizeof(char *) *
+				      list_count(assoc_mgr_tres_list));
+		itr = list_iterator_create(assoc_mgr_tres_list);
+		while ((tres_rec = list_next(itr))) {
+			tres->ids[tres->cnt] = tres_rec->id;
+			if (tres_rec->name)
+				tres->names[tres->cnt] = xstrdup_printf(
+					"%s%s/%s", EXPORT_TRES_ALLOC,
+					tres_rec->type, tres_rec->name);
+			else
+				tres->names[tres->cnt] = xstrdup_printf(
+					"%s%s", EXPORT_TRES_ALLOC,
+					tres_rec->type);
+			tres->cnt++;
+		}
+		list_iterator_destroy(itr);
+	}
+	assoc_mgr_unlock(&locks);
+}
+
+static void _free_tres(export_tres_t *tres)
+{
+	int i;
+
+	for (i = 0; i < tres->cnt; i++)
+		xfree(tres->names[i]);
+	xfree(tres->names);
+	xfree(tres->ids);
+}
+
+/*
+ * Add the columns of a table, return the column of each field (NULL for
+ * those not exported) followed by the column of each TRES
+ */
+static slurmdb_export_col_t **_add_cols(slurmdb_export_t *table,
+					export_field_t *fields,
+					export_tres_t *tres, int *field_cnt)
+{
+	slurmdb_export_col_t **cols;
+	int i;
+
+	for (i = 0; fields[i].field; i++)
+		;
+	*field_cnt = i;
+	cols = xmalloc(sizeof(slurmdb_export_col_t *) * (i + tres->cnt));
+	for (i = 0; i < *field_cnt; i++) {
+		if (fields[i].name)
+			cols[i] = slurmdb_export_add_col(table, fields[i].name,
+							 fields[i].type);
+	}
+	for (i = 0; i < tres->cnt; i++)
+		cols[*field_cnt + i] = slurmdb_export_add_col(
+			table, tres->names[i], EXPORT_COL_UINT64);
+
+	return cols;
+}
+
+static char *_field_str(export_field_t *fields)
+{
+	char *field_str = NULL;
+	int i;
+
+	for (i = 0; fields[i].field; i++)
+		xstrfmtcat(field_str, "%s%s", i ? ", " : "", fields[i].field);
+
+	return field_str;
+}
+
+static void _pack_row(slurmdb_export_t *table, slurmdb_export_col_t **cols,
+		      export_field_t *fields, int field_cnt,
+		      export_tres_t *tres, MYSQL_ROW row)
+{
+	char *tres_str = row[field_cnt - 1];
+	uint64_t count;
+	int i;
+
+	for (i = 0; i < field_cnt; i++) {
+		if (!cols[i])
+			continue;
+		switch (fields[i].type) {
+		case EXPORT_COL_UINT32:
+			pack32(row[i] ? slurm_atoul(row[i]) : 0,
+			       cols[i]->buffer);
+			break;
+		case EXPORT_COL_UINT64:
+			pack64(row[i] ? slurm_atoull(row[i]) : 0,
+			       cols[i]->buffer);
+			break;
+		default:
+			packstr(row[i], cols[i]->buffer);
+			break;
+		}
+	}
+
+	for (i = 0; i < tres->cnt; i++) {
+		count = slurmdb_find_tres_count_in_string(tres_str,
+							  tres->ids[i]);
+		if (count == INFINITE64)
+			count = 0;
+		pack64(count, cols[field_cnt + i]->buffer);
+	}
+
+	table->rows++;
+}
+
+static int _write_table(slurmdb_export_t *table, char *table_name)
+{
+	char *file;
+	int rc;
+
+	file = slurmdb_export_file_name(slurmdbd_conf->export_dir,
+					table->cluster, table_name,
+					table->period_start);
+	if (!file)
+		return SLURM_ERROR;
+
+	debug("Exporting %u %s records of cluster %s to %s",
+	      table->rows, table_name, table->cluster, file);
+	rc = slurmdb_export_write(table, file);
+	xfree(file);
+
+	return rc;
+}
+
+static int _export_month(mysql_conn_t *mysql_conn, char *cluster_name,
+			 time_t start, time_t end)
+{
+	MYSQL_RES *result = NULL;
+	MYSQL_ROW row;
+	char *query = NULL, *job_str, *step_str;
+	slurmdb_export_t *jobs, *steps;
+	slurmdb_export_col_t **job_cols, **step_cols;
+	int job_field_cnt, step_field_cnt, rc = SLURM_SUCCESS;
+	uint32_t first_inx, last_inx = 0, cnt;
+	export_tres_t tres;
+	DEF_TIMERS;
+
+	START_TIMER;
+	_get_tres(&tres);
+	jobs = slurmdb_export_create(cluster_name, start, end);
+	steps = slurmdb_export_create(cluster_name, start, end);
+	job_cols = _add_cols(jobs, job_fields, &tres, &job_field_cnt);
+	step_cols = _add_cols(steps, step_fields, &tres, &step_field_cnt);
+	job_str = _field_str(job_fields);
+	step_str = _field_str(step_fields);
+
+	/*
+	 * Read the jobs in batches of job_db_inx, and the steps of each batch
+	 * right after it, so neither result holds the whole month
+	 */
+	do {
+		query = xstrdup_printf(
+			"select %s from \"%s_%s\" as t1 "
+			"left join \"%s_%s\" as t2 on t1.id_assoc=t2.id_assoc "
+			"where t1.deleted=0 && t1.time_end>=%ld && "
+			"t1.time_end<%ld && t1.job_db_inx>%u "
+			"order by t1.job_db_inx limit %u",
+			job_str, cluster_name, job_table,
+			cluster_name, assoc_table,
+			start, end, last_inx, EXPORT_BATCH_SIZE);
+		if (debug_flags & DEBUG_FLAG_DB_USAGE)
+			DB_DEBUG(mysql_conn->conn, "query\n%s", query);
+		result = mysql_db_query_ret(mysql_conn, query, 0);
+		xfree(query);
+		if (!result) {
+			rc = SLURM_ERROR;
+			break;
+		}
+
+		first_inx = last_inx;
+		cnt = mysql_num_rows(result);
+		while ((row = mysql_fetch_row(result))) {
+			last_inx = slurm_atoul(row[0]);
+			_pack_row(jobs, job_cols, job_fields, job_field_cnt,
+				  &tres, row);
+		}
+		mysql_free_result(result);
+		if (!cnt)
+			break;
+
+		query = xstrdup_printf(
+			"select %s from \"%s_%s\" as t1, \"%s_%s\" as t2 "
+			"where t1.job_db_inx=t2.job_db_inx && "
+			"t1.job_db_inx>%u && t1.job_db_inx<=%u && "
+			"t1.deleted=0 && t2.deleted=0 && "
+			"t2.time_end>=%ld && t2.time_end<%ld "
+			"order by t1.job_db_inx, t1.id_step",
+			step_str, cluster_name, step_table,
+			cluster_name, job_table,
+			first_inx, last_inx, start, end);
+		if (debug_flags & DEBUG_FLAG_DB_USAGE)
+			DB_DEBUG(mysql_conn->conn, "query\n%s", query);
+		result = mysql_db_query_ret(mysql_conn, query, 0);
+		xfree(query);
+		if (!result) {
+			rc = SLURM_ERROR;
+			break;
+		}
+		while ((row = mysql_fetch_row(result)))
+			_pack_row(steps, step_cols, step_fields, step_field_cnt,
+				  &tres, row);
+		mysql_free_result(result);
+	} while (cnt == EXPORT_BATCH_SIZE);
+
+	if ((rc == SLURM_SUCCESS) && jobs->rows) {
+		rc = _write_table(jobs, EXPORT_TABLE_JOB);
+		if (rc == SLURM_SUCCESS)
+			rc = _write_table(steps, EXPORT_TABLE_STEP);
+	}
+
+	xfree(job_str);
+	xfree(step_str);
+	xfree(job_cols);
+	xfree(step_cols);
+	slurmdb_export_destroy(jobs);
+	slurmdb_export_destroy(steps);
+	_free_tres(&tres);
+	END_TIMER2("export_month");
+
+	return rc;
+}
+
+extern int as_mysql_export_months(mysql_conn_t *mysql_conn, char *cluster_name,
+				  time_t month_start, time_t month_end)
+{
+	struct tm start_tm;
+	time_t curr_start = month_start, curr_end;
+	int rc = SLURM_SUCCESS;
+
+	if (!slurmdbd_conf || !slurmdbd_conf->export_dir)
+		return SLURM_SUCCESS;
+
+	while (curr_start < month_end) {
+		if (!slurm_localtime_r(&curr_start, &start_tm)) {
+			error("Couldn't get localtime from month start %ld",
+			      curr_start);
+			return SLURM_ERROR;
+		}
+		start_tm.tm_mon++;
+		start_tm.tm_isdst = -1;
+		curr_end = slurm_mktime(&start_tm);
+
+		if ((rc = _export_month(mysql_conn, cluster_name,
+					curr_start, curr_end)) != SLURM_SUCCESS) {
+			error("Couldn't export the jobs of cluster %s "
+			      "that ended after %ld",
+			      cluster_name, curr_start);
+			break;
+		}
+		curr_start = curr_end;
+	}
+
+	return rc;
+}
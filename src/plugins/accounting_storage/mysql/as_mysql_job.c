@@ -49,6 +49,17 @@
 
 #define BUFFER_SIZE 4096
 
+/* Update clause of the multi-row step start insert, see as_mysql_step_start */
+static char *step_start_dup =
+	" on duplicate key update "
+	"nodes_alloc=VALUES(nodes_alloc), task_cnt=VALUES(task_cnt), "
+	"time_end=0, state=VALUES(state), "
+	"nodelist=VALUES(nodelist), node_inx=VALUES(node_inx), "
+	"task_dist=VALUES(task_dist), req_cpufreq=VALUES(req_cpufreq), "
+	"req_cpufreq_min=VALUES(req_cpufreq_min), "
+	"req_cpufreq_gov=VALUES(req_cpufreq_gov), "
+	"tres_alloc=VALUES(tres_alloc)";
+
 /* Used in job functions for getting the database index based off the
  * submit time, job and assoc id.  0 is returned if none is found
  */
@@ -939,7 +950,7 @@ extern int as_mysql_step_start(mysql_conn_t *mysql_conn,
 	char node_list[BUFFER_SIZE];
 	char *node_inx = NULL, *step_name = NULL;
 	time_t start_time, submit_time;
-	char *query = NULL;
+	char *query = NULL, *row = NULL;
 
 	if (!step_ptr->job_ptr->db_index
 	    && ((!step_ptr->job_ptr->details
@@ -1072,35 +1083,37 @@ extern int as_mysql_step_start(mysql_conn_t *mysql_conn,
 
 	step_name = slurm_add_slash_to_quotes(step_ptr->name);
 
-	/* we want to print a -1 for the requid so leave it a
-	   %d */
-	/* The stepid could be -2 so use %d not %u */
+	/* Steps starting together are added in one multi-row insert, which
+	 * runs before any other query on the connection. If it fails then,
+	 * the commit fails and the records are sent again. */
 	query = xstrdup_printf(
 		"insert into \"%s_%s\" (job_db_inx, id_step, time_start, "
 		"step_name, state, tres_alloc, "
 		"nodes_alloc, task_cnt, nodelist, node_inx, "
 		"task_dist, req_cpufreq, req_cpufreq_min, req_cpufreq_gov) "
-		"values (%d, %d, %d, '%s', %d, '%s', %d, %d, "
-		"'%s', '%s', %d, %u, %u, %u) "
-		"on duplicate key update "
-		"nodes_alloc=%d, task_cnt=%d, time_end=0, state=%d, "
-		"nodelist='%s', node_inx='%s', task_dist=%d, "
-		"req_cpufreq=%u, req_cpufreq_min=%u, req_cpufreq_gov=%u,"
-		"tres_alloc='%s';",
-		mysql_conn->cluster_name, step_table,
+		"values ",
+		mysql_conn->cluster_name, step_table);
+	/* The stepid could be -2 so use %d not %u */
+	row = xstrdup_printf(
+		"%d, %d, %d, '%s', %d, '%s', %d, %d, "
+		"'%s', '%s', %d, %u, %u, %u",
 		step_ptr->job_ptr->db_index,
 		step_ptr->step_id,
 		(int)start_time, step_name,
 		JOB_RUNNING, step_ptr->tres_alloc_str,
 		nodes, tasks, node_list, node_inx, task_dist,
 		step_ptr->cpu_freq_max, step_ptr->cpu_freq_min,
-		step_ptr->cpu_freq_gov, nodes, tasks, JOB_RUNNING,
-		node_list, node_inx, task_dist, step_ptr->cpu_freq_max,
-		step_ptr->cpu_freq_min, step_ptr->cpu_freq_gov,
-		step_ptr->tres_alloc_str);
+		step_ptr->cpu_freq_gov);
 	if (debug_flags & DEBUG_FLAG_DB_STEP)
-		DB_DEBUG(mysql_conn->conn, "query\n%s", query);
-	rc = mysql_db_query(mysql_conn, query);
+		DB_DEBUG(mysql_conn->conn, "query\n%s(%s)%s",
+			 query, row, step_start_dup);
+	rc = mysql_db_batch_insert(mysql_conn, query, row, step_start_dup);
+	/* With CommitDelay nothing reports a failed deferred insert back
+	 * to the slurmctld, which would drop the step, so run it now. */
+	if ((rc == SLURM_SUCCESS) && slurmdbd_conf &&
+	    slurmdbd_conf->commit_delay)
+		rc = mysql_db_batch_flush(mysql_conn);
+	xfree(row);
 	xfree(query);
 	xfree(step_name);
 
@@ -368,9 +368,10 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 			     char *cluster_name,
 			     char *job_fields, char *step_fields,
 			     char *sent_extra,
-			     bool is_admin, int only_pending, List sent_list)
+			     bool is_admin, int only_pending, List sent_list,
+			     uint32_t page_size, uint32_t *page_cursor)
 {
-	char *query = NULL;
+	char *query = NULL, *table_str = NULL;
 	char *extra = xstrdup(sent_extra);
 	uint16_t private_data = slurm_get_private_data();
 	slurmdb_selected_step_t *selected_step = NULL;
@@ -455,22 +456,58 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 	setup_job_cluster_cond_limits(mysql_conn, job_cond,
 				      cluster_name, &extra);
 
-	query = xstrdup_printf("select %s from \"%s_%s\" as t1 "
-			       "left join \"%s_%s\" as t2 "
-			       "on t1.id_assoc=t2.id_assoc "
-			       "left join \"%s_%s\" as t3 "
-			       "on t1.id_resv=t3.id_resv && "
-			       "((t1.time_start && "
-			       "(t3.time_start < t1.time_start && "
-			       "(t3.time_end >= t1.time_start || "
-			       "t3.time_end = 0))) || "
-			       "((t3.time_start < t1.time_submit && "
-			       "(t3.time_end >= t1.time_submit || "
-			       "t3.time_end = 0)) || "
-			       "(t3.time_start > t1.time_submit)))",
-			       job_fields, cluster_name, job_table,
-			       cluster_name, assoc_table,
-			       cluster_name, resv_table);
+	table_str = xstrdup_printf("\"%s_%s\" as t1 "
+				   "left join \"%s_%s\" as t2 "
+				   "on t1.id_assoc=t2.id_assoc "
+				   "left join \"%s_%s\" as t3 "
+				   "on t1.id_resv=t3.id_resv && "
+				   "((t1.time_start && "
+				   "(t3.time_start < t1.time_start && "
+				   "(t3.time_end >= t1.time_start || "
+				   "t3.time_end = 0))) || "
+				   "((t3.time_start < t1.time_submit && "
+				   "(t3.time_end >= t1.time_submit || "
+				   "t3.time_end = 0)) || "
+				   "(t3.time_start > t1.time_submit)))",
+				   cluster_name, job_table,
+				   cluster_name, assoc_table,
+				   cluster_name, resv_table);
+
+	/* Only look at the next page_size job ids after the cursor.
+	 * They are read forward from the cursor on the id_job index, so
+	 * each page costs the same however far into the table it is.
+	 * All the records of a job id land in the same page so the
+	 * duplicate and resize handling below still works.
+	 */
+	if (page_cursor) {
+		xstrfmtcat(extra, " %s t1.id_job>%u",
+			   extra ? "&&" : "where", *page_cursor);
+		query = xstrdup_printf("select distinct t1.id_job from %s%s "
+				       "order by t1.id_job limit %u",
+				       table_str, extra, page_size);
+		if (debug_flags & DEBUG_FLAG_DB_JOB)
+			DB_DEBUG(mysql_conn->conn, "query\n%s", query);
+		if (!(result = mysql_db_query_ret(mysql_conn, query, 0))) {
+			xfree(extra);
+			xfree(query);
+			xfree(table_str);
+			rc = SLURM_ERROR;
+			goto end_it;
+		}
+		xfree(query);
+		if (mysql_num_rows(result) < page_size) {
+			/* The rest of the jobs fit in this page */
+			*page_cursor = 0;
+		} else {
+			while ((row = mysql_fetch_row(result)))
+				*page_cursor = slurm_atoul(row[0]);
+			xstrfmtcat(extra, " && t1.id_job<=%u", *page_cursor);
+		}
+		mysql_free_result(result);
+	}
+
+	query = xstrdup_printf("select %s from %s", job_fields, table_str);
+	xfree(table_str);
 	if (extra) {
 		xstrcat(query, extra);
 		xfree(extra);
@@ -1526,7 +1563,8 @@ extern List as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
 	slurmdb_user_rec_t user;
 	int only_pending = 0;
 	List use_cluster_list = as_mysql_cluster_list;
-	char *cluster_name;
+	char *cluster_name, *cursor_cluster = NULL;
+	uint32_t page_size = 0;
 	assoc_mgr_lock_t locks = { NO_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
 				   READ_LOCK, NO_LOCK, NO_LOCK };
 
@@ -1550,6 +1588,11 @@ extern List as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
 		}
 	}
 
+	if (job_cond) {
+		page_size = job_cond->page_size;
+		cursor_cluster = job_cond->cursor_cluster;
+	}
+
 	if (job_cond
 	    && job_cond->state_list && (list_count(job_cond->state_list) == 1)
 	    && (slurm_atoul(list_peek(job_cond->state_list)) == JOB_PENDING))
@@ -1581,12 +1624,45 @@ extern List as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
 	itr = list_iterator_create(use_cluster_list);
 	while ((cluster_name = list_next(itr))) {
 		int rc;
-		if ((rc = _cluster_get_jobs(mysql_conn, &user, job_cond,
-					    cluster_name, tmp, tmp2, extra,
-					    is_admin, only_pending, job_list))
-		    != SLURM_SUCCESS)
-			error("Problem getting jobs for cluster %s",
-			      cluster_name);
+		uint32_t page_cursor = 0, last_cursor;
+
+		if (!page_size) {
+			if ((rc = _cluster_get_jobs(
+				     mysql_conn, &user, job_cond,
+				     cluster_name, tmp, tmp2, extra,
+				     is_admin, only_pending, job_list, 0, NULL))
+			    != SLURM_SUCCESS)
+				error("Problem getting jobs for cluster %s",
+				      cluster_name);
+			continue;
+		}
+
+		/* Start the page after the cursor from the last one */
+		if (cursor_cluster) {
+			if (xstrcmp(cluster_name, cursor_cluster))
+				continue;
+			page_cursor = job_cond->cursor_jobid;
+			cursor_cluster = NULL;
+		}
+
+		/* Keep going until the page is full or the cluster is
+		 * out of jobs, an empty page means there are no more. */
+		do {
+			last_cursor = page_cursor;
+			if ((rc = _cluster_get_jobs(
+				     mysql_conn, &user, job_cond,
+				     cluster_name, tmp, tmp2, extra,
+				     is_admin, only_pending, job_list,
+				     page_size - list_count(job_list),
+				     &page_cursor))
+			    != SLURM_SUCCESS)
+				error("Problem getting jobs for cluster %s",
+				      cluster_name);
+		} while ((rc == SLURM_SUCCESS) && (page_cursor > last_cursor)
+			 && (list_count(job_list) < page_size));
+
+		if (list_count(job_list) >= page_size)
+			break;
 	}
 	list_iterator_destroy(itr);
 
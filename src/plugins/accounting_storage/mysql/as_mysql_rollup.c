@@ -67,9 +67,15 @@ typedef struct {
 	uint64_t total_time;
 } local_tres_usage_t;
 
-typedef struct {
+/* Association and wckey usage records are hashed by id as there can be
+ * many thousands of them for an hour */
+#define ID_USAGE_HASH_SIZE	4096
+#define ID_USAGE_HASH_INX(_id)	((uint32_t)(_id) % ID_USAGE_HASH_SIZE)
+
+typedef struct local_id_usage {
 	int id;
 	List loc_tres;
+	struct local_id_usage *next;	/* next record in hash chain */
 } local_id_usage_t;
 
 typedef struct {
@@ -88,6 +94,12 @@ typedef struct {
 	time_t start;
 } local_resv_usage_t;
 
+typedef struct {
+	uint64_t job_db_inx;
+	time_t end;
+	time_t start;
+} local_suspend_t;
+
 static void _destroy_local_tres_usage(void *object)
 {
 	local_tres_usage_t *a_usage = (local_tres_usage_t *)object;
@@ -134,14 +146,47 @@ static int _find_loc_tres(void *x, void *key)
 	return 0;
 }
 
-static int _find_id_usage(void *x, void *key)
+/* Find the usage record of an id, adding it to usage_list if not found */
+static local_id_usage_t *_get_id_usage(List usage_list,
+				       local_id_usage_t **usage_hash,
+				       uint32_t id, bool make_tres)
 {
-	local_id_usage_t *loc = (local_id_usage_t *)x;
-	uint32_t id = *(uint32_t *)key;
+	int inx = ID_USAGE_HASH_INX(id);
+	local_id_usage_t *usage = usage_hash[inx];
 
-	if (loc->id == id)
-		return 1;
-	return 0;
+	while (usage && (usage->id != id))
+		usage = usage->next;
+
+	if (!usage) {
+		usage = xmalloc(sizeof(local_id_usage_t));
+		usage->id = id;
+		usage->next = usage_hash[inx];
+		usage_hash[inx] = usage;
+		list_append(usage_list, usage);
+	}
+	if (make_tres && !usage->loc_tres)
+		usage->loc_tres = list_create(_destroy_local_tres_usage);
+
+	return usage;
+}
+
+/* Return the index of the first suspend record of a job in an array
+ * sorted by job_db_inx, or suspend_cnt if the job has none */
+static int _find_suspend(local_suspend_t *suspend, int suspend_cnt,
+			 uint64_t job_db_inx)
+{
+	int lo = 0, hi = suspend_cnt, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (suspend[mid].job_db_inx < job_db_inx)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if ((lo < suspend_cnt) && (suspend[lo].job_db_inx == job_db_inx))
+		return lo;
+	return suspend_cnt;
 }
 
 static void _remove_job_tres_time_from_cluster(List c_tres, List j_tres,
@@ -905,6 +950,12 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 	local_resv_usage_t *r_usage = NULL;
 	local_id_usage_t *a_usage = NULL;
 	local_id_usage_t *w_usage = NULL;
+	local_id_usage_t **assoc_hash = xmalloc(sizeof(local_id_usage_t *) *
+						ID_USAGE_HASH_SIZE);
+	local_id_usage_t **wckey_hash = xmalloc(sizeof(local_id_usage_t *) *
+						ID_USAGE_HASH_SIZE);
+	local_suspend_t *suspend = NULL;
+	int suspend_cnt = 0;
 	/* char start_char[20], end_char[20]; */
 
 	char *job_req_inx[] = {
@@ -941,11 +992,13 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 	};
 
 	char *suspend_req_inx[] = {
+		"job_db_inx",
 		"time_start",
 		"time_end"
 	};
 	char *suspend_str = NULL;
 	enum {
+		SUSPEND_REQ_DB_INX,
 		SUSPEND_REQ_START,
 		SUSPEND_REQ_END,
 		SUSPEND_REQ_COUNT
@@ -1121,6 +1174,38 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 		}
 		mysql_free_result(result);
 
+		/* Get the suspended time of all the jobs during this
+		 * time at once rather than querying it job by job. */
+		query = xstrdup_printf("select %s from \"%s_%s\" where "
+				       "(time_start < %ld && (time_end >= %ld "
+				       "|| time_end = 0)) "
+				       "order by job_db_inx, time_start",
+				       suspend_str, cluster_name, suspend_table,
+				       curr_end, curr_start);
+
+		if (debug_flags & DEBUG_FLAG_DB_USAGE)
+			DB_DEBUG(mysql_conn->conn, "query\n%s", query);
+		if (!(result = mysql_db_query_ret(
+			      mysql_conn, query, 0))) {
+			rc = SLURM_ERROR;
+			goto end_it;
+		}
+		xfree(query);
+
+		if (mysql_num_rows(result))
+			suspend = xmalloc(sizeof(local_suspend_t) *
+					  mysql_num_rows(result));
+		while ((row = mysql_fetch_row(result))) {
+			suspend[suspend_cnt].job_db_inx =
+				slurm_atoull(row[SUSPEND_REQ_DB_INX]);
+			suspend[suspend_cnt].start =
+				slurm_atoul(row[SUSPEND_REQ_START]);
+			suspend[suspend_cnt].end =
+				slurm_atoul(row[SUSPEND_REQ_END]);
+			suspend_cnt++;
+		}
+		mysql_free_result(result);
+
 		/* now get the jobs during this time only  */
 		query = xstrdup_printf("select %s from \"%s_%s\" as job "
 				       "left outer join \"%s_%s\" as step on "
@@ -1179,35 +1264,18 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 			seconds = (row_end - row_start);
 
 			if (slurm_atoul(row[JOB_REQ_SUSPENDED])) {
-				MYSQL_RES *result2 = NULL;
-				MYSQL_ROW row2;
+				uint64_t job_db_inx =
+					slurm_atoull(row[JOB_REQ_DB_INX]);
+				int s_inx = _find_suspend(suspend, suspend_cnt,
+							  job_db_inx);
 				/* get the suspended time for this job */
-				query = xstrdup_printf(
-					"select %s from \"%s_%s\" where "
-					"(time_start < %ld && (time_end >= %ld "
-					"|| time_end = 0)) && job_db_inx=%s "
-					"order by time_start",
-					suspend_str, cluster_name,
-					suspend_table,
-					curr_end, curr_start,
-					row[JOB_REQ_DB_INX]);
-
-				debug4("%d(%s:%d) query\n%s",
-				       mysql_conn->conn, THIS_FILE,
-				       __LINE__, query);
-				if (!(result2 = mysql_db_query_ret(
-					      mysql_conn,
-					      query, 0))) {
-					rc = SLURM_ERROR;
-					goto end_it;
-				}
-				xfree(query);
-				while ((row2 = mysql_fetch_row(result2))) {
+				for ( ; (s_inx < suspend_cnt) &&
+					(suspend[s_inx].job_db_inx ==
+					 job_db_inx); s_inx++) {
 					int tot_time = 0;
-					time_t local_start = slurm_atoul(
-						row2[SUSPEND_REQ_START]);
-					time_t local_end = slurm_atoul(
-						row2[SUSPEND_REQ_END]);
+					time_t local_start =
+						suspend[s_inx].start;
+					time_t local_end = suspend[s_inx].end;
 
 					if (!local_start)
 						continue;
@@ -1221,13 +1289,12 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 					if (tot_time > 0)
 						suspend_seconds += tot_time;
 				}
-				mysql_free_result(result2);
 			}
 
 			if (last_id != assoc_id) {
-				a_usage = xmalloc(sizeof(local_id_usage_t));
-				a_usage->id = assoc_id;
-				list_append(assoc_usage_list, a_usage);
+				a_usage = _get_id_usage(assoc_usage_list,
+							assoc_hash, assoc_id,
+							false);
 				last_id = assoc_id;
 				/* a_usage->loc_tres is made later,
 				   don't do it here.
@@ -1240,20 +1307,9 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 
 			/* do the wckey calculation */
 			if (last_wckeyid != wckey_id) {
-				list_iterator_reset(w_itr);
-				while ((w_usage = list_next(w_itr)))
-					if (w_usage->id == wckey_id)
-						break;
-
-				if (!w_usage) {
-					w_usage = xmalloc(
-						sizeof(local_id_usage_t));
-					w_usage->id = wckey_id;
-					list_append(wckey_usage_list,
-						    w_usage);
-					w_usage->loc_tres = list_create(
-						_destroy_local_tres_usage);
-				}
+				w_usage = _get_id_usage(wckey_usage_list,
+							wckey_hash, wckey_id,
+							true);
 				last_wckeyid = wckey_id;
 			}
 
@@ -1474,19 +1530,12 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 					r_usage->local_assocs);
 				while ((assoc = list_next(tmp_itr))) {
 					uint32_t associd = slurm_atoul(assoc);
-					if ((last_id != associd) &&
-					    !(a_usage = list_find_first(
-						      assoc_usage_list,
-						      _find_id_usage,
-						      &associd))) {
-						a_usage = xmalloc(
-							sizeof(local_id_usage_t));
-						a_usage->id = associd;
-						list_append(assoc_usage_list,
-							    a_usage);
+					if (last_id != associd) {
+						a_usage = _get_id_usage(
+							assoc_usage_list,
+							assoc_hash, associd,
+							true);
 						last_id = associd;
-						a_usage->loc_tres = list_create(
-							_destroy_local_tres_usage);
 					}
 
 					_add_time_tres(a_usage->loc_tres,
@@ -1571,6 +1620,12 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 		list_flush(cluster_down_list);
 		list_flush(wckey_usage_list);
 		list_flush(resv_usage_list);
+		memset(assoc_hash, 0,
+		       sizeof(local_id_usage_t *) * ID_USAGE_HASH_SIZE);
+		memset(wckey_hash, 0,
+		       sizeof(local_id_usage_t *) * ID_USAGE_HASH_SIZE);
+		xfree(suspend);
+		suspend_cnt = 0;
 		curr_start = curr_end;
 		curr_end = curr_start + add_sec;
 	}
@@ -1596,6 +1651,9 @@ end_it:
 	FREE_NULL_LIST(cluster_down_list);
 	FREE_NULL_LIST(wckey_usage_list);
 	FREE_NULL_LIST(resv_usage_list);
+	xfree(assoc_hash);
+	xfree(wckey_hash);
+	xfree(suspend);
 
 /* 	info("stop start %s", slurm_ctime2(&curr_start)); */
 /* 	info("stop end %s", slurm_ctime2(&curr_end)); */
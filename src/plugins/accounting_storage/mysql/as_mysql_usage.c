@@ -38,6 +38,7 @@
 \*****************************************************************************/
 
 #include "as_mysql_cluster.h"
+#include "as_mysql_export.h"
 #include "as_mysql_usage.h"
 #include "as_mysql_rollup.h"
 #include "src/common/slurm_time.h"
@@ -335,6 +336,12 @@ static void *_cluster_rollup_usage(void *arg)
 		END_TIMER3(timer_str, 5000000);
 		if (rc != SLURM_SUCCESS)
 			goto end_it;
+
+		/* The jobs of these months are complete, an export failing
+		 * does not fail the rollup */
+		(void) as_mysql_export_months(&mysql_conn,
+					      local_rollup->cluster_name,
+					      month_start, month_end);
 	}
 
 	if ((hour_end - hour_start) > 0) {
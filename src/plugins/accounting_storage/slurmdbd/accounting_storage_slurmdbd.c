@@ -2735,12 +2735,31 @@ extern List jobacct_storage_p_get_jobs_cond(void *db_conn, uid_t uid,
 
 	get_msg.cond = job_cond;
 
-	req.msg_type = DBD_GET_JOBS_COND;
+	if (job_cond && job_cond->page_size)
+		req.msg_type = DBD_GET_JOBS_PAGE;
+	else
+		req.msg_type = DBD_GET_JOBS_COND;
 	req.data = &get_msg;
 	rc = slurm_send_recv_slurmdbd_msg(SLURM_PROTOCOL_VERSION, &req, &resp);
 
+	if ((rc == SLURM_SUCCESS) && (req.msg_type == DBD_GET_JOBS_PAGE) &&
+	    (resp.msg_type == DBD_RC) &&
+	    (((dbd_rc_msg_t *) resp.data)->return_code == EINVAL)) {
+		/* This slurmdbd does not know DBD_GET_JOBS_PAGE, get all
+		 * the jobs at once. Clearing page_size tells the caller
+		 * there are no more pages. */
+		debug("slurmdbd: DBD_GET_JOBS_PAGE not supported, "
+		      "getting all jobs");
+		slurmdbd_free_rc_msg(resp.data);
+		job_cond->page_size = 0;
+		req.msg_type = DBD_GET_JOBS_COND;
+		rc = slurm_send_recv_slurmdbd_msg(SLURM_PROTOCOL_VERSION,
+						  &req, &resp);
+	}
+
 	if (rc != SLURM_SUCCESS)
-		error("slurmdbd: DBD_GET_JOBS_COND failure: %m");
+		error("slurmdbd: %s failure: %m",
+		      slurmdbd_msg_type_2_str(req.msg_type, 1));
 	else if (resp.msg_type == DBD_RC) {
 		dbd_rc_msg_t *msg = resp.data;
 		if (msg->return_code == SLURM_SUCCESS) {
@@ -105,7 +105,7 @@ static bool _run_in_daemon(void)
 
 /* Finally, pre-define all the routines. */
 
-static void _get_offspring_data(List prec_list, prec_t *ancestor, pid_t pid);
+static void _get_offspring_data(jag_prec_t *ancestor);
 
 /* system call to get process table */
 extern int getprocs(struct procsinfo *procinfo, int, struct fdsinfo *,
@@ -116,48 +116,49 @@ extern int getprocs(struct procsinfo *procinfo, int, struct fdsinfo *,
 
 
 /*
- * _get_offspring_data() -- collect memory usage data for the offspring
- *
- * For each process that lists <pid> as its parent, add its memory
- * usage data to the ancestor's <prec> record. Recurse to gather data
- * for *all* subsequent generations.
- *
- * IN:	prec_list       list of prec's
- * 	ancestor	The entry in prec_list to which the data
- * 			should be added. Even as we recurse, this will
- * 			always be the prec for the base of the family
- * 			tree.
- * 	pid		The process for which we are currently looking
- * 			for offspring.
+ * _add_offspring_data() -- add the usage data of the children of <parent>
  *
- * OUT:	none.
+ * For each child process of <parent>, add its memory usage data to the
+ * ancestor's <prec> record. Recurse to gather data for *all* subsequent
+ * generations.
  *
- * RETVAL:	none.
+ * IN:	ancestor	The prec to which the data should be added. Even as
+ * 			we recurse, this will always be the prec for the
+ * 			base of the family tree.
+ * 	parent		The process whose offspring we are adding.
  *
  * THREADSAFE! Only one thread ever gets here.
  */
-static void _get_offspring_data(List prec_list, jag_prec_t *ancestor, pid_t pid)
+static void _add_offspring_data(jag_prec_t *ancestor, jag_prec_t *parent)
 {
-	ListIterator itr;
-	jag_prec_t *prec = NULL;
+	jag_prec_t *prec;
 
-	itr = list_iterator_create(prec_list);
-	while((prec = list_next(itr))) {
-		if (prec->ppid == pid) {
-			_get_offspring_data(prec_list, ancestor, prec->pid);
-			debug2("adding %d to %d rss = %f vsize = %f",
-			      prec->pid, ancestor->pid,
-			      prec->rss, prec->vsize);
-			ancestor->usec += prec->usec;
-			ancestor->ssec += prec->ssec;
-			ancestor->pages += prec->pages;
-			ancestor->rss += prec->rss;
-			ancestor->vsize += prec->vsize;
-		}
+	for (prec = parent->child; prec; prec = prec->sibling) {
+		if (prec->visited)	/* pid reuse made a loop */
+			continue;
+		prec->visited = true;
+		_add_offspring_data(ancestor, prec);
+		debug2("adding %d to %d rss = %f vsize = %f",
+		      prec->pid, ancestor->pid,
+		      prec->rss, prec->vsize);
+		ancestor->usec += prec->usec;
+		ancestor->ssec += prec->ssec;
+		ancestor->pages += prec->pages;
+		ancestor->rss += prec->rss;
+		ancestor->vsize += prec->vsize;
 	}
-	list_iterator_destroy(itr);
+}
 
-	return;
+/*
+ * _get_offspring_data() -- collect memory usage data for the offspring
+ *
+ * IN:	ancestor	The prec of the task, linked to the precs of its
+ * 			children by jag_common_poll_data().
+ */
+static void _get_offspring_data(jag_prec_t *ancestor)
+{
+	ancestor->visited = true;
+	_add_offspring_data(ancestor, ancestor);
 }
 
 static List _get_precs(List task_list, bool pgid_plugin, uint64_t cont_id,
@@ -99,18 +99,14 @@ const uint32_t plugin_version = SLURM_VERSION_NUMBER;
 /* Other useful declarations */
 static slurm_cgroup_conf_t slurm_cgroup_conf;
 
-static void _prec_extra(jag_prec_t *prec)
+/* Set the cpu and memory usage of prec from the contents of a cgroup's
+ * cpuacct.stat and memory.stat files */
+static void _prec_cgroup_stat(jag_prec_t *prec, char *cpu_time,
+			      char *memory_stat)
 {
 	unsigned long utime, stime, total_rss, total_pgpgin;
-	char *cpu_time = NULL, *memory_stat = NULL, *ptr;
-	size_t cpu_time_size = 0, memory_stat_size = 0;
+	char *ptr;
 
-	//DEF_TIMERS;
-	//START_TIMER;
-	/* info("before"); */
-	/* print_jag_prec(prec); */
-	xcgroup_get_param(&task_cpuacct_cg, "cpuacct.stat",
-			  &cpu_time, &cpu_time_size);
 	if (cpu_time == NULL) {
 		debug2("%s: failed to collect cpuacct.stat pid %d ppid %d",
 		       __func__, prec->pid, prec->ppid);
@@ -120,8 +116,6 @@ static void _prec_extra(jag_prec_t *prec)
 		prec->ssec = stime;
 	}
 
-	xcgroup_get_param(&task_memory_cg, "memory.stat",
-			  &memory_stat, &memory_stat_size);
 	if (memory_stat == NULL) {
 		debug2("%s: failed to collect memory.stat  pid %d ppid %d",
 		       __func__, prec->pid, prec->ppid);
@@ -131,9 +125,11 @@ static void _prec_extra(jag_prec_t *prec)
 		   different than what proc presents, but is probably more
 		   accurate on what the user is actually using.
 		*/
-		ptr = strstr(memory_stat, "total_rss");
-		sscanf(ptr, "total_rss %lu", &total_rss);
-		prec->rss = total_rss / 1024; /* convert from bytes to KB */
+		if ((ptr = strstr(memory_stat, "total_rss"))) {
+			sscanf(ptr, "total_rss %lu", &total_rss);
+			/* convert from bytes to KB */
+			prec->rss = total_rss / 1024;
+		}
 
 		/* total_pgmajfault is what is reported in proc, so we use
 		 * the same thing here. */
@@ -142,6 +138,22 @@ static void _prec_extra(jag_prec_t *prec)
 			prec->pages = total_pgpgin;
 		}
 	}
+}
+
+static void _prec_extra(jag_prec_t *prec)
+{
+	char *cpu_time = NULL, *memory_stat = NULL;
+	size_t cpu_time_size = 0, memory_stat_size = 0;
+
+	//DEF_TIMERS;
+	//START_TIMER;
+	/* info("before"); */
+	/* print_jag_prec(prec); */
+	xcgroup_get_param(&task_cpuacct_cg, "cpuacct.stat",
+			  &cpu_time, &cpu_time_size);
+	xcgroup_get_param(&task_memory_cg, "memory.stat",
+			  &memory_stat, &memory_stat_size);
+	_prec_cgroup_stat(prec, cpu_time, memory_stat);
 
 	xfree(cpu_time);
 	xfree(memory_stat);
@@ -183,6 +195,51 @@ static void _prec_extra(jag_prec_t *prec)
 
 }
 
+/*
+ * Build one process record per task from the task's cpuacct and memory
+ * cgroups, with JobAcctGatherParams=UseTaskCgroup. Unlike a scan of /proc,
+ * the cost of this does not grow with the number of processes the tasks
+ * run. Virtual memory size and I/O are not available from the cgroups
+ * and are left zero.
+ */
+static List _get_precs_task_cgroup(List task_list, bool pgid_plugin,
+				   uint64_t cont_id,
+				   jag_callbacks_t *callbacks)
+{
+	List prec_list = list_create(destroy_jag_prec);
+	struct jobacctinfo *jobacct;
+	ListIterator itr;
+	jag_prec_t *prec;
+	char *cpu_time, *memory_stat;
+	size_t cpu_time_size, memory_stat_size;
+
+	if (!task_list)
+		return prec_list;
+
+	itr = list_iterator_create(task_list);
+	while ((jobacct = list_next(itr))) {
+		cpu_time = memory_stat = NULL;
+		if (jobacct_gather_cgroup_cpuacct_get_task_param(
+			    jobacct->id.taskid, "cpuacct.stat",
+			    &cpu_time, &cpu_time_size) != SLURM_SUCCESS)
+			continue;	/* Assume the task went away */
+		jobacct_gather_cgroup_memory_get_task_param(
+			jobacct->id.taskid, "memory.stat",
+			&memory_stat, &memory_stat_size);
+
+		prec = xmalloc(sizeof(jag_prec_t));
+		prec->pid = jobacct->pid;
+		_prec_cgroup_stat(prec, cpu_time, memory_stat);
+		list_append(prec_list, prec);
+
+		xfree(cpu_time);
+		xfree(memory_stat);
+	}
+	list_iterator_destroy(itr);
+
+	return prec_list;
+}
+
 static bool _run_in_daemon(void)
 {
 	static bool set = false;
@@ -288,9 +345,15 @@ extern void jobacct_gather_p_poll_data(
 	static bool first = 1;
 
 	if (first) {
+		char *acct_params = slurm_get_jobacct_gather_params();
+
 		memset(&callbacks, 0, sizeof(jag_callbacks_t));
 		first = 0;
-		callbacks.prec_extra = _prec_extra;
+		if (acct_params && strstr(acct_params, "UseTaskCgroup"))
+			callbacks.get_precs = _get_precs_task_cgroup;
+		else
+			callbacks.prec_extra = _prec_extra;
+		xfree(acct_params);
 	}
 
 	jag_common_poll_data(task_list, pgid_plugin, cont_id, &callbacks,
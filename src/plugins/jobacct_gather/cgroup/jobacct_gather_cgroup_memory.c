@@ -405,3 +405,24 @@ error:
 	xcgroup_destroy(&memory_cg);
 	return fstatus;
 }
+
+extern int
+jobacct_gather_cgroup_memory_get_task_param(uint32_t taskid, char *param,
+					    char **content, size_t *csize)
+{
+	xcgroup_t memory_cg;
+	char buf[PATH_MAX];
+	int rc;
+
+	if (jobstep_cgroup_path[0] == '\0')
+		return SLURM_ERROR;
+	if (snprintf(buf, PATH_MAX, "%s/task_%u",
+		     jobstep_cgroup_path, taskid) >= PATH_MAX)
+		return SLURM_ERROR;
+	if (xcgroup_create(&memory_ns, &memory_cg, buf, 0, 0) != XCGROUP_SUCCESS)
+		return SLURM_ERROR;
+	rc = xcgroup_get_param(&memory_cg, param, content, csize);
+	xcgroup_destroy(&memory_cg);
+
+	return (rc == XCGROUP_SUCCESS) ? SLURM_SUCCESS : SLURM_ERROR;
+}
@@ -43,6 +43,7 @@
 #include <signal.h>
 #include <time.h>
 #include <ctype.h>
+#include <sys/resource.h>
 
 #include "src/common/slurm_xlator.h"
 #include "src/common/slurm_jobacct_gather.h"
@@ -50,6 +51,7 @@
 #include "src/common/slurm_protocol_defs.h"
 #include "src/common/slurm_acct_gather_energy.h"
 #include "src/common/slurm_acct_gather_infiniband.h"
+#include "src/common/timers.h"
 #include "src/slurmd/common/proctrack.h"
 
 #include "common_jag.h"
@@ -62,15 +64,148 @@ static DIR  *slash_proc = NULL;
 static int energy_profile = ENERGY_DATA_NODE_ENERGY_UP;
 static uint64_t debug_flags = 0;
 
-static int _find_prec(void *x, void *key)
+/*
+ * Open /proc files of the processes found through the proctrack plugin.
+ * They are kept open between polls, so a poll only needs to pread() each
+ * file of a process it has seen before. Records of processes which were
+ * not seen in a poll are closed at the end of it.
+ */
+typedef struct jag_proc_fds {
+	int io_fd;			/* /proc/<pid>/io, -1 if not open */
+	int lwp;			/* _is_a_lwp() result, -1 if unknown */
+	struct jag_proc_fds *next;	/* next record in hash bucket */
+	pid_t pid;
+	uint32_t seen;			/* last poll which found the pid */
+	uint64_t start_time;		/* start time of the process, to
+					 * detect reuse of its pid */
+	int stat_fd;			/* /proc/<pid>/stat, -1 if not open */
+	int statm_fd;			/* /proc/<pid>/statm, -1 if not open */
+} jag_proc_fds_t;
+
+#define PROC_FDS_HASH_SIZE	1024
+#define PROC_FDS_MAX		16384
+
+static jag_proc_fds_t *proc_fds_hash[PROC_FDS_HASH_SIZE];
+static int proc_fds_cnt = 0;
+static int proc_fds_max = 0;		/* limit from RLIMIT_NOFILE */
+static uint32_t proc_fds_poll = 0;
+
+static int _open_proc_file(char *file)
 {
-	jag_prec_t *prec = (jag_prec_t *) x;
-	struct jobacctinfo *jobacct = (struct jobacctinfo *) key;
+	int fd;
 
-	if (prec->pid == jobacct->pid)
-		return 1;
+#ifdef O_CLOEXEC
+	fd = open(file, O_RDONLY | O_CLOEXEC);
+#else
+	if ((fd = open(file, O_RDONLY)) >= 0)
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+	return fd;
+}
 
-	return 0;
+static void _proc_fds_close(jag_proc_fds_t *fds)
+{
+	if (fds->stat_fd >= 0)
+		(void) close(fds->stat_fd);
+	if (fds->statm_fd >= 0)
+		(void) close(fds->statm_fd);
+	if (fds->io_fd >= 0)
+		(void) close(fds->io_fd);
+	fds->stat_fd = fds->statm_fd = fds->io_fd = -1;
+}
+
+/* Return the record of pid, creating it if there is room */
+static jag_proc_fds_t *_proc_fds_get(pid_t pid)
+{
+	jag_proc_fds_t *fds;
+	int inx = pid % PROC_FDS_HASH_SIZE;
+
+	for (fds = proc_fds_hash[inx]; fds; fds = fds->next) {
+		if (fds->pid == pid) {
+			fds->seen = proc_fds_poll;
+			return fds;
+		}
+	}
+	if (proc_fds_cnt >= proc_fds_max)
+		return NULL;
+
+	fds = xmalloc(sizeof(jag_proc_fds_t));
+	fds->pid = pid;
+	fds->seen = proc_fds_poll;
+	fds->lwp = -1;
+	fds->stat_fd = fds->statm_fd = fds->io_fd = -1;
+	fds->next = proc_fds_hash[inx];
+	proc_fds_hash[inx] = fds;
+	proc_fds_cnt++;
+
+	return fds;
+}
+
+/* Drop the records of processes not seen in the current poll, or of all
+ * processes if purge_all is set */
+static void _proc_fds_purge(bool purge_all)
+{
+	jag_proc_fds_t *fds, **fds_pptr;
+	int i;
+
+	for (i = 0; i < PROC_FDS_HASH_SIZE; i++) {
+		fds_pptr = &proc_fds_hash[i];
+		while ((fds = *fds_pptr)) {
+			if (!purge_all && (fds->seen == proc_fds_poll)) {
+				fds_pptr = &fds->next;
+				continue;
+			}
+			*fds_pptr = fds->next;
+			_proc_fds_close(fds);
+			xfree(fds);
+			proc_fds_cnt--;
+		}
+	}
+}
+
+/* Return the record of pid from a hash table built by _prec_tree_build() */
+static jag_prec_t *_prec_find(jag_prec_t **prec_hash, int hash_size,
+			      pid_t pid)
+{
+	jag_prec_t *prec;
+
+	for (prec = prec_hash[pid % hash_size]; prec; prec = prec->hash_next) {
+		if (prec->pid == pid)
+			return prec;
+	}
+	return NULL;
+}
+
+/*
+ * Hash the records of prec_list by pid and link each record to the record
+ * of its parent process, so that the offspring of a process can be found
+ * without searching the whole list.
+ * RET hash table of hash_size entries, free with xfree()
+ */
+static jag_prec_t **_prec_tree_build(List prec_list, int *hash_size)
+{
+	jag_prec_t **prec_hash, *prec, *parent;
+	ListIterator itr;
+
+	*hash_size = (list_count(prec_list) * 2) + 1;
+	prec_hash = xmalloc(sizeof(jag_prec_t *) * (*hash_size));
+
+	itr = list_iterator_create(prec_list);
+	while ((prec = list_next(itr))) {
+		prec->hash_next = prec_hash[prec->pid % *hash_size];
+		prec_hash[prec->pid % *hash_size] = prec;
+	}
+	list_iterator_reset(itr);
+	while ((prec = list_next(itr))) {
+		if ((prec->ppid == prec->pid) ||
+		    !(parent = _prec_find(prec_hash, *hash_size, prec->ppid)))
+			continue;
+		prec->sibling = parent->child;
+		parent->child = prec;
+	}
+	list_iterator_destroy(itr);
+
+	return prec_hash;
 }
 
 /* return weighted frequency in mhz */
@@ -296,7 +431,7 @@ static int _get_process_data_line(int in, jag_prec_t *prec) {
 	long unsigned f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13;
 	int exit_signal, last_cpu;
 
-	num_read = read(in, sbuf, (sizeof(sbuf) - 1));
+	num_read = pread(in, sbuf, (sizeof(sbuf) - 1), 0);
 	if (num_read <= 0)
 		return 0;
 	sbuf[num_read] = '\0';
@@ -326,11 +461,6 @@ static int _get_process_data_line(int in, jag_prec_t *prec) {
 	if ((nvals < 37) || (rss < 0))
 		return 0;
 
-	/* If current pid corresponds to a Light Weight Process (Thread POSIX) */
-	/* skip it, we will only account the original process (pid==tgid) */
-	if (_is_a_lwp(prec->pid) > 0)
-		return 0;
-
 	/* Copy the values that slurm records into our data structure */
 	prec->ppid  = ppid;
 	prec->pages = majflt;
@@ -339,6 +469,7 @@ static int _get_process_data_line(int in, jag_prec_t *prec) {
 	prec->vsize = vsize / 1024; /* convert from bytes to KB */
 	prec->rss   = rss * my_pagesize;/* convert from pages to KB */
 	prec->last_cpu = last_cpu;
+	prec->start_time = starttime;
 	return 1;
 }
 
@@ -361,7 +492,7 @@ static int _get_process_memory_line(int in, jag_prec_t *prec)
 	int num_read, nvals;
 	long int size, rss, share, text, lib, data, dt;
 
-	num_read = read(in, sbuf, (sizeof(sbuf) - 1));
+	num_read = pread(in, sbuf, (sizeof(sbuf) - 1), 0);
 	if (num_read <= 0)
 		return 0;
 	sbuf[num_read] = '\0';
@@ -384,23 +515,6 @@ static int _get_process_memory_line(int in, jag_prec_t *prec)
 	return 1;
 }
 
-static int _remove_share_data(char *proc_stat_file, jag_prec_t *prec)
-{
-	FILE *statm_fp = NULL;
-	char proc_statm_file[256];	/* Allow ~20x extra length */
-	int rc = 0, fd;
-
-	snprintf(proc_statm_file, sizeof(proc_statm_file), "%sm",
-		 proc_stat_file);
-	if (!(statm_fp = fopen(proc_statm_file, "r")))
-		return rc;  /* Assume the process went away */
-	fd = fileno(statm_fp);
-	fcntl(fd, F_SETFD, FD_CLOEXEC);
-	rc = _get_process_memory_line(fd, prec);
-	fclose(statm_fp);
-	return rc;
-}
-
 /* _get_process_io_data_line() - get line of data from /proc/<pid>/io
  *
  * IN:	in - input file descriptor
@@ -420,7 +534,7 @@ static int _get_process_io_data_line(int in, jag_prec_t *prec) {
 	int num_read, nvals;
 	uint64_t rchar, wchar;
 
-	num_read = read(in, sbuf, (sizeof(sbuf) - 1));
+	num_read = pread(in, sbuf, (sizeof(sbuf) - 1), 0);
 	if (num_read <= 0)
 		return 0;
 	sbuf[num_read] = '\0';
@@ -430,9 +544,6 @@ static int _get_process_io_data_line(int in, jag_prec_t *prec) {
 	if (nvals < 4)
 		return 0;
 
-	if (_is_a_lwp(prec->pid) > 0)
-		return 0;
-
 	/* Copy the values that slurm records into our data structure */
 	prec->disk_read = (double)rchar / (double)1048576;
 	prec->disk_write = (double)wchar / (double)1048576;
@@ -440,15 +551,38 @@ static int _get_process_io_data_line(int in, jag_prec_t *prec) {
 	return 1;
 }
 
-static void _handle_stats(List prec_list, char *proc_stat_file, char *proc_io_file,
+/*
+ * Parse a /proc file with get_line(), reusing the descriptor *fd if it is
+ * open. A descriptor of a process which has exited can no longer be read,
+ * so the file is reopened once in case its pid was reused.
+ * OUT opened - set if the file had to be (re)opened
+ */
+static int _read_proc_file(int *fd, char *file,
+			   int (*get_line) (int in, jag_prec_t *prec),
+			   jag_prec_t *prec, bool *opened)
+{
+	*opened = false;
+	if (*fd >= 0) {
+		if ((*get_line)(*fd, prec))
+			return 1;
+		(void) close(*fd);
+	}
+	*opened = true;
+	if ((*fd = _open_proc_file(file)) < 0)
+		return 0;	/* Assume the process went away */
+	return (*get_line)(*fd, prec);
+}
+
+static void _handle_stats(List prec_list, pid_t pid, bool cache_fds,
+			  char *proc_stat_file, char *proc_io_file,
 			  char *proc_smaps_file, jag_callbacks_t *callbacks)
 {
 	static int no_share_data = -1;
 	static int use_pss = -1;
-	FILE *stat_fp = NULL;
-	FILE *io_fp = NULL;
-	int fd, fd2;
+	char proc_statm_file[256];	/* Allow ~20x extra length */
+	jag_proc_fds_t *fds = NULL, tmp_fds;
 	jag_prec_t *prec = NULL;
+	bool opened;
 
 	if (no_share_data == -1) {
 		char *acct_params = slurm_get_jobacct_gather_params();
@@ -464,55 +598,87 @@ static void _handle_stats(List prec_list, char *proc_stat_file, char *proc_io_fi
 		xfree(acct_params);
 	}
 
-	if (!(stat_fp = fopen(proc_stat_file, "r")))
-		return;  /* Assume the process went away */
+	if (cache_fds)
+		fds = _proc_fds_get(pid);
+	if (!fds) {
+		fds = &tmp_fds;
+		fds->lwp = -1;
+		fds->stat_fd = fds->statm_fd = fds->io_fd = -1;
+	}
+
+	prec = try_xmalloc(sizeof(jag_prec_t));
+	if (prec == NULL)	/* Avoid killing slurmstepd on malloc failure */
+		goto done;
+
 	/*
-	 * Close the file on exec() of user tasks.
-	 *
-	 * NOTE: If we fork() slurmstepd after the
-	 * fopen() above and before the fcntl() below,
-	 * then the user task may have this extra file
-	 * open, which can cause problems for
-	 * checkpoint/restart, but this should be a very rare
-	 * problem in practice.
+	 * All files are opened with close-on-exec, so that user tasks
+	 * forked by slurmstepd do not inherit them.
 	 */
-	fd = fileno(stat_fp);
-	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	if (!_read_proc_file(&fds->stat_fd, proc_stat_file,
+			     _get_process_data_line, prec, &opened)) {
+		_proc_fds_close(fds);
+		goto bail;
+	}
 
-	prec = try_xmalloc(sizeof(jag_prec_t));
-	if (prec == NULL) {	/* Avoid killing slurmstepd on malloc failure */
-		fclose(stat_fp);
-		return;
+	/*
+	 * A different start time means the pid now belongs to another
+	 * process, so nothing learned from the old one can be trusted.
+	 */
+	if (!opened && (fds->lwp != -1) &&
+	    (prec->start_time != fds->start_time)) {
+		debug2("%s: pid %d was reused", __func__, pid);
+		opened = true;
 	}
-	if (!_get_process_data_line(fd, prec)) {
-		xfree(prec);
-		fclose(stat_fp);
-		return;
+	if (opened) {
+		if (fds->statm_fd >= 0)
+			(void) close(fds->statm_fd);
+		if (fds->io_fd >= 0)
+			(void) close(fds->io_fd);
+		fds->statm_fd = fds->io_fd = -1;
+		fds->lwp = -1;
+	}
+	fds->start_time = prec->start_time;
+
+	/* If current pid corresponds to a Light Weight Process (Thread POSIX) */
+	/* skip it, we will only account the original process (pid==tgid) */
+	if (fds->lwp == -1)
+		fds->lwp = (_is_a_lwp(pid) > 0);
+	if (fds->lwp) {
+		if (fds->statm_fd >= 0)
+			(void) close(fds->statm_fd);
+		if (fds->io_fd >= 0)
+			(void) close(fds->io_fd);
+		fds->statm_fd = fds->io_fd = -1;
+		goto bail;
 	}
-	fclose(stat_fp);
 
 	/* Remove shared data from rss */
-	if (no_share_data)
-		_remove_share_data(proc_stat_file, prec);
+	if (no_share_data) {
+		snprintf(proc_statm_file, sizeof(proc_statm_file), "%sm",
+			 proc_stat_file);
+		_read_proc_file(&fds->statm_fd, proc_statm_file,
+				_get_process_memory_line, prec, &opened);
+	}
 
 	/* Use PSS instead if RSS */
 	if (use_pss) {
-		if (_get_pss(proc_smaps_file, prec) == -1) {
-			xfree(prec);
-			return;
-		}
+		if (_get_pss(proc_smaps_file, prec) == -1)
+			goto bail;
 	}
 
 	list_append(prec_list, prec);
 
-	if ((io_fp = fopen(proc_io_file, "r"))) {
-		fd2 = fileno(io_fp);
-		fcntl(fd2, F_SETFD, FD_CLOEXEC);
-		_get_process_io_data_line(fd2, prec);
-		fclose(io_fp);
-	}
+	_read_proc_file(&fds->io_fd, proc_io_file, _get_process_io_data_line,
+			prec, &opened);
 	if (callbacks->prec_extra)
 		(*(callbacks->prec_extra))(prec);
+	prec = NULL;
+
+bail:
+	xfree(prec);
+done:
+	if (fds == &tmp_fds)
+		_proc_fds_close(fds);
 }
 
 static List _get_precs(List task_list, bool pgid_plugin, uint64_t cont_id,
@@ -542,16 +708,19 @@ static List _get_precs(List task_list, bool pgid_plugin, uint64_t cont_id,
 			}
 
 			debug4("no pids in this container %"PRIu64"", cont_id);
+			_proc_fds_purge(true);
 			goto finished;
 		}
+		proc_fds_poll++;
 		for (i = 0; i < npids; i++) {
 			snprintf(proc_stat_file, 256, "/proc/%d/stat", pids[i]);
 			snprintf(proc_io_file, 256, "/proc/%d/io", pids[i]);
 			snprintf(proc_smaps_file, 256, "/proc/%d/smaps", pids[i]);
-			_handle_stats(prec_list, proc_stat_file, proc_io_file,
-				      proc_smaps_file, callbacks);
+			_handle_stats(prec_list, pids[i], true, proc_stat_file,
+				      proc_io_file, proc_smaps_file, callbacks);
 		}
 		xfree(pids);
+		_proc_fds_purge(false);
 	} else {
 		struct dirent *slash_proc_entry;
 		char  *iptr = NULL, *optr = NULL, *optr2 = NULL;
@@ -637,8 +806,9 @@ static List _get_precs(List task_list, bool pgid_plugin, uint64_t cont_id,
 			} while (*iptr);
 			*optr2 = 0;
 
-			_handle_stats(prec_list, proc_stat_file, proc_io_file,
-				      proc_smaps_file,callbacks);
+			_handle_stats(prec_list, atoi(slash_proc_entry->d_name),
+				      false, proc_stat_file, proc_io_file,
+				      proc_smaps_file, callbacks);
 		}
 	}
 
@@ -741,6 +911,7 @@ static void _record_profile(struct jobacctinfo *jobacct)
 
 extern void jag_common_init(long in_hertz)
 {
+	struct rlimit rlim;
 	uint32_t profile_opt;
 
 	debug_flags = slurm_get_debug_flags();
@@ -766,12 +937,17 @@ extern void jag_common_init(long in_hertz)
 	}
 
 	my_pagesize = getpagesize() / 1024;
+
+	/* Leave most descriptors to the rest of slurmstepd */
+	if (getrlimit(RLIMIT_NOFILE, &rlim) == 0)
+		proc_fds_max = MIN(rlim.rlim_cur / 8, PROC_FDS_MAX);
 }
 
 extern void jag_common_fini(void)
 {
 	if (slash_proc)
 		(void) closedir(slash_proc);
+	_proc_fds_purge(true);
 }
 
 extern void destroy_jag_prec(void *object)
@@ -802,13 +978,15 @@ extern void jag_common_poll_data(
 	List prec_list = NULL;
 	uint64_t total_job_mem = 0, total_job_vsize = 0;
 	ListIterator itr;
-	jag_prec_t *prec = NULL;
+	jag_prec_t *prec = NULL, **prec_hash = NULL;
 	struct jobacctinfo *jobacct = NULL;
 	static int processing = 0;
+	int hash_size = 0;
 	char sbuf[72];
 	int energy_counted = 0;
 	time_t ct;
 	static int no_over_memory_kill = -1;
+	DEF_TIMERS;
 
 	xassert(callbacks);
 
@@ -836,17 +1014,23 @@ extern void jag_common_poll_data(
 		callbacks->get_precs = _get_precs;
 
 	ct = time(NULL);
+	START_TIMER;
 	prec_list = (*(callbacks->get_precs))(task_list, pgid_plugin, cont_id,
 					      callbacks);
+	END_TIMER;
+	debug2("%s: collected %d process records in %s",
+	       __func__, list_count(prec_list), TIME_STR);
 
 	if (!list_count(prec_list) || !task_list || !list_count(task_list))
 		goto finished;	/* We have no business being here! */
 
+	prec_hash = _prec_tree_build(prec_list, &hash_size);
+
 	itr = list_iterator_create(task_list);
 	while ((jobacct = list_next(itr))) {
 		double cpu_calc;
 		double last_total_cputime;
-		if (!(prec = list_find_first(prec_list, _find_prec, jobacct)))
+		if (!(prec = _prec_find(prec_hash, hash_size, jobacct->pid)))
 			continue;
 
 #if _DEBUG
@@ -855,8 +1039,7 @@ extern void jag_common_poll_data(
 #endif
 		/* find all my descendents */
 		if (callbacks->get_offspring_data)
-			(*(callbacks->get_offspring_data))
-				(prec_list, prec, prec->pid);
+			(*(callbacks->get_offspring_data))(prec);
 
 		last_total_cputime = jobacct->tot_cpu;
 
@@ -942,6 +1125,7 @@ extern void jag_common_poll_data(
 		jobacct_gather_handle_mem_limit(total_job_mem, total_job_vsize);
 
 finished:
+	xfree(prec_hash);
 	FREE_NULL_LIST(prec_list);
 	processing = 0;
 }
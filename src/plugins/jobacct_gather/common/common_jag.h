@@ -45,15 +45,20 @@
 
 typedef struct jag_prec {	/* process record */
 	int	act_cpufreq;	/* actual average cpu frequency */
+	struct jag_prec *child;	/* first child process, see sibling */
 	double	disk_read;	/* local disk read */
 	double	disk_write;	/* local disk write */
+	struct jag_prec *hash_next; /* next record in pid hash bucket */
 	int	last_cpu;	/* last cpu */
 	int     pages;  /* pages */
 	pid_t	pid;
 	pid_t	ppid;
 	uint64_t rss;	/* rss */
+	struct jag_prec *sibling; /* next child of the parent process */
 	int     ssec;   /* system cpu time */
+	uint64_t start_time; /* clock ticks after boot the process started */
 	int     usec;   /* user cpu time */
+	bool	visited;	/* already added to an ancestor's usage */
 	uint64_t vsize;	/* virtual size */
 } jag_prec_t;
 
@@ -61,8 +66,9 @@ typedef struct jag_callbacks {
 	void (*prec_extra) (jag_prec_t *prec);
 	List (*get_precs) (List task_list, bool pgid_plugin, uint64_t cont_id,
 			   struct jag_callbacks *callbacks);
-	void (*get_offspring_data) (List prec_list,
-				    jag_prec_t *ancestor, pid_t pid);
+	/* Add the usage of all descendants of ancestor, found through the
+	 * child and sibling links, to ancestor */
+	void (*get_offspring_data) (jag_prec_t *ancestor);
 } jag_callbacks_t;
 
 extern void jag_common_init(long in_hertz);
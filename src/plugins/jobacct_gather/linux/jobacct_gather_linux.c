@@ -83,50 +83,52 @@ const char plugin_type[] = "jobacct_gather/linux";
 const uint32_t plugin_version = SLURM_VERSION_NUMBER;
 
 /*
- * _get_offspring_data() -- collect memory usage data for the offspring
+ * _add_offspring_data() -- add the usage data of the children of <parent>
  *
- * For each process that lists <pid> as its parent, add its memory
- * usage data to the ancestor's <prec> record. Recurse to gather data
- * for *all* subsequent generations.
+ * For each child process of <parent>, add its usage data to the
+ * ancestor's <prec> record. Recurse to gather data for *all* subsequent
+ * generations.
  *
- * IN:	prec_list       list of prec's
- *      ancestor	The entry in precTable[] to which the data
- * 			should be added. Even as we recurse, this will
- * 			always be the prec for the base of the family
- * 			tree.
- * 	pid		The process for which we are currently looking
- * 			for offspring.
- *
- * OUT:	none.
- *
- * RETVAL:	none.
+ * IN:	ancestor	The prec to which the data should be added. Even as
+ * 			we recurse, this will always be the prec for the
+ * 			base of the family tree.
+ * 	parent		The process whose offspring we are adding.
  *
  * THREADSAFE! Only one thread ever gets here.
  */
-static void _get_offspring_data(List prec_list, jag_prec_t *ancestor, pid_t pid)
+static void _add_offspring_data(jag_prec_t *ancestor, jag_prec_t *parent)
 {
-	ListIterator itr;
-	jag_prec_t *prec = NULL;
+	jag_prec_t *prec;
 
-	itr = list_iterator_create(prec_list);
-	while((prec = list_next(itr))) {
-		if (prec->ppid == pid) {
+	for (prec = parent->child; prec; prec = prec->sibling) {
+		if (prec->visited)	/* pid reuse made a loop */
+			continue;
+		prec->visited = true;
 #if _DEBUG
-			info("pid:%u ppid:%u rss:%d KB",
-			     prec->pid, prec->ppid, prec->rss);
+		info("pid:%u ppid:%u rss:%d KB",
+		     prec->pid, prec->ppid, prec->rss);
 #endif
-			_get_offspring_data(prec_list, ancestor, prec->pid);
-			ancestor->usec += prec->usec;
-			ancestor->ssec += prec->ssec;
-			ancestor->pages += prec->pages;
-			ancestor->rss += prec->rss;
-			ancestor->vsize += prec->vsize;
-			ancestor->disk_read += prec->disk_read;
-			ancestor->disk_write += prec->disk_write;
-		}
+		_add_offspring_data(ancestor, prec);
+		ancestor->usec += prec->usec;
+		ancestor->ssec += prec->ssec;
+		ancestor->pages += prec->pages;
+		ancestor->rss += prec->rss;
+		ancestor->vsize += prec->vsize;
+		ancestor->disk_read += prec->disk_read;
+		ancestor->disk_write += prec->disk_write;
 	}
-	list_iterator_destroy(itr);
-	return;
+}
+
+/*
+ * _get_offspring_data() -- collect usage data for the offspring of a task
+ *
+ * IN:	ancestor	The prec of the task, linked to the precs of its
+ * 			children by jag_common_poll_data().
+ */
+static void _get_offspring_data(jag_prec_t *ancestor)
+{
+	ancestor->visited = true;
+	_add_offspring_data(ancestor, ancestor);
 }
 
 static bool _run_in_daemon(void)
@@ -0,0 +1,467 @@
+/*****************************************************************************\
+ *  aggregate.c - job aggregations for sacct from export files
+ *****************************************************************************
+ *  Copyright (C) 2016 SchedMD LLC.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <dirent.h>
+
+#include "sacct.h"
+#include "src/common/slurm_time.h"
+#include "src/common/slurmdb_export.h"
+#include "src/common/xhash.h"
+
+#define EXPORT_CPU_COL EXPORT_TRES_ALLOC "cpu"
+
+typedef struct {
+	uint64_t cpu_time;
+	uint64_t elapsed;
+	char *group;
+	uint32_t jobs;
+} agg_rec_t;
+
+enum {
+	AGG_GROUP,
+	AGG_JOBS,
+	AGG_ELAPSED,
+	AGG_CPU_TIME,
+	AGG_CPU_TIME_RAW
+};
+
+static print_field_t agg_fields[] = {
+	{-12, NULL, print_fields_str, AGG_GROUP},
+	{8,  "Jobs", print_fields_uint, AGG_JOBS},
+	{12, "Elapsed", print_fields_time_from_secs, AGG_ELAPSED},
+	{12, "CPUTime", print_fields_time_from_secs, AGG_CPU_TIME},
+	{12, "CPUTimeRAW", print_fields_uint64, AGG_CPU_TIME_RAW},
+	{0,  NULL, NULL, 0}};
+
+/* Values of --aggregate, with the export column each one groups by */
+static struct {
+	char *name;
+	char *header;
+	char *col;
+} agg_types[] = {
+	{ "account", "Account", "account" },
+	{ "cluster", "Cluster", NULL },
+	{ "partition", "Partition", "partition" },
+	{ "state", "State", "state" },
+	{ "user", "User", "user" },
+	{ "wckey", "WCKey", "wckey" },
+	{ NULL, NULL, NULL }
+};
+
+/* One row of the jobs export, only the columns read are set */
+typedef struct {
+	char *account;
+	uint64_t cpus;
+	uint64_t end;
+	char *partition;
+	uint64_t start;
+	uint32_t state;
+	uint64_t suspended;
+	uint32_t uid;
+	char *user;
+	char *wckey;
+} agg_row_t;
+
+static const char *_agg_rec_id(void *item)
+{
+	return ((agg_rec_t *)item)->group;
+}
+
+static void _destroy_agg_rec(void *object)
+{
+	agg_rec_t *rec = (agg_rec_t *)object;
+
+	if (rec) {
+		xfree(rec->group);
+		xfree(rec);
+	}
+}
+
+static void _append_agg_rec(void *item, void *arg)
+{
+	list_append((List)arg, item);
+}
+
+static int _sort_agg_rec(void *v1, void *v2)
+{
+	agg_rec_t *rec_a = *(agg_rec_t **)v1;
+	agg_rec_t *rec_b = *(agg_rec_t **)v2;
+
+	return xstrcmp(rec_a->group, rec_b->group);
+}
+
+static int _find_str(void *x, void *key)
+{
+	if (!xstrcmp((char *)x, (char *)key))
+		return 1;
+	return 0;
+}
+
+static int _find_num(void *x, void *key)
+{
+	if (slurm_atoul((char *)x) == *(uint32_t *)key)
+		return 1;
+	return 0;
+}
+
+static bool _filtered(List filter, char *str)
+{
+	if (!filter || !list_count(filter))
+		return false;
+	return !list_find_first(filter, _find_str, str ? str : "");
+}
+
+static bool _filtered_num(List filter, uint32_t num)
+{
+	if (!filter || !list_count(filter))
+		return false;
+	return !list_find_first(filter, _find_num, &num);
+}
+
+static void _unpack_str(slurmdb_export_col_t *col, char **str)
+{
+	uint32_t len;
+
+	if (col && (unpackstr_ptr(str, &len, col->buffer) == SLURM_SUCCESS)
+	    && len)
+		return;
+	*str = NULL;
+}
+
+static void _unpack_64(slurmdb_export_col_t *col, uint64_t *val)
+{
+	if (!col || (unpack64(val, col->buffer) != SLURM_SUCCESS))
+		*val = 0;
+}
+
+static void _unpack_32(slurmdb_export_col_t *col, uint32_t *val)
+{
+	if (!col || (unpack32(val, col->buffer) != SLURM_SUCCESS))
+		*val = 0;
+}
+
+/* Add the jobs of one export file to the aggregation */
+static void _aggregate_file(char *file, List col_names, int type,
+			    xhash_t *agg_hash)
+{
+	slurmdb_job_cond_t *job_cond = params.job_cond;
+	slurmdb_export_t *table;
+	slurmdb_export_col_t *account, *cpus, *end, *partition, *start;
+	slurmdb_export_col_t *state, *suspended, *uid, *user, *wckey;
+	agg_row_t row;
+	agg_rec_t *rec;
+	char *group;
+	uint64_t elapsed;
+	uint32_t i;
+
+	if (!(table = slurmdb_export_read(file, col_names))) {
+		error("Unable to read export file %s", file);
+		return;
+	}
+	debug("Aggregating %u jobs from %s", table->rows, file);
+
+	account = slurmdb_export_find_col(table, "account");
+	cpus = slurmdb_export_find_col(table, EXPORT_CPU_COL);
+	end = slurmdb_export_find_col(table, "end");
+	partition = slurmdb_export_find_col(table, "partition");
+	start = slurmdb_export_find_col(table, "start");
+	state = slurmdb_export_find_col(table, "state");
+	suspended = slurmdb_export_find_col(table, "suspended");
+	uid = slurmdb_export_find_col(table, "uid");
+	user = slurmdb_export_find_col(table, "user");
+	wckey = slurmdb_export_find_col(table, "wckey");
+
+	for (i = 0; i < table->rows; i++) {
+		_unpack_str(account, &row.account);
+		_unpack_64(cpus, &row.cpus);
+		_unpack_64(end, &row.end);
+		_unpack_str(partition, &row.partition);
+		_unpack_64(start, &row.start);
+		_unpack_32(state, &row.state);
+		_unpack_64(suspended, &row.suspended);
+		_unpack_32(uid, &row.uid);
+		_unpack_str(user, &row.user);
+		_unpack_str(wckey, &row.wckey);
+
+		if ((row.end < job_cond->usage_start) ||
+		    (job_cond->usage_end && (row.end >= job_cond->usage_end)))
+			continue;
+		if (_filtered(job_cond->acct_list, row.account) ||
+		    _filtered(job_cond->partition_list, row.partition) ||
+		    _filtered(job_cond->wckey_list, row.wckey) ||
+		    _filtered_num(job_cond->userid_list, row.uid) ||
+		    _filtered_num(job_cond->state_list,
+				  row.state & JOB_STATE_BASE))
+			continue;
+
+		if (!xstrcmp(agg_types[type].name, "account"))
+			group = row.account;
+		else if (!xstrcmp(agg_types[type].name, "cluster"))
+			group = table->cluster;
+		else if (!xstrcmp(agg_types[type].name, "partition"))
+			group = row.partition;
+		else if (!xstrcmp(agg_types[type].name, "state"))
+			group = job_state_string(row.state);
+		else if (!xstrcmp(agg_types[type].name, "user"))
+			group = row.user;
+		else
+			group = row.wckey;
+		if (!group)
+			group = "";
+
+		if (!(rec = xhash_get(agg_hash, group))) {
+			rec = xmalloc(sizeof(agg_rec_t));
+			rec->group = xstrdup(group);
+			xhash_add(agg_hash, rec);
+		}
+
+		elapsed = 0;
+		if (row.start && (row.end > row.start + row.suspended))
+			elapsed = row.end - row.start - row.suspended;
+		rec->jobs++;
+		rec->elapsed += elapsed;
+		rec->cpu_time += elapsed * row.cpus;
+	}
+
+	slurmdb_export_destroy(table);
+}
+
+/* Aggregate the export files of a cluster for the months asked for */
+static void _aggregate_cluster(char *dir, char *cluster, List col_names,
+			       int type, xhash_t *agg_hash)
+{
+	slurmdb_job_cond_t *job_cond = params.job_cond;
+	char *cluster_dir, *file;
+	struct dirent *ent;
+	struct tm month_tm;
+	time_t month_start, month_end;
+	int year, month, len;
+	DIR *dp;
+
+	cluster_dir = xstrdup_printf("%s/%s", dir, cluster);
+	if (!(dp = opendir(cluster_dir))) {
+		debug("No export of cluster %s in %s: %m", cluster, dir);
+		xfree(cluster_dir);
+		return;
+	}
+
+	while ((ent = readdir(dp))) {
+		len = 0;
+		if ((sscanf(ent->d_name, EXPORT_TABLE_JOB "_%4d-%2d%n",
+			    &year, &month, &len) != 2) ||
+		    (len != strlen(ent->d_name)))
+			continue;
+
+		memset(&month_tm, 0, sizeof(struct tm));
+		month_tm.tm_year = year - 1900;
+		month_tm.tm_mon = month - 1;
+		month_tm.tm_mday = 1;
+		month_tm.tm_isdst = -1;
+		month_start = slurm_mktime(&month_tm);
+		month_tm.tm_mon++;
+		month_tm.tm_isdst = -1;
+		month_end = slurm_mktime(&month_tm);
+
+		/* Skip the months that can't hold a job asked for */
+		if ((month_end <= job_cond->usage_start) ||
+		    (job_cond->usage_end &&
+		     (month_start >= job_cond->usage_end)))
+			continue;
+
+		file = xstrdup_printf("%s/%s", cluster_dir, ent->d_name);
+		_aggregate_file(file, col_names, type, agg_hash);
+		xfree(file);
+	}
+	closedir(dp);
+	xfree(cluster_dir);
+}
+
+/* Get the ExportDir of the slurmdbd, the export needs to be shared */
+static char *_get_export_dir(void)
+{
+	List config_list;
+	ListIterator itr;
+	config_key_pair_t *key_pair;
+	char *dir = NULL;
+
+	if (!acct_db_conn)
+		return NULL;
+	if (!(config_list = slurmdb_config_get(acct_db_conn)))
+		return NULL;
+
+	itr = list_iterator_create(config_list);
+	while ((key_pair = list_next(itr))) {
+		if (!xstrcasecmp(key_pair->name, "ExportDir")) {
+			dir = xstrdup(key_pair->value);
+			break;
+		}
+	}
+	list_iterator_destroy(itr);
+	FREE_NULL_LIST(config_list);
+
+	return dir;
+}
+
+static void _print_agg_rec(agg_rec_t *rec, List agg_fields_list)
+{
+	ListIterator itr;
+	print_field_t *field;
+	int curr_inx = 1, field_cnt = list_count(agg_fields_list);
+
+	itr = list_iterator_create(agg_fields_list);
+	while ((field = list_next(itr))) {
+		switch (field->type) {
+		case AGG_GROUP:
+			field->print_routine(field, rec->group,
+					     (curr_inx == field_cnt));
+			break;
+		case AGG_JOBS:
+			field->print_routine(field, rec->jobs,
+					     (curr_inx == field_cnt));
+			break;
+		case AGG_ELAPSED:
+			field->print_routine(field, rec->elapsed,
+					     (curr_inx == field_cnt));
+			break;
+		case AGG_CPU_TIME:
+		case AGG_CPU_TIME_RAW:
+			field->print_routine(field, rec->cpu_time,
+					     (curr_inx == field_cnt));
+			break;
+		}
+		curr_inx++;
+	}
+	list_iterator_destroy(itr);
+	printf("\n");
+}
+
+/*
+ * Answer --aggregate from the columnar export of the slurmdbd, which only
+ * holds the jobs of months already rolled up, without reading the database.
+ */
+void do_aggregate(void)
+{
+	slurmdb_job_cond_t *job_cond = params.job_cond;
+	List agg_list, agg_fields_list, col_names;
+	List cluster_list = job_cond->cluster_list, dir_list = NULL;
+	ListIterator itr;
+	xhash_t *agg_hash;
+	agg_rec_t *rec;
+	char *dir, *cluster;
+	struct dirent *ent;
+	DIR *dp;
+	int type, i;
+
+	for (type = 0; agg_types[type].name; type++) {
+		if (!xstrcasecmp(agg_types[type].name, params.opt_aggregate))
+			break;
+	}
+	if (!agg_types[type].name) {
+		error("Invalid aggregation \"%s\", valid ones are account, "
+		      "cluster, partition, state, user and wckey",
+		      params.opt_aggregate);
+		exit(1);
+	}
+
+	if (params.opt_export_dir)
+		dir = xstrdup(params.opt_export_dir);
+	else if (!(dir = _get_export_dir())) {
+		error("No ExportDir is set in slurmdbd.conf, "
+		      "use --exportdir to give one");
+		exit(1);
+	}
+
+	/* Only read the columns used */
+	col_names = list_create(NULL);
+	list_append(col_names, EXPORT_CPU_COL);
+	list_append(col_names, "end");
+	list_append(col_names, "start");
+	list_append(col_names, "suspended");
+	if (agg_types[type].col)
+		list_append(col_names, agg_types[type].col);
+	if (job_cond->acct_list && list_count(job_cond->acct_list))
+		list_append(col_names, "account");
+	if (job_cond->partition_list && list_count(job_cond->partition_list))
+		list_append(col_names, "partition");
+	if (job_cond->state_list && list_count(job_cond->state_list))
+		list_append(col_names, "state");
+	if (job_cond->userid_list && list_count(job_cond->userid_list))
+		list_append(col_names, "uid");
+	if (job_cond->wckey_list && list_count(job_cond->wckey_list))
+		list_append(col_names, "wckey");
+
+	/* All clusters, each has its own directory */
+	if (!cluster_list || !list_count(cluster_list)) {
+		if (!(dp = opendir(dir))) {
+			error("Can't open export directory %s: %m", dir);
+			exit(1);
+		}
+		cluster_list = dir_list = list_create(slurm_destroy_char);
+		while ((ent = readdir(dp))) {
+			if (ent->d_name[0] != '.')
+				list_append(dir_list, xstrdup(ent->d_name));
+		}
+		closedir(dp);
+	}
+
+	agg_hash = xhash_init(_agg_rec_id, _destroy_agg_rec, NULL, 0);
+	itr = list_iterator_create(cluster_list);
+	while ((cluster = list_next(itr)))
+		_aggregate_cluster(dir, cluster, col_names, type, agg_hash);
+	list_iterator_destroy(itr);
+
+	/* The hash frees the records, the list sorts them */
+	agg_list = list_create(NULL);
+	xhash_walk(agg_hash, _append_agg_rec, agg_list);
+	list_sort(agg_list, _sort_agg_rec);
+
+	agg_fields[AGG_GROUP].name = agg_types[type].header;
+	agg_fields_list = list_create(NULL);
+	for (i = 0; agg_fields[i].name; i++)
+		list_append(agg_fields_list, &agg_fields[i]);
+	print_fields_header(agg_fields_list);
+
+	itr = list_iterator_create(agg_list);
+	while ((rec = list_next(itr)))
+		_print_agg_rec(rec, agg_fields_list);
+	list_iterator_destroy(itr);
+
+	FREE_NULL_LIST(agg_fields_list);
+	FREE_NULL_LIST(agg_list);
+	xhash_free_ptr(&agg_hash);
+	FREE_NULL_LIST(dir_list);
+	FREE_NULL_LIST(col_names);
+	xfree(dir);
+}
@@ -51,6 +51,8 @@
 #define OPT_LONG_DELIMITER 0x101
 #define OPT_LONG_NOCONVERT 0x102
 #define OPT_LONG_UNITS     0x103
+#define OPT_LONG_AGGREGATE 0x104
+#define OPT_LONG_EXPORTDIR 0x105
 
 void _help_fields_msg(void);
 void _help_msg(void);
@@ -287,6 +289,13 @@ sacct [<OPTION>]                                                            \n \
      -A, --accounts:                                                        \n\
 	           Use this comma separated list of accounts to select jobs \n\
                    to display.  By default, all accounts are selected.      \n\
+     --aggregate=account|cluster|partition|state|user|wckey:                \n\
+                   Display the number of jobs, elapsed and CPU time of each \n\
+                   account, cluster, etc. instead of the jobs, read from the\n\
+                   export files of the slurmdbd's ExportDir.  Only jobs that\n\
+                   ended in a month already rolled up are counted.  The     \n\
+                   -A, -E, -M, -r, -s, -S, -u and -W options select jobs by \n\
+                   their end time and final state.                          \n\
      -b, --brief:                                                           \n\
 	           Equivalent to '--format=jobstep,state,error'.            \n\
      -c, --completion: Use job completion instead of accounting data.       \n\
@@ -307,6 +316,9 @@ sacct [<OPTION>]                                                            \n \
                    Select jobs eligible before this time.  If states are    \n\
                    given with the -s option return jobs in this state before\n\
                    this period.                                             \n\
+     --exportdir=dir:                                                       \n\
+                   With --aggregate, read the export files from this        \n\
+                   directory instead of asking the slurmdbd for its ExportDir.\n\
      -f, --file=file:                                                       \n\
 	           Read data from the specified file, rather than SLURM's   \n\
                    current accounting log file. (Only appliciable when      \n\
@@ -439,6 +451,7 @@ int get_data(void)
 		jobs = g_slurm_jobcomp_get_jobs(job_cond);
 		return SLURM_SUCCESS;
 	} else {
+		FREE_NULL_LIST(jobs);
 		jobs = slurmdb_jobs_get(acct_db_conn, job_cond);
 	}
 
@@ -483,6 +496,48 @@ int get_data(void)
 	return SLURM_SUCCESS;
 }
 
+/* next_page() -- Move the cursor past the jobs just listed
+ *
+ * In:	Nothing explicit.
+ * Out:	true if get_data() should be called for another page of jobs.
+ *
+ * The jobs of each cluster come back ordered by job id, so the page
+ * ends with the highest job id of the last cluster in the list.
+ */
+bool next_page(void)
+{
+	slurmdb_job_cond_t *job_cond = params.job_cond;
+	slurmdb_job_rec_t *job = NULL;
+	ListIterator itr = NULL;
+	char *cluster = NULL;
+	uint32_t jobid = 0;
+
+	if (!job_cond->page_size || !jobs || !list_count(jobs))
+		return false;
+
+	itr = list_iterator_create(jobs);
+	while ((job = list_next(itr))) {
+		if (xstrcmp(job->cluster, cluster)) {
+			cluster = job->cluster;
+			jobid = 0;
+		}
+		if (job->jobid > jobid)
+			jobid = job->jobid;
+	}
+	list_iterator_destroy(itr);
+
+	/* Don't loop forever if the storage ignored the cursor */
+	if ((jobid == job_cond->cursor_jobid)
+	    && !xstrcmp(cluster, job_cond->cursor_cluster))
+		return false;
+
+	xfree(job_cond->cursor_cluster);
+	job_cond->cursor_cluster = xstrdup(cluster);
+	job_cond->cursor_jobid = jobid;
+
+	return true;
+}
+
 void parse_command_line(int argc, char **argv)
 {
 	extern int optind;
@@ -502,6 +557,7 @@ void parse_command_line(int argc, char **argv)
 	bool set;
 
 	static struct option long_options[] = {
+                {"aggregate",      required_argument, 0,    OPT_LONG_AGGREGATE},
                 {"allusers",       no_argument,       0,    'a'},
                 {"accounts",       required_argument, 0,    'A'},
                 {"allocations",    no_argument,       0,    'X'},
@@ -512,6 +568,7 @@ void parse_command_line(int argc, char **argv)
                 {"helpformat",     no_argument,       0,    'e'},
                 {"help-fields",    no_argument,       0,    'e'},
                 {"endtime",        required_argument, 0,    'E'},
+                {"exportdir",      required_argument, 0,    OPT_LONG_EXPORTDIR},
                 {"file",           required_argument, 0,    'f'},
                 {"gid",            required_argument, 0,    'g'},
                 {"group",          required_argument, 0,    'g'},
@@ -565,6 +622,10 @@ void parse_command_line(int argc, char **argv)
 		case 'a':
 			all_users = 1;
 			break;
+		case OPT_LONG_AGGREGATE:
+			xfree(params.opt_aggregate);
+			params.opt_aggregate = xstrdup(optarg);
+			break;
 		case 'A':
 			if (!job_cond->acct_list)
 				job_cond->acct_list =
@@ -606,6 +667,10 @@ void parse_command_line(int argc, char **argv)
 			if (errno == ESLURM_INVALID_TIME_VALUE)
 				exit(1);
 			break;
+		case OPT_LONG_EXPORTDIR:
+			xfree(params.opt_export_dir);
+			params.opt_export_dir = xstrdup(optarg);
+			break;
 		case 'f':
 			xfree(params.opt_filein);
 			params.opt_filein = xstrdup(optarg);
@@ -812,7 +877,9 @@ void parse_command_line(int argc, char **argv)
 	job_cond->duplicates = params.opt_dup;
 	job_cond->without_steps = params.opt_allocs;
 
-	if (!job_cond->usage_start && !job_cond->step_list) {
+	/* Aggregations cover every exported month unless told otherwise */
+	if (!job_cond->usage_start && !job_cond->step_list &&
+	    !params.opt_aggregate) {
 		struct tm start_tm;
 		job_cond->usage_start = time(NULL);
 		/* If we are looking for job states default to now.
@@ -867,6 +934,8 @@ void parse_command_line(int argc, char **argv)
 			exit(1);
 		}
 		xfree(acct_type);
+	} else if (params.opt_aggregate && params.opt_export_dir) {
+		/* Answered from the export files alone */
 	} else {
 		slurm_acct_storage_init(params.opt_filein);
 
@@ -877,6 +946,9 @@ void parse_command_line(int argc, char **argv)
 				"SLURM accounting storage is disabled\n");
 			exit(1);
 		}
+		/* Only the slurmdbd can send the jobs a page at a time */
+		if (!xstrcmp(acct_type, "accounting_storage/slurmdbd"))
+			job_cond->page_size = SACCT_PAGE_SIZE;
 		xfree(acct_type);
 		acct_db_conn = slurmdb_connection_get();
 		if (errno != SLURM_SUCCESS) {
@@ -1213,10 +1285,12 @@ void sacct_fini()
 
 	if (params.opt_completion)
 		g_slurm_jobcomp_fini();
-	else {
+	else if (acct_db_conn) {
 		slurmdb_connection_close(&acct_db_conn);
 		slurm_acct_storage_fini();
 	}
+	xfree(params.opt_aggregate);
+	xfree(params.opt_export_dir);
 	xfree(params.opt_field_list);
 	xfree(params.opt_filein);
 	slurmdb_destroy_job_cond(params.job_cond);
@@ -135,6 +135,7 @@ List jobs = NULL;
 int main(int argc, char **argv)
 {
 	enum {
+		SACCT_AGGREGATE,
 		SACCT_LIST,
 		SACCT_HELP,
 		SACCT_USAGE
@@ -151,19 +152,31 @@ int main(int argc, char **argv)
 
 	if (params.opt_help)
 		op = SACCT_HELP;
+	else if (params.opt_aggregate)
+		op = SACCT_AGGREGATE;
 	else
 		op = SACCT_LIST;
 
 
 	switch (op) {
+	case SACCT_AGGREGATE:
+		do_aggregate();
+		break;
 	case SACCT_LIST:
 		print_fields_header(print_fields_list);
-		if (get_data() == SLURM_ERROR)
-			exit(errno);
-		if (params.opt_completion)
+		if (params.opt_completion) {
+			if (get_data() == SLURM_ERROR)
+				exit(errno);
 			do_list_completion();
-		else
+			break;
+		}
+		/* Print each page of jobs as it arrives rather than
+		 * holding every job in memory at once */
+		do {
+			if (get_data() == SLURM_ERROR)
+				exit(errno);
 			do_list();
+		} while (next_page());
 		break;
 	case SACCT_HELP:
 		do_help();
@@ -72,6 +72,7 @@
 #define LONG_COMP_FIELDS "jobid,uid,jobname,partition,nnodes,nodelist,state,start,end,timelimit"
 
 #define MAX_PRINTFIELDS 100
+#define SACCT_PAGE_SIZE 10000	/* jobs to get from the slurmdbd at once */
 #define FORMAT_STRING_SIZE 34
 
 #define SECONDS_IN_MINUTE 60
@@ -174,8 +175,10 @@ typedef enum {
 typedef struct {
 	uint32_t convert_flags;	/* --noconvert */
 	slurmdb_job_cond_t *job_cond;
+	char *opt_aggregate;	/* --aggregate= */
 	int opt_completion;	/* --completion */
 	int opt_dup;		/* --duplicates; +1 = explicitly set */
+	char *opt_export_dir;	/* --exportdir= */
 	char *opt_field_list;	/* --fields= */
 	int opt_gid;		/* running persons gid */
 	int opt_help;		/* --help */
@@ -190,12 +193,16 @@ extern print_field_t fields[];
 extern sacct_parameters_t params;
 
 extern List jobs;
+extern void *acct_db_conn;
 extern List print_fields_list;
 extern ListIterator print_fields_itr;
 extern int field_count;
 extern List g_qos_list;
 extern List g_tres_list;
 
+/* aggregate.c */
+void do_aggregate(void);
+
 /* process.c */
 char *find_hostname(uint32_t pos, char *hosts);
 void aggregate_stats(slurmdb_stats_t *dest, slurmdb_stats_t *from);
@@ -205,6 +212,7 @@ void print_fields(type_t type, void *object);
 
 /* options.c */
 int get_data(void);
+bool next_page(void);
 void parse_command_line(int argc, char **argv);
 void do_help(void);
 void do_list(void);
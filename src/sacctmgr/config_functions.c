@@ -147,6 +147,34 @@ static void _print_slurm_config(void)
 	printf("TrackWCKey             = %u\n", track_wckey);
 }
 
+extern int sacctmgr_list_stats(void)
+{
+	ListIterator iter = NULL;
+	config_key_pair_t *key_pair;
+	List stats_list;
+	time_t now = time(NULL);
+	char tmp_str[128];
+
+	if (!(stats_list = acct_storage_g_get_config(db_conn,
+						     "slurmdbd.stats"))) {
+		exit_code = 1;
+		fprintf(stderr, " Problem getting statistics from the "
+			"database.  Contact your admin.\n");
+		return SLURM_ERROR;
+	}
+
+	slurm_make_time_str(&now, tmp_str, sizeof(tmp_str));
+	printf("SlurmDBD statistics as of %s\n", tmp_str);
+	iter = list_iterator_create(stats_list);
+	while ((key_pair = list_next(iter))) {
+		printf("%-22s = %s\n", key_pair->name, key_pair->value);
+	}
+	list_iterator_destroy(iter);
+	FREE_NULL_LIST(stats_list);
+
+	return SLURM_SUCCESS;
+}
+
 extern int sacctmgr_list_config(bool have_db_conn)
 {
 	_load_slurm_config();
@@ -662,6 +662,8 @@ static void _show_it (int argc, char *argv[])
 	} else if (!strncasecmp(argv[0], "Reservations", MAX(command_len, 4)) ||
 		   !strncasecmp(argv[0], "Resv", MAX(command_len, 4))) {
 		error_code = sacctmgr_list_reservation((argc - 1), &argv[1]);
+	} else if (!strncasecmp(argv[0], "Stats", MAX(command_len, 1))) {
+		error_code = sacctmgr_list_stats();
 	} else if (!strncasecmp(argv[0], "Transactions", MAX(command_len, 1))
 		   || !strncasecmp(argv[0], "Txn", MAX(command_len, 1))) {
 		error_code = sacctmgr_list_txn((argc - 1), &argv[1]);
@@ -679,8 +681,8 @@ static void _show_it (int argc, char *argv[])
 		fprintf(stderr, "\"Account\", \"Association\", "
 			"\"Cluster\", \"Configuration\",\n\"Event\", "
 			"\"Problem\", \"QOS\", \"Resource\", \"Reservation\", "
-			"\"RunAwayJobs\", \"Transaction\", \"TRES\", "
-			"\"User\", or \"WCKey\"\n");
+			"\"RunAwayJobs\", \"Stats\", \"Transaction\", "
+			"\"TRES\", \"User\", or \"WCKey\"\n");
 	}
 
 	if (error_code != SLURM_SUCCESS) {
@@ -858,7 +860,7 @@ sacctmgr [<OPTION>] [<COMMAND>]                                            \n\
   <ENTITY> may be \"account\", \"association\", \"cluster\",               \n\
                   \"configuration\", \"coordinator\", \"event\", \"job\",  \n\
                   \"problem\", \"qos\", \"resource\", \"reservation\",     \n\
-                  \"runawayjobs\", \"transaction\", \"tres\",              \n\
+                  \"runawayjobs\", \"stats\", \"transaction\", \"tres\",   \n\
                   \"user\" or \"wckey\"                                    \n\
                                                                            \n\
   <SPECS> are different for each command entity pair.                      \n\
@@ -62,6 +62,8 @@
 
 #define OPT_LONG_HELP   0x100
 #define OPT_LONG_USAGE  0x101
+#define OPT_LONG_PIPELINE 0x102
+#define OPT_LONG_CACHE  0x103
 
 /* getopt_long options, integers but not characters */
 
@@ -80,10 +82,12 @@ extern void parse_command_line(int argc, char *argv[])
 	int opt_char;
 	int option_index;
 	static struct option long_options[] = {
+		{"cache",     no_argument,       0, OPT_LONG_CACHE},
 		{"compress",  optional_argument, 0, 'C'},
 		{"fanout",    required_argument, 0, 'F'},
 		{"force",     no_argument,       0, 'f'},
 		{"jobid",     required_argument, 0, 'j'},
+		{"pipeline",  required_argument, 0, OPT_LONG_PIPELINE},
 		{"preserve",  no_argument,       0, 'p'},
 		{"size",      required_argument, 0, 's'},
 		{"timeout",   required_argument, 0, 't'},
@@ -94,6 +98,8 @@ extern void parse_command_line(int argc, char *argv[])
 		{NULL,        0,                 0, 0}
 	};
 
+	if (getenv("SBCAST_CACHE"))
+		params.cache = true;
 	if (getenv("SBCAST_COMPRESS"))
 		params.compress = parse_compress_type(env_val);
 	if ( ( env_val = getenv("SBCAST_FANOUT") ) )
@@ -104,6 +110,8 @@ extern void parse_command_line(int argc, char *argv[])
 	params.job_id  = NO_VAL;
 	params.step_id = NO_VAL;
 
+	if ( ( env_val = getenv("SBCAST_PIPELINE") ) )
+		params.pipeline = atoi(env_val);
 	if (getenv("SBCAST_PRESERVE"))
 		params.preserve = true;
 	if ( ( env_val = getenv("SBCAST_SIZE") ) )
@@ -122,6 +130,9 @@ extern void parse_command_line(int argc, char *argv[])
 				"Try \"sbcast --help\" for more information\n");
 			exit(1);
 			break;
+		case (int) OPT_LONG_CACHE:
+			params.cache = true;
+			break;
 		case (int)'C':
 			params.compress = parse_compress_type(optarg);
 			break;
@@ -139,6 +150,9 @@ extern void parse_command_line(int argc, char *argv[])
 		case (int)'p':
 			params.preserve = true;
 			break;
+		case (int) OPT_LONG_PIPELINE:
+			params.pipeline = atoi(optarg);
+			break;
 		case (int) 's':
 			params.block_size = _map_size(optarg);
 			break;
@@ -220,6 +234,7 @@ static void _print_options( void )
 {
 	info("-----------------------------");
 	info("block_size = %u", params.block_size);
+	info("cache      = %s", params.cache ? "true" : "false");
 	info("compress   = %u", params.compress);
 	info("force      = %s", params.force ? "true" : "false");
 	info("fanout     = %d", params.fanout);
@@ -227,6 +242,7 @@ static void _print_options( void )
 		info("jobid      = %u", params.job_id);
 	else
 		info("jobid      = %u.%u", params.job_id, params.step_id);
+	info("pipeline   = %d", params.pipeline);
 	info("preserve   = %s", params.preserve ? "true" : "false");
 	info("timeout    = %d", params.timeout);
 	info("verbose    = %d", params.verbose);
@@ -245,11 +261,13 @@ static void _help( void )
 {
 	printf ("\
 Usage: sbcast [OPTIONS] SOURCE DEST\n\
+      --cache          install from the cache on the nodes when possible\n\
   -C, --compress[=lib] compress the file being transmitted\n\
   -f, --force          replace destination file as required\n\
   -F, --fanout=num     specify message fanout\n\
   -j, --jobid=#[.#]    specify job ID and optional step ID, unneeded if run\n\
                        inside allocation\n\
+      --pipeline=num   number of blocks to have in flight at one time\n\
   -p, --preserve       preserve modes and times of source file\n\
   -s, --size=num       block size in bytes (rounded off)\n\
   -t, --timeout=secs   specify message timeout (seconds)\n\
@@ -102,12 +102,26 @@
 #define BUILD_TIMEOUT 2000000	/* Max build_job_queue() run time in usec */
 #define MAX_FAILED_RESV 10
 #define MAX_RETRIES 10
+#define MAX_SCRIPT_RUN 128	/* PrologSlurmctld/EpilogSlurmctld run at once */
+#define SCRIPT_MAX_DELAY 200	/* max msec between checks for script exit */
 
-typedef struct epilog_arg {
-	char *epilog_slurmctld;
+/* A PrologSlurmctld or EpilogSlurmctld run by _script_agent() */
+typedef struct script_run {
+	pid_t cpid;
+	time_t end_time;	/* kill at this time, 0 if no timeout */
 	uint32_t job_id;
+	bool killed;
 	char **my_env;
-} epilog_arg_t;
+	bitstr_t *node_bitmap;	/* prolog: nodes allowed time to boot */
+	bool prolog;
+	char *script;
+	int status;
+} script_run_t;
+
+static pthread_cond_t  script_cond  = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t script_mutex = PTHREAD_MUTEX_INITIALIZER;
+static List            script_queue = NULL;
+static bool            script_agent_running = false;
 
 static char **	_build_env(struct job_record *job_ptr);
 static void	_depend_list_del(void *dep_ptr);
@@ -119,9 +133,10 @@ static bool	_job_runnable_test1(struct job_record *job_ptr,
 				    bool clear_start);
 static bool	_job_runnable_test2(struct job_record *job_ptr,
 				    bool check_min_time);
-static void *	_run_epilog(void *arg);
-static void *	_run_prolog(void *arg);
 static bool	_scan_depend(List dependency_list, uint32_t job_id);
+static void *	_script_agent(void *args);
+static int	_script_queue(struct job_record *job_ptr, char *script,
+			      bool prolog, bitstr_t *node_bitmap);
 static void *	_sched_agent(void *args);
 static int	_schedule(uint32_t job_limit);
 static int	_valid_feature_list(struct job_record *job_ptr,
@@ -3318,9 +3333,6 @@ extern int job_start_data(job_desc_msg_t *job_desc_msg,
 extern int epilog_slurmctld(struct job_record *job_ptr)
 {
 	int rc;
-	pthread_t thread_id_epilog;
-	pthread_attr_t thread_attr_epilog;
-	epilog_arg_t *epilog_arg;
 
 	if ((slurmctld_conf.epilog_slurmctld == NULL) ||
 	    (slurmctld_conf.epilog_slurmctld[0] == '\0'))
@@ -3331,30 +3343,78 @@ extern int epilog_slurmctld(struct job_record *job_ptr)
 		return errno;
 	}
 
-	epilog_arg = xmalloc(sizeof(epilog_arg_t));
-	epilog_arg->job_id = job_ptr->job_id;
-	epilog_arg->epilog_slurmctld = xstrdup(slurmctld_conf.epilog_slurmctld);
-	epilog_arg->my_env = _build_env(job_ptr);
-
-	slurm_attr_init(&thread_attr_epilog);
-	pthread_attr_setdetachstate(&thread_attr_epilog,
-				    PTHREAD_CREATE_DETACHED);
 	job_ptr->epilog_running = true;
-	while (1) {
-		rc = pthread_create(&thread_id_epilog,
-				    &thread_attr_epilog,
-				    _run_epilog, (void *) epilog_arg);
-		if (rc == 0) {
-			slurm_attr_destroy(&thread_attr_epilog);
-			return SLURM_SUCCESS;
-		}
-		if (errno == EAGAIN)
-			continue;
-		error("pthread_create: %m");
-		slurm_attr_destroy(&thread_attr_epilog);
+	rc = _script_queue(job_ptr, slurmctld_conf.epilog_slurmctld, false,
+			   NULL);
+	if (rc != SLURM_SUCCESS)
 		job_ptr->epilog_running = false;
-		return errno;
+	return rc;
+}
+
+/* Free a script record */
+static void _script_free(void *x)
+{
+	script_run_t *script_run = (script_run_t *) x;
+	int i;
+
+	if (!script_run)
+		return;
+	xfree(script_run->script);
+	for (i = 0; script_run->my_env[i]; i++)
+		xfree(script_run->my_env[i]);
+	xfree(script_run->my_env);
+	FREE_NULL_BITMAP(script_run->node_bitmap);
+	xfree(script_run);
+}
+
+/*
+ * Queue a PrologSlurmctld or EpilogSlurmctld to be run by _script_agent(),
+ * starting the agent if needed. Job write lock must be held.
+ */
+static int _script_queue(struct job_record *job_ptr, char *script,
+			 bool prolog, bitstr_t *node_bitmap)
+{
+	script_run_t *script_run;
+	pthread_t thread_id;
+	pthread_attr_t thread_attr;
+	int rc = SLURM_SUCCESS;
+
+	script_run = xmalloc(sizeof(script_run_t));
+	script_run->job_id = job_ptr->job_id;
+	script_run->my_env = _build_env(job_ptr);
+	script_run->node_bitmap = node_bitmap;
+	script_run->prolog = prolog;
+	script_run->script = xstrdup(script);
+
+	slurm_mutex_lock(&script_mutex);
+	if (!script_queue)
+		script_queue = list_create(_script_free);
+	if (!script_agent_running) {
+		slurm_attr_init(&thread_attr);
+		pthread_attr_setdetachstate(&thread_attr,
+					    PTHREAD_CREATE_DETACHED);
+		while (pthread_create(&thread_id, &thread_attr,
+				      _script_agent, NULL)) {
+			if (errno == EAGAIN)
+				continue;
+			error("pthread_create: %m");
+			rc = errno;
+			break;
+		}
+		slurm_attr_destroy(&thread_attr);
+		if (rc == SLURM_SUCCESS)
+			script_agent_running = true;
 	}
+	if (rc == SLURM_SUCCESS) {
+		list_enqueue(script_queue, script_run);
+		pthread_cond_broadcast(&script_cond);
+	} else {
+		script_run->node_bitmap = NULL;	/* owned by caller */
+		_script_free(script_run);
+	}
+	slurm_mutex_unlock(&script_mutex);
+
+	return rc;
 }
 
 static char **_build_env(struct job_record *job_ptr)
@@ -3466,24 +3526,20 @@ static char **_build_env(struct job_record *job_ptr)
 	return my_env;
 }
 
-static void *_run_epilog(void *arg)
+/* Start a script, RET -1 if it could not be started */
+static pid_t _script_start(script_run_t *script_run)
 {
-	/* Locks: Write job */
-	slurmctld_lock_t job_write_lock = {
-		NO_LOCK, WRITE_LOCK, NO_LOCK, NO_LOCK };
-	struct job_record *job_ptr;
-	epilog_arg_t *epilog_arg = (epilog_arg_t *) arg;
 	pid_t cpid;
-	int i, status, wait_rc;
 	char *argv[2];
-	uint16_t tm;
+	int i;
 
-	argv[0] = epilog_arg->epilog_slurmctld;
+	argv[0] = script_run->script;
 	argv[1] = NULL;
 
 	if ((cpid = fork()) < 0) {
-		error("epilog_slurmctld fork error: %m");
-		goto fini;
+		error("%s fork error: %m", script_run->prolog ?
+		      "prolog_slurmctld" : "epilog_slurmctld");
+		return -1;
 	}
 	if (cpid == 0) {
 		for (i = 0; i < 1024; i++)
@@ -3493,35 +3549,28 @@ static void *_run_epilog(void *arg)
 #else
 		setpgrp();
 #endif
-		execve(argv[0], argv, epilog_arg->my_env);
+		execve(argv[0], argv, script_run->my_env);
 		exit(127);
 	}
 
-	/* Prolog and epilog use the same timeout
-	 */
-	tm = slurm_get_prolog_timeout();
-	while (1) {
-		wait_rc = waitpid_timeout(__func__, cpid, &status, tm);
-		if (wait_rc < 0) {
-			if (errno == EINTR)
-				continue;
-			error("%s: waitpid error: %m", __func__);
-			break;
-		} else if (wait_rc > 0) {
-			break;
-		}
-	}
-	if (status != 0) {
+	return cpid;
+}
+
+/* Clean up after an EpilogSlurmctld, job write lock must be held */
+static void _epilog_complete(script_run_t *script_run)
+{
+	struct job_record *job_ptr;
+
+	if (script_run->status != 0) {
 		error("epilog_slurmctld job %u epilog exit status %u:%u",
-		      epilog_arg->job_id, WEXITSTATUS(status),
-		      WTERMSIG(status));
+		      script_run->job_id, WEXITSTATUS(script_run->status),
+		      WTERMSIG(script_run->status));
 	} else {
 		debug2("epilog_slurmctld job %u epilog completed",
-		       epilog_arg->job_id);
+		       script_run->job_id);
 	}
 
- fini:	lock_slurmctld(job_write_lock);
-	job_ptr = find_job_record(epilog_arg->job_id);
+	job_ptr = find_job_record(script_run->job_id);
 	if (job_ptr) {
 		job_ptr->epilog_running = false;
 		/* Clean up the JOB_COMPLETING flag
@@ -3532,12 +3581,157 @@ static void *_run_epilog(void *arg)
 		    && IS_JOB_COMPLETING(job_ptr))
 			cleanup_completing(job_ptr);
 	}
-	unlock_slurmctld(job_write_lock);
-	xfree(epilog_arg->epilog_slurmctld);
-	for (i=0; epilog_arg->my_env[i]; i++)
-		xfree(epilog_arg->my_env[i]);
-	xfree(epilog_arg->my_env);
-	xfree(epilog_arg);
+}
+
+/* Requeue or kill the job of a failed PrologSlurmctld and launch the job
+ * of a successful one, job and node write locks must be held */
+static void _prolog_complete(script_run_t *script_run)
+{
+	struct job_record *job_ptr;
+	uint32_t job_id = script_run->job_id;
+	bitstr_t *node_bitmap = NULL;
+	int i;
+
+	job_ptr = find_job_record(job_id);
+	if (script_run->status != 0) {
+		error("prolog_slurmctld job %u prolog exit status %u:%u",
+		      job_id, WEXITSTATUS(script_run->status),
+		      WTERMSIG(script_run->status));
+		if (job_requeue(0, job_id, -1, (uint16_t) NO_VAL, false, 0)) {
+			info("unable to requeue job %u: %m", job_id);
+			if (job_ptr) {
+				srun_user_message(job_ptr,
+					"PrologSlurmctld failed, job killed");
+			}
+			(void) job_signal(job_id, SIGKILL, 0, 0, false);
+		}
+		job_ptr = find_job_record(job_id);
+	} else
+		debug2("prolog_slurmctld job %u prolog completed", job_id);
+
+	if (job_ptr == NULL)
+		error("prolog_slurmctld job %u now defunct", job_id);
+	prolog_running_decr(job_ptr);
+	if (power_save_test()) {
+		/* Wait for node to register after booting */
+	} else if (job_ptr && job_ptr->node_bitmap) {
+		node_bitmap = job_ptr->node_bitmap;
+	} else if (script_run->node_bitmap) {
+		node_bitmap = script_run->node_bitmap;
+	}
+	if (node_bitmap) {
+		for (i = 0; i < node_record_count; i++) {
+			if (bit_test(node_bitmap, i) == 0)
+				continue;
+			bit_clear(booting_node_bitmap, i);
+			node_record_table_ptr[i].node_state &=
+				(~NODE_STATE_POWER_UP);
+		}
+	}
+}
+
+/*
+ * Run queued PrologSlurmctld and EpilogSlurmctld scripts, up to
+ * MAX_SCRIPT_RUN at once, from a single thread rather than one thread per
+ * script. Exited scripts found in one pass are processed together under one
+ * acquisition of the locks.
+ */
+static void *_script_agent(void *args)
+{
+	/* Locks: Read config; Write jobs, nodes */
+	slurmctld_lock_t job_write_lock = {
+		READ_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK };
+	List run_list = list_create(_script_free);
+	List done_list = list_create(_script_free);
+	ListIterator iter;
+	script_run_t *script_run;
+	struct timespec ts;
+	struct timeval now;
+	int delay = 10, wait_rc;
+	uint16_t tm;
+
+	while (1) {
+		slurm_mutex_lock(&script_mutex);
+		while ((list_count(run_list) < MAX_SCRIPT_RUN) &&
+		       (script_run = list_dequeue(script_queue))) {
+			slurm_mutex_unlock(&script_mutex);
+			/* Prolog and epilog use the same timeout */
+			tm = slurm_get_prolog_timeout();
+			if ((tm > 0) && (tm != (uint16_t) NO_VAL))
+				script_run->end_time = time(NULL) + tm;
+			script_run->cpid = _script_start(script_run);
+			if (script_run->cpid < 0) {
+				script_run->status = -1;
+				list_append(done_list, script_run);
+			} else
+				list_append(run_list, script_run);
+			delay = 10;
+			slurm_mutex_lock(&script_mutex);
+		}
+		if ((list_count(run_list) == 0) &&
+		    (list_count(done_list) == 0)) {
+			pthread_cond_wait(&script_cond, &script_mutex);
+			slurm_mutex_unlock(&script_mutex);
+			continue;
+		}
+		slurm_mutex_unlock(&script_mutex);
+
+		iter = list_iterator_create(run_list);
+		while ((script_run = list_next(iter))) {
+			wait_rc = waitpid(script_run->cpid,
+					  &script_run->status, WNOHANG);
+			if ((wait_rc < 0) && (errno == EINTR))
+				continue;
+			if (wait_rc < 0) {
+				error("%s: waitpid error: %m", __func__);
+				script_run->status = -1;
+			} else if (wait_rc == 0) {
+				if (script_run->end_time &&
+				    !script_run->killed &&
+				    (time(NULL) >= script_run->end_time)) {
+					info("%s: timeout after %us: killing pgid %d",
+					     script_run->prolog ?
+					     "prolog_slurmctld" :
+					     "epilog_slurmctld",
+					     slurm_get_prolog_timeout(),
+					     script_run->cpid);
+					killpg(script_run->cpid, SIGKILL);
+					script_run->killed = true;
+				}
+				continue;
+			}
+			killpg(script_run->cpid, SIGKILL); /* kill children */
+			list_remove(iter);
+			list_append(done_list, script_run);
+		}
+		list_iterator_destroy(iter);
+
+		if (list_count(done_list)) {
+			lock_slurmctld(job_write_lock);
+			while ((script_run = list_pop(done_list))) {
+				if (script_run->prolog)
+					_prolog_complete(script_run);
+				else
+					_epilog_complete(script_run);
+				_script_free(script_run);
+			}
+			unlock_slurmctld(job_write_lock);
+			delay = 10;
+			continue;
+		}
+
+		/* Wait for a script to exit or a new one to be queued */
+		gettimeofday(&now, NULL);
+		ts.tv_sec  = now.tv_sec + (now.tv_usec / 1000 + delay) / 1000;
+		ts.tv_nsec = ((now.tv_usec / 1000 + delay) % 1000) * 1000000;
+		slurm_mutex_lock(&script_mutex);
+		if (list_count(script_queue) == 0)
+			pthread_cond_timedwait(&script_cond, &script_mutex,
+					       &ts);
+		slurm_mutex_unlock(&script_mutex);
+		delay = MIN(delay * 2, SCRIPT_MAX_DELAY);
+	}
+
 	return NULL;
 }
 
@@ -3740,9 +3934,11 @@ static void *_wait_boot(void *arg)
  */
 extern int prolog_slurmctld(struct job_record *job_ptr)
 {
-	int rc;
-	pthread_t thread_id_prolog;
-	pthread_attr_t thread_attr_prolog;
+	struct node_record *node_ptr;
+	bitstr_t *node_bitmap = NULL;
+	time_t now = time(NULL);
+	uint16_t resume_timeout = slurm_get_resume_timeout();
+	int i, rc;
 
 	if ((slurmctld_conf.prolog_slurmctld == NULL) ||
 	    (slurmctld_conf.prolog_slurmctld[0] == '\0'))
@@ -3753,51 +3949,6 @@ extern int prolog_slurmctld(struct job_record *job_ptr)
 		return errno;
 	}
 
-	if (job_ptr->details)
-		job_ptr->details->prolog_running++;
-
-	job_ptr->job_state |= JOB_CONFIGURING;
-
-	slurm_attr_init(&thread_attr_prolog);
-	pthread_attr_setdetachstate(&thread_attr_prolog,
-				    PTHREAD_CREATE_DETACHED);
-	while (1) {
-		rc = pthread_create(&thread_id_prolog,
-				    &thread_attr_prolog,
-				    _run_prolog, (void *) job_ptr);
-		if (rc == 0) {
-			slurm_attr_destroy(&thread_attr_prolog);
-			return SLURM_SUCCESS;
-		}
-		if (errno == EAGAIN)
-			continue;
-		error("pthread_create: %m");
-		slurm_attr_destroy(&thread_attr_prolog);
-		return errno;
-	}
-}
-
-static void *_run_prolog(void *arg)
-{
-	struct job_record *job_ptr = (struct job_record *) arg;
-	struct node_record *node_ptr;
-	uint32_t job_id;
-	pid_t cpid;
-	int i, rc, status, wait_rc;
-	char *argv[2], **my_env;
-	/* Locks: Read config; Write jobs, nodes */
-	slurmctld_lock_t config_read_lock = {
-		READ_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK };
-	bitstr_t *node_bitmap = NULL;
-	time_t now = time(NULL);
-	uint16_t resume_timeout = slurm_get_resume_timeout();
-	uint16_t tm;
-
-	lock_slurmctld(config_read_lock);
-	argv[0] = xstrdup(slurmctld_conf.prolog_slurmctld);
-	argv[1] = NULL;
-	my_env = _build_env(job_ptr);
-	job_id = job_ptr->job_id;
 	if (job_ptr->node_bitmap) {
 		node_bitmap = bit_copy(job_ptr->node_bitmap);
 		for (i = 0, node_ptr = node_record_table_ptr;
@@ -3808,94 +3959,20 @@ static void *_run_prolog(void *arg)
 			node_ptr->last_response = now + resume_timeout;
 		}
 	}
-	unlock_slurmctld(config_read_lock);
-
-	if ((cpid = fork()) < 0) {
-		error("prolog_slurmctld fork error: %m");
-		goto fini;
-	}
-	if (cpid == 0) {
-		for (i = 0; i < 1024; i++)
-			(void) close(i);
-#ifdef SETPGRP_TWO_ARGS
-		setpgrp(0, 0);
-#else
-		setpgrp();
-#endif
-		execve(argv[0], argv, my_env);
-		exit(127);
-	}
 
-	tm = slurm_get_prolog_timeout();
-	while (1) {
-		wait_rc = waitpid_timeout(__func__, cpid, &status, tm);
-		if (wait_rc < 0) {
-			if (errno == EINTR)
-				continue;
-			error("%s: waitpid error: %m", __func__);
-			break;
-		} else if (wait_rc > 0) {
-			break;
-		}
+	rc = _script_queue(job_ptr, slurmctld_conf.prolog_slurmctld, true,
+			   node_bitmap);
+	if (rc != SLURM_SUCCESS) {
+		FREE_NULL_BITMAP(node_bitmap);
+		return rc;
 	}
 
-	if (status != 0) {
-		bool kill_job = false;
-		slurmctld_lock_t job_write_lock = {
-			NO_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK };
-		error("prolog_slurmctld job %u prolog exit status %u:%u",
-		      job_id, WEXITSTATUS(status), WTERMSIG(status));
-		lock_slurmctld(job_write_lock);
-		if ((rc = job_requeue(0, job_id, -1, (uint16_t) NO_VAL,
-				      false, 0))) {
-			info("unable to requeue job %u: %m", job_id);
-			kill_job = true;
-		}
-		if (kill_job) {
-			srun_user_message(job_ptr,
-					  "PrologSlurmctld failed, job killed");
-			(void) job_signal(job_id, SIGKILL, 0, 0, false);
-		}
-
-		unlock_slurmctld(job_write_lock);
-	} else
-		debug2("prolog_slurmctld job %u prolog completed", job_id);
+	if (job_ptr->details)
+		job_ptr->details->prolog_running++;
 
- fini:	xfree(argv[0]);
-	for (i=0; my_env[i]; i++)
-		xfree(my_env[i]);
-	xfree(my_env);
-	lock_slurmctld(config_read_lock);
-	if (job_ptr->job_id != job_id) {
-		error("prolog_slurmctld job %u pointer invalid", job_id);
-		job_ptr = find_job_record(job_id);
-		if (job_ptr == NULL)
-			error("prolog_slurmctld job %u now defunct", job_id);
-	}
-	prolog_running_decr(job_ptr);
-	if (power_save_test()) {
-		/* Wait for node to register after booting */
-	} else if (job_ptr && job_ptr->node_bitmap) {
-		for (i=0; i<node_record_count; i++) {
-			if (bit_test(job_ptr->node_bitmap, i) == 0)
-				continue;
-			bit_clear(booting_node_bitmap, i);
-			node_record_table_ptr[i].node_state &=
-				(~NODE_STATE_POWER_UP);
-		}
-	} else if (node_bitmap) {
-		for (i=0; i<node_record_count; i++) {
-			if (bit_test(node_bitmap, i) == 0)
-				continue;
-			bit_clear(booting_node_bitmap, i);
-			node_record_table_ptr[i].node_state &=
-				(~NODE_STATE_POWER_UP);
-		}
-	}
-	unlock_slurmctld(config_read_lock);
-	FREE_NULL_BITMAP(node_bitmap);
+	job_ptr->job_state |= JOB_CONFIGURING;
 
-	return NULL;
+	return SLURM_SUCCESS;
 }
 
 /* Decrement a job's prolog_running counter and launch the job if zero */
@@ -4190,6 +4267,9 @@ void
 cleanup_completing(struct job_record *job_ptr)
 {
 	time_t delay;
+	struct timeval now;
+	long delta_t;
+	uint32_t free_usec;
 
 	trace_job(job_ptr, __func__, "");
 
@@ -4199,6 +4279,28 @@ cleanup_completing(struct job_record *job_ptr)
 		     __func__, job_ptr->job_id,(long) delay);
 	}
 
+	/* Job-to-free-node latency, logged when the statistics are reset.
+	 * Not known for jobs recovered from saved state while COMPLETING */
+	if (job_ptr->free_start_tv.tv_sec) {
+		gettimeofday(&now, NULL);
+		delta_t  = (now.tv_sec - job_ptr->free_start_tv.tv_sec) *
+			   1000000;
+		delta_t += (now.tv_usec - job_ptr->free_start_tv.tv_usec);
+		if (delta_t < 0)
+			delta_t = 0;
+		else if (delta_t > INFINITE - 1)
+			delta_t = INFINITE - 1;
+		free_usec = delta_t;
+		debug2("%s: job %u nodes freed in %u usec",
+		       __func__, job_ptr->job_id, free_usec);
+		slurmctld_diag_stats.job_free_counter++;
+		slurmctld_diag_stats.job_free_last = free_usec;
+		slurmctld_diag_stats.job_free_sum += free_usec;
+		if (free_usec > slurmctld_diag_stats.job_free_max)
+			slurmctld_diag_stats.job_free_max = free_usec;
+		job_ptr->free_start_tv.tv_sec = 0;
+	}
+
 	license_job_return(job_ptr);
 	if (slurm_sched_g_freealloc(job_ptr) != SLURM_SUCCESS)
 		error("slurm_sched_freealloc(%u): %m", job_ptr->job_id);
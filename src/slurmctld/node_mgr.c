@@ -310,11 +310,16 @@ extern int load_all_node_state ( bool state_only )
 	Buf buffer;
 	char *ver_str = NULL;
 	hostset_t hs = NULL;
-	bool power_save_mode = false;
+	bool power_save_mode = false, fast_start = false;
 	uint16_t protocol_version = (uint16_t)NO_VAL;
+	char *sched_params;
 
 	if (slurmctld_conf.suspend_program && slurmctld_conf.resume_program)
 		power_save_mode = true;
+	sched_params = slurm_get_sched_params();
+	if (sched_params && strstr(sched_params, "fast_start"))
+		fast_start = true;
+	xfree(sched_params);
 
 	/* read the file */
 	lock_state_files ();
@@ -533,6 +538,22 @@ extern int load_all_node_state ( bool state_only )
 						     NODE_STATE_FLAGS;
 					node_ptr->node_state = NODE_STATE_DOWN
 						| orig_flags;
+				} else if (fast_start &&
+					   !(node_state &
+					     NODE_STATE_NO_RESPOND) &&
+					   ((base_state == NODE_STATE_IDLE) ||
+					    (base_state ==
+					     NODE_STATE_ALLOCATED) ||
+					    (base_state == NODE_STATE_MIXED))) {
+					/* Schedule before it registers, the
+					 * state of nodes running jobs is set
+					 * once jobs are recovered. The node
+					 * is set DOWN if it never responds. */
+					orig_flags = node_ptr->node_state &
+						     NODE_STATE_FLAGS;
+					node_ptr->node_state = NODE_STATE_IDLE
+						| orig_flags;
+					node_ptr->last_response = now;
 				}
 				if (node_state & NODE_STATE_DRAIN)
 					 node_ptr->node_state |=
@@ -492,6 +492,7 @@ extern void deallocate_nodes(struct job_record *job_ptr, bool timeout,
 			select_serial = 1;
 	}
 
+	gettimeofday(&job_ptr->free_start_tv, NULL);
 	acct_policy_job_fini(job_ptr);
 	if (select_g_job_fini(job_ptr) != SLURM_SUCCESS)
 		error("select_g_job_fini(%u): %m", job_ptr->job_id);
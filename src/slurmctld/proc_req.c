@@ -215,6 +215,59 @@ static void  _slurm_rpc_assoc_mgr_info(slurm_msg_t * msg);
 
 extern diag_stats_t slurmctld_diag_stats;
 
+/* Node registrations validated in batches under one acquisition of the
+ * job and node write locks, see _node_reg_batch() */
+#define MAX_NODE_REG_BATCH 256
+typedef struct {
+	bool done;
+	int error_code;
+	slurm_msg_t *msg;
+	bool newly_up;
+} node_reg_t;
+static pthread_cond_t  node_reg_cond  = PTHREAD_COND_INITIALIZER;
+static bool            node_reg_leader = false;
+static List            node_reg_list  = NULL;
+static pthread_mutex_t node_reg_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Job and step completions processed in batches under one acquisition of
+ * the job and node write locks, see _comp_batch() */
+#define MAX_COMP_BATCH 256
+typedef struct {
+	void *arg;
+	bool done;
+	void (*func) (void *arg);
+} comp_req_t;
+static pthread_cond_t  comp_cond   = PTHREAD_COND_INITIALIZER;
+static uint32_t        comp_delay  = 0;	/* usec, comp_batch_delay */
+static bool            comp_leader = false;
+static List            comp_list   = NULL;
+static pthread_mutex_t comp_mutex  = PTHREAD_MUTEX_INITIALIZER;
+static time_t          comp_update = (time_t) 0;
+
+/* REQUEST_COMPLETE_BATCH_SCRIPT state, see _batch_comp_process() */
+typedef struct {
+#ifdef HAVE_BG
+	update_block_msg_t block_desc;
+#endif
+	bool dump_job;
+	bool dump_node;
+	int error_code;
+	struct job_record *job_ptr;
+	slurm_msg_t *msg;
+	uid_t uid;
+	bool wrong_node;
+} batch_comp_t;
+
+/* REQUEST_STEP_COMPLETE state, see _step_comp_process() */
+typedef struct {
+	int error_code;
+	slurm_msg_t *msg;
+	int rc;
+	int rem;
+	uint32_t step_rc;
+	uid_t uid;
+} step_comp_t;
+
 /*
  * slurmctld_req  - Process an individual RPC request
  * IN/OUT msg - the request message, data associated with the message is freed
@@ -1966,52 +2019,111 @@ static void _slurm_rpc_complete_prolog(slurm_msg_t * msg)
 	}
 }
 
-/* _slurm_rpc_complete_batch - process RPC from slurmstepd to note the
- *	completion of a batch script */
-static void _slurm_rpc_complete_batch_script(slurm_msg_t *msg,
-					     bool *run_scheduler,
-					     bool running_composite)
+/*
+ * Queue a job or step completion and wait until func(arg) has been run. The
+ * first thread to find no batch in progress runs everything queued (up to
+ * MAX_COMP_BATCH records) under a single acquisition of the job and node
+ * write locks, so that jobs ending together on many nodes do not each wait
+ * their turn for the locks. With SchedulerParameters=comp_batch_delay=# the
+ * leader first waits that many microseconds for more completions to arrive.
+ */
+static void _comp_batch(void (*func) (void *arg), void *arg)
 {
-	static int active_rpc_cnt = 0;
-	int error_code = SLURM_SUCCESS, i;
-	DEF_TIMERS;
-	complete_batch_script_msg_t *comp_msg =
-		(complete_batch_script_msg_t *) msg->data;
 	/* Locks: Write job, write node */
 	slurmctld_lock_t job_write_lock = {
-		NO_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK
-	};
-	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred,
-					 slurmctld_config.auth_info);
-	bool job_requeue = false;
-	bool dump_job = false, dump_node = false;
-	struct job_record *job_ptr = NULL;
-	char *msg_title = "node(s)";
-	char *nodes = comp_msg->node_name;
-#ifdef HAVE_BG
-	update_block_msg_t block_desc;
-	memset(&block_desc, 0, sizeof(update_block_msg_t));
-#endif
-	/* init */
-	START_TIMER;
-	debug2("Processing RPC: REQUEST_COMPLETE_BATCH_SCRIPT from "
-	       "uid=%u JobId=%u",
-	       uid, comp_msg->job_id);
+		NO_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK };
+	List batch_list;
+	ListIterator iter;
+	comp_req_t comp_req, *batch_req;
+	uint32_t delay;
+	DEF_TIMERS;
 
-	if (!validate_slurm_user(uid)) {
-		error("A non superuser %u tried to complete batch job %u",
-		      uid, comp_msg->job_id);
-		/* Only the slurmstepd can complete a batch script */
-		END_TIMER2("_slurm_rpc_complete_batch_script");
-		return;
-	}
+	comp_req.arg  = arg;
+	comp_req.done = false;
+	comp_req.func = func;
+
+	slurm_mutex_lock(&comp_mutex);
+	if (!comp_list)
+		comp_list = list_create(NULL);
+	list_append(comp_list, &comp_req);
+	while (!comp_req.done) {
+		if (comp_leader) {
+			pthread_cond_wait(&comp_cond, &comp_mutex);
+			continue;
+		}
+		comp_leader = true;
+		if (comp_update != slurmctld_conf.last_update) {
+			char *sched_params = slurm_get_sched_params();
+			char *tmp_ptr;
+			int i;
+
+			comp_delay = 0;
+			if (sched_params &&
+			    (tmp_ptr = strstr(sched_params,
+					      "comp_batch_delay="))) {
+				i = atoi(tmp_ptr + 17);
+				if ((i < 0) || (i > 1000000)) {
+					error("Invalid comp_batch_delay: %d",
+					      i);
+				} else
+					comp_delay = i;
+			}
+			xfree(sched_params);
+			comp_update = slurmctld_conf.last_update;
+		}
+		if (list_count(comp_list) < MAX_COMP_BATCH)
+			delay = comp_delay;
+		else
+			delay = 0;
+		if (delay) {
+			slurm_mutex_unlock(&comp_mutex);
+			usleep(delay);
+			slurm_mutex_lock(&comp_mutex);
+		}
+		batch_list = list_create(NULL);
+		while ((list_count(batch_list) < MAX_COMP_BATCH) &&
+		       (batch_req = list_dequeue(comp_list)))
+			list_append(batch_list, batch_req);
+		slurm_mutex_unlock(&comp_mutex);
 
-	if (!running_composite) {
-		_throttle_start(&active_rpc_cnt);
+		START_TIMER;
 		lock_slurmctld(job_write_lock);
-	}
+		iter = list_iterator_create(batch_list);
+		while ((batch_req = list_next(iter)))
+			(batch_req->func)(batch_req->arg);
+		list_iterator_destroy(iter);
+		unlock_slurmctld(job_write_lock);
+		END_TIMER2("_comp_batch");
+		debug2("%s: processed %d completions %s", __func__,
+		       list_count(batch_list), TIME_STR);
+
+		slurm_mutex_lock(&comp_mutex);
+		iter = list_iterator_create(batch_list);
+		while ((batch_req = list_next(iter)))
+			batch_req->done = true;
+		list_iterator_destroy(iter);
+		FREE_NULL_LIST(batch_list);
+		comp_leader = false;
+		pthread_cond_broadcast(&comp_cond);
+	}
+	slurm_mutex_unlock(&comp_mutex);
+}
+
+/* Process one batch script completion, job and node write locks must be
+ * held */
+static void _batch_comp_process(void *arg)
+{
+	batch_comp_t *batch_comp = (batch_comp_t *) arg;
+	complete_batch_script_msg_t *comp_msg =
+		(complete_batch_script_msg_t *) batch_comp->msg->data;
+	bool job_requeue = false;
+	struct job_record *job_ptr;
+	char *msg_title = "node(s)";
+	char *nodes = comp_msg->node_name;
+	int i;
 
 	job_ptr = find_job_record(comp_msg->job_id);
+	batch_comp->job_ptr = job_ptr;
 
 	if (job_ptr && job_ptr->batch_host && comp_msg->node_name &&
 	    xstrcmp(job_ptr->batch_host, comp_msg->node_name)) {
@@ -2024,11 +2136,7 @@ static void _slurm_rpc_complete_batch_script(slurm_msg_t *msg,
 		      "Was the job requeued due to node failure?",
 		      comp_msg->job_id,
 		      comp_msg->node_name, job_ptr->batch_host);
-		if (!running_composite) {
-			unlock_slurmctld(job_write_lock);
-			_throttle_fini(&active_rpc_cnt);
-		}
-		slurm_send_rc_msg(msg, error_code);
+		batch_comp->wrong_node = true;
 		return;
 	}
 
@@ -2101,7 +2209,7 @@ static void _slurm_rpc_complete_batch_script(slurm_msg_t *msg,
 		 */
 		error("ALPS reservation for JobId %u failed: %s",
 			comp_msg->job_id, slurm_strerror(comp_msg->slurm_rc));
-		dump_job = job_requeue = true;
+		batch_comp->dump_job = job_requeue = true;
 #endif
 	/* Handle non-fatal errors here. All others drain the node. */
 	} else if ((comp_msg->slurm_rc == SLURM_COMMUNICATIONS_SEND_ERROR) ||
@@ -2118,13 +2226,13 @@ static void _slurm_rpc_complete_batch_script(slurm_msg_t *msg,
 		      msg_title, nodes,
 		      slurm_strerror(comp_msg->slurm_rc));
 		slurmctld_diag_stats.jobs_failed++;
-		if (error_code == SLURM_SUCCESS) {
+		if (batch_comp->error_code == SLURM_SUCCESS) {
 #ifdef HAVE_BG
 			if (job_ptr) {
 				select_g_select_jobinfo_get(
 					job_ptr->select_jobinfo,
 					SELECT_JOBDATA_BLOCK_ID,
-					&block_desc.bg_block_id);
+					&batch_comp->block_desc.bg_block_id);
 			}
 #else
 #ifdef HAVE_FRONT_END
@@ -2137,39 +2245,83 @@ static void _slurm_rpc_complete_batch_script(slurm_msg_t *msg,
 				update_node_msg.node_state = NODE_STATE_DRAIN;
 				update_node_msg.reason =
 					"batch job complete failure";
-				error_code = update_front_end(&update_node_msg);
+				batch_comp->error_code =
+					update_front_end(&update_node_msg);
 			}
 #else
-			error_code = drain_nodes(comp_msg->node_name,
-						 "batch job complete failure",
-						 getuid());
+			batch_comp->error_code =
+				drain_nodes(comp_msg->node_name,
+					    "batch job complete failure",
+					    getuid());
 #endif	/* !HAVE_FRONT_END */
 #endif	/* !HAVE_BG */
 			if ((comp_msg->job_rc != SLURM_SUCCESS) && job_ptr &&
 			    job_ptr->details && job_ptr->details->requeue)
 				job_requeue = true;
-			dump_job = true;
-			dump_node = true;
+			batch_comp->dump_job = true;
+			batch_comp->dump_node = true;
 		}
 	}
 
 	/* Mark job allocation complete */
-	if (msg->msg_type == REQUEST_COMPLETE_BATCH_JOB)
+	if (batch_comp->msg->msg_type == REQUEST_COMPLETE_BATCH_JOB)
 		job_epilog_complete(comp_msg->job_id, comp_msg->node_name, 0);
-	i = job_complete(comp_msg->job_id, uid, job_requeue, false,
+	i = job_complete(comp_msg->job_id, batch_comp->uid, job_requeue, false,
 			 comp_msg->job_rc);
-	error_code = MAX(error_code, i);
-	if (!running_composite) {
-		unlock_slurmctld(job_write_lock);
-		_throttle_fini(&active_rpc_cnt);
+	batch_comp->error_code = MAX(batch_comp->error_code, i);
+}
+
+/* _slurm_rpc_complete_batch - process RPC from slurmstepd to note the
+ *	completion of a batch script */
+static void _slurm_rpc_complete_batch_script(slurm_msg_t *msg,
+					     bool *run_scheduler,
+					     bool running_composite)
+{
+	int error_code = SLURM_SUCCESS;
+#ifdef HAVE_BG
+	int i;
+#endif
+	DEF_TIMERS;
+	complete_batch_script_msg_t *comp_msg =
+		(complete_batch_script_msg_t *) msg->data;
+	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred,
+					 slurmctld_config.auth_info);
+	batch_comp_t batch_comp;
+
+	/* init */
+	START_TIMER;
+	debug2("Processing RPC: REQUEST_COMPLETE_BATCH_SCRIPT from "
+	       "uid=%u JobId=%u",
+	       uid, comp_msg->job_id);
+
+	if (!validate_slurm_user(uid)) {
+		error("A non superuser %u tried to complete batch job %u",
+		      uid, comp_msg->job_id);
+		/* Only the slurmstepd can complete a batch script */
+		END_TIMER2("_slurm_rpc_complete_batch_script");
+		return;
+	}
+
+	memset(&batch_comp, 0, sizeof(batch_comp_t));
+	batch_comp.msg = msg;
+	batch_comp.uid = uid;
+	if (running_composite)	/* Locks already held */
+		_batch_comp_process(&batch_comp);
+	else
+		_comp_batch(_batch_comp_process, &batch_comp);
+	if (batch_comp.wrong_node) {
+		slurm_send_rc_msg(msg, error_code);
+		return;
 	}
+	error_code = batch_comp.error_code;
 #ifdef HAVE_BG
-	if (block_desc.bg_block_id) {
-		block_desc.reason = slurm_strerror(comp_msg->slurm_rc);
-		block_desc.state = BG_BLOCK_ERROR_FLAG;
-		i = select_g_update_block(&block_desc);
+	if (batch_comp.block_desc.bg_block_id) {
+		batch_comp.block_desc.reason =
+			slurm_strerror(comp_msg->slurm_rc);
+		batch_comp.block_desc.state = BG_BLOCK_ERROR_FLAG;
+		i = select_g_update_block(&batch_comp.block_desc);
 		error_code = MAX(error_code, i);
-		xfree(block_desc.bg_block_id);
+		xfree(batch_comp.block_desc.bg_block_id);
 	}
 #endif
 
@@ -2193,17 +2345,18 @@ static void _slurm_rpc_complete_batch_script(slurm_msg_t *msg,
 		debug2("_slurm_rpc_complete_batch_script JobId=%u %s",
 		       comp_msg->job_id, TIME_STR);
 		slurmctld_diag_stats.jobs_completed++;
-		dump_job = true;
-		if (replace_batch_job(msg, job_ptr, running_composite))
+		batch_comp.dump_job = true;
+		if (replace_batch_job(msg, batch_comp.job_ptr,
+				      running_composite))
 			*run_scheduler = true;
 	}
 
 	/* If running composite lets not call this to avoid deadlock */
 	if (!running_composite && *run_scheduler)
 		(void) schedule(0);		/* Has own locking */
-	if (dump_job)
+	if (batch_comp.dump_job)
 		(void) schedule_job_save();	/* Has own locking */
-	if (dump_node)
+	if (batch_comp.dump_node)
 		(void) schedule_node_save();	/* Has own locking */
 }
 
@@ -2504,6 +2657,80 @@ static void _slurm_rpc_job_will_run(slurm_msg_t * msg)
 	xfree(err_msg);
 }
 
+/* Validate one node registration, job and node write locks must be held */
+static void _node_reg_validate(node_reg_t *node_reg)
+{
+	slurm_node_registration_status_msg_t *node_reg_stat_msg =
+		(slurm_node_registration_status_msg_t *) node_reg->msg->data;
+
+#ifdef HAVE_FRONT_END		/* Operates only on front-end */
+	node_reg->error_code = validate_nodes_via_front_end(
+		node_reg_stat_msg, node_reg->msg->protocol_version,
+		&node_reg->newly_up);
+#else
+	validate_jobs_on_node(node_reg_stat_msg);
+	node_reg->error_code = validate_node_specs(
+		node_reg_stat_msg, node_reg->msg->protocol_version,
+		&node_reg->newly_up);
+#endif
+}
+
+/*
+ * Queue a node registration and wait until it has been validated. The first
+ * thread to find no batch in progress validates everything queued (up to
+ * MAX_NODE_REG_BATCH records) under a single acquisition of the locks, so
+ * that the registrations of all nodes after a slurmctld restart do not each
+ * wait their turn for the job and node write locks.
+ */
+static void _node_reg_batch(node_reg_t *node_reg)
+{
+	/* Locks: Read config, write job, write node */
+	slurmctld_lock_t job_write_lock = {
+		READ_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK };
+	List batch_list;
+	ListIterator iter;
+	node_reg_t *batch_reg;
+	DEF_TIMERS;
+
+	slurm_mutex_lock(&node_reg_mutex);
+	if (!node_reg_list)
+		node_reg_list = list_create(NULL);
+	list_append(node_reg_list, node_reg);
+	while (!node_reg->done) {
+		if (node_reg_leader) {
+			pthread_cond_wait(&node_reg_cond, &node_reg_mutex);
+			continue;
+		}
+		node_reg_leader = true;
+		batch_list = list_create(NULL);
+		while ((list_count(batch_list) < MAX_NODE_REG_BATCH) &&
+		       (batch_reg = list_dequeue(node_reg_list)))
+			list_append(batch_list, batch_reg);
+		slurm_mutex_unlock(&node_reg_mutex);
+
+		START_TIMER;
+		lock_slurmctld(job_write_lock);
+		iter = list_iterator_create(batch_list);
+		while ((batch_reg = list_next(iter)))
+			_node_reg_validate(batch_reg);
+		list_iterator_destroy(iter);
+		unlock_slurmctld(job_write_lock);
+		END_TIMER2("_node_reg_batch");
+		debug2("%s: validated %d node registrations %s", __func__,
+		       list_count(batch_list), TIME_STR);
+
+		slurm_mutex_lock(&node_reg_mutex);
+		iter = list_iterator_create(batch_list);
+		while ((batch_reg = list_next(iter)))
+			batch_reg->done = true;
+		list_iterator_destroy(iter);
+		FREE_NULL_LIST(batch_list);
+		node_reg_leader = false;
+		pthread_cond_broadcast(&node_reg_cond);
+	}
+	slurm_mutex_unlock(&node_reg_mutex);
+}
+
 /* _slurm_rpc_node_registration - process RPC to determine if a node's
  *	actual configuration satisfies the configured specification */
 static void _slurm_rpc_node_registration(slurm_msg_t * msg,
@@ -2512,12 +2739,9 @@ static void _slurm_rpc_node_registration(slurm_msg_t * msg,
 	/* init */
 	DEF_TIMERS;
 	int error_code = SLURM_SUCCESS;
-	bool newly_up = false;
+	node_reg_t node_reg;
 	slurm_node_registration_status_msg_t *node_reg_stat_msg =
 		(slurm_node_registration_status_msg_t *) msg->data;
-	/* Locks: Read config, write job, write node */
-	slurmctld_lock_t job_write_lock = {
-		READ_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK };
 	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred,
 					 slurmctld_config.auth_info);
 
@@ -2547,22 +2771,15 @@ static void _slurm_rpc_node_registration(slurm_msg_t * msg,
 			      "set DebugFlags=NO_CONF_HASH in your slurm.conf.",
 			      node_reg_stat_msg->node_name);
 		}
-		if (!running_composite)
-			lock_slurmctld(job_write_lock);
-#ifdef HAVE_FRONT_END		/* Operates only on front-end */
-		error_code = validate_nodes_via_front_end(node_reg_stat_msg,
-							  msg->protocol_version,
-							  &newly_up);
-#else
-		validate_jobs_on_node(node_reg_stat_msg);
-		error_code = validate_node_specs(node_reg_stat_msg,
-						 msg->protocol_version,
-						 &newly_up);
-#endif
-		if (!running_composite)
-			unlock_slurmctld(job_write_lock);
+		memset(&node_reg, 0, sizeof(node_reg_t));
+		node_reg.msg = msg;
+		if (running_composite)	/* Locks already held */
+			_node_reg_validate(&node_reg);
+		else
+			_node_reg_batch(&node_reg);
+		error_code = node_reg.error_code;
 		END_TIMER2("_slurm_rpc_node_registration");
-		if (newly_up) {
+		if (node_reg.newly_up) {
 			queue_job_scheduler();
 		}
 	}
@@ -3093,23 +3310,43 @@ static void _slurm_rpc_shutdown_controller_immediate(slurm_msg_t * msg)
 		debug("Performing RPC: REQUEST_SHUTDOWN_IMMEDIATE");
 }
 
+/* Process one step completion, job and node write locks must be held */
+static void _step_comp_process(void *arg)
+{
+	step_comp_t *step_comp = (step_comp_t *) arg;
+	step_complete_msg_t *req = (step_complete_msg_t *)step_comp->msg->data;
+
+	step_comp->rc = step_partial_comp(req, step_comp->uid,
+					  &step_comp->rem, &step_comp->step_rc);
+	if (step_comp->rc || step_comp->rem)	/* some error or not done */
+		return;
+
+	if (req->job_step_id == SLURM_BATCH_SCRIPT) {
+		/* FIXME: test for error, possibly cause batch job requeue */
+		step_comp->error_code = job_complete(req->job_id,
+						     step_comp->uid, false,
+						     false, step_comp->step_rc);
+	} else {
+		step_comp->error_code = job_step_complete(req->job_id,
+							  req->job_step_id,
+							  step_comp->uid, false,
+							  step_comp->step_rc);
+	}
+}
+
 /* _slurm_rpc_step_complete - process step completion RPC to note the
  *      completion of a job step on at least some nodes.
  *	If the job step is complete, it may
  *	represent the termination of an entire job */
 static void _slurm_rpc_step_complete(slurm_msg_t *msg, bool running_composite)
 {
-	static int active_rpc_cnt = 0;
-	int error_code = SLURM_SUCCESS, rc, rem;
-	uint32_t step_rc;
+	int error_code = SLURM_SUCCESS;
 	DEF_TIMERS;
 	step_complete_msg_t *req = (step_complete_msg_t *)msg->data;
-	/* Locks: Write job, write node */
-	slurmctld_lock_t job_write_lock = {
-		NO_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK };
 	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred,
 					 slurmctld_config.auth_info);
 	bool dump_job = false, dump_node = false;
+	step_comp_t step_comp;
 
 	/* init */
 	START_TIMER;
@@ -3119,35 +3356,25 @@ static void _slurm_rpc_step_complete(slurm_msg_t *msg, bool running_composite)
 		     req->job_id, req->job_step_id, req->range_first,
 		     req->range_last, req->step_rc, uid);
 
-	if (!running_composite) {
-		_throttle_start(&active_rpc_cnt);
-		lock_slurmctld(job_write_lock);
-	}
-
-	rc = step_partial_comp(req, uid, &rem, &step_rc);
+	memset(&step_comp, 0, sizeof(step_comp_t));
+	step_comp.msg = msg;
+	step_comp.uid = uid;
+	if (running_composite)	/* Locks already held */
+		_step_comp_process(&step_comp);
+	else
+		_comp_batch(_step_comp_process, &step_comp);
 
-	if (rc || rem) {	/* some error or not totally done */
+	if (step_comp.rc || step_comp.rem) {	/* some error or not done */
 		/* Note: Error printed within step_partial_comp */
-		if (!running_composite) {
-			unlock_slurmctld(job_write_lock);
-			_throttle_fini(&active_rpc_cnt);
-		}
-		slurm_send_rc_msg(msg, rc);
-		if (!rc)	/* partition completion */
+		slurm_send_rc_msg(msg, step_comp.rc);
+		if (!step_comp.rc)	/* partition completion */
 			schedule_job_save();	/* Has own locking */
 		return;
 	}
 
+	error_code = step_comp.error_code;
+	END_TIMER2("_slurm_rpc_step_complete");
 	if (req->job_step_id == SLURM_BATCH_SCRIPT) {
-		/* FIXME: test for error, possibly cause batch job requeue */
-		error_code = job_complete(req->job_id, uid, false,
-					  false, step_rc);
-		if (!running_composite) {
-			unlock_slurmctld(job_write_lock);
-			_throttle_fini(&active_rpc_cnt);
-		}
-		END_TIMER2("_slurm_rpc_step_complete");
-
 		/* return result */
 		if (error_code) {
 			if (slurmctld_conf.debug_flags & DEBUG_FLAG_STEPS)
@@ -3162,14 +3389,6 @@ static void _slurm_rpc_step_complete(slurm_msg_t *msg, bool running_composite)
 			dump_job = true;
 		}
 	} else {
-		error_code = job_step_complete(req->job_id, req->job_step_id,
-					       uid, false, step_rc);
-		if (!running_composite) {
-			unlock_slurmctld(job_write_lock);
-			_throttle_fini(&active_rpc_cnt);
-		}
-		END_TIMER2("_slurm_rpc_step_complete");
-
 		/* return result */
 		if (error_code) {
 			if (slurmctld_conf.debug_flags & DEBUG_FLAG_STEPS)
@@ -204,6 +204,11 @@ typedef struct diag_stats {
 	uint32_t bf_queue_len_sum;
 	time_t   bf_when_last_cycle;
 	uint32_t bf_active;
+
+	uint32_t job_free_counter;	/* jobs whose nodes were released */
+	uint32_t job_free_last;		/* usec from deallocate_nodes() to */
+	uint32_t job_free_max;		/* the end of job COMPLETING state */
+	uint64_t job_free_sum;
 } diag_stats_t;
 
 /* This is used to point out constants that exist in the
@@ -642,6 +647,9 @@ struct job_record {
 					 * wait call) */
 	front_end_record_t *front_end_ptr; /* Pointer to front-end node running
 					 * this job */
+	struct timeval free_start_tv;	/* when deallocate_nodes() began
+					 * releasing the job's nodes, not
+					 * saved in state */
 	char *gres;			/* generic resources requested by job */
 	List gres_list;			/* generic resource allocation detail */
 	char *gres_alloc;		/* Allocated GRES added over all nodes
@@ -178,10 +178,28 @@ extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 	buffer_ptr[0] = xfer_buf_data(buffer);
 }
 
+/* Log the time taken to free the nodes of ending jobs, which sdiag does
+ * not report since that would change the stats response format */
+static void _log_job_free_stats(void)
+{
+	if (!slurmctld_diag_stats.job_free_counter)
+		return;
+
+	info("Job to free node statistics: jobs:%u last:%u max:%u "
+	     "mean:%"PRIu64" usec",
+	     slurmctld_diag_stats.job_free_counter,
+	     slurmctld_diag_stats.job_free_last,
+	     slurmctld_diag_stats.job_free_max,
+	     slurmctld_diag_stats.job_free_sum /
+	     slurmctld_diag_stats.job_free_counter);
+}
+
 /* Reset all scheduling statistics
  * level IN - clear backfilled_jobs count if set */
 extern void reset_stats(int level)
 {
+	_log_job_free_stats();
+
 	slurmctld_diag_stats.proc_req_raw = 0;
 	slurmctld_diag_stats.proc_req_threads = 0;
 	slurmctld_diag_stats.schedule_cycle_max = 0;
@@ -211,5 +229,10 @@ extern void reset_stats(int level)
 	slurmctld_diag_stats.bf_last_depth_try = 0;
 	slurmctld_diag_stats.bf_active = 0;
 
+	slurmctld_diag_stats.job_free_counter = 0;
+	slurmctld_diag_stats.job_free_last = 0;
+	slurmctld_diag_stats.job_free_max = 0;
+	slurmctld_diag_stats.job_free_sum = 0;
+
 	last_proc_req_start = time(NULL);
 }
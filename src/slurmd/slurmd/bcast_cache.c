@@ -0,0 +1,470 @@
+/*****************************************************************************\
+ *  bcast_cache.c - node local cache of files sent by sbcast
+ *****************************************************************************
+ *  Copyright (C) 2016 SchedMD LLC.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include "src/common/fd.h"
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/sha256.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "src/bcast/file_bcast.h"
+
+#include "src/slurmd/slurmd/bcast_cache.h"
+#include "src/slurmd/slurmd/slurmd.h"
+
+#define CACHE_DIR	"sbcast_cache"	/* under SlurmdSpoolDir */
+#define EXPECT_TIMEOUT	3600	/* seconds to wait for an expected file */
+#define TMP_PREFIX	"tmp."	/* copies not yet added to the cache */
+
+/* A file missing from the cache whose data sbcast is sending */
+typedef struct cache_expect {
+	uint8_t hash[SHA256_LEN];
+	uint32_t job_id;
+	char *fname;
+	uint64_t size;
+	time_t start_time;
+	uid_t uid;
+} cache_expect_t;
+
+/*
+ * A private copy of a file, written from the blocks sbcast sends. It is
+ * owned by root in a directory only root can access, so unlike the file
+ * given to the user it can not change after its hash is checked.
+ */
+struct bcast_cache_file {
+	bool failed;		/* a block could not be written */
+	int fd;
+	uint8_t hash[SHA256_LEN];
+	uint64_t size;
+	char *tmp_path;
+	uid_t uid;
+};
+
+/* A file in the cache, used for eviction */
+typedef struct cache_ent {
+	char *path;
+	uint64_t size;
+	time_t mtime;
+} cache_ent_t;
+
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static List expect_list = NULL;
+
+static char *_cache_path(uid_t uid, uint8_t *hash, uint64_t size)
+{
+	char *hash_str, *path;
+
+	hash_str = bcast_hash_str(hash);
+	path = xstrdup_printf("%s/%s/%u.%s.%"PRIu64, conf->spooldir, CACHE_DIR,
+			      (uint32_t) uid, hash_str, size);
+	xfree(hash_str);
+	return path;
+}
+
+static void _free_expect(void *x)
+{
+	cache_expect_t *expect = (cache_expect_t *) x;
+
+	xfree(expect->fname);
+	xfree(expect);
+}
+
+static int _find_expect(void *x, void *key)
+{
+	cache_expect_t *expect = (cache_expect_t *) x;
+	cache_expect_t *match = (cache_expect_t *) key;
+
+	return ((expect->uid == match->uid) &&
+		(expect->job_id == match->job_id) &&
+		!xstrcmp(expect->fname, match->fname));
+}
+
+static int _find_stale_expect(void *x, void *key)
+{
+	cache_expect_t *expect = (cache_expect_t *) x;
+	time_t *now = (time_t *) key;
+
+	return ((expect->start_time + EXPECT_TIMEOUT) < *now);
+}
+
+static void _free_ent(void *x)
+{
+	cache_ent_t *ent = (cache_ent_t *) x;
+
+	xfree(ent->path);
+	xfree(ent);
+}
+
+static int _sort_ent_by_mtime(void *x, void *y)
+{
+	cache_ent_t *ent1 = *(cache_ent_t **) x;
+	cache_ent_t *ent2 = *(cache_ent_t **) y;
+
+	if (ent1->mtime < ent2->mtime)
+		return -1;
+	if (ent1->mtime > ent2->mtime)
+		return 1;
+	return 0;
+}
+
+/*
+ * Remove the least recently used files until size more bytes fit in the
+ * cache. Copies still being written count against the cache size, but are
+ * only removed once older than EXPECT_TIMEOUT, when slurmd must have
+ * stopped while writing them.
+ * Must hold cache_mutex. RET SLURM_ERROR if they can not fit
+ */
+static int _make_room(char *dir, uint64_t size)
+{
+	DIR *dp;
+	struct dirent *de;
+	struct stat st;
+	List ent_list;
+	cache_ent_t *ent;
+	uint64_t used = 0;
+	time_t now = time(NULL);
+	char *path;
+
+	if (size > conf->sbcast_cache_size)
+		return SLURM_ERROR;
+	if (!(dp = opendir(dir))) {
+		error("sbcast cache: can't open `%s`: %m", dir);
+		return SLURM_ERROR;
+	}
+	ent_list = list_create(_free_ent);
+	while ((de = readdir(dp))) {
+		if (de->d_name[0] == '.')
+			continue;
+		path = xstrdup_printf("%s/%s", dir, de->d_name);
+		if (stat(path, &st) || !S_ISREG(st.st_mode)) {
+			xfree(path);
+			continue;
+		}
+		if (!strncmp(de->d_name, TMP_PREFIX, strlen(TMP_PREFIX))) {
+			if ((st.st_mtime + EXPECT_TIMEOUT) < now)
+				(void) unlink(path);
+			else
+				used += st.st_size;
+			xfree(path);
+			continue;
+		}
+		ent = xmalloc(sizeof(cache_ent_t));
+		ent->path = path;
+		ent->size = st.st_size;
+		ent->mtime = st.st_mtime;
+		used += ent->size;
+		list_append(ent_list, ent);
+	}
+	closedir(dp);
+
+	list_sort(ent_list, (ListCmpF) _sort_ent_by_mtime);
+	while ((used + size > conf->sbcast_cache_size) &&
+	       (ent = list_pop(ent_list))) {
+		debug("sbcast cache: removing `%s`", ent->path);
+		(void) unlink(ent->path);
+		used -= ent->size;
+		_free_ent(ent);
+	}
+	FREE_NULL_LIST(ent_list);
+
+	if (used + size > conf->sbcast_cache_size)
+		return SLURM_ERROR;
+	return SLURM_SUCCESS;
+}
+
+static void _free_cache_file(bcast_cache_file_t *cf)
+{
+	if (cf->fd >= 0)
+		(void) close(cf->fd);
+	if (cf->tmp_path) {
+		(void) unlink(cf->tmp_path);
+		xfree(cf->tmp_path);
+	}
+	xfree(cf);
+}
+
+/* Check the hash of a complete copy and move it into the cache */
+static void *_add_thread(void *arg)
+{
+	bcast_cache_file_t *cf = (bcast_cache_file_t *) arg;
+	uint8_t hash[SHA256_LEN];
+	sha256_ctx_t ctx;
+	struct stat st;
+	char *buf, *path = NULL;
+	uint64_t offset = 0;
+	ssize_t len;
+
+	if (fstat(cf->fd, &st) || (st.st_size != cf->size)) {
+		debug("sbcast cache: copy is not of the expected size");
+		goto fini;
+	}
+
+	buf = xmalloc(1024 * 1024);
+	sha256_init(&ctx);
+	while (offset < cf->size) {
+		len = pread(cf->fd, buf, 1024 * 1024, offset);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			error("sbcast cache: can't read `%s`: %m",
+			      cf->tmp_path);
+			break;
+		} else if (len == 0)
+			break;
+		sha256_update(&ctx, buf, len);
+		offset += len;
+	}
+	xfree(buf);
+	if (offset < cf->size)
+		goto fini;
+	sha256_final(&ctx, hash);
+	if (memcmp(hash, cf->hash, SHA256_LEN)) {
+		/* sbcast sent a hash of other contents */
+		debug("sbcast cache: file contents do not match hash");
+		goto fini;
+	}
+
+	path = _cache_path(cf->uid, cf->hash, cf->size);
+	slurm_mutex_lock(&cache_mutex);
+	if (access(path, F_OK) == 0) {
+		(void) utime(path, NULL);	/* added by another transfer */
+	} else if (rename(cf->tmp_path, path) < 0) {
+		error("sbcast cache: can't rename `%s`: %m", cf->tmp_path);
+	} else {
+		xfree(cf->tmp_path);
+		debug("sbcast cache: added `%s`", path);
+	}
+	slurm_mutex_unlock(&cache_mutex);
+
+fini:
+	_free_cache_file(cf);
+	xfree(path);
+	return NULL;
+}
+
+extern int bcast_cache_open(uid_t uid, uint8_t *hash, uint64_t size)
+{
+	char *path;
+	int fd;
+
+	if (!conf->sbcast_cache_size)
+		return -1;
+
+	path = _cache_path(uid, hash, size);
+	slurm_mutex_lock(&cache_mutex);
+	if ((fd = open(path, O_RDONLY)) >= 0) {
+		fd_set_close_on_exec(fd);
+		(void) utime(path, NULL);	/* for LRU eviction */
+	}
+	slurm_mutex_unlock(&cache_mutex);
+	xfree(path);
+
+	return fd;
+}
+
+extern int bcast_cache_copy(int cache_fd, int fd)
+{
+	char buf[64 * 1024];
+	int len, offset, rc;
+
+	while ((len = read(cache_fd, buf, sizeof(buf)))) {
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			rc = errno;
+			error("sbcast cache: read: %m");
+			return rc;
+		}
+		for (offset = 0; offset < len; offset += rc) {
+			rc = write(fd, buf + offset, len - offset);
+			if (rc < 0) {
+				if (errno == EINTR) {
+					rc = 0;
+					continue;
+				}
+				return errno;
+			}
+		}
+	}
+
+	return SLURM_SUCCESS;
+}
+
+extern void bcast_cache_expect(file_bcast_msg_t *req, uid_t uid,
+			       uint32_t job_id)
+{
+	cache_expect_t *expect;
+	time_t now = time(NULL);
+
+	if (!conf->sbcast_cache_size || (req->file_size == 0) ||
+	    (req->file_size > conf->sbcast_cache_size))
+		return;
+
+	expect = xmalloc(sizeof(cache_expect_t));
+	memcpy(expect->hash, req->file_hash, SHA256_LEN);
+	expect->job_id = job_id;
+	expect->fname = xstrdup(req->fname);
+	expect->size = req->file_size;
+	expect->start_time = now;
+	expect->uid = uid;
+
+	slurm_mutex_lock(&cache_mutex);
+	if (!expect_list)
+		expect_list = list_create(_free_expect);
+	list_delete_all(expect_list, _find_stale_expect, &now);
+	list_delete_all(expect_list, _find_expect, expect);
+	list_append(expect_list, expect);
+	slurm_mutex_unlock(&cache_mutex);
+}
+
+extern bcast_cache_file_t *bcast_cache_start(uid_t uid, uint32_t job_id,
+					     char *fname)
+{
+	cache_expect_t key, *expect = NULL;
+	bcast_cache_file_t *cf = NULL;
+	ListIterator itr;
+	char *dir;
+
+	key.uid = uid;
+	key.job_id = job_id;
+	key.fname = fname;
+	slurm_mutex_lock(&cache_mutex);
+	if (expect_list) {
+		itr = list_iterator_create(expect_list);
+		if ((expect = list_find(itr, _find_expect, &key)))
+			list_remove(itr);
+		list_iterator_destroy(itr);
+	}
+	if (!expect) {
+		slurm_mutex_unlock(&cache_mutex);
+		return NULL;
+	}
+
+	dir = xstrdup_printf("%s/%s", conf->spooldir, CACHE_DIR);
+	if ((mkdir(dir, 0700) < 0) && (errno != EEXIST)) {
+		error("sbcast cache: can't create `%s`: %m", dir);
+	} else if (_make_room(dir, expect->size) == SLURM_SUCCESS) {
+		cf = xmalloc(sizeof(bcast_cache_file_t));
+		cf->tmp_path = xstrdup_printf("%s/%s%u.XXXXXX", dir,
+					      TMP_PREFIX, (uint32_t) uid);
+		if ((cf->fd = mkstemp(cf->tmp_path)) < 0) {
+			error("sbcast cache: can't create `%s`: %m",
+			      cf->tmp_path);
+			xfree(cf->tmp_path);
+			xfree(cf);
+		} else {
+			fd_set_close_on_exec(cf->fd);
+			memcpy(cf->hash, expect->hash, SHA256_LEN);
+			cf->size = expect->size;
+			cf->uid = uid;
+		}
+	}
+	slurm_mutex_unlock(&cache_mutex);
+	xfree(dir);
+	_free_expect(expect);
+
+	return cf;
+}
+
+extern void bcast_cache_write(bcast_cache_file_t *cf, char *data,
+			      uint32_t len, off_t offset)
+{
+	ssize_t rc;
+
+	if (cf->failed)
+		return;
+	if ((offset < 0) || ((uint64_t) offset + len > cf->size)) {
+		cf->failed = true;
+		return;
+	}
+	while (len) {
+		rc = pwrite(cf->fd, data, len, offset);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			error("sbcast cache: can't write `%s`: %m",
+			      cf->tmp_path);
+			cf->failed = true;
+			return;
+		}
+		data += rc;
+		len -= rc;
+		offset += rc;
+	}
+}
+
+extern void bcast_cache_finish(bcast_cache_file_t *cf, bool complete)
+{
+	pthread_attr_t attr;
+	pthread_t thread_id;
+
+	if (!cf)
+		return;
+	if (!complete || cf->failed) {
+		_free_cache_file(cf);
+		return;
+	}
+
+	slurm_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if (pthread_create(&thread_id, &attr, _add_thread, cf)) {
+		error("sbcast cache: pthread_create: %m");
+		_free_cache_file(cf);
+	}
+	slurm_attr_destroy(&attr);
+}
+
+extern void bcast_cache_fini(void)
+{
+	slurm_mutex_lock(&cache_mutex);
+	FREE_NULL_LIST(expect_list);
+	slurm_mutex_unlock(&cache_mutex);
+}
@@ -0,0 +1,88 @@
+/*****************************************************************************\
+ *  bcast_cache.h - node local cache of files sent by sbcast
+ *****************************************************************************
+ *  Copyright (C) 2016 SchedMD LLC.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _BCAST_CACHE_H
+#define _BCAST_CACHE_H
+
+#include <sys/types.h>
+
+#include "src/common/slurm_protocol_defs.h"
+
+/* A private copy of a broadcast file, to be added to the cache */
+typedef struct bcast_cache_file bcast_cache_file_t;
+
+/*
+ * Open the cached copy of a user's file with the given SHA-256 and size
+ * RET file descriptor to read from or -1 if the file is not cached
+ */
+extern int bcast_cache_open(uid_t uid, uint8_t *hash, uint64_t size);
+
+/*
+ * Copy the contents of a cached file to a newly broadcast file
+ * RET SLURM_SUCCESS or the errno of the failed read or write
+ */
+extern int bcast_cache_copy(int cache_fd, int fd);
+
+/*
+ * Note that sbcast will send the data of a file missing from the cache,
+ * so that a copy of it is made by bcast_cache_start()
+ */
+extern void bcast_cache_expect(file_bcast_msg_t *req, uid_t uid,
+			       uint32_t job_id);
+
+/*
+ * Start a private copy of a file registered for a transfer, if its data is
+ * sent after a cache miss
+ * RET the copy to pass to bcast_cache_write() and bcast_cache_finish(),
+ *	or NULL if the file is not to be cached
+ */
+extern bcast_cache_file_t *bcast_cache_start(uid_t uid, uint32_t job_id,
+					     char *fname);
+
+/* Write a block of the file to its copy, at the block's offset */
+extern void bcast_cache_write(bcast_cache_file_t *cf, char *data,
+			      uint32_t len, off_t offset);
+
+/*
+ * Finish a copy and free cf. If the transfer was complete, the copy is
+ * added to the cache in the background once its contents are checked
+ * against the SHA-256 sent by sbcast, otherwise it is removed.
+ */
+extern void bcast_cache_finish(bcast_cache_file_t *cf, bool complete);
+
+/* Free the records of files expected to be added */
+extern void bcast_cache_fini(void);
+
+#endif	/* _BCAST_CACHE_H */
@@ -38,6 +38,10 @@
  *  with SLURM; if not, write to the Free Software Foundation, Inc.,
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
 \*****************************************************************************/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE		/* pipe2() */
+#endif
+
 #if HAVE_CONFIG_H
 #  include "config.h"
 #endif
@@ -91,7 +95,9 @@
 
 #include "src/bcast/file_bcast.h"
 
+#include "src/slurmd/slurmd/bcast_cache.h"
 #include "src/slurmd/slurmd/get_mach_stat.h"
+#include "src/slurmd/slurmd/req.h"
 #include "src/slurmd/slurmd/slurmd.h"
 
 #include "src/slurmd/common/job_container_plugin.h"
@@ -189,6 +195,8 @@ static void _rpc_reconfig(slurm_msg_t *msg);
 static void _rpc_reboot(slurm_msg_t *msg);
 static void _rpc_pid2jid(slurm_msg_t *msg);
 static int  _rpc_file_bcast(slurm_msg_t *msg);
+static int  _rpc_file_bcast_cached(slurm_msg_t *msg);
+static time_t _stepd_shm_max_age(void);
 static void _file_bcast_cleanup(void);
 static int  _file_bcast_register_file(slurm_msg_t *msg,
 				      file_bcast_info_t *key);
@@ -277,6 +285,21 @@ static pthread_cond_t  file_bcast_cond  = PTHREAD_COND_INITIALIZER;
 static int fb_read_lock = 0, fb_write_wait_lock = 0, fb_write_lock = 0;
 static List file_bcast_list = NULL;
 
+/* Idle slurmstepd processes waiting for a launch request, see
+ * LaunchParameters=slurmstepd_pool */
+typedef struct {
+	int to_stepd;		/* write end of slurmstepd's stdin */
+	int to_slurmd;		/* read end of slurmstepd's stdout */
+} stepd_pool_ent_t;
+static pthread_mutex_t stepd_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static stepd_pool_ent_t *stepd_pool = NULL;
+static int stepd_pool_cnt = 0;		/* idle slurmstepd in stepd_pool */
+static int stepd_pool_size = 0;		/* size of stepd_pool array */
+static int stepd_pool_spawning = 0;	/* slurmstepd being started for it */
+static uint32_t stepd_pool_gen = 0;	/* incremented by stepd_pool_purge() */
+static uint32_t stepd_launch_cnt[2] = {0, 0};	/* new, pooled */
+static long stepd_launch_usec[2] = {0, 0};	/* new, pooled */
+
 void
 slurmd_req(slurm_msg_t *msg)
 {
@@ -292,6 +315,7 @@ slurmd_req(slurm_msg_t *msg)
 			job_limits_loaded = false;
 		}
 		slurm_mutex_unlock(&job_limits_mutex);
+		stepd_pool_purge();
 		return;
 	}
 
@@ -413,9 +437,14 @@ slurmd_req(slurm_msg_t *msg)
 		_rpc_pid2jid(msg);
 		break;
 	case REQUEST_FILE_BCAST:
+	case REQUEST_FILE_BCAST_PIPELINE:
 		rc = _rpc_file_bcast(msg);
 		slurm_send_rc_msg(msg, rc);
 		break;
+	case REQUEST_FILE_BCAST_CACHED:
+		rc = _rpc_file_bcast_cached(msg);
+		slurm_send_rc_msg(msg, rc);
+		break;
 	case REQUEST_STEP_COMPLETE:
 		(void) _rpc_step_complete(msg);
 		break;
@@ -717,261 +746,543 @@ rwfail:
 
 
 /*
- * Fork and exec the slurmstepd, then send the slurmstepd its
- * initialization data.  Then wait for slurmstepd to send an "ok"
- * message before returning.  When the "ok" message is received,
- * the slurmstepd has created and begun listening on its unix
- * domain socket.
- *
- * Note that this code forks twice and it is the grandchild that
- * becomes the slurmstepd process, so the slurmstepd's parent process
- * will be init, not slurmd.
+ * Exec the slurmstepd from a child of slurmd, with to_stepd and to_slurmd
+ * becoming its stdin and stdout. This forks again and it is the grandchild
+ * that becomes the slurmstepd process, so the slurmstepd's parent process
+ * will be init, not slurmd. Never returns.
  */
-static int
-_forkexec_slurmstepd(uint16_t type, void *req,
-		     slurm_addr_t *cli, slurm_addr_t *self,
-		     const hostset_t step_hset, uint16_t protocol_version)
+static void
+_exec_slurmstepd(uint16_t type, void *req, int to_stepd[2], int to_slurmd[2])
 {
+#if (SLURMSTEPD_MEMCHECK == 1)
+	/* memcheck test of slurmstepd, option #1 */
+	char *const argv[3] = {"memcheck",
+			       (char *)conf->stepd_loc, NULL};
+#elif (SLURMSTEPD_MEMCHECK == 2)
+	/* valgrind test of slurmstepd, option #2 */
+	uint32_t job_id = 0, step_id = 0;
+	char log_file[256];
+	char *const argv[13] = {"valgrind", "--tool=memcheck",
+				"--error-limit=no",
+				"--leak-check=summary",
+				"--show-reachable=yes",
+				"--max-stackframe=16777216",
+				"--num-callers=20",
+				"--child-silent-after-fork=yes",
+				"--track-origins=yes",
+				log_file, (char *)conf->stepd_loc,
+				NULL};
+	if (type == LAUNCH_BATCH_JOB) {
+		job_id = ((batch_job_launch_msg_t *)req)->job_id;
+		step_id = ((batch_job_launch_msg_t *)req)->step_id;
+	} else if (type == LAUNCH_TASKS) {
+		job_id = ((launch_tasks_request_msg_t *)req)->job_id;
+		step_id = ((launch_tasks_request_msg_t *)req)->job_step_id;
+	}
+	snprintf(log_file, sizeof(log_file),
+		 "--log-file=/tmp/slurmstepd_valgrind_%u.%u",
+		 job_id, step_id);
+#elif (SLURMSTEPD_MEMCHECK == 3)
+	/* valgrind/drd test of slurmstepd, option #3 */
+	uint32_t job_id = 0, step_id = 0;
+	char log_file[256];
+	char *const argv[10] = {"valgrind", "--tool=drd",
+				"--error-limit=no",
+				"--max-stackframe=16777216",
+				"--num-callers=20",
+				"--child-silent-after-fork=yes",
+				log_file, (char *)conf->stepd_loc,
+				NULL};
+	if (type == LAUNCH_BATCH_JOB) {
+		job_id = ((batch_job_launch_msg_t *)req)->job_id;
+		step_id = ((batch_job_launch_msg_t *)req)->step_id;
+	} else if (type == LAUNCH_TASKS) {
+		job_id = ((launch_tasks_request_msg_t *)req)->job_id;
+		step_id = ((launch_tasks_request_msg_t *)req)->job_step_id;
+	}
+	snprintf(log_file, sizeof(log_file),
+		 "--log-file=/tmp/slurmstepd_valgrind_%u.%u",
+		 job_id, step_id);
+#elif (SLURMSTEPD_MEMCHECK == 4)
+	/* valgrind/helgrind test of slurmstepd, option #4 */
+	uint32_t job_id = 0, step_id = 0;
+	char log_file[256];
+	char *const argv[10] = {"valgrind", "--tool=helgrind",
+				"--error-limit=no",
+				"--max-stackframe=16777216",
+				"--num-callers=20",
+				"--child-silent-after-fork=yes",
+				log_file, (char *)conf->stepd_loc,
+				NULL};
+	if (type == LAUNCH_BATCH_JOB) {
+		job_id = ((batch_job_launch_msg_t *)req)->job_id;
+		step_id = ((batch_job_launch_msg_t *)req)->step_id;
+	} else if (type == LAUNCH_TASKS) {
+		job_id = ((launch_tasks_request_msg_t *)req)->job_id;
+		step_id = ((launch_tasks_request_msg_t *)req)->job_step_id;
+	}
+	snprintf(log_file, sizeof(log_file),
+		 "--log-file=/tmp/slurmstepd_valgrind_%u.%u",
+		 job_id, step_id);
+#else
+	/* no memory checking, default */
+	char *const argv[2] = { (char *)conf->stepd_loc, NULL};
+#endif
+	int i;
+	int failed = 0;
 	pid_t pid;
-	int to_stepd[2] = {-1, -1};
-	int to_slurmd[2] = {-1, -1};
+	/* inform slurmstepd about our config */
+	setenv("SLURM_CONF", conf->conffile, 1);
 
-	if (pipe(to_stepd) < 0 || pipe(to_slurmd) < 0) {
-		error("_forkexec_slurmstepd pipe failed: %m");
-		return SLURM_FAILURE;
+	/*
+	 * Child forks and exits
+	 */
+	if (setsid() < 0) {
+		error("%s: setsid: %m", __func__);
+		failed = 1;
+	}
+	if ((pid = fork()) < 0) {
+		error("%s: Unable to fork grandchild: %m", __func__);
+		failed = 2;
+	} else if (pid > 0) { /* child */
+		exit(0);
 	}
 
-	if (_add_starting_step(type, req)) {
-		error("_forkexec_slurmstepd failed in _add_starting_step: %m");
-		return SLURM_FAILURE;
+	/*
+	 * Just incase we (or someone we are linking to)
+	 * opened a file and didn't do a close on exec.  This
+	 * is needed mostly to protect us against libs we link
+	 * to that don't set the flag as we should already be
+	 * setting it for those that we open.  The number 256
+	 * is an arbitrary number based off test7.9.
+	 */
+	for (i=3; i<256; i++) {
+		(void) fcntl(i, F_SETFD, FD_CLOEXEC);
 	}
 
-	if ((pid = fork()) < 0) {
-		error("_forkexec_slurmstepd: fork: %m");
-		close(to_stepd[0]);
-		close(to_stepd[1]);
-		close(to_slurmd[0]);
-		close(to_slurmd[1]);
-		_remove_starting_step(type, req);
-		return SLURM_FAILURE;
-	} else if (pid > 0) {
-		int rc = SLURM_SUCCESS;
-#if (SLURMSTEPD_MEMCHECK == 0)
-		int i;
-		time_t start_time = time(NULL);
-#endif
-		/*
-		 * Parent sends initialization data to the slurmstepd
-		 * over the to_stepd pipe, and waits for the return code
-		 * reply on the to_slurmd pipe.
-		 */
-		if (close(to_stepd[0]) < 0)
-			error("Unable to close read to_stepd in parent: %m");
-		if (close(to_slurmd[1]) < 0)
-			error("Unable to close write to_slurmd in parent: %m");
-
-		if ((rc = _send_slurmstepd_init(to_stepd[1], type,
-						req, cli, self,
-						step_hset,
-						protocol_version)) != 0) {
-			error("Unable to init slurmstepd");
-			goto done;
-		}
+	/*
+	 * Grandchild exec's the slurmstepd
+	 *
+	 * If the slurmd is being shutdown/restarted before
+	 * the pipe happens the old conf->lfd could be reused
+	 * and if we close it the dup2 below will fail.
+	 */
+	if ((to_stepd[0] != conf->lfd)
+	    && (to_slurmd[1] != conf->lfd))
+		slurm_shutdown_msg_engine(conf->lfd);
+
+	if (close(to_stepd[1]) < 0)
+		error("close write to_stepd in grandchild: %m");
+	if (close(to_slurmd[0]) < 0)
+		error("close read to_slurmd in parent: %m");
+
+	(void) close(STDIN_FILENO); /* ignore return */
+	if (dup2(to_stepd[0], STDIN_FILENO) == -1) {
+		error("dup2 over STDIN_FILENO: %m");
+		exit(1);
+	}
+	fd_set_close_on_exec(to_stepd[0]);
+	(void) close(STDOUT_FILENO); /* ignore return */
+	if (dup2(to_slurmd[1], STDOUT_FILENO) == -1) {
+		error("dup2 over STDOUT_FILENO: %m");
+		exit(1);
+	}
+	fd_set_close_on_exec(to_slurmd[1]);
+	(void) close(STDERR_FILENO); /* ignore return */
+	if (dup2(devnull, STDERR_FILENO) == -1) {
+		error("dup2 /dev/null to STDERR_FILENO: %m");
+		exit(1);
+	}
+	fd_set_noclose_on_exec(STDERR_FILENO);
+	log_fini();
+	if (!failed) {
+		if (conf->chos_loc && !access(conf->chos_loc, X_OK))
+			execvp(conf->chos_loc, argv);
+		else
+			execvp(argv[0], argv);
+		error("exec of slurmstepd failed: %m");
+	}
+	exit(2);
+}
 
-		/* If running under valgrind/memcheck, this pipe doesn't work
-		 * correctly so just skip it. */
+/*
+ * Send a slurmstepd its initialization data, then wait for it to send an
+ * "ok" message. When the "ok" message is received, the slurmstepd has
+ * created and begun listening on its unix domain socket.
+ * IN to_stepd, to_slurmd - slurmd's ends of the slurmstepd's stdin/stdout
+ * OUT sent - set if the initialization data was delivered
+ * RET the slurmstepd's return code
+ */
+static int
+_slurmstepd_init_wait(int to_stepd, int to_slurmd, uint16_t type, void *req,
+		      slurm_addr_t *cli, slurm_addr_t *self,
+		      const hostset_t step_hset, uint16_t protocol_version,
+		      bool *sent)
+{
+	int rc = SLURM_SUCCESS;
 #if (SLURMSTEPD_MEMCHECK == 0)
-		i = read(to_slurmd[0], &rc, sizeof(int));
-		if (i < 0) {
-			error("%s: Can not read return code from slurmstepd "
-			      "got %d: %m", __func__, i);
-			rc = SLURM_FAILURE;
-		} else if (i != sizeof(int)) {
-			error("%s: slurmstepd failed to send return code "
-			      "got %d: %m", __func__, i);
-			rc = SLURM_FAILURE;
-		} else {
-			int delta_time = time(NULL) - start_time;
-			int cc;
-			if (delta_time > 5) {
-				info("Warning: slurmstepd startup took %d sec, "
-				     "possible file system problem or full "
-				     "memory", delta_time);
-			}
-			if (rc != SLURM_SUCCESS)
-				error("slurmstepd return code %d", rc);
-
-			cc = SLURM_SUCCESS;
-			cc = write(to_stepd[1], &cc, sizeof(int));
-			if (cc != sizeof(int)) {
-				error("%s: failed to send ack to stepd %d: %m",
-				      __func__, cc);
-			}
-		}
+	int i;
+	time_t start_time = time(NULL);
 #endif
-	done:
-		if (_remove_starting_step(type, req))
-			error("Error cleaning up starting_step list");
 
-		/* Reap child */
-		if (waitpid(pid, NULL, 0) < 0)
-			error("Unable to reap slurmd child process");
-		if (close(to_stepd[1]) < 0)
-			error("close write to_stepd in parent: %m");
-		if (close(to_slurmd[0]) < 0)
-			error("close read to_slurmd in parent: %m");
+	*sent = false;
+	if ((rc = _send_slurmstepd_init(to_stepd, type, req, cli, self,
+					step_hset, protocol_version)) != 0) {
+		error("Unable to init slurmstepd");
 		return rc;
+	}
+	*sent = true;
+
+	/* If running under valgrind/memcheck, this pipe doesn't work
+	 * correctly so just skip it. */
+#if (SLURMSTEPD_MEMCHECK == 0)
+	i = read(to_slurmd, &rc, sizeof(int));
+	if (i < 0) {
+		error("%s: Can not read return code from slurmstepd "
+		      "got %d: %m", __func__, i);
+		rc = SLURM_FAILURE;
+	} else if (i != sizeof(int)) {
+		error("%s: slurmstepd failed to send return code "
+		      "got %d: %m", __func__, i);
+		rc = SLURM_FAILURE;
 	} else {
-#if (SLURMSTEPD_MEMCHECK == 1)
-		/* memcheck test of slurmstepd, option #1 */
-		char *const argv[3] = {"memcheck",
-				       (char *)conf->stepd_loc, NULL};
-#elif (SLURMSTEPD_MEMCHECK == 2)
-		/* valgrind test of slurmstepd, option #2 */
-		uint32_t job_id = 0, step_id = 0;
-		char log_file[256];
-		char *const argv[13] = {"valgrind", "--tool=memcheck",
-					"--error-limit=no",
-					"--leak-check=summary",
-					"--show-reachable=yes",
-					"--max-stackframe=16777216",
-					"--num-callers=20",
-					"--child-silent-after-fork=yes",
-					"--track-origins=yes",
-					log_file, (char *)conf->stepd_loc,
-					NULL};
-		if (type == LAUNCH_BATCH_JOB) {
-			job_id = ((batch_job_launch_msg_t *)req)->job_id;
-			step_id = ((batch_job_launch_msg_t *)req)->step_id;
-		} else if (type == LAUNCH_TASKS) {
-			job_id = ((launch_tasks_request_msg_t *)req)->job_id;
-			step_id = ((launch_tasks_request_msg_t *)req)->job_step_id;
-		}
-		snprintf(log_file, sizeof(log_file),
-			 "--log-file=/tmp/slurmstepd_valgrind_%u.%u",
-			 job_id, step_id);
-#elif (SLURMSTEPD_MEMCHECK == 3)
-		/* valgrind/drd test of slurmstepd, option #3 */
-		uint32_t job_id = 0, step_id = 0;
-		char log_file[256];
-		char *const argv[10] = {"valgrind", "--tool=drd",
-					"--error-limit=no",
-					"--max-stackframe=16777216",
-					"--num-callers=20",
-					"--child-silent-after-fork=yes",
-					log_file, (char *)conf->stepd_loc,
-					NULL};
-		if (type == LAUNCH_BATCH_JOB) {
-			job_id = ((batch_job_launch_msg_t *)req)->job_id;
-			step_id = ((batch_job_launch_msg_t *)req)->step_id;
-		} else if (type == LAUNCH_TASKS) {
-			job_id = ((launch_tasks_request_msg_t *)req)->job_id;
-			step_id = ((launch_tasks_request_msg_t *)req)->job_step_id;
+		int delta_time = time(NULL) - start_time;
+		int cc;
+		if (delta_time > 5) {
+			info("Warning: slurmstepd startup took %d sec, "
+			     "possible file system problem or full "
+			     "memory", delta_time);
 		}
-		snprintf(log_file, sizeof(log_file),
-			 "--log-file=/tmp/slurmstepd_valgrind_%u.%u",
-			 job_id, step_id);
-#elif (SLURMSTEPD_MEMCHECK == 4)
-		/* valgrind/helgrind test of slurmstepd, option #4 */
-		uint32_t job_id = 0, step_id = 0;
-		char log_file[256];
-		char *const argv[10] = {"valgrind", "--tool=helgrind",
-					"--error-limit=no",
-					"--max-stackframe=16777216",
-					"--num-callers=20",
-					"--child-silent-after-fork=yes",
-					log_file, (char *)conf->stepd_loc,
-					NULL};
-		if (type == LAUNCH_BATCH_JOB) {
-			job_id = ((batch_job_launch_msg_t *)req)->job_id;
-			step_id = ((batch_job_launch_msg_t *)req)->step_id;
-		} else if (type == LAUNCH_TASKS) {
-			job_id = ((launch_tasks_request_msg_t *)req)->job_id;
-			step_id = ((launch_tasks_request_msg_t *)req)->job_step_id;
+		if (rc != SLURM_SUCCESS)
+			error("slurmstepd return code %d", rc);
+
+		cc = SLURM_SUCCESS;
+		cc = write(to_stepd, &cc, sizeof(int));
+		if (cc != sizeof(int)) {
+			error("%s: failed to send ack to stepd %d: %m",
+			      __func__, cc);
 		}
-		snprintf(log_file, sizeof(log_file),
-			 "--log-file=/tmp/slurmstepd_valgrind_%u.%u",
-			 job_id, step_id);
+	}
+#endif
+	return rc;
+}
+
+/*
+ * Create a pipe with both ends closed on exec, so that a slurmstepd forked
+ * by another thread meanwhile does not inherit them. The slurmstepd's own
+ * ends are dup2()'ed onto its stdin and stdout, which clears the flag.
+ */
+static int
+_pipe_cloexec(int fds[2])
+{
+#if defined(__linux__) && defined(O_CLOEXEC)
+	return pipe2(fds, O_CLOEXEC);
 #else
-		/* no memory checking, default */
-		char *const argv[2] = { (char *)conf->stepd_loc, NULL};
+	if (pipe(fds) < 0)
+		return -1;
+	fd_set_close_on_exec(fds[0]);
+	fd_set_close_on_exec(fds[1]);
+	return 0;
 #endif
-		int i;
-		int failed = 0;
-		/* inform slurmstepd about our config */
-		setenv("SLURM_CONF", conf->conffile, 1);
+}
 
-		/*
-		 * Child forks and exits
-		 */
-		if (setsid() < 0) {
-			error("_forkexec_slurmstepd: setsid: %m");
-			failed = 1;
+#if (SLURMSTEPD_MEMCHECK == 0)
+/*
+ * Start an idle slurmstepd for the pool. It loads its plugins and then
+ * blocks reading its initialization data until handed a launch request.
+ */
+static int
+_stepd_pool_spawn(stepd_pool_ent_t *ent)
+{
+	pid_t pid;
+	int to_stepd[2] = {-1, -1};
+	int to_slurmd[2] = {-1, -1};
+
+	if ((_pipe_cloexec(to_stepd) < 0) || (_pipe_cloexec(to_slurmd) < 0)) {
+		error("%s: pipe failed: %m", __func__);
+		goto fail;
+	}
+	if ((pid = fork()) < 0) {
+		error("%s: fork: %m", __func__);
+		goto fail;
+	} else if (pid == 0) {
+		_exec_slurmstepd(0, NULL, to_stepd, to_slurmd);
+	}
+
+	if (close(to_stepd[0]) < 0)
+		error("Unable to close read to_stepd in parent: %m");
+	if (close(to_slurmd[1]) < 0)
+		error("Unable to close write to_slurmd in parent: %m");
+	if (waitpid(pid, NULL, 0) < 0)
+		error("Unable to reap slurmd child process");
+	ent->to_stepd  = to_stepd[1];
+	ent->to_slurmd = to_slurmd[0];
+	return SLURM_SUCCESS;
+
+fail:
+	if (to_stepd[0] >= 0) {
+		(void) close(to_stepd[0]);
+		(void) close(to_stepd[1]);
+	}
+	if (to_slurmd[0] >= 0) {
+		(void) close(to_slurmd[0]);
+		(void) close(to_slurmd[1]);
+	}
+	return SLURM_ERROR;
+}
+
+/*
+ * Start idle slurmstepd processes until the pool holds conf->stepd_pool_size
+ * of them. They are forked without holding stepd_pool_mutex, so that
+ * launches can take a pooled slurmstepd meanwhile.
+ */
+static void
+_stepd_pool_fill(void)
+{
+	stepd_pool_ent_t ent;
+	uint32_t gen;
+	int need;
+	bool keep;
+
+	slurm_mutex_lock(&stepd_pool_mutex);
+	need = conf->stepd_pool_size - stepd_pool_cnt - stepd_pool_spawning;
+	if (need <= 0) {
+		slurm_mutex_unlock(&stepd_pool_mutex);
+		return;
+	}
+	stepd_pool_spawning += need;
+	gen = stepd_pool_gen;
+	slurm_mutex_unlock(&stepd_pool_mutex);
+
+	while (need > 0) {
+		if (_stepd_pool_spawn(&ent))
+			break;
+		need--;
+
+		/* Keep it unless the pool was purged or filled meanwhile */
+		keep = false;
+		slurm_mutex_lock(&stepd_pool_mutex);
+		if (gen == stepd_pool_gen) {
+			stepd_pool_spawning--;
+			if (stepd_pool_cnt < conf->stepd_pool_size) {
+				if (stepd_pool_cnt >= stepd_pool_size) {
+					stepd_pool_size = conf->stepd_pool_size;
+					xrealloc(stepd_pool,
+						 sizeof(stepd_pool_ent_t) *
+						 stepd_pool_size);
+				}
+				stepd_pool[stepd_pool_cnt++] = ent;
+				keep = true;
+			}
 		}
-		if ((pid = fork()) < 0) {
-			error("_forkexec_slurmstepd: "
-			      "Unable to fork grandchild: %m");
-			failed = 2;
-		} else if (pid > 0) { /* child */
-			exit(0);
+		slurm_mutex_unlock(&stepd_pool_mutex);
+		if (!keep) {
+			(void) close(ent.to_stepd);
+			(void) close(ent.to_slurmd);
 		}
+	}
 
-		/*
-		 * Just incase we (or someone we are linking to)
-		 * opened a file and didn't do a close on exec.  This
-		 * is needed mostly to protect us against libs we link
-		 * to that don't set the flag as we should already be
-		 * setting it for those that we open.  The number 256
-		 * is an arbitrary number based off test7.9.
-		 */
-		for (i=3; i<256; i++) {
-			(void) fcntl(i, F_SETFD, FD_CLOEXEC);
+	if (need > 0) {
+		slurm_mutex_lock(&stepd_pool_mutex);
+		if (gen == stepd_pool_gen)
+			stepd_pool_spawning -= need;
+		slurm_mutex_unlock(&stepd_pool_mutex);
+	}
+}
+
+/*
+ * Take an idle slurmstepd from the pool, skipping any which have exited.
+ * RET true if to_stepd and to_slurmd were set to its stdin/stdout pipes
+ */
+static bool
+_stepd_pool_get(int *to_stepd, int *to_slurmd)
+{
+	struct pollfd pfd;
+	bool found = false;
+
+	slurm_mutex_lock(&stepd_pool_mutex);
+	while (stepd_pool_cnt > 0) {
+		stepd_pool_cnt--;
+		*to_stepd  = stepd_pool[stepd_pool_cnt].to_stepd;
+		*to_slurmd = stepd_pool[stepd_pool_cnt].to_slurmd;
+
+		/* An idle slurmstepd writes nothing, so anything to read
+		 * on its stdout means it has exited */
+		pfd.fd = *to_slurmd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, 0) == 0) {
+			found = true;
+			break;
 		}
+		debug("%s: discarding exited slurmstepd", __func__);
+		(void) close(*to_stepd);
+		(void) close(*to_slurmd);
+	}
+	slurm_mutex_unlock(&stepd_pool_mutex);
 
-		/*
-		 * Grandchild exec's the slurmstepd
-		 *
-		 * If the slurmd is being shutdown/restarted before
-		 * the pipe happens the old conf->lfd could be reused
-		 * and if we close it the dup2 below will fail.
-		 */
-		if ((to_stepd[0] != conf->lfd)
-		    && (to_slurmd[1] != conf->lfd))
-			slurm_shutdown_msg_engine(conf->lfd);
+	return found;
+}
+#endif
 
+/*
+ * Close the pipes to all idle slurmstepd processes, which then exit.
+ * Called on reconfiguration, so the pool is refilled with slurmstepd
+ * processes started with the new configuration.
+ */
+extern void stepd_pool_purge(void)
+{
+	int i;
+
+	slurm_mutex_lock(&stepd_pool_mutex);
+	for (i = 0; i < stepd_pool_cnt; i++) {
+		(void) close(stepd_pool[i].to_stepd);
+		(void) close(stepd_pool[i].to_slurmd);
+	}
+	stepd_pool_cnt = 0;
+	stepd_pool_size = 0;
+	xfree(stepd_pool);
+	/* slurmstepd still being started were started with the old
+	 * configuration, _stepd_pool_fill() discards them */
+	stepd_pool_spawning = 0;
+	stepd_pool_gen++;
+	slurm_mutex_unlock(&stepd_pool_mutex);
+}
+
+/*
+ * Start idle slurmstepd processes until the pool is full, so that the first
+ * launches after slurmd starts or is reconfigured do not fork one.
+ */
+extern void stepd_pool_fill(void)
+{
+#if (SLURMSTEPD_MEMCHECK == 0)
+	_stepd_pool_fill();
+#endif
+}
+
+/* Log the time taken from the start of a launch request until the
+ * slurmstepd is ready to launch the tasks */
+static void
+_log_stepd_launch_time(uint16_t type, void *req, bool pooled, long usec)
+{
+	uint32_t job_id = 0, step_id = 0;
+	uint32_t cnt;
+	long avg;
+
+	if (type == LAUNCH_BATCH_JOB) {
+		job_id = ((batch_job_launch_msg_t *)req)->job_id;
+		step_id = ((batch_job_launch_msg_t *)req)->step_id;
+	} else if (type == LAUNCH_TASKS) {
+		job_id = ((launch_tasks_request_msg_t *)req)->job_id;
+		step_id = ((launch_tasks_request_msg_t *)req)->job_step_id;
+	}
+
+	slurm_mutex_lock(&stepd_pool_mutex);
+	stepd_launch_cnt[pooled]++;
+	stepd_launch_usec[pooled] += usec;
+	cnt = stepd_launch_cnt[pooled];
+	avg = stepd_launch_usec[pooled] / cnt;
+	slurm_mutex_unlock(&stepd_pool_mutex);
+
+	debug("slurmstepd for %u.%u ready in %ld usec (%s), average "
+	      "%ld usec over %u launches", job_id, step_id, usec,
+	      pooled ? "pooled" : "new", avg, cnt);
+}
+
+/*
+ * Start a slurmstepd for a batch job or job step, send the slurmstepd its
+ * initialization data and wait for it to report back. An idle slurmstepd
+ * from the pool is used if available, otherwise a new one is forked and
+ * exec'ed.
+ */
+static int
+_forkexec_slurmstepd(uint16_t type, void *req,
+		     slurm_addr_t *cli, slurm_addr_t *self,
+		     const hostset_t step_hset, uint16_t protocol_version)
+{
+	pid_t pid;
+	int to_stepd[2] = {-1, -1};
+	int to_slurmd[2] = {-1, -1};
+	int rc = SLURM_SUCCESS;
+	bool sent;
+	DEF_TIMERS;
+
+	if (_add_starting_step(type, req)) {
+		error("_forkexec_slurmstepd failed in _add_starting_step: %m");
+		return SLURM_FAILURE;
+	}
+	START_TIMER;
+
+#if (SLURMSTEPD_MEMCHECK == 0)
+	while (_stepd_pool_get(&to_stepd[1], &to_slurmd[0])) {
+		rc = _slurmstepd_init_wait(to_stepd[1], to_slurmd[0], type,
+					   req, cli, self, step_hset,
+					   protocol_version, &sent);
 		if (close(to_stepd[1]) < 0)
-			error("close write to_stepd in grandchild: %m");
+			error("close write to_stepd in parent: %m");
 		if (close(to_slurmd[0]) < 0)
 			error("close read to_slurmd in parent: %m");
-
-		(void) close(STDIN_FILENO); /* ignore return */
-		if (dup2(to_stepd[0], STDIN_FILENO) == -1) {
-			error("dup2 over STDIN_FILENO: %m");
-			exit(1);
-		}
-		fd_set_close_on_exec(to_stepd[0]);
-		(void) close(STDOUT_FILENO); /* ignore return */
-		if (dup2(to_slurmd[1], STDOUT_FILENO) == -1) {
-			error("dup2 over STDOUT_FILENO: %m");
-			exit(1);
-		}
-		fd_set_close_on_exec(to_slurmd[1]);
-		(void) close(STDERR_FILENO); /* ignore return */
-		if (dup2(devnull, STDERR_FILENO) == -1) {
-			error("dup2 /dev/null to STDERR_FILENO: %m");
-			exit(1);
-		}
-		fd_set_noclose_on_exec(STDERR_FILENO);
-		log_fini();
-		if (!failed) {
-			if (conf->chos_loc && !access(conf->chos_loc, X_OK))
-				execvp(conf->chos_loc, argv);
-			else
-				execvp(argv[0], argv);
-			error("exec of slurmstepd failed: %m");
+		if (sent || (rc != EPIPE)) {
+			END_TIMER;
+			_log_stepd_launch_time(type, req, true, DELTA_TIMER);
+			if (_remove_starting_step(type, req))
+				error("Error cleaning up starting_step list");
+			_stepd_pool_fill();
+			return rc;
 		}
-		exit(2);
+		/* The pooled slurmstepd exited, try another */
+	}
+#endif
+
+	if ((_pipe_cloexec(to_stepd) < 0) || (_pipe_cloexec(to_slurmd) < 0)) {
+		error("_forkexec_slurmstepd pipe failed: %m");
+		_remove_starting_step(type, req);
+		return SLURM_FAILURE;
 	}
+
+	if ((pid = fork()) < 0) {
+		error("_forkexec_slurmstepd: fork: %m");
+		close(to_stepd[0]);
+		close(to_stepd[1]);
+		close(to_slurmd[0]);
+		close(to_slurmd[1]);
+		_remove_starting_step(type, req);
+		return SLURM_FAILURE;
+	} else if (pid == 0) {
+		_exec_slurmstepd(type, req, to_stepd, to_slurmd);
+	}
+
+	/*
+	 * Parent sends initialization data to the slurmstepd
+	 * over the to_stepd pipe, and waits for the return code
+	 * reply on the to_slurmd pipe.
+	 */
+	if (close(to_stepd[0]) < 0)
+		error("Unable to close read to_stepd in parent: %m");
+	if (close(to_slurmd[1]) < 0)
+		error("Unable to close write to_slurmd in parent: %m");
+
+	rc = _slurmstepd_init_wait(to_stepd[1], to_slurmd[0], type, req,
+				   cli, self, step_hset, protocol_version,
+				   &sent);
+	END_TIMER;
+	if (sent)
+		_log_stepd_launch_time(type, req, false, DELTA_TIMER);
+
+	if (_remove_starting_step(type, req))
+		error("Error cleaning up starting_step list");
+
+	/* Reap child */
+	if (waitpid(pid, NULL, 0) < 0)
+		error("Unable to reap slurmd child process");
+	if (close(to_stepd[1]) < 0)
+		error("close write to_stepd in parent: %m");
+	if (close(to_slurmd[0]) < 0)
+		error("close read to_slurmd in parent: %m");
+#if (SLURMSTEPD_MEMCHECK == 0)
+	_stepd_pool_fill();
+#endif
+	return rc;
 }
 
 
@@ -2563,7 +2874,8 @@ _enforce_job_mem_limit(void)
 	ListIterator step_iter, job_limits_iter;
 	job_mem_limits_t *job_limits_ptr;
 	step_loc_t *stepd;
-	int fd, i, job_inx, job_cnt;
+	int fd, i, job_inx, job_cnt, rc;
+	uid_t uid;
 	uint16_t vsize_factor;
 	uint64_t step_rss, step_vsize;
 	job_step_id_msg_t acct_req;
@@ -2634,19 +2946,27 @@ _enforce_job_mem_limit(void)
 		if (job_inx >= job_cnt)
 			continue;	/* job/step not being tracked */
 
-		fd = stepd_connect(stepd->directory, stepd->nodename,
-				   stepd->jobid, stepd->stepid,
-				   &stepd->protocol_version);
-		if (fd == -1)
-			continue;	/* step completed */
-		acct_req.job_id  = stepd->jobid;
-		acct_req.step_id = stepd->stepid;
 		resp = xmalloc(sizeof(job_step_stat_t));
+		fd = -1;
+		rc = SLURM_SUCCESS;
+		if (!_stepd_shm_max_age() ||
+		    stepd_shm_stat(stepd->directory, stepd->nodename,
+				   stepd->jobid, stepd->stepid,
+				   _stepd_shm_max_age(), &uid, resp)) {
+			fd = stepd_connect(stepd->directory, stepd->nodename,
+					   stepd->jobid, stepd->stepid,
+					   &stepd->protocol_version);
+			if (fd == -1) {
+				slurm_free_job_step_stat(resp);
+				continue;	/* step completed */
+			}
+			acct_req.job_id  = stepd->jobid;
+			acct_req.step_id = stepd->stepid;
+			rc = stepd_stat_jobacct(fd, stepd->protocol_version,
+						&acct_req, resp);
+		}
 
-		if ((!stepd_stat_jobacct(
-			     fd, stepd->protocol_version,
-			     &acct_req, resp)) &&
-		    (resp->jobacct)) {
+		if ((rc == SLURM_SUCCESS) && (resp->jobacct)) {
 			/* resp->jobacct is NULL if account is disabled */
 			jobacctinfo_getinfo((struct jobacctinfo *)
 					    resp->jobacct,
@@ -2671,7 +2991,8 @@ _enforce_job_mem_limit(void)
 			job_mem_info_ptr[job_inx].vsize_used += step_vsize;
 		}
 		slurm_free_job_step_stat(resp);
-		close(fd);
+		if (fd >= 0)
+			close(fd);
 	}
 	list_iterator_destroy(step_iter);
 	FREE_NULL_LIST(steps);
@@ -3268,6 +3589,15 @@ _rpc_daemon_status(slurm_msg_t *msg)
 	return SLURM_SUCCESS;
 }
 
+/* Seconds after which the state published by a slurmstepd is stale,
+ * zero if tasks are not polled */
+static time_t _stepd_shm_max_age(void)
+{
+	if (!conf->acct_freq_task || (conf->acct_freq_task == (uint16_t)NO_VAL))
+		return 0;
+	return 2 * conf->acct_freq_task;
+}
+
 static int
 _rpc_stat_jobacct(slurm_msg_t *msg)
 {
@@ -3283,6 +3613,33 @@ _rpc_stat_jobacct(slurm_msg_t *msg)
 	   so only root or SlurmUser is allowed here */
 	req_uid = g_slurm_auth_get_uid(msg->auth_cred, conf->auth_info);
 
+	/* Use the data published by the slurmstepd after its last poll
+	 * if recent, rather than have it poll again for us */
+	resp = xmalloc(sizeof(job_step_stat_t));
+	resp->step_pids = xmalloc(sizeof(job_step_pids_t));
+	resp->step_pids->node_name = xstrdup(conf->node_name);
+	resp->return_code = SLURM_SUCCESS;
+	if (_stepd_shm_max_age() &&
+	    (stepd_shm_stat(conf->spooldir, conf->node_name, req->job_id,
+			    req->step_id, _stepd_shm_max_age(), &uid, resp) ==
+	     SLURM_SUCCESS)) {
+		if ((req_uid != uid) && (!_slurm_authorized_user(req_uid))) {
+			error("stat_jobacct from uid %ld for job %u "
+			      "owned by uid %ld",
+			      (long) req_uid, req->job_id, (long) uid);
+			slurm_free_job_step_stat(resp);
+			slurm_send_rc_msg(msg, ESLURM_USER_ID_MISSING);
+			return ESLURM_USER_ID_MISSING;
+		}
+		slurm_msg_t_copy(&resp_msg, msg);
+		resp_msg.msg_type     = RESPONSE_JOB_STEP_STAT;
+		resp_msg.data         = resp;
+		slurm_send_node_msg(msg->conn_fd, &resp_msg);
+		slurm_free_job_step_stat(resp);
+		return SLURM_SUCCESS;
+	}
+	slurm_free_job_step_stat(resp);
+
 	fd = stepd_connect(conf->spooldir, conf->node_name,
 			   req->job_id, req->step_id, &protocol_version);
 	if (fd == -1) {
@@ -3746,6 +4103,7 @@ static void _file_bcast_close_file(file_bcast_info_t *key)
 
 static void _free_file_bcast_info_t(file_bcast_info_t *f)
 {
+	bcast_cache_finish(f->cache, f->complete);
 	xfree(f->fname);
 	if (f->fd)
 		close(f->fd);
@@ -3784,14 +4142,62 @@ void file_bcast_init(void)
 
 void file_bcast_purge(void)
 {
+	bcast_cache_fini();
 	_fb_wrlock();
 	list_destroy(file_bcast_list);
 	/* destroying list before exit, no need to unlock */
 }
 
+/*
+ * Return the file offset of a block. block_offset only holds 32 bits, but
+ * the blocks of a transfer arrive close to each other, so the high bits
+ * are taken from the furthest block written so far.
+ */
+static off_t _bcast_block_offset(file_bcast_info_t *file_info,
+				 uint32_t block_offset)
+{
+	uint64_t last, offset;
+
+	slurm_mutex_lock(&file_bcast_mutex);
+	last = file_info->max_offset;
+	slurm_mutex_unlock(&file_bcast_mutex);
+
+	offset = (last & ~0xffffffffULL) | block_offset;
+	if ((offset > last + 0x80000000ULL) && (offset >= 0x100000000ULL))
+		offset -= 0x100000000ULL;
+	else if (offset + 0x80000000ULL < last)
+		offset += 0x100000000ULL;
+
+	return (off_t) offset;
+}
+
+/* Set the modes, owner and times of a completely written file */
+static void _file_bcast_set_attrs(file_bcast_msg_t *req,
+				  file_bcast_info_t *key, int fd)
+{
+	if (fchmod(fd, (req->modes & 0777))) {
+		error("sbcast: uid:%u can't chmod `%s`: %m",
+		      key->uid, key->fname);
+	}
+	if (fchown(fd, key->uid, key->gid)) {
+		error("sbcast: uid:%u gid:%u can't chown `%s`: %m",
+		      key->uid, key->gid, key->fname);
+	}
+	if (req->atime) {
+		struct utimbuf time_buf;
+		time_buf.actime  = req->atime;
+		time_buf.modtime = req->mtime;
+		if (utime(key->fname, &time_buf)) {
+			error("sbcast: uid:%u can't utime `%s`: %m",
+			      key->uid, key->fname);
+		}
+	}
+}
+
 static int _rpc_file_bcast(slurm_msg_t *msg)
 {
 	int rc, offset, inx;
+	off_t file_offset = -1;
 	file_bcast_info_t *file_info;
 	file_bcast_msg_t *req = msg->data;
 	file_bcast_info_t key;
@@ -3847,10 +4253,26 @@ static int _rpc_file_bcast(slurm_msg_t *msg)
 		return SLURM_FAILURE;
 	}
 
+	/*
+	 * Blocks may arrive out of order when sbcast pipelines the transfer,
+	 * so they are written at their own offset. sbcast only pipelines
+	 * after the first block was accepted as REQUEST_FILE_BCAST_PIPELINE,
+	 * which a slurmd writing blocks sequentially does not understand.
+	 * Older clients do not set the offset and send one block at a time.
+	 */
+	if (msg->protocol_version >= SLURM_16_05_PROTOCOL_VERSION)
+		file_offset = _bcast_block_offset(file_info,
+						  req->block_offset);
 	offset = 0;
 	while (req->block_len - offset) {
-		inx = write(file_info->fd, &req->block[offset],
-			    (req->block_len - offset));
+		if (file_offset >= 0) {
+			inx = pwrite(file_info->fd, &req->block[offset],
+				     (req->block_len - offset),
+				     file_offset + offset);
+		} else {
+			inx = write(file_info->fd, &req->block[offset],
+				    (req->block_len - offset));
+		}
 		if (inx == -1) {
 			if ((errno == EINTR) || (errno == EAGAIN))
 				continue;
@@ -3861,26 +4283,21 @@ static int _rpc_file_bcast(slurm_msg_t *msg)
 		}
 		offset += inx;
 	}
+	if (file_info->cache)
+		bcast_cache_write(file_info->cache, req->block, req->block_len,
+				  file_offset);
 
+	slurm_mutex_lock(&file_bcast_mutex);
+	if (file_offset >= 0)
+		file_info->max_offset = MAX(file_info->max_offset,
+					    file_offset + offset);
 	file_info->last_update = time(NULL);
+	if (req->last_block)
+		file_info->complete = true;
+	slurm_mutex_unlock(&file_bcast_mutex);
 
-	if (req->last_block && fchmod(file_info->fd, (req->modes & 0777))) {
-		error("sbcast: uid:%u can't chmod `%s`: %m",
-		      key.uid, key.fname);
-	}
-	if (req->last_block && fchown(file_info->fd, key.uid, key.gid)) {
-		error("sbcast: uid:%u gid:%u can't chown `%s`: %m",
-		      key.uid, key.gid, key.fname);
-	}
-	if (req->last_block && req->atime) {
-		struct utimbuf time_buf;
-		time_buf.actime  = req->atime;
-		time_buf.modtime = req->mtime;
-		if (utime(key.fname, &time_buf)) {
-			error("sbcast: uid:%u can't utime `%s`: %m",
-			      key.uid, key.fname);
-		}
-	}
+	if (req->last_block)
+		_file_bcast_set_attrs(req, &key, file_info->fd);
 
 	_fb_rdunlock();
 
@@ -3890,6 +4307,60 @@ static int _rpc_file_bcast(slurm_msg_t *msg)
 	return SLURM_SUCCESS;
 }
 
+/*
+ * Install a broadcast file from the sbcast cache. On a miss the file is
+ * expected to be added to the cache once sbcast has sent its data.
+ */
+static int _rpc_file_bcast_cached(slurm_msg_t *msg)
+{
+	int rc, cache_fd;
+	file_bcast_info_t *file_info;
+	file_bcast_msg_t *req = msg->data;
+	file_bcast_info_t key;
+
+	key.uid = g_slurm_auth_get_uid(msg->auth_cred, conf->auth_info);
+	key.gid = g_slurm_auth_get_gid(msg->auth_cred, conf->auth_info);
+	key.fname = req->fname;
+
+	rc = _valid_sbcast_cred(req, key.uid, req->block_no, &key.job_id);
+	if ((rc != SLURM_SUCCESS) && !_slurm_authorized_user(key.uid))
+		return rc;
+
+	if (!conf->sbcast_cache_size)
+		return ESLURM_NOT_SUPPORTED;
+	cache_fd = bcast_cache_open(key.uid, req->file_hash, req->file_size);
+	if (cache_fd < 0) {
+		debug("sbcast req_uid=%u job_id=%u fname=%s not cached",
+		      key.uid, key.job_id, key.fname);
+		bcast_cache_expect(req, key.uid, key.job_id);
+		return ENOENT;
+	}
+	info("sbcast req_uid=%u job_id=%u fname=%s from cache",
+	     key.uid, key.job_id, key.fname);
+
+	if ((rc = _file_bcast_register_file(msg, &key))) {
+		close(cache_fd);
+		return rc;
+	}
+
+	_fb_rdlock();
+	if (!(file_info = _bcast_lookup_file(&key))) {
+		error("No registered file transfer for uid %u file `%s`.",
+		      key.uid, key.fname);
+		rc = SLURM_ERROR;
+	} else if ((rc = bcast_cache_copy(cache_fd, file_info->fd))) {
+		error("sbcast: uid:%u can't write `%s`: %s",
+		      key.uid, key.fname, slurm_strerror(rc));
+	} else {
+		_file_bcast_set_attrs(req, &key, file_info->fd);
+	}
+	_fb_rdunlock();
+	close(cache_fd);
+
+	_file_bcast_close_file(&key);
+	return rc;
+}
+
 /* pass an open file descriptor back to the parent process */
 static void _send_back_fd(int socket, int fd)
 {
@@ -3994,6 +4465,11 @@ static int _file_bcast_register_file(slurm_msg_t *msg,
 		file_info->gid = key->gid;
 		file_info->job_id = key->job_id;
 		file_info->start_time = time(NULL);
+		/* a copy of data sent after a cache miss is cached */
+		if (msg->msg_type != REQUEST_FILE_BCAST_CACHED)
+			file_info->cache = bcast_cache_start(key->uid,
+							     key->job_id,
+							     req->fname);
 
 		//TODO: mmap the file here
 		_fb_wrlock();
@@ -4047,13 +4523,20 @@ static int _file_bcast_register_file(slurm_msg_t *msg,
 		exit(errno);
 	}
 
-	flags = O_WRONLY | O_CREAT;
+	/* Open for reading as well, so that the file can be added to the
+	 * sbcast cache once complete */
+	flags = O_RDWR | O_CREAT;
 	if (req->force)
 		flags |= O_TRUNC;
 	else
 		flags |= O_EXCL;
 
 	fd = open(key->fname, flags, 0700);
+	if ((fd == -1) && (errno == EACCES)) {
+		flags &= ~O_RDWR;
+		flags |= O_WRONLY;
+		fd = open(key->fname, flags, 0700);
+	}
 	if (fd == -1) {
 		error("sbcast: uid:%u can't open `%s`: %m",
 		      key->uid, key->fname);
@@ -54,6 +54,12 @@ void gids_cache_purge(void);
 /* Add record for every launched job so we know they are ready for suspend */
 extern void record_launched_jobs(void);
 
+/* Close the pipes to all idle slurmstepd processes, which then exit */
+extern void stepd_pool_purge(void);
+
+/* Start idle slurmstepd processes until the pool is full */
+extern void stepd_pool_fill(void);
+
 void file_bcast_init(void);
 void file_bcast_purge(void);
 
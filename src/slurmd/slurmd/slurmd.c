@@ -123,6 +123,8 @@
 
 #define MAX_THREADS		256
 
+#define MAX_STEPD_POOL		64	/* LaunchParameters=slurmstepd_pool */
+
 #define _free_and_set(__dst, __src) \
 	xfree(__dst); __dst = __src
 
@@ -459,6 +461,7 @@ _msg_engine(void)
 
 	msg_pthread = pthread_self();
 	slurmd_req(NULL);	/* initialize timer */
+	stepd_pool_fill();
 	while (!_shutdown) {
 		if (_reconfig) {
 			verbose("got reconfigure request");
@@ -809,6 +812,7 @@ _read_config(void)
 {
 	char *path_pubkey = NULL;
 	slurm_ctl_conf_t *cf = NULL;
+	char *tmp_ptr;
 	int cc;
 #ifndef HAVE_FRONT_END
 	bool cr_flag = false, gang_flag = false;
@@ -1029,6 +1033,22 @@ _read_config(void)
 		      xstrdup(cf->msg_aggr_params));
 	_set_msg_aggr_params();
 
+	conf->sbcast_cache_size = 0;
+	if (cf->launch_params &&
+	    (tmp_ptr = slurm_strcasestr(cf->launch_params,
+					"sbcast_cache="))) {
+		cc = atoi(tmp_ptr + 13);
+		conf->sbcast_cache_size = (uint64_t) MAX(cc, 0) * 1024 * 1024;
+	}
+
+	conf->stepd_pool_size = 0;
+	if (cf->launch_params &&
+	    (tmp_ptr = slurm_strcasestr(cf->launch_params,
+					"slurmstepd_pool="))) {
+		cc = atoi(tmp_ptr + 16);
+		conf->stepd_pool_size = MIN(MAX(cc, 0), MAX_STEPD_POOL);
+	}
+
 	if ( (conf->node_name == NULL) ||
 	     (conf->node_name[0] == '\0') )
 		fatal("Node name lookup failure");
@@ -1060,6 +1080,8 @@ _reconfigure(void)
 	_reconfig = 0;
 	slurm_conf_reinit(conf->conffile);
 	_read_config();
+	stepd_pool_purge();
+	stepd_pool_fill();
 
 	/*
 	 * Rebuild topology information and refresh slurmd topo infos
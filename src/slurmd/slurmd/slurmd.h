@@ -164,6 +164,10 @@ typedef struct slurmd_config {
 	char           *msg_aggr_params;      /* message aggregation params */
 	uint64_t        msg_aggr_window_msgs; /* msg aggr window size in msgs */
 	uint64_t        msg_aggr_window_time; /* msg aggr window size in time */
+	uint64_t	sbcast_cache_size; /* bytes of sbcast cache,
+					    * LaunchParameters=sbcast_cache */
+	uint16_t	stepd_pool_size; /* idle slurmstepd to keep ready,
+					  * LaunchParameters=slurmstepd_pool */
 	uint16_t	use_pam;
 	uint32_t	task_plugin_param; /* TaskPluginParams, expressed
 					 * using cpu_bind_type_t flags */
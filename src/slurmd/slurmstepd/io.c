@@ -67,6 +67,7 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
@@ -99,6 +100,13 @@ static bool _client_writable(eio_obj_t *);
 static int  _client_read(eio_obj_t *, List);
 static int  _client_write(eio_obj_t *, List);
 
+/* Most queued messages written to a client socket by one writev() */
+#define CLIENT_WRITE_IOV 64
+
+/* Most messages read from a task pipe without the cbuf by one _task_read()
+ * call, the same amount of data the cbuf can hold */
+#define TASK_READ_DIRECT_MSGS 4
+
 struct io_operations client_ops = {
 	.readable = &_client_readable,
 	.writable = &_client_writable,
@@ -216,8 +224,12 @@ static int _send_io_init_msg(int sock, srun_key_t *key, stepd_step_rec_t *job);
 static void _send_eof_msg(struct task_read_info *out);
 static struct io_buf *_task_build_message(struct task_read_info *out,
 					  stepd_step_rec_t *job, cbuf_t cbuf);
+static void _task_pack_header(struct task_read_info *out,
+			      struct io_buf *msg, int len);
 static void *_io_thr(void *arg);
 static void _route_msg_task_to_client(eio_obj_t *obj);
+static void _route_msg_to_clients(struct task_read_info *out,
+				  struct io_buf *msg);
 static void _free_outgoing_msg(struct io_buf *msg, stepd_step_rec_t *job);
 static void _free_incoming_msg(struct io_buf *msg, stepd_step_rec_t *job);
 static void _free_all_outgoing_msgs(List msg_queue, stepd_step_rec_t *job);
@@ -440,14 +452,18 @@ _client_read(eio_obj_t *obj, List objs)
 }
 
 /*
- * Write outgoing packed messages to the client socket.
+ * Write outgoing packed messages to the client socket. Every message
+ * queued for the client is gathered into a single writev(), so that a task
+ * producing a lot of output does not cost a system call per message.
  */
 static int
 _client_write(eio_obj_t *obj, List objs)
 {
 	struct client_io_info *client = (struct client_io_info *) obj->arg;
-	void *buf;
-	int n;
+	struct iovec iov[CLIENT_WRITE_IOV];
+	struct io_buf *msg;
+	ListIterator msgs;
+	int iovcnt = 1, n;
 
 	xassert(client->magic == CLIENT_IO_MAGIC);
 
@@ -471,12 +487,25 @@ _client_write(eio_obj_t *obj, List objs)
 	debug5("  client->out_remaining = %d", client->out_remaining);
 
 	/*
-	 * Write message to socket.
+	 * Gather the rest of the current message and the messages queued
+	 * behind it. They stay in the queue until they are written.
 	 */
-	buf = client->out_msg->data +
+	iov[0].iov_base = client->out_msg->data +
 		(client->out_msg->length - client->out_remaining);
+	iov[0].iov_len = client->out_remaining;
+	msgs = list_iterator_create(client->msg_queue);
+	while ((iovcnt < CLIENT_WRITE_IOV) && (msg = list_next(msgs))) {
+		iov[iovcnt].iov_base = msg->data;
+		iov[iovcnt].iov_len = msg->length;
+		iovcnt++;
+	}
+	list_iterator_destroy(msgs);
+
+	/*
+	 * Write messages to socket.
+	 */
 again:
-	if ((n = write(obj->fd, buf, client->out_remaining)) < 0) {
+	if ((n = writev(obj->fd, iov, iovcnt)) < 0) {
 		if (errno == EINTR) {
 			goto again;
 		} else if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
@@ -488,17 +517,18 @@ again:
 			return SLURM_SUCCESS;
 		}
 	}
-	if (n < client->out_remaining) {
-		error("Only wrote %d of %d bytes to socket",
-		      n, client->out_remaining);
-	} else
-		debug5("Wrote %d bytes to socket", n);
-	client->out_remaining -= n;
-	if (client->out_remaining > 0)
-		return SLURM_SUCCESS;
+	debug5("Wrote %d bytes from %d messages to socket", n, iovcnt);
 
-	_free_outgoing_msg(client->out_msg, client->job);
-	client->out_msg = NULL;
+	/* Release the messages which were written completely */
+	while (n >= client->out_remaining) {
+		n -= client->out_remaining;
+		_free_outgoing_msg(client->out_msg, client->job);
+		client->out_msg = list_dequeue(client->msg_queue);
+		if (client->out_msg == NULL)
+			return SLURM_SUCCESS;
+		client->out_remaining = client->out_msg->length;
+	}
+	client->out_remaining -= n;
 
 	return SLURM_SUCCESS;
 }
@@ -760,10 +790,48 @@ _task_readable(eio_obj_t *obj)
 	return false;
 }
 
+/*
+ * Read output from a task directly into outgoing messages, rather than
+ * through the cbuf. Only used when the cbuf is empty, so that the order
+ * of the output is kept.
+ * RET bytes read, 0 on eof or -1 on error (errno set)
+ */
+static int
+_task_read_direct(eio_obj_t *obj)
+{
+	struct task_read_info *out = (struct task_read_info *)obj->arg;
+	struct io_buf *msg;
+	int i, n, rc = 0, save_errno;
+
+	for (i = 0; (i < TASK_READ_DIRECT_MSGS) && _outgoing_buf_free(out->job);
+	     i++) {
+		msg = list_dequeue(out->job->free_outgoing);
+again:
+		n = read(obj->fd, msg->data + io_hdr_packed_size(),
+			 MAX_MSG_LEN);
+		if ((n < 0) && (errno == EINTR))
+			goto again;
+		if (n <= 0) {
+			save_errno = errno;
+			list_enqueue(out->job->free_outgoing, msg);
+			errno = save_errno;
+			return rc ? rc : n;
+		}
+		_task_pack_header(out, msg, n);
+		_route_msg_to_clients(out, msg);
+		rc += n;
+		if (n < MAX_MSG_LEN)
+			break;	/* pipe drained */
+	}
+
+	return rc;
+}
+
 /*
  * Read output (stdout or stderr) from a task into a cbuf.  The cbuf
  * allows whole lines to be packed into messages if line buffering
- * is requested.
+ * is requested. When the cbuf is empty and message buffers are free,
+ * the output is read straight into messages instead.
  */
 static int
 _task_read(eio_obj_t *obj, List objs)
@@ -776,7 +844,20 @@ _task_read(eio_obj_t *obj, List objs)
 
 	debug4("Entering _task_read for obj %zx", (size_t)obj);
 	len = cbuf_free(out->buf);
-	if (len > 0 && !out->eof) {
+	if (!out->eof && (cbuf_used(out->buf) == 0) &&
+	    _outgoing_buf_free(out->job)) {
+		if ((rc = _task_read_direct(obj)) < 0) {
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+				debug5("_task_read returned EAGAIN");
+				return SLURM_SUCCESS;
+			}
+			debug5("  error in _task_read: %m");
+		}
+		if (rc <= 0) {  /* got eof */
+			debug5("  got eof on task");
+			out->eof = true;
+		}
+	} else if (len > 0 && !out->eof) {
 again:
 		if ((rc = cbuf_write_from_fd(out->buf, obj->fd, len, NULL))
 		    < 0) {
@@ -1312,10 +1393,7 @@ static void
 _route_msg_task_to_client(eio_obj_t *obj)
 {
 	struct task_read_info *out = (struct task_read_info *)obj->arg;
-	struct client_io_info *client;
 	struct io_buf *msg = NULL;
-	eio_obj_t *eio;
-	ListIterator clients;
 
 	/* Pack task output into messages for transfer to a client */
 	while (cbuf_used(out->buf) > 0
@@ -1324,38 +1402,47 @@ _route_msg_task_to_client(eio_obj_t *obj)
 		msg = _task_build_message(out, out->job, out->buf);
 		if (msg == NULL)
 			return;
+		_route_msg_to_clients(out, msg);
+	}
+}
 
-		/* Add message to the msg_queue of all clients */
-		clients = list_iterator_create(out->job->clients);
-		while ((eio = list_next(clients))) {
-			client = (struct client_io_info *)eio->arg;
-			if (client->out_eof == true)
-				continue;
+/* Add a message of task output to the msg_queue of all clients taking it */
+static void
+_route_msg_to_clients(struct task_read_info *out, struct io_buf *msg)
+{
+	struct client_io_info *client;
+	eio_obj_t *eio;
+	ListIterator clients;
 
-			/* Some clients only take certain I/O streams */
-			if (out->type==SLURM_IO_STDOUT) {
-				if (client->ltaskid_stdout != -1 &&
-				    client->ltaskid_stdout != out->ltaskid)
-					continue;
-			}
-			if (out->type==SLURM_IO_STDERR) {
-				if (client->ltaskid_stderr != -1 &&
-				    client->ltaskid_stderr != out->ltaskid)
-					continue;
-			}
+	clients = list_iterator_create(out->job->clients);
+	while ((eio = list_next(clients))) {
+		client = (struct client_io_info *)eio->arg;
+		if (client->out_eof == true)
+			continue;
 
-			debug5("======================== Enqueued message");
-			xassert(client->magic == CLIENT_IO_MAGIC);
-			if (list_enqueue(client->msg_queue, msg))
-				msg->ref_count++;
+		/* Some clients only take certain I/O streams */
+		if (out->type==SLURM_IO_STDOUT) {
+			if (client->ltaskid_stdout != -1 &&
+			    client->ltaskid_stdout != out->ltaskid)
+				continue;
+		}
+		if (out->type==SLURM_IO_STDERR) {
+			if (client->ltaskid_stderr != -1 &&
+			    client->ltaskid_stderr != out->ltaskid)
+				continue;
 		}
-		list_iterator_destroy(clients);
 
-		/* Update the outgoing message cache */
-		if (list_enqueue(out->job->outgoing_cache, msg)) {
+		debug5("======================== Enqueued message");
+		xassert(client->magic == CLIENT_IO_MAGIC);
+		if (list_enqueue(client->msg_queue, msg))
 			msg->ref_count++;
-			_shrink_msg_cache(out->job->outgoing_cache, out->job);
-		}
+	}
+	list_iterator_destroy(clients);
+
+	/* Update the outgoing message cache */
+	if (list_enqueue(out->job->outgoing_cache, msg)) {
+		msg->ref_count++;
+		_shrink_msg_cache(out->job->outgoing_cache, out->job);
 	}
 }
 
@@ -1814,8 +1901,6 @@ _task_build_message(struct task_read_info *out, stepd_step_rec_t *job, cbuf_t cb
 {
 	struct io_buf *msg;
 	char *ptr;
-	Buf packbuf;
-	struct slurm_io_header header;
 	int n;
 
 	debug4("%s: Entering...", __func__);
@@ -1828,16 +1913,29 @@ _task_build_message(struct task_read_info *out, stepd_step_rec_t *job, cbuf_t cb
 
 	ptr = msg->data + io_hdr_packed_size();
 	n = cbuf_read(cbuf, ptr, MAX_MSG_LEN);
+	_task_pack_header(out, msg, n);
+
+	debug4("%s: Leaving...", __func__);
+	return msg;
+}
+
+/* Pack the header of a message holding len bytes of task output */
+static void
+_task_pack_header(struct task_read_info *out, struct io_buf *msg, int len)
+{
+	Buf packbuf;
+	struct slurm_io_header header;
+
 	header.type = out->type;
 	header.ltaskid = out->ltaskid;
 	header.gtaskid = out->gtaskid;
-	header.length = n;
+	header.length = len;
 
-	debug4("%s: header.length %d", __func__, n);
+	debug4("%s: header.length %d", __func__, len);
 	packbuf = create_buf(msg->data, io_hdr_packed_size());
 	if (!packbuf) {
 		fatal("Failure to allocate memory for a message header");
-		return msg;	/* Fix for CLANG false positive error */
+		return;	/* Fix for CLANG false positive error */
 	}
 	io_hdr_pack(&header, packbuf);
 	msg->length = io_hdr_packed_size() + header.length;
@@ -1846,9 +1944,6 @@ _task_build_message(struct task_read_info *out, stepd_step_rec_t *job, cbuf_t cb
 	/* free the Buf packbuf, but not the memory to which it points */
 	packbuf->head = NULL;	/* CLANG false positive bug here */
 	free_buf(packbuf);
-
-	debug4("%s: Leaving...", __func__);
-	return msg;
 }
 
 struct io_buf *
@@ -42,6 +42,7 @@
 #endif
 
 #include <sys/types.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <sys/stat.h>
@@ -111,6 +112,9 @@ struct io_operations msg_socket_ops = {
 };
 
 static char *socket_name;
+static char *shm_name = NULL;
+static stepd_step_rec_t *shm_job = NULL;
+static stepd_shm_t *shm_ptr = NULL;
 static pthread_mutex_t suspend_mutex = PTHREAD_MUTEX_INITIALIZER;
 static bool suspended = false;
 
@@ -230,6 +234,117 @@ _domain_socket_destroy(int fd)
 		error("Unable to unlink domain socket: %m");
 }
 
+/*
+ * Publish the step's latest accounting data and process IDs for local
+ * readers (see stepd_shm_stat()), called by the jobacct_gather polling
+ * thread after each poll.
+ */
+static void _stepd_shm_publish(void)
+{
+	jobacctinfo_t *jobacct;
+	uint32_t num_tasks, data_len, pid_cnt = 0;
+	pid_t *pids = NULL;
+	int i, npids = 0;
+	bool fits = true;
+	uint32_t *shm_pids;
+	Buf buffer;
+
+	if (!(jobacct = jobacctinfo_create(NULL)))
+		return;		/* accounting disabled */
+	num_tasks = jobacct_gather_stat_all_task(jobacct);
+	buffer = init_buf(0);
+	jobacctinfo_pack(jobacct, SLURM_PROTOCOL_VERSION,
+			 PROTOCOL_TYPE_SLURM, buffer);
+	jobacctinfo_destroy(jobacct);
+	proctrack_g_get_pids(shm_job->cont_id, &pids, &npids);
+	if (npids > 0)
+		pid_cnt = npids;
+
+	data_len = get_buf_offset(buffer) + pid_cnt * sizeof(uint32_t);
+	if (data_len > (STEPD_SHM_SIZE - sizeof(stepd_shm_t))) {
+		debug("%s: %u bytes of step state do not fit", __func__,
+		      data_len);
+		fits = false;
+	}
+
+	shm_ptr->seq++;			/* odd: being updated */
+	__sync_synchronize();
+	shm_ptr->state = shm_job->state;
+	if (fits) {
+		shm_ptr->protocol_version = SLURM_PROTOCOL_VERSION;
+		shm_ptr->sample_time = time(NULL);
+		shm_ptr->num_tasks = num_tasks;
+		shm_ptr->jobacct_len = get_buf_offset(buffer);
+		shm_ptr->pid_cnt = pid_cnt;
+		memcpy(shm_ptr + 1, get_buf_data(buffer),
+		       shm_ptr->jobacct_len);
+		shm_pids = (uint32_t *) ((char *) (shm_ptr + 1) +
+					 shm_ptr->jobacct_len);
+		for (i = 0; i < pid_cnt; i++)
+			shm_pids[i] = (uint32_t) pids[i];
+	} else
+		shm_ptr->sample_time = 0;	/* readers use the socket */
+	__sync_synchronize();
+	shm_ptr->seq++;
+
+	free_buf(buffer);
+	xfree(pids);
+}
+
+/* Create the file in which the step's state is published */
+static void _stepd_shm_create(stepd_step_rec_t *job)
+{
+	int fd;
+	void *map;
+
+	shm_name = stepd_shm_name(conf->spooldir, conf->node_name,
+				  job->jobid, job->stepid);
+	fd = open(shm_name, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd < 0) {
+		error("%s: open(%s): %m", __func__, shm_name);
+		xfree(shm_name);
+		return;
+	}
+	if (ftruncate(fd, STEPD_SHM_SIZE) < 0) {
+		error("%s: ftruncate(%s): %m", __func__, shm_name);
+		map = MAP_FAILED;
+	} else {
+		map = mmap(NULL, STEPD_SHM_SIZE, PROT_READ | PROT_WRITE,
+			   MAP_SHARED, fd, 0);
+		if (map == MAP_FAILED)
+			error("%s: mmap(%s): %m", __func__, shm_name);
+	}
+	close(fd);
+	if (map == MAP_FAILED) {
+		(void) unlink(shm_name);
+		xfree(shm_name);
+		return;
+	}
+
+	shm_ptr = (stepd_shm_t *) map;
+	shm_ptr->uid = (uint32_t) job->uid;
+	shm_ptr->state = job->state;
+	shm_ptr->version = STEPD_SHM_VERSION;
+	shm_ptr->hdr_size = sizeof(stepd_shm_t);
+	shm_ptr->magic = STEPD_SHM_MAGIC;
+	shm_job = job;
+	jobacct_gather_set_poll_hook(_stepd_shm_publish);
+}
+
+static void _stepd_shm_destroy(void)
+{
+	if (!shm_ptr)
+		return;
+
+	jobacct_gather_set_poll_hook(NULL);
+	if (unlink(shm_name) == -1)
+		error("Unable to unlink %s: %m", shm_name);
+	munmap(shm_ptr, STEPD_SHM_SIZE);
+	shm_ptr = NULL;
+	shm_job = NULL;
+	xfree(shm_name);
+}
+
 
 static void *
 _msg_thr_internal(void *job_arg)
@@ -257,6 +372,7 @@ msg_thr_create(stepd_step_rec_t *job)
 		return SLURM_ERROR;
 
 	fd_set_nonblocking(fd);
+	_stepd_shm_create(job);
 
 	eio_obj = eio_obj_create(fd, &msg_socket_ops, (void *)job);
 	job->msg_handle = eio_handle_create(0);
@@ -306,6 +422,7 @@ _msg_socket_readable(eio_obj_t *obj)
 		/* All spawned tasks have been completed by this point */
 		if (obj->fd != -1) {
 			debug2("  false, shutdown");
+			_stepd_shm_destroy();
 			_domain_socket_destroy(obj->fd);
 			/* slurmd considers the job step done now that
 			 * the domain name socket is destroyed */
@@ -91,7 +91,7 @@ static int   _get_config(slurmdbd_conn_t *slurmdbd_conn,
 			 Buf in_buffer, Buf *out_buffer, uint32_t *uid);
 static int   _get_events(slurmdbd_conn_t *slurmdbd_conn,
 			 Buf in_buffer, Buf *out_buffer, uint32_t *uid);
-static int   _get_jobs_cond(slurmdbd_conn_t *slurmdbd_conn,
+static int   _get_jobs_cond(uint16_t type, slurmdbd_conn_t *slurmdbd_conn,
 			    Buf in_buffer, Buf *out_buffer, uint32_t *uid);
 static int   _get_probs(slurmdbd_conn_t *slurmdbd_conn,
 			Buf in_buffer, Buf *out_buffer, uint32_t *uid);
@@ -297,7 +297,8 @@ proc_req(slurmdbd_conn_t *slurmdbd_conn,
 					 in_buffer, out_buffer, uid);
 			break;
 		case DBD_GET_JOBS_COND:
-			rc = _get_jobs_cond(slurmdbd_conn,
+		case DBD_GET_JOBS_PAGE:
+			rc = _get_jobs_cond(msg_type, slurmdbd_conn,
 					    in_buffer, out_buffer, uid);
 			break;
 		case DBD_GET_PROBS:
@@ -484,14 +485,30 @@ proc_req(slurmdbd_conn_t *slurmdbd_conn,
 			error("CONN:%u Security violation, %s",
 			      slurmdbd_conn->newsockfd,
 			      slurmdbd_msg_type_2_str(msg_type, 1));
-		else if (slurmdbd_conn->ctld_port
+		else if (slurmdbd_conn->ctld_port && !slurmdbd_conn->mult_msg
 			 && !slurmdbd_conf->commit_delay) {
 			/* If we are dealing with the slurmctld do the
 			   commit (SUCCESS or NOT) afterwards since we
 			   do transactions for performance reasons.
 			   (don't ever use autocommit with innodb)
+			   The records of a DBD_SEND_MULT_MSG are all
+			   committed together once it is processed.
+			   If that fails nothing was kept, so tell the
+			   sender to keep its records and send them again.
 			*/
-			acct_storage_g_commit(slurmdbd_conn->db_conn, 1);
+			if ((acct_storage_g_commit(slurmdbd_conn->db_conn, 1)
+			     != SLURM_SUCCESS) && (rc == SLURM_SUCCESS)) {
+				comment = "Failed to commit";
+				error("CONN:%u %s %s",
+				      slurmdbd_conn->newsockfd, comment,
+				      slurmdbd_msg_type_2_str(msg_type, 1));
+				rc = SLURM_ERROR;
+				if (*out_buffer)
+					free_buf(*out_buffer);
+				*out_buffer = make_dbd_rc_msg(
+					slurmdbd_conn->rpc_version, rc,
+					comment, msg_type);
+			}
 		}
 
 	}
@@ -1288,7 +1305,16 @@ static int _get_config(slurmdbd_conn_t *slurmdbd_conn,
 	if (config_name == NULL ||
 	    xstrcmp(config_name, "slurmdbd.conf") == 0)
 		list_msg.my_list = dump_config();
-	else if ((list_msg.my_list = acct_storage_g_get_config(
+	else if (xstrcmp(config_name, "slurmdbd.stats") == 0) {
+		List storage_list;
+		list_msg.my_list = rpc_mgr_dump_stats();
+		/* the storage plugin may add statistics of its own */
+		if ((storage_list = acct_storage_g_get_config(
+			     slurmdbd_conn->db_conn, config_name))) {
+			list_transfer(list_msg.my_list, storage_list);
+			FREE_NULL_LIST(storage_list);
+		}
+	} else if ((list_msg.my_list = acct_storage_g_get_config(
 			slurmdbd_conn->db_conn, config_name)) == NULL) {
 		*out_buffer = make_dbd_rc_msg(slurmdbd_conn->rpc_version,
 					      errno, slurm_strerror(errno),
@@ -1351,7 +1377,7 @@ static int _get_events(slurmdbd_conn_t *slurmdbd_conn,
 	return rc;
 }
 
-static int _get_jobs_cond(slurmdbd_conn_t *slurmdbd_conn,
+static int _get_jobs_cond(uint16_t type, slurmdbd_conn_t *slurmdbd_conn,
 			  Buf in_buffer, Buf *out_buffer, uint32_t *uid)
 {
 	dbd_cond_msg_t *cond_msg = NULL;
@@ -1359,15 +1385,13 @@ static int _get_jobs_cond(slurmdbd_conn_t *slurmdbd_conn,
 	char *comment = NULL;
 	int rc = SLURM_SUCCESS;
 
-	debug2("DBD_GET_JOBS_COND: called");
+	debug2("%s: called", slurmdbd_msg_type_2_str(type, 1));
 	if (slurmdbd_unpack_cond_msg(&cond_msg, slurmdbd_conn->rpc_version,
-				     DBD_GET_JOBS_COND, in_buffer) !=
-	    SLURM_SUCCESS) {
-		comment = "Failed to unpack DBD_GET_JOBS_COND message";
+				     type, in_buffer) != SLURM_SUCCESS) {
+		comment = "Failed to unpack job condition message";
 		error("CONN:%u %s", slurmdbd_conn->newsockfd, comment);
 		*out_buffer = make_dbd_rc_msg(slurmdbd_conn->rpc_version,
-					      SLURM_ERROR, comment,
-					      DBD_GET_JOBS_COND);
+					      SLURM_ERROR, comment, type);
 		return SLURM_ERROR;
 	}
 
@@ -1383,12 +1407,11 @@ static int _get_jobs_cond(slurmdbd_conn_t *slurmdbd_conn,
 				       DBD_GOT_JOBS, *out_buffer);
 	} else {
 		*out_buffer = make_dbd_rc_msg(slurmdbd_conn->rpc_version,
-					      errno, slurm_strerror(errno),
-					      DBD_GET_JOBS_COND);
+					      errno, slurm_strerror(errno), type);
 		rc = SLURM_ERROR;
 	}
 
-	slurmdbd_free_cond_msg(cond_msg, DBD_GET_JOBS_COND);
+	slurmdbd_free_cond_msg(cond_msg, type);
 	FREE_NULL_LIST(list_msg.my_list);
 
 	return rc;
@@ -3595,6 +3618,7 @@ static int   _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn,
 
 	list_msg.my_list = list_create(slurmdbd_free_buffer);
 	/* START_TIMER; */
+	slurmdbd_conn->mult_msg = true;
 	itr = list_iterator_create(get_msg->my_list);
 	while ((req_buf = list_next(itr))) {
 		ret_buf = NULL;
@@ -3606,6 +3630,7 @@ static int   _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn,
 			break;
 	}
 	list_iterator_destroy(itr);
+	slurmdbd_conn->mult_msg = false;
 	/* END_TIMER; */
 	/* info("%d multi took %s", list_count(get_msg->my_list), TIME_STR); */
 
@@ -48,6 +48,7 @@ typedef struct {
 	uint16_t ctld_port; /* slurmctld_port */
 	void *db_conn; /* database connection */
 	char ip[32];
+	bool mult_msg; /* processing DBD_SEND_MULT_MSG, commit once at end */
 	slurm_fd_t newsockfd; /* socket connection descriptor */
 	uint16_t orig_port;
 	uint16_t rpc_version; /* version of rpc */
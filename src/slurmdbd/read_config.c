@@ -97,10 +97,13 @@ static void _clear_slurmdbd_conf(void)
 		slurmdbd_conf->debug_flags = 0;
 		slurmdbd_conf->debug_level = 0;
 		xfree(slurmdbd_conf->default_qos);
+		xfree(slurmdbd_conf->export_dir);
 		xfree(slurmdbd_conf->log_file);
+		slurmdbd_conf->max_query_threads = 0;
 		xfree(slurmdbd_conf->pid_file);
 		xfree(slurmdbd_conf->plugindir);
 		slurmdbd_conf->private_data = 0;
+		slurmdbd_conf->purge_batch_size = 0;
 		slurmdbd_conf->purge_event = 0;
 		slurmdbd_conf->purge_job = 0;
 		slurmdbd_conf->purge_resv = 0;
@@ -113,6 +116,9 @@ static void _clear_slurmdbd_conf(void)
 		xfree(slurmdbd_conf->storage_loc);
 		xfree(slurmdbd_conf->storage_pass);
 		slurmdbd_conf->storage_port = 0;
+		xfree(slurmdbd_conf->storage_replica_host);
+		slurmdbd_conf->storage_replica_lag = 0;
+		slurmdbd_conf->storage_replica_port = 0;
 		xfree(slurmdbd_conf->storage_type);
 		xfree(slurmdbd_conf->storage_user);
 		slurmdbd_conf->track_wckey = 0;
@@ -146,13 +152,16 @@ extern int read_slurmdbd_conf(void)
 		{"DebugFlags", S_P_STRING},
 		{"DebugLevel", S_P_STRING},
 		{"DefaultQOS", S_P_STRING},
+		{"ExportDir", S_P_STRING},
 		{"JobPurge", S_P_UINT32},
 		{"LogFile", S_P_STRING},
 		{"LogTimeFormat", S_P_STRING},
+		{"MaxQueryThreads", S_P_UINT16},
 		{"MessageTimeout", S_P_UINT16},
 		{"PidFile", S_P_STRING},
 		{"PluginDir", S_P_STRING},
 		{"PrivateData", S_P_STRING},
+		{"PurgeBatchSize", S_P_UINT32},
 		{"PurgeEventAfter", S_P_STRING},
 		{"PurgeJobAfter", S_P_STRING},
 		{"PurgeResvAfter", S_P_STRING},
@@ -169,6 +178,9 @@ extern int read_slurmdbd_conf(void)
 		{"StorageLoc", S_P_STRING},
 		{"StoragePass", S_P_STRING},
 		{"StoragePort", S_P_UINT16},
+		{"StorageReplicaHost", S_P_STRING},
+		{"StorageReplicaMaxLag", S_P_UINT32},
+		{"StorageReplicaPort", S_P_UINT16},
 		{"StorageType", S_P_STRING},
 		{"StorageUser", S_P_STRING},
 		{"TCPTimeout", S_P_UINT16},
@@ -243,6 +255,7 @@ extern int read_slurmdbd_conf(void)
 		}
 
 		s_p_get_string(&slurmdbd_conf->default_qos, "DefaultQOS", tbl);
+		s_p_get_string(&slurmdbd_conf->export_dir, "ExportDir", tbl);
 		if (s_p_get_uint32(&slurmdbd_conf->purge_job,
 				   "JobPurge", tbl)) {
 			if (!slurmdbd_conf->purge_job)
@@ -273,6 +286,12 @@ extern int read_slurmdbd_conf(void)
 		} else
 			slurmdbd_conf->log_fmt = LOG_FMT_ISO8601_MS;
 
+		if (!s_p_get_uint16(&slurmdbd_conf->max_query_threads,
+				    "MaxQueryThreads", tbl) ||
+		    !slurmdbd_conf->max_query_threads)
+			slurmdbd_conf->max_query_threads =
+				DEFAULT_SLURMDBD_QUERY_THREADS;
+
 		if (!s_p_get_uint16(&slurmdbd_conf->msg_timeout,
 				    "MessageTimeout", tbl))
 			slurmdbd_conf->msg_timeout = DEFAULT_MSG_TIMEOUT;
@@ -310,6 +329,13 @@ extern int read_slurmdbd_conf(void)
 				slurmdbd_conf->private_data = 0xffff;
 			xfree(temp_str);
 		}
+
+		if (!s_p_get_uint32(&slurmdbd_conf->purge_batch_size,
+				    "PurgeBatchSize", tbl) ||
+		    !slurmdbd_conf->purge_batch_size)
+			slurmdbd_conf->purge_batch_size =
+				DEFAULT_SLURMDBD_PURGE_BATCH;
+
 		if (s_p_get_string(&temp_str, "PurgeEventAfter", tbl)) {
 			/* slurmdb_parse_purge will set SLURMDB_PURGE_FLAGS */
 			if ((slurmdbd_conf->purge_event =
@@ -413,6 +439,14 @@ extern int read_slurmdbd_conf(void)
 			       "StoragePass", tbl);
 		s_p_get_uint16(&slurmdbd_conf->storage_port,
 			       "StoragePort", tbl);
+		s_p_get_string(&slurmdbd_conf->storage_replica_host,
+			       "StorageReplicaHost", tbl);
+		if (!s_p_get_uint32(&slurmdbd_conf->storage_replica_lag,
+				    "StorageReplicaMaxLag", tbl))
+			slurmdbd_conf->storage_replica_lag =
+				DEFAULT_SLURMDBD_REPLICA_LAG;
+		s_p_get_uint16(&slurmdbd_conf->storage_replica_port,
+			       "StorageReplicaPort", tbl);
 		s_p_get_string(&slurmdbd_conf->storage_type,
 			       "StorageType", tbl);
 		s_p_get_string(&slurmdbd_conf->storage_user,
@@ -501,6 +535,9 @@ extern int read_slurmdbd_conf(void)
 			slurmdbd_conf->storage_loc =
 				xstrdup(DEFAULT_STORAGE_LOC);
 	}
+	if (!slurmdbd_conf->storage_replica_port)
+		slurmdbd_conf->storage_replica_port =
+			slurmdbd_conf->storage_port;
 
 	if (slurmdbd_conf->archive_dir) {
 		if (stat(slurmdbd_conf->archive_dir, &buf) < 0)
@@ -515,6 +552,19 @@ extern int read_slurmdbd_conf(void)
 			      slurmdbd_conf->archive_dir);
 	}
 
+	if (slurmdbd_conf->export_dir) {
+		if (stat(slurmdbd_conf->export_dir, &buf) < 0)
+			fatal("Failed to stat the export directory %s: %m",
+			      slurmdbd_conf->export_dir);
+		if (!(buf.st_mode & S_IFDIR))
+			fatal("export directory %s isn't a directory",
+			      slurmdbd_conf->export_dir);
+
+		if (access(slurmdbd_conf->export_dir, W_OK) < 0)
+			fatal("export directory %s is not writable",
+			      slurmdbd_conf->export_dir);
+	}
+
 	if (slurmdbd_conf->archive_script) {
 		if (stat(slurmdbd_conf->archive_script, &buf) < 0)
 			fatal("Failed to stat the archive script %s: %m",
@@ -564,8 +614,10 @@ extern void log_config(void)
 	xfree(tmp_ptr);
 	debug2("DebugLevel        = %u", slurmdbd_conf->debug_level);
 	debug2("DefaultQOS        = %s", slurmdbd_conf->default_qos);
+	debug2("ExportDir         = %s", slurmdbd_conf->export_dir);
 
 	debug2("LogFile           = %s", slurmdbd_conf->log_file);
+	debug2("MaxQueryThreads   = %u", slurmdbd_conf->max_query_threads);
 	debug2("MessageTimeout    = %u", slurmdbd_conf->msg_timeout);
 	debug2("PidFile           = %s", slurmdbd_conf->pid_file);
 	debug2("PluginDir         = %s", slurmdbd_conf->plugindir);
@@ -574,6 +626,8 @@ extern void log_config(void)
 			    tmp_str, sizeof(tmp_str));
 	debug2("PrivateData       = %s", tmp_str);
 
+	debug2("PurgeBatchSize    = %u", slurmdbd_conf->purge_batch_size);
+
 	slurmdb_purge_string(slurmdbd_conf->purge_event,
 			     tmp_str, sizeof(tmp_str), 1);
 	debug2("PurgeEventAfter   = %s", tmp_str);
@@ -602,6 +656,12 @@ extern void log_config(void)
 	debug2("StorageLoc        = %s", slurmdbd_conf->storage_loc);
 	/* debug2("StoragePass       = %s", slurmdbd_conf->storage_pass); */
 	debug2("StoragePort       = %u", slurmdbd_conf->storage_port);
+	debug2("StorageReplicaHost = %s",
+	       slurmdbd_conf->storage_replica_host);
+	debug2("StorageReplicaMaxLag = %u",
+	       slurmdbd_conf->storage_replica_lag);
+	debug2("StorageReplicaPort = %u",
+	       slurmdbd_conf->storage_replica_port);
 	debug2("StorageType       = %s", slurmdbd_conf->storage_type);
 	debug2("StorageUser       = %s", slurmdbd_conf->storage_user);
 
@@ -741,11 +801,22 @@ extern List dump_config(void)
 	key_pair->value = xstrdup(slurmdbd_conf->default_qos);
 	list_append(my_list, key_pair);
 
+	key_pair = xmalloc(sizeof(config_key_pair_t));
+	key_pair->name = xstrdup("ExportDir");
+	key_pair->value = xstrdup(slurmdbd_conf->export_dir);
+	list_append(my_list, key_pair);
+
 	key_pair = xmalloc(sizeof(config_key_pair_t));
 	key_pair->name = xstrdup("LogFile");
 	key_pair->value = xstrdup(slurmdbd_conf->log_file);
 	list_append(my_list, key_pair);
 
+	key_pair = xmalloc(sizeof(config_key_pair_t));
+	key_pair->name = xstrdup("MaxQueryThreads");
+	key_pair->value = xstrdup_printf("%u",
+					 slurmdbd_conf->max_query_threads);
+	list_append(my_list, key_pair);
+
 	key_pair = xmalloc(sizeof(config_key_pair_t));
 	key_pair->name = xstrdup("MessageTimeout");
 	key_pair->value = xstrdup_printf("%u secs", slurmdbd_conf->msg_timeout);
@@ -768,6 +839,12 @@ extern List dump_config(void)
 			    key_pair->value, 128);
 	list_append(my_list, key_pair);
 
+	key_pair = xmalloc(sizeof(config_key_pair_t));
+	key_pair->name = xstrdup("PurgeBatchSize");
+	key_pair->value = xstrdup_printf("%u",
+					 slurmdbd_conf->purge_batch_size);
+	list_append(my_list, key_pair);
+
 	key_pair = xmalloc(sizeof(config_key_pair_t));
 	key_pair->name = xstrdup("PurgeEventAfter");
 	if (slurmdbd_conf->purge_event != NO_VAL) {
@@ -857,6 +934,23 @@ extern List dump_config(void)
 	key_pair->value = xstrdup_printf("%u", slurmdbd_conf->storage_port);
 	list_append(my_list, key_pair);
 
+	key_pair = xmalloc(sizeof(config_key_pair_t));
+	key_pair->name = xstrdup("StorageReplicaHost");
+	key_pair->value = xstrdup(slurmdbd_conf->storage_replica_host);
+	list_append(my_list, key_pair);
+
+	key_pair = xmalloc(sizeof(config_key_pair_t));
+	key_pair->name = xstrdup("StorageReplicaMaxLag");
+	key_pair->value = xstrdup_printf("%u sec",
+					 slurmdbd_conf->storage_replica_lag);
+	list_append(my_list, key_pair);
+
+	key_pair = xmalloc(sizeof(config_key_pair_t));
+	key_pair->name = xstrdup("StorageReplicaPort");
+	key_pair->value = xstrdup_printf("%u",
+					 slurmdbd_conf->storage_replica_port);
+	list_append(my_list, key_pair);
+
 	key_pair = xmalloc(sizeof(config_key_pair_t));
 	key_pair->name = xstrdup("StorageType");
 	key_pair->value = xstrdup(slurmdbd_conf->storage_type);
@@ -61,6 +61,9 @@
 //#define DEFAULT_SLURMDBD_JOB_PURGE	12
 #define DEFAULT_SLURMDBD_PIDFILE	"/var/run/slurmdbd.pid"
 #define DEFAULT_SLURMDBD_ARCHIVE_DIR	"/tmp"
+#define DEFAULT_SLURMDBD_PURGE_BATCH	50000
+#define DEFAULT_SLURMDBD_QUERY_THREADS	16
+#define DEFAULT_SLURMDBD_REPLICA_LAG	60
 //#define DEFAULT_SLURMDBD_STEP_PURGE	1
 
 /* SlurmDBD configuration parameters */
@@ -83,12 +86,18 @@ typedef struct slurm_dbd_conf {
 	uint16_t	debug_level;	/* Debug level, default=3	*/
 	char *	 	default_qos;	/* default qos setting when
 					 * adding clusters              */
+	char *		export_dir;	/* where to write the columnar
+					 * export of completed months	*/
 	char *		log_file;	/* Log file			*/
 	uint16_t        log_fmt;        /* Log file timestamt format    */
+	uint16_t	max_query_threads; /* user requests processed
+					    * at once			*/
 	uint16_t        msg_timeout;    /* message timeout		*/
 	char *		pid_file;	/* where to store current PID	*/
 	char *		plugindir;	/* dir to look for plugins	*/
 	uint16_t        private_data;   /* restrict information         */
+	uint32_t	purge_batch_size; /* records archived and purged
+					   * in one transaction		*/
 					/* purge variable format
 					 * controlled by PURGE_FLAGS	*/
 	uint32_t        purge_event;    /* purge events older than
@@ -106,6 +115,12 @@ typedef struct slurm_dbd_conf {
 	char *		storage_loc;	/* database name		*/
 	char *		storage_pass;   /* password for DB write	*/
 	uint16_t	storage_port;	/* port DB is listening to	*/
+	char *		storage_replica_host; /* host of a read only replica
+					       * of the DB for queries	*/
+	uint32_t	storage_replica_lag; /* max seconds the replica may
+					      * be behind the DB	*/
+	uint16_t	storage_replica_port; /* port the replica is
+					       * listening to		*/
 	char *		storage_type;	/* DB to be used for storage	*/
 	char *		storage_user;	/* user authorized to write DB	*/
 	uint16_t        track_wckey;    /* Whether or not to track wckey*/
@@ -51,11 +51,13 @@
 #include "src/common/fd.h"
 #include "src/common/log.h"
 #include "src/common/macros.h"
+#include "src/common/read_config.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_accounting_storage.h"
 #include "src/common/slurmdbd_defs.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xsignal.h"
+#include "src/common/xstring.h"
 #include "src/slurmdbd/proc_req.h"
 #include "src/slurmdbd/read_config.h"
 #include "src/slurmdbd/rpc_mgr.h"
@@ -69,13 +71,37 @@
  */
 #define MAX_MSG_SIZE     (16*1024*1024)
 
+/* Requests are processed in one of these lanes. Those of the slurmctld
+ * never wait, those of users wait for one of MaxQueryThreads slots. */
+enum {
+	LANE_CTLD,
+	LANE_QUERY,
+	LANE_CNT
+};
+
+typedef struct {
+	char *name;
+	uint32_t active;	/* requests being processed */
+	uint32_t queued;	/* requests waiting for a slot */
+	uint32_t max_queued;
+	uint32_t cnt;		/* requests processed */
+	uint64_t wait_usec;	/* total time waiting for a slot */
+	uint32_t max_wait_usec;
+	uint64_t proc_usec;	/* total time processing */
+	uint32_t max_proc_usec;
+} rpc_lane_t;
+
 /* Local functions */
 static bool   _fd_readable(slurm_fd_t fd);
 static void   _free_server_thread(pthread_t my_tid);
+static int    _lane_enter(slurmdbd_conn_t *conn, char *msg,
+			  struct timeval *start_time);
+static void   _lane_exit(int lane, struct timeval *start_time);
 static int    _send_resp(slurm_fd_t fd, Buf buffer);
 static void * _service_connection(void *arg);
 static void   _sig_handler(int signal);
 static int    _tot_wait (struct timeval *start_time);
+static uint32_t _tot_wait_usec(struct timeval *start_time);
 static int    _wait_for_server_thread(void);
 static void   _wait_for_thread_fini(void);
 
@@ -84,6 +110,9 @@ static pthread_t       master_thread_id = 0, slave_thread_id[MAX_THREAD_COUNT];
 static int             thread_count = 0;
 static pthread_mutex_t thread_count_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  thread_count_cond = PTHREAD_COND_INITIALIZER;
+static rpc_lane_t      lanes[LANE_CNT] = { { "Controller" }, { "Query" } };
+static pthread_mutex_t lane_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  lane_cond = PTHREAD_COND_INITIALIZER;
 
 
 /* Process incoming RPCs. Meant to execute as a pthread */
@@ -181,6 +210,104 @@ extern void rpc_mgr_wake(void)
 			pthread_kill(slave_thread_id[i], SIGUSR1);
 	}
 	slurm_mutex_unlock(&thread_count_lock);
+
+	slurm_mutex_lock(&lane_lock);
+	pthread_cond_broadcast(&lane_cond);
+	slurm_mutex_unlock(&lane_lock);
+}
+
+/* Return the statistics of each request lane
+ * RET List of config_key_pair_t *, caller must free */
+extern List rpc_mgr_dump_stats(void)
+{
+	config_key_pair_t *key_pair;
+	List my_list = list_create(destroy_config_key_pair);
+	rpc_lane_t *lane;
+	int i;
+
+	slurm_mutex_lock(&lane_lock);
+	for (i = 0; i < LANE_CNT; i++) {
+		lane = &lanes[i];
+		key_pair = xmalloc(sizeof(config_key_pair_t));
+		key_pair->name = xstrdup_printf("%sLane", lane->name);
+		key_pair->value = xstrdup_printf(
+			"Requests=%u Active=%u Queued=%u MaxQueued=%u "
+			"AveWait=%"PRIu64"us MaxWait=%uus "
+			"AveTime=%"PRIu64"us MaxTime=%uus",
+			lane->cnt, lane->active, lane->queued,
+			lane->max_queued,
+			lane->cnt ? lane->wait_usec / lane->cnt : 0,
+			lane->max_wait_usec,
+			lane->cnt ? lane->proc_usec / lane->cnt : 0,
+			lane->max_proc_usec);
+		list_append(my_list, key_pair);
+	}
+	slurm_mutex_unlock(&lane_lock);
+
+	return my_list;
+}
+
+/* Wait for a slot in the lane of this request
+ * OUT start_time - when processing of the request started
+ * RET the lane to pass to _lane_exit() */
+static int _lane_enter(slurmdbd_conn_t *conn, char *msg,
+		       struct timeval *start_time)
+{
+	rpc_lane_t *lane;
+	uint16_t msg_type;
+	uint32_t usec;
+	int inx = LANE_QUERY;
+
+	/* Opening and closing a connection is cheap and a slurmctld
+	 * hasn't registered yet when it opens its connection. */
+	memcpy(&msg_type, msg, sizeof(msg_type));
+	msg_type = ntohs(msg_type);
+	if (conn->ctld_port || (msg_type == DBD_INIT) ||
+	    (msg_type == DBD_FINI) || (msg_type == DBD_REGISTER_CTLD))
+		inx = LANE_CTLD;
+	lane = &lanes[inx];
+
+	gettimeofday(start_time, NULL);
+	slurm_mutex_lock(&lane_lock);
+	if (inx == LANE_QUERY) {
+		lane->queued++;
+		if (lane->queued > lane->max_queued)
+			lane->max_queued = lane->queued;
+		while (!shutdown_time &&
+		       (lane->active >= slurmdbd_conf->max_query_threads))
+			pthread_cond_wait(&lane_cond, &lane_lock);
+		lane->queued--;
+	}
+	lane->active++;
+	usec = _tot_wait_usec(start_time);
+	lane->wait_usec += usec;
+	if (usec > lane->max_wait_usec)
+		lane->max_wait_usec = usec;
+	slurm_mutex_unlock(&lane_lock);
+
+	if (usec > 1000000)
+		debug("%s request from connection %d(%s) waited %u usec",
+		      lane->name, conn->newsockfd, conn->ip, usec);
+
+	gettimeofday(start_time, NULL);
+	return inx;
+}
+
+/* Release the slot taken by _lane_enter() */
+static void _lane_exit(int inx, struct timeval *start_time)
+{
+	rpc_lane_t *lane = &lanes[inx];
+	uint32_t usec = _tot_wait_usec(start_time);
+
+	slurm_mutex_lock(&lane_lock);
+	lane->active--;
+	lane->cnt++;
+	lane->proc_usec += usec;
+	if (usec > lane->max_proc_usec)
+		lane->max_proc_usec = usec;
+	if (inx == LANE_QUERY)
+		pthread_cond_signal(&lane_cond);
+	slurm_mutex_unlock(&lane_lock);
 }
 
 static void * _service_connection(void *arg)
@@ -191,7 +318,8 @@ static void * _service_connection(void *arg)
 	ssize_t msg_read = 0, offset = 0;
 	bool fini = false, first = true;
 	Buf buffer = NULL;
-	int rc = SLURM_SUCCESS;
+	int lane, rc = SLURM_SUCCESS;
+	struct timeval start_time;
 
 	debug2("Opened connection %d from %s", conn->newsockfd, conn->ip);
 
@@ -229,8 +357,10 @@ static void * _service_connection(void *arg)
 			offset += msg_read;
 		}
 		if (msg_size == offset) {
+			lane = _lane_enter(conn, msg, &start_time);
 			rc = proc_req(
 				conn, msg, msg_size, first, &buffer, &uid);
+			_lane_exit(lane, &start_time);
 			first = false;
 			if (rc != SLURM_SUCCESS && rc != ACCOUNTING_FIRST_REG) {
 				error("Processing last message from "
@@ -367,6 +497,22 @@ static int _tot_wait (struct timeval *start_time)
 	return msec_delay;
 }
 
+/* Return time in usec since "start time" */
+static uint32_t _tot_wait_usec(struct timeval *start_time)
+{
+	struct timeval end_time;
+	int64_t usec_delay;
+
+	gettimeofday(&end_time, NULL);
+	usec_delay  = (end_time.tv_sec - start_time->tv_sec) * 1000000;
+	usec_delay += end_time.tv_usec - start_time->tv_usec;
+	if (usec_delay < 0)
+		return 0;
+	if (usec_delay > UINT32_MAX)
+		return UINT32_MAX;
+	return (uint32_t) usec_delay;
+}
+
 /* Wait until a file is readable, return false if can not be read */
 static bool _fd_readable(slurm_fd_t fd)
 {
@@ -55,4 +55,8 @@ extern void *rpc_mgr(void *no_data);
 /* Wake up the RPC manager so that it can exit */
 extern void rpc_mgr_wake(void);
 
+/* Return the statistics of each request lane
+ * RET List of config_key_pair_t *, caller must free */
+extern List rpc_mgr_dump_stats(void);
+
 #endif /* !_RPC_MGR_H */
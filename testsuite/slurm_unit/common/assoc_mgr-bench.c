@@ -0,0 +1,171 @@
+/* Test and timing of the user and QOS lookups of src/common/assoc_mgr.c
+ *
+ * Loads USER_CNT users and QOS_CNT QOS through the update calls, as the
+ * slurmctld does when slurmdbd sends them, checks that they are found by
+ * uid, name and id, also after a rename and a remove, and then notes how
+ * many assoc_mgr_fill_in_user() by uid plus assoc_mgr_fill_in_qos() by
+ * name pairs are done per second.
+ */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "src/common/assoc_mgr.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#define USER_CNT	20000
+#define QOS_CNT		200
+#define LOOKUP_CNT	200000
+#define FIRST_UID	100000
+
+/* testsuite/dejagnu.h defines a wait() which conflicts with the one of
+ * <sys/wait.h> included by assoc_mgr.h, so report failures here
+ */
+static int failed = 0;
+
+#define TEST(_tst, _msg) do {			\
+	if (! (_tst)) {				\
+		printf("FAIL: %s\n", _msg);	\
+		failed++;			\
+	} else					\
+		printf("PASS: %s\n", _msg);	\
+} while (0)
+
+static double _now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + (tv.tv_usec / 1000000.0);
+}
+
+/* Return SLURM_SUCCESS if a user with this uid or name is cached */
+static int _find_user(uint32_t uid, char *name)
+{
+	slurmdb_user_rec_t user, *user_ptr = NULL;
+
+	memset(&user, 0, sizeof(user));
+	user.uid = uid;
+	user.name = name;
+	if (assoc_mgr_fill_in_user(NULL, &user, ACCOUNTING_ENFORCE_ASSOCS,
+				   &user_ptr) != SLURM_SUCCESS)
+		return SLURM_ERROR;
+	if ((uid != NO_VAL) && (user_ptr->uid != uid))
+		return SLURM_ERROR;
+	if (name && xstrcasecmp(user_ptr->name, name))
+		return SLURM_ERROR;
+	return SLURM_SUCCESS;
+}
+
+/* Return SLURM_SUCCESS if a QOS with this id or name is cached */
+static int _find_qos(uint32_t id, char *name)
+{
+	slurmdb_qos_rec_t qos;
+
+	memset(&qos, 0, sizeof(qos));
+	qos.id = id;
+	qos.name = name;
+	if (assoc_mgr_fill_in_qos(NULL, &qos, ACCOUNTING_ENFORCE_QOS,
+				  NULL, false) != SLURM_SUCCESS)
+		return SLURM_ERROR;
+	if (id && (qos.id != id))
+		return SLURM_ERROR;
+	return SLURM_SUCCESS;
+}
+
+int
+main(int argc, char *argv[])
+{
+	slurmdb_update_object_t update;
+	slurmdb_user_rec_t *user;
+	slurmdb_qos_rec_t *qos;
+	double start, secs;
+	int i, misses = 0;
+
+	assoc_mgr_user_list = list_create(slurmdb_destroy_user_rec);
+	assoc_mgr_qos_list = list_create(slurmdb_destroy_qos_rec);
+
+	/* Numeric names get their number as uid */
+	memset(&update, 0, sizeof(update));
+	update.type = SLURMDB_ADD_USER;
+	update.objects = list_create(slurmdb_destroy_user_rec);
+	for (i = 0; i < USER_CNT; i++) {
+		user = xmalloc(sizeof(slurmdb_user_rec_t));
+		user->name = xstrdup_printf("%d", FIRST_UID + i);
+		list_append(update.objects, user);
+	}
+	start = _now();
+	TEST(assoc_mgr_update_users(&update, false) == SLURM_SUCCESS,
+	     "add users");
+	printf("added %d users in %.3f sec\n", USER_CNT, _now() - start);
+
+	update.type = SLURMDB_ADD_QOS;
+	for (i = 0; i < QOS_CNT; i++) {
+		qos = xmalloc(sizeof(slurmdb_qos_rec_t));
+		slurmdb_init_qos_rec(qos, 0, NO_VAL);
+		qos->id = i + 1;
+		qos->name = xstrdup_printf("qos%d", i + 1);
+		list_append(update.objects, qos);
+	}
+	TEST(assoc_mgr_update_qos(&update, false) == SLURM_SUCCESS,
+	     "add QOS");
+
+	TEST(_find_user(FIRST_UID, NULL) == SLURM_SUCCESS,
+	     "first user by uid");
+	TEST(_find_user(FIRST_UID + USER_CNT - 1, NULL) == SLURM_SUCCESS,
+	     "last user by uid");
+	TEST(_find_user(NO_VAL, "112345") == SLURM_SUCCESS, "user by name");
+	TEST(_find_user(FIRST_UID + USER_CNT, NULL) != SLURM_SUCCESS,
+	     "unknown uid");
+	TEST(_find_qos(0, "qos150") == SLURM_SUCCESS, "QOS by name");
+	TEST(_find_qos(0, "QOS150") == SLURM_SUCCESS,
+	     "QOS by name in upper case");
+	TEST(_find_qos(QOS_CNT, NULL) == SLURM_SUCCESS, "QOS by id");
+	TEST(_find_qos(QOS_CNT + 1, NULL) != SLURM_SUCCESS, "unknown QOS id");
+
+	update.type = SLURMDB_MODIFY_USER;
+	user = xmalloc(sizeof(slurmdb_user_rec_t));
+	user->old_name = xstrdup("100001");
+	user->name = xstrdup("renamed");
+	user->admin_level = SLURMDB_ADMIN_NOTSET;
+	list_append(update.objects, user);
+	assoc_mgr_update_users(&update, false);
+	TEST(_find_user(NO_VAL, "renamed") == SLURM_SUCCESS,
+	     "renamed user by new name");
+	TEST(_find_user(NO_VAL, "100001") != SLURM_SUCCESS,
+	     "renamed user by old name");
+
+	update.type = SLURMDB_REMOVE_USER;
+	user = xmalloc(sizeof(slurmdb_user_rec_t));
+	user->name = xstrdup("100002");
+	list_append(update.objects, user);
+	assoc_mgr_update_users(&update, false);
+	TEST(_find_user(FIRST_UID + 2, NULL) != SLURM_SUCCESS,
+	     "removed user by uid");
+	TEST(_find_user(NO_VAL, "100002") != SLURM_SUCCESS,
+	     "removed user by name");
+	FREE_NULL_LIST(update.objects);
+
+	/* Spread the uids over the table, as job submits would */
+	start = _now();
+	for (i = 0; i < LOOKUP_CNT; i++) {
+		if (_find_user(FIRST_UID + 3 + (i * 7919) % (USER_CNT - 3),
+			       NULL) ||
+		    _find_qos(0, "qos150"))
+			misses++;
+	}
+	secs = _now() - start;
+	printf("%d user and QOS lookups in %.3f sec, %.0f/sec\n",
+	       LOOKUP_CNT, secs, LOOKUP_CNT / secs);
+	TEST(!misses, "timed lookups");
+
+	assoc_mgr_fini(NULL);
+
+	return failed ? 1 : 0;
+}
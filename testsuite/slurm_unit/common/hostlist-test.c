@@ -0,0 +1,151 @@
+/* Test of src/common/hostlist.c and the node name to bitmap translation
+ * in src/common/node_conf.c
+ */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <src/common/bitstring.h>
+#include <src/common/hostlist.h>
+#include <src/common/node_conf.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+
+/* dejagnu.h defines a wait() function, which conflicts with the one from
+ * <sys/wait.h> included through node_conf.h */
+#define wait dejagnu_wait
+#include <testsuite/dejagnu.h>
+#undef wait
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+/* Build a node table with the given names, in order */
+static void _build_nodes(char **names, int cnt)
+{
+	int i;
+
+	node_record_table_ptr = xmalloc(sizeof(struct node_record) * cnt);
+	for (i = 0; i < cnt; i++)
+		node_record_table_ptr[i].name = xstrdup(names[i]);
+	node_record_count = cnt;
+	rehash_node();
+}
+
+static void _free_nodes(void)
+{
+	int i;
+
+	for (i = 0; i < node_record_count; i++)
+		xfree(node_record_table_ptr[i].name);
+	xfree(node_record_table_ptr);
+	node_record_count = 0;
+	rehash_node();
+}
+
+/* Return the bitmap of node_names formatted as a string */
+static char *_bitmap_str(char *node_names, int *rc)
+{
+	static char buf[1024];
+	bitstr_t *bitmap = NULL;
+
+	*rc = node_name2bitmap(node_names, false, &bitmap);
+	bit_fmt(buf, sizeof(buf), bitmap);
+	FREE_NULL_BITMAP(bitmap);
+	return buf;
+}
+
+int
+main(int argc, char *argv[])
+{
+	note("Testing hostlist_nth_range");
+	{
+		hostlist_t hl = hostlist_create("nid[00001-00010,00020],login");
+		char *prefix;
+		unsigned long lo, hi;
+		int width;
+
+		TEST(hostlist_nth_range(hl, 0, &prefix, &lo, &hi, &width) == 0,
+		     "first range found");
+		TEST(!strcmp(prefix, "nid") && (lo == 1) && (hi == 10) &&
+		     (width == 5), "first range components");
+		TEST(hostlist_nth_range(hl, 1, &prefix, &lo, &hi, &width) == 0,
+		     "second range found");
+		TEST((lo == 20) && (hi == 20), "second range components");
+		TEST(hostlist_nth_range(hl, 2, &prefix, &lo, &hi, &width) == 0,
+		     "single host range found");
+		TEST(!strcmp(prefix, "login") && (width == -1),
+		     "single host range components");
+		TEST(hostlist_nth_range(hl, 3, &prefix, &lo, &hi, &width) == -1,
+		     "no range past end");
+		hostlist_destroy(hl);
+	}
+
+	note("Testing hostset_within");
+	{
+		hostset_t hs = hostset_create("nid[00001-50000],login[1-2]");
+
+		TEST(hostset_within(hs, "nid[00001-50000]"), "whole set");
+		TEST(hostset_within(hs, "nid[00100-00200,40000],login2"),
+		     "subset");
+		TEST(!hostset_within(hs, "nid[49990-50001]"), "past end");
+		TEST(!hostset_within(hs, "nid[0001-0010]"), "other width");
+		TEST(!hostset_within(hs, "login[1-3]"), "missing host");
+		hostset_destroy(hs);
+
+		hs = hostset_create("tux[1-5,7-20]");
+		TEST(hostset_within(hs, "tux[3-9]") == 0, "gap in set");
+		TEST(hostset_within(hs, "tux[1-5,7-20]"), "two set ranges");
+		hostset_destroy(hs);
+	}
+
+	note("Testing node_name2bitmap");
+	{
+		char *names[] = { "tux0", "tux1", "tux2", "tux3", "tux4",
+				  "tux5", "tux6", "tux7", "tux8", "tux9",
+				  "tux10", "tux11", "nid007", "nid008",
+				  "nid010", "nid009", "login" };
+		int rc;
+
+		_build_nodes(names, 17);
+		TEST(!strcmp(_bitmap_str("tux[0-11]", &rc), "0-11") &&
+		     (rc == 0), "natural width range");
+		TEST(!strcmp(_bitmap_str("tux[9-10]", &rc), "9-10") &&
+		     (rc == 0), "range across digit count");
+		TEST(!strcmp(_bitmap_str("nid[007-010],login", &rc),
+			     "12-16") && (rc == 0), "unordered table");
+		TEST(!strcmp(_bitmap_str("tux[09-10]", &rc), "10") &&
+		     (rc != 0), "zero padded names do not exist");
+		TEST(!strcmp(_bitmap_str("nid[7-8]", &rc), "") &&
+		     (rc != 0), "unpadded names do not exist");
+		_free_nodes();
+	}
+
+	note("Testing node_name2bitmap with mixed suffix widths");
+	{
+		char *names[] = { "a05", "a06", "a07", "a08", "a09", "a10",
+				  "a11", "a12", "a7", "a8", "a9" };
+		int rc;
+
+		_build_nodes(names, 11);
+		TEST(!strcmp(_bitmap_str("a[10-12]", &rc), "5-7") &&
+		     (rc == 0), "wide range after narrow one");
+		TEST(!strcmp(_bitmap_str("a[7-9]", &rc), "8-10") &&
+		     (rc == 0), "narrow range inside wide one");
+		TEST(!strcmp(_bitmap_str("a[07-12]", &rc), "2-7") &&
+		     (rc == 0), "padded range");
+		_free_nodes();
+	}
+
+	totals();
+	return failed;
+}
@@ -0,0 +1,172 @@
+/* Test of src/common/list.c, including the per-thread object caches
+ */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <src/common/list.h>
+#include <src/common/xmalloc.h>
+
+#include <testsuite/dejagnu.h>
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+#define THREAD_CNT	8
+#define ITEM_CNT	100000
+
+static List shared_list = NULL;
+
+static void _free_int(void *x)
+{
+	xfree(x);
+}
+
+static int _find_int(void *x, void *key)
+{
+	return (*(int *) x == *(int *) key);
+}
+
+/* Build and tear down many short lists, each with its own iterator */
+static void *_churn(void *arg)
+{
+	long sum = 0;
+	int i, j, *x;
+	List l;
+	ListIterator itr;
+
+	for (i = 0; i < ITEM_CNT / 10; i++) {
+		l = list_create(_free_int);
+		for (j = 0; j < 10; j++) {
+			x = xmalloc(sizeof(int));
+			*x = j;
+			list_append(l, x);
+		}
+		itr = list_iterator_create(l);
+		while ((x = list_next(itr)))
+			sum += *x;
+		list_iterator_destroy(itr);
+		list_destroy(l);
+	}
+
+	return (void *) sum;
+}
+
+/* Move items into the shared list, so that the nodes allocated here are
+ * freed by other threads */
+static void *_produce(void *arg)
+{
+	int i, *x;
+
+	for (i = 0; i < ITEM_CNT; i++) {
+		x = xmalloc(sizeof(int));
+		*x = 1;
+		list_enqueue(shared_list, x);
+	}
+
+	return NULL;
+}
+
+static void *_consume(void *arg)
+{
+	long got = 0;
+	int *x;
+
+	while (got < ITEM_CNT) {
+		if ((x = list_dequeue(shared_list))) {
+			got += *x;
+			xfree(x);
+		}
+	}
+
+	return (void *) got;
+}
+
+static double _elapsed(struct timeval *start)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return (now.tv_sec - start->tv_sec) +
+	       (now.tv_usec - start->tv_usec) / 1000000.0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	pthread_t tid[THREAD_CNT];
+	struct timeval start;
+	char msg[128];
+	void *rc;
+	long sum;
+	int i, key, *x;
+
+	note("Testing basic list operations");
+	{
+		List l = list_create(_free_int);
+
+		for (i = 0; i < 5; i++) {
+			x = xmalloc(sizeof(int));
+			*x = i;
+			list_append(l, x);
+		}
+		TEST(list_count(l) == 5, "list_count");
+		key = 3;
+		TEST(list_find_first(l, _find_int, &key), "list_find_first");
+		TEST(list_delete_all(l, _find_int, &key) == 1,
+		     "list_delete_all");
+		x = list_pop(l);
+		TEST(x && (*x == 0), "list_pop");
+		xfree(x);
+		TEST(list_count(l) == 3, "list_count after removal");
+		list_destroy(l);
+	}
+
+	note("Testing lists created and destroyed by many threads");
+	gettimeofday(&start, NULL);
+	for (i = 0; i < THREAD_CNT; i++)
+		pthread_create(&tid[i], NULL, _churn, NULL);
+	for (i = 0, sum = 0; i < THREAD_CNT; i++) {
+		pthread_join(tid[i], &rc);
+		sum += (long) rc;
+	}
+	TEST(sum == (long) THREAD_CNT * (ITEM_CNT / 10) * 45,
+	     "threaded list churn");
+	snprintf(msg, sizeof(msg), "%d threads churned %d lists in %.3f sec",
+		 THREAD_CNT, THREAD_CNT * (ITEM_CNT / 10), _elapsed(&start));
+	note(msg);
+
+	note("Testing list nodes freed by other threads");
+	shared_list = list_create(NULL);
+	gettimeofday(&start, NULL);
+	for (i = 0; i < THREAD_CNT; i++) {
+		if (i % 2)
+			pthread_create(&tid[i], NULL, _consume, NULL);
+		else
+			pthread_create(&tid[i], NULL, _produce, NULL);
+	}
+	for (i = 0, sum = 0; i < THREAD_CNT; i++) {
+		pthread_join(tid[i], &rc);
+		sum += (long) rc;
+	}
+	TEST((sum == (long) (THREAD_CNT / 2) * ITEM_CNT) &&
+	     (list_count(shared_list) == 0), "producer/consumer queue");
+	snprintf(msg, sizeof(msg), "%d threads passed %d items in %.3f sec",
+		 THREAD_CNT, (THREAD_CNT / 2) * ITEM_CNT, _elapsed(&start));
+	note(msg);
+	list_destroy(shared_list);
+
+	totals();
+	return failed;
+}
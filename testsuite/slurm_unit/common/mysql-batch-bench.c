@@ -0,0 +1,197 @@
+/* Benchmark of step start inserts with src/database/mysql_common.c
+ *
+ * This needs a MySQL or MariaDB server, so "make check" only builds it.
+ * Run it by hand:
+ *	mysql-batch-bench [-h host] [-P port] [-u user] [-p password]
+ *			  [-d database] [-n rows]
+ * The database is created if needed. Its bench_step_table, which has the
+ * key and the columns of a step table that a step start sets, is created
+ * again for each way of inserting the rows:
+ *	row/commit - one insert per row, committed after each row, which is
+ *		     how slurmdbd handled a DBD_SEND_MULT_MSG before
+ *	row/batch  - one insert per row, committed every BATCH_ROWS rows as
+ *		     slurmdbd now commits each DBD_SEND_MULT_MSG
+ *	multi/batch - mysql_db_batch_insert() rows, committed every
+ *		     BATCH_ROWS rows, as as_mysql_step_start() now does
+ */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+#include "src/database/mysql_common.h"
+
+#define BATCH_ROWS 1000		/* MAX_AGENT_BATCH_CNT of the dbd agent */
+
+enum {
+	ROW_COMMIT,
+	ROW_BATCH,
+	MULTI_BATCH,
+	MODE_CNT
+};
+
+static char *mode_names[] = { "row/commit", "row/batch", "multi/batch" };
+
+static char *create_query =
+	"create table bench_step_table ("
+	"job_db_inx int unsigned not null, "
+	"id_step int not null, "
+	"time_start int unsigned default 0 not null, "
+	"time_end int unsigned default 0 not null, "
+	"step_name text not null, "
+	"state smallint unsigned not null, "
+	"tres_alloc text not null, "
+	"nodes_alloc int unsigned not null, "
+	"task_cnt int unsigned not null, "
+	"nodelist text not null, "
+	"node_inx text, "
+	"task_dist smallint default 0 not null, "
+	"req_cpufreq int unsigned default 0 not null, "
+	"req_cpufreq_min int unsigned default 0 not null, "
+	"req_cpufreq_gov int unsigned default 0 not null, "
+	"primary key (job_db_inx, id_step)) engine='innodb'";
+
+static char *insert_prefix =
+	"insert into bench_step_table (job_db_inx, id_step, time_start, "
+	"step_name, state, tres_alloc, nodes_alloc, task_cnt, nodelist, "
+	"node_inx, task_dist, req_cpufreq, req_cpufreq_min, "
+	"req_cpufreq_gov) values ";
+
+/* as step_start_dup in as_mysql_job.c */
+static char *insert_suffix =
+	" on duplicate key update "
+	"nodes_alloc=VALUES(nodes_alloc), task_cnt=VALUES(task_cnt), "
+	"time_end=0, state=VALUES(state), "
+	"nodelist=VALUES(nodelist), node_inx=VALUES(node_inx), "
+	"task_dist=VALUES(task_dist), req_cpufreq=VALUES(req_cpufreq), "
+	"req_cpufreq_min=VALUES(req_cpufreq_min), "
+	"req_cpufreq_gov=VALUES(req_cpufreq_gov), "
+	"tres_alloc=VALUES(tres_alloc)";
+
+static double _now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + (tv.tv_usec / 1000000.0);
+}
+
+/* Insert rows into a new table
+ * RET seconds taken, or -1 on error */
+static double _run(mysql_conn_t *mysql_conn, int mode, int rows)
+{
+	char *query, *row;
+	double start;
+	int i, rc = SLURM_SUCCESS;
+
+	if (mysql_db_query(mysql_conn, "drop table if exists bench_step_table")
+	    || mysql_db_query(mysql_conn, create_query)
+	    || mysql_db_commit(mysql_conn))
+		return -1;
+
+	start = _now();
+	for (i = 0; (i < rows) && (rc == SLURM_SUCCESS); i++) {
+		row = xstrdup_printf("%d, %d, %d, 'bench', 1, '1=16,2=32000', "
+				     "1, 16, 'node%04d', '%d', 1, 0, 0, 0",
+				     (i / 4) + 1, i % 4, (int) time(NULL),
+				     i % 1000, i % 1000);
+		if (mode == MULTI_BATCH) {
+			rc = mysql_db_batch_insert(mysql_conn, insert_prefix,
+						   row, insert_suffix);
+		} else {
+			query = xstrdup_printf("%s(%s)%s", insert_prefix, row,
+					       insert_suffix);
+			rc = mysql_db_query(mysql_conn, query);
+			xfree(query);
+		}
+		xfree(row);
+
+		if ((rc == SLURM_SUCCESS) &&
+		    ((mode == ROW_COMMIT) || !((i + 1) % BATCH_ROWS)))
+			rc = mysql_db_commit(mysql_conn);
+	}
+	if (rc == SLURM_SUCCESS)
+		rc = mysql_db_commit(mysql_conn);
+	if (rc != SLURM_SUCCESS)
+		return -1;
+
+	return _now() - start;
+}
+
+int
+main(int argc, char *argv[])
+{
+	mysql_db_info_t db_info;
+	mysql_conn_t *mysql_conn;
+	char *db_name = "slurm_bench";
+	double secs;
+	int c, mode, rows = 100000, rc = 0;
+
+	memset(&db_info, 0, sizeof(db_info));
+	db_info.host = "localhost";
+	db_info.port = 3306;
+	db_info.user = getenv("USER");
+	while ((c = getopt(argc, argv, "d:h:n:p:P:u:")) != -1) {
+		switch (c) {
+		case 'd':
+			db_name = optarg;
+			break;
+		case 'h':
+			db_info.host = optarg;
+			break;
+		case 'n':
+			rows = atoi(optarg);
+			break;
+		case 'p':
+			db_info.pass = optarg;
+			break;
+		case 'P':
+			db_info.port = atoi(optarg);
+			break;
+		case 'u':
+			db_info.user = optarg;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-h host] [-P port] "
+				"[-u user] [-p password] [-d database] "
+				"[-n rows]\n", argv[0]);
+			exit(1);
+		}
+	}
+
+	/* rollback, so that inserts are only committed with a commit */
+	mysql_conn = create_mysql_conn(0, true, NULL);
+	if (mysql_db_get_db_connection(mysql_conn, db_name, &db_info)
+	    != SLURM_SUCCESS) {
+		fprintf(stderr, "Can't connect to database %s on %s:%u\n",
+			db_name, db_info.host, db_info.port);
+		exit(1);
+	}
+
+	for (mode = 0; mode < MODE_CNT; mode++) {
+		if ((secs = _run(mysql_conn, mode, rows)) < 0) {
+			fprintf(stderr, "%s: insert failed: %s\n",
+				mode_names[mode],
+				mysql_error(mysql_conn->db_conn));
+			rc = 1;
+			continue;
+		}
+		printf("%-12s %8d rows %8.3f sec %10.0f rows/sec\n",
+		       mode_names[mode], rows, secs, rows / secs);
+	}
+
+	(void) mysql_db_query(mysql_conn, "drop table bench_step_table");
+	(void) mysql_db_commit(mysql_conn);
+	destroy_mysql_conn(mysql_conn);
+	mysql_db_cleanup();
+
+	return rc;
+}
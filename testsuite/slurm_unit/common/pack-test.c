@@ -15,6 +15,7 @@
 
 #include <src/common/pack.h>
 #include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
 
 #include <testsuite/dejagnu.h>
 
@@ -92,6 +93,36 @@ int main (int argc, char *argv[])
 
 	xfree(outstring);
 
+	free_buf(buffer);
+
+	buffer = init_buf(0);
+	packstr(teststring, buffer);
+	packstr(teststring, buffer);
+	set_buf_offset(buffer, 0);
+	buffer->arena = xarena_create();
+	{
+		xarena_t *arena = buffer->arena;
+		char *arenastr;
+
+		unpackstr_xmalloc(&arenastr, &byte_cnt, buffer);
+		TEST(strcmp(teststring, arenastr) != 0,
+		     "un/packstr_xmalloc into arena");
+		TEST(xarena_find(arenastr) != arena,
+		     "xarena_find of arena string");
+		TEST(xsize(arenastr) != byte_cnt, "xsize of arena string");
+		xfree(arenastr);
+		TEST(arenastr != NULL, "xfree of arena string");
+
+		unpackstr_xmalloc(&arenastr, &byte_cnt, buffer);
+		xstrcat(arenastr, "!");
+		TEST(xarena_find(arenastr) != NULL,
+		     "xrealloc moves arena string to heap");
+		TEST(strncmp(teststring, arenastr, strlen(teststring)) != 0,
+		     "xrealloc of arena string keeps contents");
+		xfree(arenastr);
+		xarena_destroy(arena);
+	}
+	buffer->arena = NULL;
 	free_buf(buffer);
 	totals();
 	return failed;
@@ -0,0 +1,74 @@
+/* Test of src/common/sha256.c, with the test vectors of FIPS 180-2
+ */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <src/common/sha256.h>
+
+#include <testsuite/dejagnu.h>
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+/* Return the digest formatted in hex */
+static char *_hex(uint8_t *digest)
+{
+	static char buf[SHA256_LEN * 2 + 1];
+	int i;
+
+	for (i = 0; i < SHA256_LEN; i++)
+		sprintf(buf + (i * 2), "%02x", digest[i]);
+	return buf;
+}
+
+int
+main(int argc, char *argv[])
+{
+	uint8_t digest[SHA256_LEN];
+	sha256_ctx_t ctx;
+	char *data;
+	int i;
+
+	note("Testing sha256");
+	sha256("", 0, digest);
+	TEST(!strcmp(_hex(digest), "e3b0c44298fc1c149afbf4c8996fb924"
+				   "27ae41e4649b934ca495991b7852b855"),
+	     "empty message");
+
+	sha256("abc", 3, digest);
+	TEST(!strcmp(_hex(digest), "ba7816bf8f01cfea414140de5dae2223"
+				   "b00361a396177a9cb410ff61f20015ad"),
+	     "one block message");
+
+	data = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+	sha256(data, strlen(data), digest);
+	TEST(!strcmp(_hex(digest), "248d6a61d20638b8e5c026930c3e6039"
+				   "a33ce45964ff2167f6ecedd419db06c1"),
+	     "two block message");
+
+	/* Also hashes the data in pieces which do not fill a block */
+	data = malloc(1001);
+	memset(data, 'a', 1001);
+	sha256_init(&ctx);
+	for (i = 0; i < 1000; i++)
+		sha256_update(&ctx, data, (i % 2) ? 999 : 1001);
+	sha256_final(&ctx, digest);
+	TEST(!strcmp(_hex(digest), "cdc76e5c9914fb9281a1c7e284d73e67"
+				   "f1809a48a497200e046d39ccc7112cd0"),
+	     "long message in pieces");
+	free(data);
+
+	totals();
+	return failed;
+}